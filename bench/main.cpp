@@ -0,0 +1,722 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        main.cpp
+ * \brief       The benchmark suite of \p libiban
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This file contains the microbenchmarks of \p libiban and the entry point for
+ * \p Google \p Benchmark. The benchmarks run on a corpus mixing countries
+ * roughly like real payment data, with a share of invalid records. Besides the
+ * time per iteration, every benchmark reports the records processed per second
+ * and the time per record.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+#include "../src/libiban.h"
+#include "../src/arena.h"
+#include "../src/bankdirectory.h"
+#include "../src/bulk.h"
+#include "../src/column.h"
+#include "../src/correction.h"
+#include "../src/countrytable.h"
+#include "../src/file.h"
+#include "../src/filter.h"
+#include "../src/generator.h"
+#include "../src/ibanset.h"
+#include "../src/literal.h"
+#include "../src/normalize.h"
+#include "../src/prefixindex.h"
+#include "../src/scanner.h"
+#include "../src/service.h"
+#include "../src/stats.h"
+#include "../src/utils.h"
+
+namespace {
+    /// Number of records of the corpus
+    constexpr size_t corpusSize = 8192;
+    /// Every n-th record of the corpus is invalid
+    constexpr size_t invalidEvery = 20;
+
+    /// Countries of the corpus and their relative frequencies
+    const std::pair<const char*, unsigned> countryMix[] = {
+        {"DE", 30}, {"FR", 15}, {"GB", 12}, {"IT", 10}, {"ES", 9}, {"NL", 7}, {"BE", 4},
+        {"AT", 3}, {"CH", 3}, {"PL", 2}, {"SE", 1}, {"NO", 1}, {"MT", 1}, {"LC", 1}, {"LU", 1}
+    };
+
+    /// The corpus in its different representations
+    struct Corpus {
+        std::vector<std::string> machineForms;
+        std::vector<std::string> humanReadable;
+        std::vector<IBAN::IBAN> ibans;
+        std::vector<std::string> numerical;
+        std::vector<const char*> pointers;
+        std::vector<uint8_t> lengths;
+        std::string lines;
+
+        Corpus() {
+            unsigned total = 0;
+            for (const auto& country : countryMix) {
+                total += country.second;
+            }
+            for (size_t i = 0; i < corpusSize; ++i) {
+                // pick the countries in a fixed, interleaved order
+                unsigned slot = static_cast<unsigned>((i * 7919) % total);
+                const char* country = countryMix[0].first;
+                for (const auto& entry : countryMix) {
+                    if (slot < entry.second) {
+                        country = entry.first;
+                        break;
+                    }
+                    slot -= entry.second;
+                }
+                auto iban = IBAN::IBAN::generateIBAN(country);
+                std::string machineForm = iban.getMachineForm();
+                if (i % invalidEvery == 0) {
+                    machineForm[2] = machineForm[2] == '9' ? '0' : static_cast<char>(machineForm[2] + 1);
+                }
+                machineForms.push_back(machineForm);
+                ibans.push_back(IBAN::IBAN::createFromString(machineForm));
+                humanReadable.push_back(ibans.back().getHumanReadable());
+            }
+            for (const auto& machineForm : machineForms) {
+                pointers.push_back(machineForm.data());
+                lengths.push_back(static_cast<uint8_t>(machineForm.size()));
+                numerical.push_back(makeNumerical(machineForm.substr(4) + machineForm.substr(0, 4)));
+                lines += machineForm + "\n";
+            }
+        }
+    };
+
+    const Corpus& getCorpus() {
+        static const Corpus corpus;
+        return corpus;
+    }
+
+    /// Reports \p records processed records per iteration
+    void reportRecords(benchmark::State& state, size_t records) {
+        const double processed = static_cast<double>(records);
+        state.counters["records/s"] = benchmark::Counter(processed, benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["s/record"] = benchmark::Counter(processed, benchmark::Counter::kIsIterationInvariantRate |
+                                                                   benchmark::Counter::kInvert);
+    }
+
+    void BM_createFromString(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::IBAN::createFromString(corpus.humanReadable[i++ % corpusSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_createFromString);
+
+    void BM_IBANVector(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        IBAN::MonotonicArena arena(corpusSize * sizeof(IBAN::IBAN) + 1024);
+        for (auto _ : state) {
+            {
+                // allocators do not propagate on assignment, so pick the resource up front
+                IBAN::IBANVector batch(state.range(0) ? IBAN::MemoryResource::getDefault() : &arena);
+                batch.reserve(corpusSize);
+                for (const auto& str : corpus.humanReadable) {
+                    batch.push_back(IBAN::IBAN::createFromString(str));
+                }
+                benchmark::DoNotOptimize(batch.data());
+            }
+            arena.release();
+        }
+        reportRecords(state, corpusSize);
+    }
+    // 0: arena, 1: default resource
+    BENCHMARK(BM_IBANVector)->Arg(0)->Arg(1);
+
+    void BM_validate(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(corpus.ibans[i++ % corpusSize].validate());
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_validate);
+
+    void BM_getHumanReadable(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(corpus.ibans[i++ % corpusSize].getHumanReadable());
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_getHumanReadable);
+
+    void BM_formatHumanReadable(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        char buffer[IBAN::maxHumanReadableLength];
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(corpus.ibans[i++ % corpusSize].formatHumanReadable(buffer, sizeof(buffer)));
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_formatHumanReadable);
+
+    void BM_getMachineForm(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(corpus.ibans[i++ % corpusSize].getMachineForm());
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_getMachineForm);
+
+    void BM_generateIBAN(benchmark::State& state) {
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::IBAN::generateIBAN(countryMix[i++ % 15].first));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_generateIBAN);
+
+    void BM_IBANGenerator(benchmark::State& state) {
+        std::vector<IBAN::CountryWeight> mix;
+        for (const auto& country : countryMix) {
+            mix.push_back({country.first, country.second});
+        }
+        IBAN::IBANGenerator generator(42);
+        std::vector<IBAN::CompactIBAN> ibans(corpusSize);
+        for (auto _ : state) {
+            generator.generate(mix, ibans.data(), ibans.size());
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_IBANGenerator);
+
+    void BM_generateRange(benchmark::State& state) {
+        std::vector<IBAN::CompactIBAN> ibans(corpusSize);
+        for (auto _ : state) {
+            IBAN::generateRange("DE", "37040044", 0, ibans.size(), ibans.data());
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_generateRange);
+
+    void BM_makeNumerical(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(makeNumerical(corpus.machineForms[i++ % corpusSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_makeNumerical);
+
+    void BM_getReminderForIBANString(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(getReminderForIBANString(corpus.numerical[i++ % corpusSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_getReminderForIBANString);
+
+    void BM_getRemainderForIBAN(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            const auto& machineForm = corpus.machineForms[i++ % corpusSize];
+            benchmark::DoNotOptimize(getRemainderForIBAN(machineForm.data(), machineForm.size()));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_getRemainderForIBAN);
+
+    void BM_tryParse(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::IBAN::tryParse(corpus.humanReadable[i++ % corpusSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_tryParse);
+
+    void BM_tryParse_countryTable(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        IBAN::CountryTableBuilder builder;
+        builder.addCompiledIn();
+        IBAN::setCountryTable(IBAN::CountryTable::fromBuffer(builder.build()));
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::IBAN::tryParse(corpus.humanReadable[i++ % corpusSize]));
+        }
+        IBAN::setCountryTable(nullptr);
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_tryParse_countryTable);
+
+    void BM_normalizeIBAN(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        char machineForm[IBAN::maxIBANLength];
+        size_t length = 0;
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::normalizeIBAN(corpus.humanReadable[i++ % corpusSize],
+                                                         machineForm, &length));
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_normalizeIBAN);
+
+    // pasted input: a prefix, lowercase letters and no-break spaces
+    void BM_normalizeIBAN_unicode(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        std::vector<std::string> inputs;
+        for (const auto& humanReadable : corpus.humanReadable) {
+            std::string input = "IBAN: ";
+            for (const char ch : humanReadable) {
+                if (ch == ' ') {
+                    input += "\xC2\xA0";
+                } else {
+                    input += static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+                }
+            }
+            inputs.push_back(input);
+        }
+        char machineForm[IBAN::maxIBANLength];
+        size_t length = 0;
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::normalizeIBAN(inputs[i++ % corpusSize], machineForm, &length));
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_normalizeIBAN_unicode);
+
+    void BM_CompactIBAN_tryParse(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        IBAN::CompactIBAN compact;
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::CompactIBAN::tryParse(corpus.machineForms[i++ % corpusSize], compact));
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_CompactIBAN_tryParse);
+
+    // the constexpr parser evaluated at runtime, as for literals outside of
+    // constant expressions before C++20
+    void BM_parseConstant(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::getConstantStatus(corpus.machineForms[i++ % corpusSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_parseConstant);
+
+    void BM_PackedIBAN_roundTrip(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        IBAN::PackedIBAN packed;
+        IBAN::CompactIBAN compact;
+        size_t i = 0;
+        for (auto _ : state) {
+            IBAN::PackedIBAN::pack(corpus.machineForms[i++ % corpusSize], packed);
+            benchmark::DoNotOptimize(packed.unpack(compact));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_PackedIBAN_roundTrip);
+
+    void BM_lookupBank(benchmark::State& state) {
+        // a directory of the size of the Bundesbank's Bankleitzahlen file
+        constexpr size_t bankCount = 16384;
+        IBAN::BankDirectoryBuilder builder;
+        std::vector<IBAN::CompactIBAN> ibans(1024);
+        char bankCode[9];
+        for (size_t i = 0; i < bankCount; ++i) {
+            std::snprintf(bankCode, sizeof(bankCode), "%08zu", 10000000 + i * 37);
+            builder.add("DE", bankCode, "", "COBADEFFXXX", "Bank " + std::to_string(i));
+            if (i % (bankCount / ibans.size()) == 0) {
+                IBAN::generateRange("DE", bankCode, i, 1, &ibans[i / (bankCount / ibans.size())]);
+            }
+        }
+        IBAN::setBankDirectory(IBAN::BankDirectory::fromBuffer(builder.build()));
+        IBAN::BankInfo info;
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::lookupBank(ibans[(i++ * 7919) % ibans.size()], info));
+        }
+        reportRecords(state, 1);
+        IBAN::setBankDirectory(std::unique_ptr<IBAN::BankDirectory>());
+    }
+    BENCHMARK(BM_lookupBank);
+
+    /// Number of IBANs of the prefix index
+    constexpr size_t indexSize = 1 << 20;
+
+    /// Returns the IBANs of the prefix index, mixing the countries like the corpus
+    const std::vector<IBAN::CompactIBAN>& getIndexIBANs() {
+        static const std::vector<IBAN::CompactIBAN> ibans = []() {
+            std::vector<IBAN::CountryWeight> mix;
+            for (const auto& country : countryMix) {
+                mix.push_back({country.first, country.second});
+            }
+            std::vector<IBAN::CompactIBAN> result(indexSize);
+            IBAN::IBANGenerator(1).generate(mix, result.data(), result.size());
+            return result;
+        }();
+        return ibans;
+    }
+
+    /// Returns the prefix index over \p getIndexIBANs()
+    const IBAN::PrefixIndex& getPrefixIndex() {
+        static const std::unique_ptr<IBAN::PrefixIndex> index = []() {
+            IBAN::PrefixIndexBuilder builder;
+            builder.add(getIndexIBANs().data(), indexSize);
+            return IBAN::PrefixIndex::fromBuffer(builder.build());
+        }();
+        return *index;
+    }
+
+    void BM_PrefixIndex_build(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        for (auto _ : state) {
+            IBAN::PrefixIndexBuilder builder;
+            builder.add(ibans.data(), ibans.size());
+            benchmark::DoNotOptimize(builder.build());
+        }
+        reportRecords(state, indexSize);
+    }
+    BENCHMARK(BM_PrefixIndex_build)->Unit(benchmark::kMillisecond);
+
+    void BM_PrefixIndex_contains(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        const auto& index = getPrefixIndex();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(index.contains(ibans[(i++ * 7919) % indexSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_PrefixIndex_contains);
+
+    void BM_PrefixIndex_findPrefix(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        const auto& index = getPrefixIndex();
+        size_t i = 0;
+        for (auto _ : state) {
+            // country code, check digits and the first four characters of the BBAN
+            const IBAN::StringView machineForm = ibans[(i++ * 7919) % indexSize].getMachineForm();
+            benchmark::DoNotOptimize(index.findPrefix(IBAN::StringView(machineForm.data(), 8)));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_PrefixIndex_findPrefix);
+
+    void BM_PrefixIndex_findBank(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        const auto& index = getPrefixIndex();
+        size_t i = 0;
+        for (auto _ : state) {
+            const IBAN::CompactIBAN& iban = ibans[(i++ * 7919) % indexSize];
+            benchmark::DoNotOptimize(index.findBank(iban.getCountryCode(), iban.getBankCode()));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_PrefixIndex_findBank);
+
+    /// Returns the filter over \p getIndexIBANs()
+    const IBAN::IBANFilter& getIBANFilter() {
+        static const std::unique_ptr<IBAN::IBANFilter> filter = []() {
+            IBAN::IBANFilterBuilder builder;
+            builder.add(getIndexIBANs().data(), indexSize);
+            return IBAN::IBANFilter::fromBuffer(builder.build());
+        }();
+        return *filter;
+    }
+
+    void BM_IBANFilter_build(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        for (auto _ : state) {
+            IBAN::IBANFilterBuilder builder;
+            builder.add(ibans.data(), ibans.size());
+            benchmark::DoNotOptimize(builder.build());
+        }
+        reportRecords(state, indexSize);
+    }
+    BENCHMARK(BM_IBANFilter_build)->Unit(benchmark::kMillisecond);
+
+    void BM_IBANFilter_contains(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        const auto& filter = getIBANFilter();
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(filter.contains(ibans[(i++ * 7919) % indexSize]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_IBANFilter_contains);
+
+    void BM_IBANFilter_containsBatch(benchmark::State& state) {
+        const auto& ibans = getIndexIBANs();
+        const auto& filter = getIBANFilter();
+        std::vector<IBAN::CompactIBAN> batch(1024);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i] = ibans[(i * 7919) % indexSize];
+        }
+        std::vector<uint8_t> results(batch.size());
+        for (auto _ : state) {
+            filter.containsBatch(batch.data(), batch.size(), results.data());
+            benchmark::DoNotOptimize(results.data());
+        }
+        reportRecords(state, batch.size());
+    }
+    BENCHMARK(BM_IBANFilter_containsBatch);
+
+    /// Returns \p count IBANs with consecutive account numbers
+    std::vector<IBAN::CompactIBAN> getConsecutiveIBANs(size_t count) {
+        std::vector<IBAN::CompactIBAN> ibans(count);
+        IBAN::generateRange("DE", "37040044", 0, count, ibans.data());
+        return ibans;
+    }
+
+    void BM_IBANSet_insert(benchmark::State& state) {
+        const auto ibans = getConsecutiveIBANs(static_cast<size_t>(state.range(0)));
+        size_t memory = 0;
+        for (auto _ : state) {
+            IBAN::IBANSet set;
+            for (const auto& iban : ibans) {
+                set.insert(iban);
+            }
+            memory = set.getMemoryUsage();
+            benchmark::DoNotOptimize(set.size());
+        }
+        reportRecords(state, ibans.size());
+        state.counters["bytes/IBAN"] = static_cast<double>(memory) / ibans.size();
+    }
+    BENCHMARK(BM_IBANSet_insert)->Arg(1 << 16)->Arg(1 << 20);
+
+    void BM_unorderedSet_insert(benchmark::State& state) {
+        const auto ibans = getConsecutiveIBANs(static_cast<size_t>(state.range(0)));
+        for (auto _ : state) {
+            std::unordered_set<std::string> set;
+            for (const auto& iban : ibans) {
+                set.insert(iban.getMachineForm().toString());
+            }
+            benchmark::DoNotOptimize(set.size());
+        }
+        reportRecords(state, ibans.size());
+    }
+    BENCHMARK(BM_unorderedSet_insert)->Arg(1 << 16)->Arg(1 << 20);
+
+    void BM_IBANSet_contains(benchmark::State& state) {
+        const auto ibans = getConsecutiveIBANs(static_cast<size_t>(state.range(0)));
+        IBAN::IBANSet set;
+        for (size_t i = 0; i < ibans.size(); i += 2) {
+            set.insert(ibans[i]);
+        }
+        size_t i = 0;
+        for (auto _ : state) {
+            // walk the IBANs in a scattered order, half of them are contained
+            benchmark::DoNotOptimize(set.contains(ibans[(i++ * 7919) % ibans.size()]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_IBANSet_contains)->Arg(1 << 16)->Arg(1 << 20);
+
+    void BM_unorderedSet_contains(benchmark::State& state) {
+        const auto ibans = getConsecutiveIBANs(static_cast<size_t>(state.range(0)));
+        std::vector<std::string> strings;
+        for (const auto& iban : ibans) {
+            strings.push_back(iban.getMachineForm().toString());
+        }
+        std::unordered_set<std::string> set;
+        for (size_t i = 0; i < strings.size(); i += 2) {
+            set.insert(strings[i]);
+        }
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(set.count(strings[(i++ * 7919) % strings.size()]));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_unorderedSet_contains)->Arg(1 << 16)->Arg(1 << 20);
+
+    void BM_suggestCorrections(benchmark::State& state) {
+        const size_t maxEdits = static_cast<size_t>(state.range(0));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::suggestCorrections("DE89370400440532013001", maxEdits));
+        }
+        reportRecords(state, 1);
+    }
+    BENCHMARK(BM_suggestCorrections)->Arg(1)->Arg(2);
+
+    void BM_validateBatch(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        const auto kernel = static_cast<IBAN::BatchKernel>(state.range(0));
+        std::vector<uint8_t> results(corpusSize);
+        for (auto _ : state) {
+            IBAN::validateBatch(corpus.pointers.data(), corpus.lengths.data(), corpusSize,
+                                results.data(), kernel);
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_validateBatch)
+            ->Arg(static_cast<int>(IBAN::BatchKernel::Scalar))
+            ->Arg(static_cast<int>(IBAN::BatchKernel::SSE42))
+            ->Arg(static_cast<int>(IBAN::BatchKernel::AVX2));
+
+    void BM_validateBatch_national(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        std::vector<uint8_t> results(corpusSize);
+        for (auto _ : state) {
+            IBAN::validateBatch(corpus.pointers.data(), corpus.lengths.data(), corpusSize,
+                                results.data(), IBAN::BatchKernel::Auto, true);
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_validateBatch_national);
+
+    void BM_IBANColumn_fromBuffer(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::IBANColumn::fromBuffer(corpus.lines.data(), corpus.lines.size()));
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_IBANColumn_fromBuffer);
+
+    void BM_IBANColumn_validate(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        const auto column = IBAN::IBANColumn::fromBuffer(corpus.lines.data(), corpus.lines.size());
+        std::vector<uint8_t> results(column.size());
+        for (auto _ : state) {
+            column.validate(results.data());
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_IBANColumn_validate);
+
+    void BM_BulkValidator(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        IBAN::BulkValidator validator(static_cast<size_t>(state.range(0)));
+        std::vector<uint8_t> results;
+        for (auto _ : state) {
+            validator.validate(corpus.lines.data(), corpus.lines.size(), results);
+            benchmark::ClobberMemory();
+        }
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_BulkValidator)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+    void BM_validateFile(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        const std::string path = "libiban_bench_records.txt";
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << corpus.lines;
+        }
+        IBAN::FileValidationResult result;
+        for (auto _ : state) {
+            IBAN::validateFile(path, result);
+            benchmark::ClobberMemory();
+        }
+        std::remove(path.c_str());
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_validateFile);
+
+    void BM_IBANScanner(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        // payment references with one IBAN each, half of them grouped
+        std::string text;
+        for (size_t i = 0; i < corpusSize; ++i) {
+            text += "<RmtInf><Ustrd>Invoice 2017-" + std::to_string(i) + " to ";
+            text += i % 2 ? corpus.humanReadable[i] : corpus.machineForms[i];
+            text += "</Ustrd></RmtInf>\n";
+        }
+        size_t found = 0;
+        IBAN::IBANScanner scanner([&found](const IBAN::IBANMatch&) { ++found; });
+        for (auto _ : state) {
+            scanner.feed(text);
+            scanner.finish();
+        }
+        benchmark::DoNotOptimize(found);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+        reportRecords(state, corpusSize);
+    }
+    BENCHMARK(BM_IBANScanner);
+
+    void BM_ValidationService(benchmark::State& state) {
+        const auto& corpus = getCorpus();
+        const size_t jobSize = static_cast<size_t>(state.range(0));
+        const size_t jobs = corpusSize / jobSize;
+        std::vector<std::vector<std::string>> requests(jobs);
+        for (size_t i = 0; i < jobs * jobSize; ++i) {
+            requests[i / jobSize].push_back(corpus.machineForms[i]);
+        }
+        IBAN::ValidationService service;
+        std::vector<std::future<std::vector<IBAN::ParseStatus>>> futures(jobs);
+        for (auto _ : state) {
+            for (size_t i = 0; i < jobs; ++i) {
+                futures[i] = service.submit(requests[i]);
+            }
+            for (auto& future : futures) {
+                benchmark::DoNotOptimize(future.get());
+            }
+        }
+        reportRecords(state, jobs * jobSize);
+    }
+    // IBANs per job
+    BENCHMARK(BM_ValidationService)->Arg(1)->Arg(100)->UseRealTime();
+
+    void BM_getStats(benchmark::State& state) {
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(IBAN::getStats().getCalls(IBAN::StatsOperation::Validate));
+        }
+    }
+    BENCHMARK(BM_getStats);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,720 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        main.cpp
+ * \brief       The end-to-end performance tool of \p libiban
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This file contains \p libiban_perf, which measures the throughput of every
+ * validation mode on a generated corpus and writes the results as JSON, so
+ * runs can be compared across versions and machines. The corpus only depends
+ * on the options: the same seed always yields the same records. Besides the
+ * records and bytes per second, the tool reports the heap allocations per
+ * record and, on Linux, the hardware counters of the threads involved.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/libiban.h"
+#include "../src/bulk.h"
+#include "../src/file.h"
+#include "../src/generator.h"
+
+#ifdef __linux__
+#define LIBIBAN_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define LIBIBAN_PERF_EVENTS 0
+#endif
+
+namespace {
+    /// Number of heap allocations of the process so far
+    std::atomic<uint64_t> allocationCount(0);
+}
+
+// count the allocations of the tool and of the library
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC takes the inlined replacements for a mismatch of new and free()
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept {
+    ::operator delete(pointer);
+}
+
+// the sized forms the compiler calls with -fsized-deallocation (C++14 and later)
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* pointer, size_t) noexcept {
+    ::operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    ::operator delete(pointer);
+}
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+    /// The validation modes in the order they are run
+    const char* const allModes[] = {"object", "tryParse", "batch", "bulk", "file"};
+
+    /// Number of records handed to \p validateBatch() at once
+    constexpr size_t perfBatchSize = 4096;
+
+    /// Options of the tool
+    struct Options {
+        size_t records = 1000000;
+        uint64_t seed = 1;
+        double invalidRate = 0.05;
+        double malformedRate = 0.01;
+        double groupedRate = 0.5;
+        size_t threads = 0;
+        size_t repetitions = 3;
+        std::vector<std::string> modes;
+        std::vector<IBAN::CountryWeight> countries;
+        std::string output;
+        std::string file = "libiban_perf_corpus.txt";
+    };
+
+    /// Holds the country codes \p Options::countries points to
+    std::vector<std::string> countryCodes;
+
+    /// Prints the usage of the tool
+    void printUsage(std::ostream& out) {
+        out << "Usage: libiban_perf [options]\n"
+               "  --records=N          number of records of the corpus (default: 1000000)\n"
+               "  --seed=N             seed of the corpus (default: 1)\n"
+               "  --invalid-rate=R     share of records with a wrong check sum (default: 0.05)\n"
+               "  --malformed-rate=R   share of records that cannot be parsed (default: 0.01)\n"
+               "  --grouped-rate=R     share of records in groups of four (default: 0.5)\n"
+               "  --countries=LIST     countries and weights, e.g. DE:30,FR:15 (default: every\n"
+               "                       country of IBAN::m_countryCodes with the same weight)\n"
+               "  --modes=LIST         modes to run out of object,tryParse,batch,bulk,file\n"
+               "                       (default: all)\n"
+               "  --threads=N          worker threads of the bulk mode (default: one per\n"
+               "                       hardware thread)\n"
+               "  --repetitions=N      runs per mode, the fastest is reported (default: 3)\n"
+               "  --file=PATH          corpus file of the file mode, removed afterwards\n"
+               "                       (default: libiban_perf_corpus.txt)\n"
+               "  --output=PATH        file receiving the JSON report (default: stdout)\n";
+    }
+
+    /// Splits \p list at commas
+    std::vector<std::string> splitList(const std::string& list) {
+        std::vector<std::string> items;
+        std::istringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    /// Parses a rate between 0 and 1
+    double parseRate(const std::string& name, const std::string& value) {
+        size_t end = 0;
+        double rate = -1;
+        try {
+            rate = std::stod(value, &end);
+        } catch (const std::logic_error&) {
+            // reported below
+        }
+        if (end != value.size() || rate < 0 || rate > 1) {
+            throw std::invalid_argument(name + " must be between 0 and 1");
+        }
+        return rate;
+    }
+
+    /// Parses a non-negative integer
+    uint64_t parseNumber(const std::string& name, const std::string& value) {
+        size_t end = 0;
+        unsigned long long number = 0;
+        try {
+            number = std::stoull(value, &end);
+        } catch (const std::logic_error&) {
+            // reported below
+        }
+        if (end == 0 || end != value.size() || value[0] == '-') {
+            throw std::invalid_argument(name + " must be a non-negative integer");
+        }
+        return number;
+    }
+
+    /// Parses the command line; returns \p false if the usage was requested
+    bool parseOptions(int argc, char** argv, Options& options) {
+        std::string countries;
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            if (argument == "--help" || argument == "-h") {
+                return false;
+            }
+            const size_t equals = argument.find('=');
+            if (argument.compare(0, 2, "--") != 0 || equals == std::string::npos) {
+                throw std::invalid_argument("unknown argument " + argument);
+            }
+            const std::string name = argument.substr(0, equals);
+            const std::string value = argument.substr(equals + 1);
+            if (name == "--records") {
+                options.records = static_cast<size_t>(parseNumber(name, value));
+            } else if (name == "--seed") {
+                options.seed = parseNumber(name, value);
+            } else if (name == "--invalid-rate") {
+                options.invalidRate = parseRate(name, value);
+            } else if (name == "--malformed-rate") {
+                options.malformedRate = parseRate(name, value);
+            } else if (name == "--grouped-rate") {
+                options.groupedRate = parseRate(name, value);
+            } else if (name == "--countries") {
+                countries = value;
+            } else if (name == "--modes") {
+                options.modes = splitList(value);
+            } else if (name == "--threads") {
+                options.threads = static_cast<size_t>(parseNumber(name, value));
+            } else if (name == "--repetitions") {
+                options.repetitions = std::max<size_t>(1, static_cast<size_t>(parseNumber(name, value)));
+            } else if (name == "--file") {
+                options.file = value;
+            } else if (name == "--output") {
+                options.output = value;
+            } else {
+                throw std::invalid_argument("unknown option " + name);
+            }
+        }
+        if (options.records == 0) {
+            throw std::invalid_argument("--records must be at least 1");
+        }
+        if (options.invalidRate + options.malformedRate > 1) {
+            throw std::invalid_argument("--invalid-rate and --malformed-rate exceed 1 together");
+        }
+
+        if (options.modes.empty()) {
+            options.modes.assign(std::begin(allModes), std::end(allModes));
+        }
+        for (const auto& mode : options.modes) {
+            if (std::find(std::begin(allModes), std::end(allModes), mode) == std::end(allModes)) {
+                throw std::invalid_argument("unknown mode " + mode);
+            }
+        }
+
+        std::vector<unsigned> weights;
+        if (countries.empty()) {
+            // sorted, since the order of the map differs between implementations
+            for (const auto& entry : IBAN::IBAN::m_countryCodes) {
+                countryCodes.push_back(entry.first);
+            }
+            std::sort(countryCodes.begin(), countryCodes.end());
+            weights.assign(countryCodes.size(), 1);
+        } else {
+            for (const auto& item : splitList(countries)) {
+                const size_t colon = item.find(':');
+                countryCodes.push_back(item.substr(0, colon));
+                if (IBAN::IBAN::m_countryCodes.count(countryCodes.back()) == 0) {
+                    throw std::invalid_argument("unknown country " + countryCodes.back());
+                }
+                weights.push_back(colon == std::string::npos ? 1u :
+                                  static_cast<unsigned>(parseNumber("--countries", item.substr(colon + 1))));
+            }
+        }
+        for (size_t i = 0; i < countryCodes.size(); ++i) {
+            options.countries.push_back({countryCodes[i].c_str(), weights[i]});
+        }
+        return true;
+    }
+
+    /// Pseudo-random numbers of the corpus (SplitMix64)
+    class Random {
+    public:
+        explicit Random(uint64_t seed) noexcept : m_state(seed) {}
+
+        /// Returns the next number
+        uint64_t next() noexcept {
+            uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        /// Returns a number in [0, 1)
+        double uniform() noexcept {
+            return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        /// Returns a number in [0, bound)
+        size_t below(size_t bound) noexcept {
+            return static_cast<size_t>(next() % bound);
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    /// The records of the corpus in the forms the modes need
+    struct Corpus {
+        /// The records, each terminated by a newline
+        std::string text;
+        /// The records as strings for the per-object mode
+        std::vector<std::string> records;
+        /// Pointers to the records in \p text
+        std::vector<const char*> pointers;
+        /// Lengths of the records
+        std::vector<uint8_t> lengths;
+        size_t validRecords = 0;
+        size_t invalidRecords = 0;
+        size_t malformedRecords = 0;
+        size_t groupedRecords = 0;
+    };
+
+    /// Damages an IBAN so that it cannot be parsed at all
+    void makeMalformed(std::string& iban, Random& random) {
+        switch (random.below(4)) {
+            case 0:
+                // illegal character in the BBAN
+                iban[4 + random.below(iban.size() - 4)] = "/#*_"[random.below(4)];
+                break;
+            case 1:
+                // characters missing
+                iban.resize(iban.size() - 1 - random.below(3));
+                break;
+            case 2:
+                // unknown country
+                iban[0] = 'Q';
+                iban[1] = 'Q';
+                break;
+            default:
+                // letter in the check sum
+                iban[2] = static_cast<char>('A' + random.below(26));
+        }
+    }
+
+    /// Replaces a character of the BBAN by another one of the same kind,
+    /// which the check sum always detects
+    void makeInvalid(std::string& iban, Random& random) {
+        const size_t position = 4 + random.below(iban.size() - 4);
+        char& ch = iban[position];
+        if (ch >= '0' && ch <= '9') {
+            ch = static_cast<char>('0' + (ch - '0' + 1 + random.below(9)) % 10);
+        } else {
+            ch = static_cast<char>('A' + (ch - 'A' + 1 + random.below(25)) % 26);
+        }
+    }
+
+    /// Generates the corpus for \p options
+    Corpus generateCorpus(const Options& options) {
+        std::vector<IBAN::CompactIBAN> ibans(options.records);
+        IBAN::IBANGenerator(options.seed).generate(options.countries, ibans.data(), ibans.size());
+        Random random(options.seed);
+        Corpus corpus;
+        corpus.records.reserve(ibans.size());
+        for (const auto& iban : ibans) {
+            std::string record = iban.getMachineForm().toString();
+            const double kind = random.uniform();
+            if (kind < options.malformedRate) {
+                makeMalformed(record, random);
+                ++corpus.malformedRecords;
+            } else if (kind < options.malformedRate + options.invalidRate) {
+                makeInvalid(record, random);
+                ++corpus.invalidRecords;
+            } else {
+                ++corpus.validRecords;
+            }
+            if (random.uniform() < options.groupedRate) {
+                for (size_t i = 4; i < record.size(); i += 5) {
+                    record.insert(i, 1, ' ');
+                }
+                ++corpus.groupedRecords;
+            }
+            corpus.records.push_back(record);
+            corpus.text += record;
+            corpus.text += '\n';
+        }
+        size_t offset = 0;
+        for (const auto& record : corpus.records) {
+            corpus.pointers.push_back(corpus.text.data() + offset);
+            corpus.lengths.push_back(static_cast<uint8_t>(record.size()));
+            offset += record.size() + 1;
+        }
+        return corpus;
+    }
+
+    /// Hardware counters of the calling thread and the threads it starts
+    /// later on; unavailable if the kernel refuses them
+    class Counters {
+    public:
+        /// Number of counters
+        static constexpr size_t count = 4;
+
+        Counters() noexcept : m_fds{-1, -1, -1, -1} {
+#if LIBIBAN_PERF_EVENTS
+            const uint64_t configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                             PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+            for (size_t i = 0; i < count; ++i) {
+                perf_event_attr attributes;
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = configs[i];
+                attributes.disabled = 1;
+                attributes.inherit = 1;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                m_fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+                if (m_fds[i] < 0) {
+                    close();
+                    return;
+                }
+            }
+#endif
+        }
+
+        ~Counters() {
+            close();
+        }
+
+        Counters(const Counters&) = delete;
+        Counters& operator=(const Counters&) = delete;
+
+        /// Returns \p true if the counters are available
+        bool isAvailable() const noexcept {
+            return m_fds[0] >= 0;
+        }
+
+        /// Resets and starts the counters
+        void start() noexcept {
+#if LIBIBAN_PERF_EVENTS
+            for (const int fd : m_fds) {
+                if (fd >= 0) {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        /// Stops the counters and stores their values in \p values
+        void stop(uint64_t* values) noexcept {
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = 0;
+#if LIBIBAN_PERF_EVENTS
+                if (m_fds[i] >= 0) {
+                    ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                    if (read(m_fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+                        values[i] = 0;
+                    }
+                }
+#endif
+            }
+        }
+
+    private:
+        void close() noexcept {
+            for (int& fd : m_fds) {
+#if LIBIBAN_PERF_EVENTS
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+#endif
+                fd = -1;
+            }
+        }
+
+        int m_fds[count];
+    };
+
+    constexpr size_t Counters::count;
+
+    /// Measurements of one run of a mode
+    struct Measurement {
+        double seconds = 0;
+        uint64_t allocations = 0;
+        size_t validRecords = 0;
+        bool countersAvailable = false;
+        uint64_t counters[Counters::count] = {};
+    };
+
+    /// Counts the records whose status is \p ParseStatus::OK
+    size_t countValid(const uint8_t* statuses, size_t count) noexcept {
+        return static_cast<size_t>(std::count(statuses, statuses + count,
+                                              static_cast<uint8_t>(IBAN::ParseStatus::OK)));
+    }
+
+    /// Runs a mode once
+    Measurement runMode(const std::string& mode, const Corpus& corpus, const Options& options) {
+        Measurement measurement;
+        // open the counters first, so they follow the worker threads
+        Counters counters;
+        std::unique_ptr<IBAN::BulkValidator> validator;
+        if (mode == "bulk") {
+            validator.reset(new IBAN::BulkValidator(options.threads));
+        }
+        std::vector<uint8_t> statuses(corpus.records.size());
+        IBAN::FileValidationResult fileResult;
+
+        const uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+        counters.start();
+        const auto start = std::chrono::steady_clock::now();
+        if (mode == "object") {
+            for (const auto& record : corpus.records) {
+                try {
+                    measurement.validRecords += IBAN::IBAN::createFromString(record).validate();
+                } catch (const IBAN::IBANParseException&) {
+                    // malformed
+                }
+            }
+        } else if (mode == "tryParse") {
+            for (size_t i = 0; i < corpus.pointers.size(); ++i) {
+                statuses[i] = static_cast<uint8_t>(IBAN::IBAN::tryParse(
+                        IBAN::StringView(corpus.pointers[i], corpus.lengths[i])));
+            }
+            measurement.validRecords = countValid(statuses.data(), statuses.size());
+        } else if (mode == "batch") {
+            for (size_t begin = 0; begin < statuses.size(); begin += perfBatchSize) {
+                IBAN::validateBatch(corpus.pointers.data() + begin, corpus.lengths.data() + begin,
+                                    std::min(perfBatchSize, statuses.size() - begin), statuses.data() + begin);
+            }
+            measurement.validRecords = countValid(statuses.data(), statuses.size());
+        } else if (mode == "bulk") {
+            validator->validate(corpus.text.data(), corpus.text.size(), statuses);
+            measurement.validRecords = countValid(statuses.data(), statuses.size());
+        } else {
+            IBAN::validateFile(options.file, fileResult);
+            measurement.validRecords = static_cast<size_t>(fileResult.records - fileResult.invalidRecords);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        counters.stop(measurement.counters);
+        measurement.allocations = allocationCount.load(std::memory_order_relaxed) - allocations;
+        measurement.seconds = std::chrono::duration<double>(end - start).count();
+        measurement.countersAvailable = counters.isAvailable();
+        return measurement;
+    }
+
+    /// Formats a number with \p decimals decimal places
+    std::string formatNumber(double value, int decimals) {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        return buffer;
+    }
+
+    /// Quotes a string for JSON
+    std::string quote(const std::string& string) {
+        std::string quoted = "\"";
+        for (const char ch : string) {
+            if (ch == '"' || ch == '\\') {
+                quoted += '\\';
+                quoted += ch;
+            } else if (static_cast<unsigned char>(ch) < 0x20) {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(ch));
+                quoted += escape;
+            } else {
+                quoted += ch;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    /// Returns the name of a batch kernel
+    const char* getKernelName(IBAN::BatchKernel kernel) noexcept {
+        switch (kernel) {
+            case IBAN::BatchKernel::AVX2:
+                return "AVX2";
+            case IBAN::BatchKernel::SSE42:
+                return "SSE4.2";
+            default:
+                return "Scalar";
+        }
+    }
+
+    /// Returns the model name of the CPU or an empty string
+    std::string getCpuName() {
+        std::ifstream cpuInfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuInfo, line)) {
+            if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+                return line.substr(std::min(line.size(), line.find(':') + 2));
+            }
+        }
+        return std::string();
+    }
+
+    /// Writes the report of all modes
+    void writeReport(std::ostream& out, const Options& options, const Corpus& corpus,
+                     const std::vector<std::pair<std::string, std::vector<Measurement>>>& results) {
+        const double records = static_cast<double>(corpus.records.size());
+        out << "{\n"
+            << "  \"tool\": \"libiban_perf\",\n"
+            << "  \"formatVersion\": 1,\n"
+            << "  \"machine\": {\n"
+            << "    \"cpu\": " << quote(getCpuName()) << ",\n"
+            << "    \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"batchKernel\": " << quote(getKernelName(IBAN::getBestBatchKernel())) << "\n"
+            << "  },\n"
+            << "  \"options\": {\n"
+            << "    \"records\": " << options.records << ",\n"
+            << "    \"seed\": " << options.seed << ",\n"
+            << "    \"invalidRate\": " << formatNumber(options.invalidRate, 4) << ",\n"
+            << "    \"malformedRate\": " << formatNumber(options.malformedRate, 4) << ",\n"
+            << "    \"groupedRate\": " << formatNumber(options.groupedRate, 4) << ",\n"
+            << "    \"countries\": " << options.countries.size() << ",\n"
+            << "    \"threads\": " << (options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency())) << ",\n"
+            << "    \"repetitions\": " << options.repetitions << "\n"
+            << "  },\n"
+            << "  \"corpus\": {\n"
+            << "    \"records\": " << corpus.records.size() << ",\n"
+            << "    \"bytes\": " << corpus.text.size() << ",\n"
+            << "    \"validRecords\": " << corpus.validRecords << ",\n"
+            << "    \"invalidRecords\": " << corpus.invalidRecords << ",\n"
+            << "    \"malformedRecords\": " << corpus.malformedRecords << ",\n"
+            << "    \"groupedRecords\": " << corpus.groupedRecords << "\n"
+            << "  },\n"
+            << "  \"modes\": [";
+        for (size_t m = 0; m < results.size(); ++m) {
+            const auto& runs = results[m].second;
+            std::vector<double> seconds;
+            for (const auto& run : runs) {
+                seconds.push_back(run.seconds);
+            }
+            std::sort(seconds.begin(), seconds.end());
+            const Measurement& best = *std::min_element(runs.begin(), runs.end(),
+                    [](const Measurement& lhs, const Measurement& rhs) { return lhs.seconds < rhs.seconds; });
+            out << (m ? ",\n" : "\n")
+                << "    {\n"
+                << "      \"mode\": " << quote(results[m].first) << ",\n"
+                << "      \"seconds\": " << formatNumber(best.seconds, 6) << ",\n"
+                << "      \"medianSeconds\": " << formatNumber(seconds[seconds.size() / 2], 6) << ",\n"
+                << "      \"recordsPerSecond\": " << formatNumber(records / best.seconds, 0) << ",\n"
+                << "      \"bytesPerSecond\": " << formatNumber(static_cast<double>(corpus.text.size()) / best.seconds, 0) << ",\n"
+                << "      \"allocationsPerRecord\": " << formatNumber(static_cast<double>(best.allocations) / records, 4) << ",\n"
+                << "      \"validRecords\": " << best.validRecords << ",\n"
+                << "      \"counters\": ";
+            if (!best.countersAvailable) {
+                out << "null\n";
+            } else {
+                const double cycles = static_cast<double>(best.counters[0]);
+                const double instructions = static_cast<double>(best.counters[1]);
+                out << "{\n"
+                    << "        \"cycles\": " << best.counters[0] << ",\n"
+                    << "        \"instructions\": " << best.counters[1] << ",\n"
+                    << "        \"ipc\": " << formatNumber(cycles > 0 ? instructions / cycles : 0, 3) << ",\n"
+                    << "        \"cacheMisses\": " << best.counters[2] << ",\n"
+                    << "        \"branchMisses\": " << best.counters[3] << ",\n"
+                    << "        \"cyclesPerRecord\": " << formatNumber(cycles / records, 1) << "\n"
+                    << "      }\n";
+            }
+            out << "    }";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage(std::cout);
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "libiban_perf: " << e.what() << "\n";
+        printUsage(std::cerr);
+        return 1;
+    }
+
+    try {
+        std::cerr << "Generating " << options.records << " records ...\n";
+        const Corpus corpus = generateCorpus(options);
+        const bool fileMode = std::find(options.modes.begin(), options.modes.end(), "file") != options.modes.end();
+        if (fileMode) {
+            std::ofstream file(options.file, std::ios::binary | std::ios::trunc);
+            file.write(corpus.text.data(), static_cast<std::streamsize>(corpus.text.size()));
+            if (!file) {
+                throw std::runtime_error("cannot write " + options.file);
+            }
+        }
+
+        std::vector<std::pair<std::string, std::vector<Measurement>>> results;
+        for (const auto& mode : options.modes) {
+            std::cerr << "Running " << mode << " ...\n";
+            std::vector<Measurement> runs;
+            for (size_t i = 0; i < options.repetitions; ++i) {
+                runs.push_back(runMode(mode, corpus, options));
+            }
+            results.emplace_back(mode, runs);
+        }
+        if (fileMode) {
+            std::remove(options.file.c_str());
+        }
+
+        if (options.output.empty()) {
+            writeReport(std::cout, options, corpus, results);
+        } else {
+            std::ofstream out(options.output);
+            writeReport(out, options, corpus, results);
+            if (!out) {
+                throw std::runtime_error("cannot write " + options.output);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "libiban_perf: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        arena.cpp
+ * \brief       Source file implementing memory resources and arena allocation
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the default memory resource and the class
+ * \p MonotonicArena.
+ */
+
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace IBAN {
+
+    namespace {
+        /// Memory resource using the global operators \p new and \p delete
+        class NewDeleteResource : public MemoryResource {
+        protected:
+            void* doAllocate(size_t bytes, size_t) override {
+                return ::operator new(bytes);
+            }
+
+            void doDeallocate(void* pointer, size_t, size_t) noexcept override {
+                ::operator delete(pointer);
+            }
+
+            bool doIsEqual(const MemoryResource& other) const noexcept override {
+                return dynamic_cast<const NewDeleteResource*>(&other) != nullptr;
+            }
+        };
+
+        /// Returns \p pointer rounded up to a multiple of \p alignment, which
+        /// is a power of 2
+        inline char* alignUp(char* pointer, size_t alignment) noexcept {
+            const uintptr_t value = reinterpret_cast<uintptr_t>(pointer);
+            return pointer + ((alignment - value % alignment) % alignment);
+        }
+    }
+
+    MemoryResource::~MemoryResource() {
+    }
+
+    /**
+     * Returns the default memory resource, which uses the global operators
+     * \p new and \p delete. Alignments beyond that of \p std::max_align_t are
+     * not supported.
+     *
+     * @return The default memory resource
+     */
+    MemoryResource* MemoryResource::getDefault() noexcept {
+        static NewDeleteResource resource;
+        return &resource;
+    }
+
+    constexpr size_t MonotonicArena::defaultBlockSize;
+
+    /**
+     * Constructs an empty arena. No memory is allocated before the first call
+     * of \p allocate().
+     *
+     * @param blockSize The size of the first block in bytes; following blocks
+     * double in size
+     * @param upstream The resource providing the blocks
+     */
+    MonotonicArena::MonotonicArena(size_t blockSize, MemoryResource* upstream) noexcept :
+            m_blocks(nullptr), m_current(nullptr), m_remaining(0),
+            m_nextBlockSize(std::max<size_t>(blockSize, 64)), m_used(0), m_buffer(nullptr),
+            m_bufferSize(0), m_initialBlockSize(m_nextBlockSize), m_upstream(upstream) {
+    }
+
+    /**
+     * Constructs an arena allocating from \p buffer first, e.g. from the
+     * stack. Blocks are allocated from \p upstream once the buffer is full.
+     *
+     * @param buffer The buffer, which must outlive the arena
+     * @param size The size of the buffer in bytes
+     * @param upstream The resource providing further blocks
+     */
+    MonotonicArena::MonotonicArena(void* buffer, size_t size, MemoryResource* upstream) noexcept :
+            m_blocks(nullptr), m_current(static_cast<char*>(buffer)), m_remaining(size),
+            m_nextBlockSize(std::max<size_t>(size, defaultBlockSize)), m_used(0),
+            m_buffer(static_cast<char*>(buffer)), m_bufferSize(size),
+            m_initialBlockSize(m_nextBlockSize), m_upstream(upstream) {
+    }
+
+    /**
+     * Releases all memory of the arena.
+     */
+    MonotonicArena::~MonotonicArena() {
+        release();
+    }
+
+    /**
+     * Releases all memory allocated from the arena at once, invalidating it.
+     * The arena can be used again afterwards.
+     */
+    void MonotonicArena::release() noexcept {
+        while (m_blocks) {
+            Block* next = m_blocks->next;
+            m_upstream->deallocate(m_blocks, m_blocks->size);
+            m_blocks = next;
+        }
+        m_current = m_buffer;
+        m_remaining = m_bufferSize;
+        m_nextBlockSize = m_initialBlockSize;
+        m_used = 0;
+    }
+
+    /**
+     * Returns the number of bytes handed out since construction or the last
+     * call of \p release(), including padding for alignment.
+     *
+     * @return The number of bytes in use
+     */
+    size_t MonotonicArena::getUsedSize() const noexcept {
+        return m_used;
+    }
+
+    void* MonotonicArena::doAllocate(size_t bytes, size_t alignment) {
+        char* aligned = alignUp(m_current, alignment);
+        size_t padding = static_cast<size_t>(aligned - m_current);
+        if (!m_current || padding + bytes > m_remaining) {
+            // the block header keeps the data aligned to std::max_align_t
+            const size_t header = (sizeof(Block) + alignof(std::max_align_t) - 1) /
+                                  alignof(std::max_align_t) * alignof(std::max_align_t);
+            const size_t size = std::max(m_nextBlockSize, header + bytes + alignment);
+            Block* block = static_cast<Block*>(m_upstream->allocate(size));
+            block->next = m_blocks;
+            block->size = size;
+            m_blocks = block;
+            m_current = reinterpret_cast<char*>(block) + header;
+            m_remaining = size - header;
+            m_nextBlockSize = size * 2;
+            aligned = alignUp(m_current, alignment);
+            padding = static_cast<size_t>(aligned - m_current);
+        }
+        m_current = aligned + bytes;
+        m_remaining -= padding + bytes;
+        m_used += padding + bytes;
+        return aligned;
+    }
+
+    void MonotonicArena::doDeallocate(void*, size_t, size_t) noexcept {
+    }
+
+    bool MonotonicArena::doIsEqual(const MemoryResource&) const noexcept {
+        return false;
+    }
+}
@@ -0,0 +1,261 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        arena.h
+ * \brief       Header file declaring memory resources and arena allocation
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the interface \p MemoryResource, modelled after
+ * \p std::pmr::memory_resource of C++17, the monotonic arena
+ * \p MonotonicArena and the allocator \p ArenaAllocator, which lets standard
+ * containers allocate from a memory resource. Batches of IBANs can thus be
+ * allocated from an arena and released at once.
+ */
+
+#ifndef LIBIBAN_ARENA_H
+#define LIBIBAN_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/**
+ * Interface of a source of memory; see \p std::pmr::memory_resource.
+ */
+class MemoryResource {
+public:
+    virtual ~MemoryResource();
+
+    /**
+     * Allocates memory.
+     *
+     * @param bytes The number of bytes to allocate
+     * @param alignment The alignment of the memory
+     * @return The allocated memory
+     * @throws std::bad_alloc If the memory cannot be allocated
+     */
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        return doAllocate(bytes, alignment);
+    }
+
+    /**
+     * Deallocates memory allocated by \p allocate() of this or an equal
+     * resource.
+     *
+     * @param pointer The memory to deallocate
+     * @param bytes The number of bytes passed to \p allocate()
+     * @param alignment The alignment passed to \p allocate()
+     */
+    void deallocate(void* pointer, size_t bytes,
+                    size_t alignment = alignof(std::max_align_t)) noexcept {
+        doDeallocate(pointer, bytes, alignment);
+    }
+
+    /**
+     * Tests if memory allocated by this resource can be deallocated by
+     * \p other and vice versa.
+     *
+     * @param other The resource to compare with
+     * @return \p true if the resources are interchangeable
+     */
+    bool isEqual(const MemoryResource& other) const noexcept {
+        return this == &other || doIsEqual(other);
+    }
+
+    static MemoryResource* getDefault() noexcept;
+
+protected:
+    virtual void* doAllocate(size_t bytes, size_t alignment) = 0;
+    virtual void doDeallocate(void* pointer, size_t bytes, size_t alignment) noexcept = 0;
+    virtual bool doIsEqual(const MemoryResource& other) const noexcept = 0;
+};
+
+/**
+ * Memory resource handing out memory from large blocks without ever freeing
+ * single allocations. Deallocation is a no-op; all memory is released at once
+ * by \p release() or the destructor, which frees one block per doubling of
+ * the arena's size. Allocating is a pointer increment in most cases.
+ *
+ * An arena is not thread-safe. Since memory is not reused before
+ * \p release(), containers should reserve their final size up front.
+ */
+class MonotonicArena : public MemoryResource {
+public:
+    /// Default size of the first block in bytes
+    static constexpr size_t defaultBlockSize = 64 * 1024;
+
+    explicit MonotonicArena(size_t blockSize = defaultBlockSize,
+                            MemoryResource* upstream = MemoryResource::getDefault()) noexcept;
+    MonotonicArena(void* buffer, size_t size,
+                   MemoryResource* upstream = MemoryResource::getDefault()) noexcept;
+    ~MonotonicArena() override;
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void release() noexcept;
+    size_t getUsedSize() const noexcept;
+
+protected:
+    void* doAllocate(size_t bytes, size_t alignment) override;
+    void doDeallocate(void* pointer, size_t bytes, size_t alignment) noexcept override;
+    bool doIsEqual(const MemoryResource& other) const noexcept override;
+
+private:
+    /// Header of a block allocated from the upstream resource
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    /// Blocks allocated from the upstream resource, most recent first
+    Block* m_blocks;
+    /// Next free byte of the current block
+    char* m_current;
+    /// Number of free bytes in the current block
+    size_t m_remaining;
+    /// Size of the next block allocated from the upstream resource
+    size_t m_nextBlockSize;
+    /// Number of bytes handed out since construction or the last release
+    size_t m_used;
+    /// Caller provided buffer used before any block is allocated
+    char* m_buffer;
+    /// Size of \p m_buffer
+    size_t m_bufferSize;
+    /// Initial value of \p m_nextBlockSize
+    size_t m_initialBlockSize;
+    /// Resource providing the blocks
+    MemoryResource* m_upstream;
+};
+
+/**
+ * Allocator allocating from a \p MemoryResource, so standard containers can
+ * use arenas; see \p std::pmr::polymorphic_allocator. Copies of an allocator
+ * share its resource.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    /**
+     * Constructs an allocator using the default resource.
+     */
+    ArenaAllocator() noexcept : m_resource(MemoryResource::getDefault()) {
+    }
+
+    /**
+     * Constructs an allocator using \p resource, which must outlive all
+     * memory allocated through the allocator.
+     *
+     * @param resource The memory resource
+     */
+    ArenaAllocator(MemoryResource* resource) noexcept : m_resource(resource) {
+    }
+
+    /**
+     * Constructs an allocator using the resource of \p other.
+     *
+     * @param other The allocator to copy the resource from
+     */
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_resource(other.getResource()) {
+    }
+
+    /**
+     * Allocates memory for \p count objects of type \p T.
+     *
+     * @param count The number of objects
+     * @return The allocated memory
+     */
+    T* allocate(size_t count) {
+        if (count > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(m_resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Deallocates memory allocated by \p allocate().
+     *
+     * @param pointer The memory to deallocate
+     * @param count The number of objects passed to \p allocate()
+     */
+    void deallocate(T* pointer, size_t count) noexcept {
+        m_resource->deallocate(pointer, count * sizeof(T), alignof(T));
+    }
+
+    /**
+     * Returns the memory resource of the allocator.
+     *
+     * @return The memory resource
+     */
+    MemoryResource* getResource() const noexcept {
+        return m_resource;
+    }
+
+private:
+    /// The memory resource
+    MemoryResource* m_resource;
+};
+
+/**
+ * Compares the resources of two allocators.
+ *
+ * @param lhs The first allocator
+ * @param rhs The second allocator
+ * @return \p true if memory allocated by one can be deallocated by the other
+ */
+template <class T, class U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept {
+    return lhs.getResource()->isEqual(*rhs.getResource());
+}
+
+/**
+ * Compares the resources of two allocators.
+ *
+ * @param lhs The first allocator
+ * @param rhs The second allocator
+ * @return \p true if memory allocated by one cannot be deallocated by the other
+ */
+template <class T, class U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+/// Vector of IBANs allocating from a memory resource. An \p IBAN stores its
+/// characters inline, so the vector's buffer is the only memory the batch
+/// needs; with a \p MonotonicArena, it is released in one go.
+typedef std::vector<IBAN, ArenaAllocator<IBAN>> IBANVector;
+
+/// Vector of compact IBANs allocating from a memory resource
+typedef std::vector<CompactIBAN, ArenaAllocator<CompactIBAN>> CompactIBANVector;
+}
+
+#endif //LIBIBAN_ARENA_H
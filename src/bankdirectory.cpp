@@ -0,0 +1,393 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        bankdirectory.cpp
+ * \brief       Source file implementing the bank directory
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p BankDirectory, \p BankDirectoryBuilder and the
+ * process wide directory behind \p lookupBank(), which is published through an
+ * \p RcuPointer.
+ */
+
+#include "bankdirectory.h"
+#include "epoch.h"
+#include "snapshot.h"
+#include <algorithm>
+
+
+namespace IBAN {
+
+    namespace {
+        /// Magic bytes at the start of a snapshot
+        constexpr char magic[8] = {'I', 'B', 'A', 'N', 'B', 'N', 'K', '1'};
+        /// Size of the snapshot header
+        constexpr size_t headerSize = 16;
+        /// Size of an entry
+        constexpr size_t entrySize = 32;
+        /// Size of an entry's key
+        constexpr size_t keySize = 24;
+
+        /// Throws the exception for a snapshot that cannot be loaded
+        [[noreturn]] void throwMalformed() {
+            throw std::runtime_error("Malformed bank directory snapshot");
+        }
+
+        /// Checks that \p code matches the character classes of the BBAN
+        /// positions starting at \p offset
+        bool matchesClasses(StringView code, const BBANStructure& structure, size_t offset) noexcept {
+            for (size_t i = 0; i < code.size(); ++i) {
+                if ((BBANStructure::classify(code[i]) & structure.classes[offset + i]) == 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Builds the key of a bank; \p key must hold \p keySize characters
+        void makeKey(StringView countryCode, StringView bankCode, StringView branchCode,
+                     char* key) noexcept {
+            std::memset(key, 0, keySize);
+            std::memcpy(key, countryCode.data(), 2);
+            std::memcpy(key + 2, bankCode.data(), bankCode.size());
+            std::memcpy(key + 2 + bankCode.size(), branchCode.data(), branchCode.size());
+        }
+
+        /// The process wide directory used by \p lookupBank()
+        RcuPointer<BankDirectory>& getGlobalDirectory() {
+            static RcuPointer<BankDirectory> directory;
+            return directory;
+        }
+    }
+
+    /**
+     * Copies a bank entry.
+     *
+     * @param entry The entry to copy
+     */
+    BankInfo::BankInfo(const BankEntry& entry) noexcept :
+            m_bic(), m_bicLength(static_cast<uint8_t>(std::min(entry.bic.size(), maxBICLength))),
+            m_name(), m_nameLength(static_cast<uint8_t>(std::min(entry.name.size(), maxBankNameLength))) {
+        std::memcpy(m_bic, entry.bic.data(), m_bicLength);
+        std::memcpy(m_name, entry.name.data(), m_nameLength);
+    }
+
+    /**
+     * Adds a bank.
+     *
+     * @param countryCode The country code
+     * @param bankCode The bank code; must have the length and character
+     * classes of the bank code of the country's BBAN structure
+     * @param branchCode The branch code or an empty view for all branches of
+     * the bank; must match the branch code of the country's BBAN structure
+     * otherwise
+     * @param bic The BIC of 8 or 11 characters or an empty view
+     * @param name The bank's name of at most \p maxBankNameLength characters
+     * @throws IBANInvalidCountryCodeException If the country is unknown
+     * @throws std::invalid_argument If a code, the BIC or the name is invalid
+     */
+    void BankDirectoryBuilder::add(StringView countryCode, StringView bankCode,
+                                   StringView branchCode, StringView bic, StringView name) {
+        const BBANStructure* structure = countryCode.size() == 2 ?
+                getBBANStructure(countryCode[0], countryCode[1]) : nullptr;
+        if (!structure) {
+            throw IBANInvalidCountryCodeException(countryCode.toString());
+        }
+        if (structure->bankLength == 0 || bankCode.size() != structure->bankLength ||
+            !matchesClasses(bankCode, *structure, structure->bankOffset)) {
+            throw std::invalid_argument("Bank code does not match the BBAN structure of " +
+                                        countryCode.toString());
+        }
+        if (!branchCode.empty() && (branchCode.size() != structure->branchLength ||
+                                    !matchesClasses(branchCode, *structure, structure->branchOffset))) {
+            throw std::invalid_argument("Branch code does not match the BBAN structure of " +
+                                        countryCode.toString());
+        }
+        if (!bic.empty() && bic.size() != 8 && bic.size() != maxBICLength) {
+            throw std::invalid_argument("BIC must consist of 8 or 11 characters");
+        }
+        if (name.size() > maxBankNameLength) {
+            throw std::invalid_argument("Bank name exceeds maxBankNameLength characters");
+        }
+        Record record;
+        record.key.resize(keySize);
+        makeKey(countryCode, bankCode, branchCode, &record.key[0]);
+        record.bic = bic.toString();
+        record.name = name.toString();
+        m_records.push_back(std::move(record));
+    }
+
+    /**
+     * Builds the snapshot of the banks added.
+     *
+     * @return The snapshot
+     * @throws std::invalid_argument If a bank was added more than once
+     */
+    std::vector<char> BankDirectoryBuilder::build() const {
+        std::vector<const Record*> sorted;
+        sorted.reserve(m_records.size());
+        size_t stringsSize = 0;
+        for (const auto& record : m_records) {
+            sorted.push_back(&record);
+            stringsSize += record.bic.size() + record.name.size();
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Record* lhs, const Record* rhs) {
+            return lhs->key < rhs->key;
+        });
+
+        std::vector<char> snapshot(headerSize + sorted.size() * entrySize + stringsSize);
+        std::memcpy(snapshot.data(), magic, sizeof(magic));
+        detail::writeNumber(snapshot.data() + 8, static_cast<uint32_t>(sorted.size()));
+        detail::writeNumber(snapshot.data() + 12, static_cast<uint32_t>(stringsSize));
+        char* entry = snapshot.data() + headerSize;
+        char* strings = entry + sorted.size() * entrySize;
+        uint32_t offset = 0;
+        for (size_t i = 0; i < sorted.size(); ++i, entry += entrySize) {
+            const Record& record = *sorted[i];
+            if (i > 0 && sorted[i - 1]->key == record.key) {
+                throw std::invalid_argument("Bank added more than once");
+            }
+            std::memcpy(entry, record.key.data(), keySize);
+            detail::writeNumber(entry + keySize, offset);
+            detail::writeNumber(entry + keySize + 4, static_cast<uint16_t>(record.bic.size()));
+            detail::writeNumber(entry + keySize + 6, static_cast<uint16_t>(record.name.size()));
+            std::memcpy(strings + offset, record.bic.data(), record.bic.size());
+            offset += static_cast<uint32_t>(record.bic.size());
+            std::memcpy(strings + offset, record.name.data(), record.name.size());
+            offset += static_cast<uint32_t>(record.name.size());
+        }
+        return snapshot;
+    }
+
+    /**
+     * Writes the snapshot of the banks added to a file.
+     *
+     * @param path The path of the file
+     * @throws std::system_error If the file cannot be written
+     * @throws std::invalid_argument If a bank was added more than once
+     */
+    void BankDirectoryBuilder::write(const std::string& path) const {
+        detail::writeSnapshot(path, build());
+    }
+
+    BankDirectory::BankDirectory() noexcept : m_mapping(nullptr), m_mappingSize(0),
+                                              m_entries(nullptr), m_strings(nullptr), m_count(0) {}
+
+    BankDirectory::~BankDirectory() {
+        detail::unmapSnapshot(m_mapping, m_mappingSize);
+    }
+
+    /**
+     * Opens a snapshot file. The file is mapped into memory and must not be
+     * modified while the directory exists; replace it by renaming a new file
+     * over it instead.
+     *
+     * @param path The path of the snapshot
+     * @return The directory
+     * @throws std::system_error If the file cannot be opened or mapped
+     * @throws std::runtime_error If the file is not a valid snapshot
+     */
+    std::unique_ptr<BankDirectory> BankDirectory::open(const std::string& path) {
+#if LIBIBAN_USE_MMAP
+        const detail::SnapshotMapping mapping = detail::mapSnapshot(path);
+        std::unique_ptr<BankDirectory> directory(new BankDirectory());
+        directory->m_mapping = mapping.data;
+        directory->m_mappingSize = mapping.size;
+        directory->load(static_cast<const char*>(mapping.data), mapping.size);
+        return directory;
+#else
+        return fromBuffer(detail::readSnapshot(path));
+#endif
+    }
+
+    /**
+     * Loads a snapshot held in memory, e.g. as returned by
+     * \p BankDirectoryBuilder::build().
+     *
+     * @param snapshot The snapshot
+     * @return The directory
+     * @throws std::runtime_error If \p snapshot is not a valid snapshot
+     */
+    std::unique_ptr<BankDirectory> BankDirectory::fromBuffer(std::vector<char> snapshot) {
+        std::unique_ptr<BankDirectory> directory(new BankDirectory());
+        directory->m_buffer = std::move(snapshot);
+        directory->load(directory->m_buffer.data(), directory->m_buffer.size());
+        return directory;
+    }
+
+    /// Checks the snapshot and indexes its entries by country
+    void BankDirectory::load(const char* data, size_t size) {
+        if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0) {
+            throwMalformed();
+        }
+        const uint64_t count = detail::readNumber<uint32_t>(data + 8);
+        const uint64_t stringsSize = detail::readNumber<uint32_t>(data + 12);
+        if (size != headerSize + count * entrySize + stringsSize) {
+            throwMalformed();
+        }
+        m_entries = data + headerSize;
+        m_strings = m_entries + count * entrySize;
+        m_count = static_cast<size_t>(count);
+
+        m_countries.assign(countryCodeCount + 1, 0);
+        for (size_t i = 0; i < m_count; ++i) {
+            const char* entry = m_entries + i * entrySize;
+            const size_t country = getCountryIndex(entry[0], entry[1]);
+            const uint64_t stringsEnd = uint64_t(detail::readNumber<uint32_t>(entry + keySize)) +
+                                        detail::readNumber<uint16_t>(entry + keySize + 4) +
+                                        detail::readNumber<uint16_t>(entry + keySize + 6);
+            if (country == countryCodeCount || stringsEnd > stringsSize ||
+                (i > 0 && std::memcmp(entry - entrySize, entry, keySize) >= 0)) {
+                throwMalformed();
+            }
+            ++m_countries[country + 1];
+        }
+        for (size_t i = 0; i < countryCodeCount; ++i) {
+            m_countries[i + 1] += m_countries[i];
+        }
+    }
+
+    /// Looks up the entry of a key among the entries of a country
+    bool BankDirectory::findKey(const char* key, size_t country, BankEntry& result) const noexcept {
+        size_t begin = m_countries[country], end = m_countries[country + 1];
+        while (begin < end) {
+            const size_t middle = begin + (end - begin) / 2;
+            const char* entry = m_entries + middle * entrySize;
+            const int order = std::memcmp(entry, key, keySize);
+            if (order == 0) {
+                const char* strings = m_strings + detail::readNumber<uint32_t>(entry + keySize);
+                const size_t bicLength = detail::readNumber<uint16_t>(entry + keySize + 4);
+                result.bic = StringView(strings, bicLength);
+                result.name = StringView(strings + bicLength,
+                                         detail::readNumber<uint16_t>(entry + keySize + 6));
+                return true;
+            }
+            if (order < 0) {
+                begin = middle + 1;
+            } else {
+                end = middle;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Looks up a bank by its codes.
+     *
+     * @param countryCode The country code
+     * @param bankCode The bank code
+     * @param branchCode The branch code or an empty view
+     * @param result The entry receiving the bank if it was found
+     * @return \p true if the bank was found
+     */
+    bool BankDirectory::find(StringView countryCode, StringView bankCode, StringView branchCode,
+                             BankEntry& result) const noexcept {
+        if (countryCode.size() != 2 || 2 + bankCode.size() + branchCode.size() > keySize) {
+            return false;
+        }
+        const size_t country = getCountryIndex(countryCode[0], countryCode[1]);
+        if (country == countryCodeCount) {
+            return false;
+        }
+        char key[keySize];
+        makeKey(countryCode, bankCode, branchCode, key);
+        return findKey(key, country, result);
+    }
+
+    /**
+     * Looks up the bank of an IBAN. A bank registered for the IBAN's branch
+     * takes precedence over one registered for all branches.
+     *
+     * @param iban The IBAN
+     * @param result The entry receiving the bank if it was found
+     * @return \p true if the bank was found
+     */
+    bool BankDirectory::find(const CompactIBAN& iban, BankEntry& result) const noexcept {
+        const StringView bankCode = iban.getBankCode();
+        if (bankCode.empty()) {
+            return false;
+        }
+        const StringView countryCode = iban.getCountryCode();
+        const StringView branchCode = iban.getBranchCode();
+        return (!branchCode.empty() && find(countryCode, bankCode, branchCode, result)) ||
+               find(countryCode, bankCode, StringView(), result);
+    }
+
+    /**
+     * Returns the number of banks.
+     *
+     * @return The number of banks
+     */
+    size_t BankDirectory::size() const noexcept {
+        return m_count;
+    }
+
+    /**
+     * Replaces the directory used by \p lookupBank(). Readers are not blocked;
+     * the call returns once no reader uses the old directory anymore, which
+     * is then deleted. Must not be called while holding an \p EpochGuard.
+     *
+     * @param directory The new directory or an empty pointer to remove it
+     */
+    void setBankDirectory(std::unique_ptr<BankDirectory> directory) {
+        getGlobalDirectory().reset(std::move(directory));
+    }
+
+    /**
+     * Returns the directory used by \p lookupBank(). The directory may only be
+     * used while the calling thread holds an \p EpochGuard.
+     *
+     * @return The directory or \p nullptr if none was set
+     */
+    const BankDirectory* getBankDirectory() noexcept {
+        return getGlobalDirectory().get();
+    }
+
+    /**
+     * Looks up the bank of an IBAN in the directory set by
+     * \p setBankDirectory().
+     *
+     * @param iban The IBAN
+     * @param result The instance receiving a copy of the bank if it was found
+     * @return \p true if the bank was found, \p false if it was not or no
+     * directory was set
+     */
+    bool lookupBank(const CompactIBAN& iban, BankInfo& result) noexcept {
+        EpochGuard guard;
+        const BankDirectory* directory = getBankDirectory();
+        BankEntry entry;
+        if (!directory || !directory->find(iban, entry)) {
+            return false;
+        }
+        result = BankInfo(entry);
+        return true;
+    }
+
+    /// \overload
+    bool lookupBank(const IBAN& iban, BankInfo& result) noexcept {
+        return lookupBank(CompactIBAN(iban), result);
+    }
+}
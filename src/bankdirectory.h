@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        bankdirectory.h
+ * \brief       Header file declaring the bank directory
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p BankDirectory, a read-only index resolving the
+ * bank code and branch code of an IBAN to the bank's BIC and name, the
+ * \p BankDirectoryBuilder writing its snapshot files, and \p lookupBank(),
+ * which looks up IBANs in a process wide directory that can be replaced at
+ * runtime without stalling readers.
+ */
+
+#ifndef LIBIBAN_BANKDIRECTORY_H
+#define LIBIBAN_BANKDIRECTORY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/// The maximum length of a BIC
+constexpr size_t maxBICLength = 11;
+/// The maximum length of a bank name, which is three SWIFT lines of 35
+/// characters
+constexpr size_t maxBankNameLength = 105;
+
+/**
+ * Bank of a \p BankDirectory. The views point into the directory and stay
+ * valid as long as the directory.
+ */
+struct BankEntry {
+    /// The bank's BIC; empty if the bank has none
+    StringView bic;
+    /// The bank's name
+    StringView name;
+};
+
+/**
+ * Copy of a bank found by \p lookupBank(), independent of the lifetime of the
+ * directory.
+ */
+class BankInfo {
+
+private:
+    /// Holds the BIC
+    char m_bic[maxBICLength];
+    /// Holds the length of the BIC
+    uint8_t m_bicLength;
+    /// Holds the name
+    char m_name[maxBankNameLength];
+    /// Holds the length of the name
+    uint8_t m_nameLength;
+
+public:
+    /// Constructs an empty instance
+    BankInfo() noexcept : m_bic(), m_bicLength(0), m_name(), m_nameLength(0) {}
+    explicit BankInfo(const BankEntry& entry) noexcept;
+
+    /// Returns the bank's BIC; empty if the bank has none
+    StringView getBIC() const noexcept { return StringView(m_bic, m_bicLength); }
+    /// Returns the bank's name
+    StringView getName() const noexcept { return StringView(m_name, m_nameLength); }
+};
+
+/**
+ * Collects banks and writes them as a snapshot for \p BankDirectory. Banks are
+ * keyed by country code, bank code and optionally branch code, where the
+ * codes must match the positions of the BBAN structure of the country, e.g.
+ * the eight digit Bankleitzahl for DE or the four letter bank code and the
+ * six digit sort code for GB.
+ */
+class BankDirectoryBuilder {
+public:
+    void add(StringView countryCode, StringView bankCode, StringView branchCode,
+             StringView bic, StringView name);
+    /// Returns the number of banks added
+    size_t size() const noexcept { return m_records.size(); }
+    std::vector<char> build() const;
+    void write(const std::string& path) const;
+
+private:
+    /// Bank added to the builder
+    struct Record {
+        std::string key;
+        std::string bic;
+        std::string name;
+    };
+
+    /// Holds the banks in the order they were added
+    std::vector<Record> m_records;
+};
+
+/**
+ * Read-only index of banks, loaded from a snapshot written by
+ * \p BankDirectoryBuilder. Snapshot files are memory mapped, so opening a
+ * directory costs a single pass over its entries and its pages are shared by
+ * all processes using the same file. Lookups are binary searches within the
+ * entries of one country and do not allocate memory.
+ *
+ * The snapshot consists of a 16 byte header ("IBANBNK1", the number of
+ * entries and the size of the string pool as 32 bit numbers), the entries of
+ * 32 bytes sorted by their key (country code, bank code and branch code padded
+ * with zeros to 24 bytes, then the offset of the bank's strings as 32 bit
+ * number and the lengths of BIC and name as 16 bit numbers) and the string
+ * pool. Numbers are stored in host byte order.
+ */
+class BankDirectory {
+public:
+    static std::unique_ptr<BankDirectory> open(const std::string& path);
+    static std::unique_ptr<BankDirectory> fromBuffer(std::vector<char> snapshot);
+    ~BankDirectory();
+
+    BankDirectory(const BankDirectory&) = delete;
+    BankDirectory& operator=(const BankDirectory&) = delete;
+
+    bool find(StringView countryCode, StringView bankCode, StringView branchCode,
+              BankEntry& result) const noexcept;
+    bool find(const CompactIBAN& iban, BankEntry& result) const noexcept;
+    size_t size() const noexcept;
+
+private:
+    BankDirectory() noexcept;
+    void load(const char* data, size_t size);
+    bool findKey(const char* key, size_t country, BankEntry& result) const noexcept;
+
+    /// Holds the snapshot if it was passed as buffer
+    std::vector<char> m_buffer;
+    /// Holds the mapping of the snapshot file or \p nullptr
+    void* m_mapping;
+    /// Holds the size of \p m_mapping
+    size_t m_mappingSize;
+    /// Points to the first entry of the snapshot
+    const char* m_entries;
+    /// Points to the string pool of the snapshot
+    const char* m_strings;
+    /// Holds the number of entries
+    size_t m_count;
+    /// Holds the index of the first entry per country code and the number of
+    /// entries at the end, so the entries of country \p i are those from
+    /// \p m_countries[i] to \p m_countries[i + 1]
+    std::vector<uint32_t> m_countries;
+};
+
+void setBankDirectory(std::unique_ptr<BankDirectory> directory);
+const BankDirectory* getBankDirectory() noexcept;
+bool lookupBank(const CompactIBAN& iban, BankInfo& result) noexcept;
+bool lookupBank(const IBAN& iban, BankInfo& result) noexcept;
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_BANKDIRECTORY_H
@@ -0,0 +1,438 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        batch.cpp
+ * \brief       Source file implementing batch validation of IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p validateBatch(), which validates many IBANs
+ * with SIMD kernels selected at runtime.
+ *
+ * The vector kernels validate one IBAN per iteration in machine form and use
+ * the linearity of the remainder: an IBAN's remainder is the sum of its
+ * characters' values, each multiplied by 10 to the power of the number of
+ * digits following the character in the numerical string, modulo 97. The
+ * weights only depend on the country (which fixes the length) and on which
+ * positions hold letters (which expand to two digits), so they are computed
+ * once per combination and reused for all following IBANs of the batch. The
+ * structure check and the remainder then take a handful of vector
+ * instructions. Every IBAN the vector kernels cannot decide on their own is
+ * handed to \p IBAN::tryParse(), so all kernels return the same results.
+ * If a table was set by \p setCountryTable(), the vector kernels only handle
+ * the countries whose current format equals the compiled-in one.
+ */
+
+#include "libiban.h"
+#include "countrytable.h"
+#include "epoch.h"
+#include "national.h"
+#include "stats.h"
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LIBIBAN_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define LIBIBAN_X86_KERNELS 0
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Number of characters of an IBAN processed by the vector kernels;
+        /// longer IBANs are handed to the scalar kernel
+        constexpr size_t vectorWidth = 32;
+
+        /// Marks an empty entry of the weight cache; no IBAN has letters at
+        /// the positions of its check sum
+        constexpr uint32_t noLetters = 0xFFFFFFFFu;
+
+        /// Per-country masks of the vector kernels
+        struct CountryProfile {
+            /// 0xFF where the machine form allows a digit
+            uint8_t digits[vectorWidth];
+            /// 0xFF where the machine form allows a letter
+            uint8_t letters[vectorWidth];
+            /// 0xFF behind the end of the machine form
+            uint8_t ignore[vectorWidth];
+            /// Bit mask of the positions of the machine form
+            uint32_t positions;
+            /// Length of the machine form
+            uint32_t length;
+        };
+
+        /// Profiles of all countries fitting into the vector kernels
+        struct ProfileTable {
+            /// Index into \p profiles plus one per country code; 0 if the
+            /// country is unknown or its IBANs are too long
+            uint8_t slots[countryCodeCount];
+            /// The profiles
+            CountryProfile profiles[countryFormatCount];
+
+            ProfileTable() noexcept : slots(), profiles() {
+                for (size_t i = 0; i < countryFormatCount; ++i) {
+                    const char* code = CountryRegistry::formats[i].countryCode;
+                    const BBANStructure* structure = getBBANStructure(code[0], code[1]);
+                    const size_t length = structure ? structure->length + 4u : 0;
+                    if (length == 0 || length > vectorWidth) {
+                        continue;
+                    }
+                    CountryProfile& profile = profiles[i];
+                    for (size_t p = 0; p < vectorWidth; ++p) {
+                        uint8_t charClass = p < 2 ? BBANStructure::Letter :
+                                            p < 4 ? BBANStructure::Digit :
+                                            p < length ? structure->classes[p - 4] : 0;
+                        profile.digits[p] = (charClass & BBANStructure::Digit) ? 0xFF : 0;
+                        profile.letters[p] = (charClass & BBANStructure::Letter) ? 0xFF : 0;
+                        profile.ignore[p] = p < length ? 0 : 0xFF;
+                    }
+                    profile.positions = length == 32 ? 0xFFFFFFFFu : (1u << length) - 1;
+                    profile.length = static_cast<uint32_t>(length);
+                    slots[getCountryIndex(code[0], code[1])] = static_cast<uint8_t>(i + 1);
+                }
+            }
+        };
+
+        /// Returns the profile table, which is built on first use
+        const ProfileTable& getProfileTable() noexcept {
+            static const ProfileTable table;
+            return table;
+        }
+
+        /// Weights of the characters of a country's IBANs with letters at the
+        /// positions given by \p letters
+        struct WeightCache {
+            /// Bit mask of the positions holding letters
+            uint32_t letters;
+            /// Weight per position; 0 behind the end of the IBAN
+            int8_t weights[vectorWidth];
+        };
+
+        /**
+         * Computes the weights of the characters of an IBAN in machine form:
+         * the powers of 10 (modulo 97) given by the number of digits following
+         * each character once the IBAN is rearranged and made numerical.
+         */
+        void computeWeights(size_t length, uint32_t letters, int8_t* weights) noexcept {
+            std::memset(weights, 0, vectorWidth);
+            unsigned power = 1;
+            auto assign = [&](size_t p) {
+                weights[p] = static_cast<int8_t>(power);
+                power = power * (((letters >> p) & 1) ? 100 : 10) % 97;
+            };
+            // the check sum and country code are the last characters of the
+            // rearranged IBAN, preceded by the BBAN
+            for (size_t p = 4; p-- > 0;) {
+                assign(p);
+            }
+            for (size_t p = length; p-- > 4;) {
+                assign(p);
+            }
+        }
+
+        /// Returns the weights for \p letters, computing them on a cache miss
+        inline const int8_t* getWeights(WeightCache& cache, size_t length,
+                                        uint32_t letters) noexcept {
+            if (cache.letters != letters) {
+                computeWeights(length, letters, cache.weights);
+                cache.letters = letters;
+            }
+            return cache.weights;
+        }
+
+        /// Returns the data the vector kernels load an IBAN from: the string
+        /// itself if loading \p vectorWidth bytes does not cross a page
+        /// boundary (and thus cannot fault), a copy in \p buffer otherwise
+        inline const char* getLoadSource(const char* iban, size_t length,
+                                         char* buffer) noexcept {
+            if ((reinterpret_cast<uintptr_t>(iban) & 4095) <= 4096 - vectorWidth) {
+                return iban;
+            }
+            std::memcpy(buffer, iban, length);
+            return buffer;
+        }
+
+        /// Returns the profile for an IBAN or \p nullptr if the vector kernels
+        /// cannot handle it, which includes countries whose format in
+        /// \p countries (if given) differs from the compiled-in one on \p day
+        inline const CountryProfile* getProfile(const ProfileTable& table, const char* iban, size_t length,
+                                                const CountryTable* countries, uint32_t day) noexcept {
+            if (length < 5 || length > vectorWidth) {
+                return nullptr;
+            }
+            const size_t index = getCountryIndex(iban[0], iban[1]);
+            const size_t slot = index < countryCodeCount ? table.slots[index] : 0;
+            if (slot == 0 || table.profiles[slot - 1].length != length) {
+                return nullptr;
+            }
+            if (countries) {
+                const CountryTableEntry* entry = countries->findEntry(iban[0], iban[1], day);
+                if (!entry || !entry->compiledIn) {
+                    return nullptr;
+                }
+            }
+            return &table.profiles[slot - 1];
+        }
+
+        /// Validates a single IBAN with \p IBAN::tryParse()
+        inline uint8_t validateScalar(const char* iban, size_t length) noexcept {
+            return static_cast<uint8_t>(IBAN::tryParse(StringView(iban, length)));
+        }
+
+        /// Verifies the national check digits of an IBAN that passed the IBAN
+        /// check, normalizing it first unless it is in machine form already.
+        /// The checks know the compiled-in formats only, so IBANs of countries
+        /// whose format in \p countries (if given) differs are not verified.
+        inline uint8_t validateNational(const char* iban, size_t length, const CountryTable* countries,
+                                        uint32_t day) noexcept {
+            StringView machineForm(iban, length);
+            const BBANStructure* structure = getBBANStructure(iban[0], iban[1]);
+            char normalized[maxIBANLength];
+            if (!structure || !structure->matches(iban + 4, length - 4)) {
+                size_t normalizedLength = 0;
+                IBAN::tryParse(machineForm, normalized, &normalizedLength);
+                machineForm = StringView(normalized, normalizedLength);
+            }
+            if (countries) {
+                const CountryTableEntry* entry = countries->findEntry(machineForm[0], machineForm[1], day);
+                if (!entry || !entry->compiledIn) {
+                    return static_cast<uint8_t>(ParseStatus::OK);
+                }
+            }
+            return static_cast<uint8_t>(checkNationalDigits(machineForm) ? ParseStatus::OK :
+                                        ParseStatus::NationalChecksumMismatch);
+        }
+
+        /// Portable kernel
+        void validateBatchScalar(const char* const* ibans, const uint8_t* lengths,
+                                 size_t count, uint8_t* results) noexcept {
+            for (size_t i = 0; i < count; ++i) {
+                results[i] = validateScalar(ibans[i], lengths[i]);
+            }
+        }
+
+#if LIBIBAN_X86_KERNELS
+        /// Kernel using SSE4.2 instructions; processes an IBAN in two halves
+        __attribute__((target("sse4.2"), no_sanitize_address))
+        void validateBatchSSE42(const char* const* ibans, const uint8_t* lengths,
+                                size_t count, uint8_t* results, const CountryTable* countries,
+                                uint32_t day) noexcept {
+            const ProfileTable& table = getProfileTable();
+            WeightCache caches[countryFormatCount];
+            for (auto& cache : caches) {
+                cache.letters = noLetters;
+            }
+            char buffer[vectorWidth];
+            const __m128i zero = _mm_set1_epi8('0'), upperA = _mm_set1_epi8('A');
+            const __m128i nine = _mm_set1_epi8(9), twentyFive = _mm_set1_epi8(25);
+            const __m128i ten = _mm_set1_epi8(10), ones = _mm_set1_epi16(1);
+
+            for (size_t i = 0; i < count; ++i) {
+                const char* iban = ibans[i];
+                const size_t length = lengths[i];
+                const CountryProfile* profile = getProfile(table, iban, length, countries, day);
+                if (!profile) {
+                    results[i] = validateScalar(iban, length);
+                    continue;
+                }
+                const char* source = getLoadSource(iban, length, buffer);
+
+                uint32_t allowed = 0, letters = 0;
+                __m128i values[2];
+                for (size_t half = 0; half < 2; ++half) {
+                    const size_t offset = half * 16;
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + offset));
+                    const __m128i d = _mm_sub_epi8(v, zero);
+                    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+                    const __m128i u = _mm_sub_epi8(v, upperA);
+                    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(u, twentyFive), u);
+                    const __m128i ok = _mm_or_si128(
+                            _mm_or_si128(_mm_and_si128(isDigit, _mm_loadu_si128(reinterpret_cast<const __m128i*>(profile->digits + offset))),
+                                         _mm_and_si128(isLetter, _mm_loadu_si128(reinterpret_cast<const __m128i*>(profile->letters + offset)))),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(profile->ignore + offset)));
+                    allowed |= static_cast<uint32_t>(_mm_movemask_epi8(ok)) << offset;
+                    letters |= static_cast<uint32_t>(_mm_movemask_epi8(isLetter)) << offset;
+                    values[half] = _mm_blendv_epi8(d, _mm_add_epi8(u, ten), isLetter);
+                }
+                if (allowed != 0xFFFFFFFFu) {
+                    // let the scalar kernel find the reason
+                    results[i] = validateScalar(iban, length);
+                    continue;
+                }
+
+                const int8_t* weights = getWeights(caches[profile - table.profiles], length,
+                                                   letters & profile->positions);
+                __m128i sums = _mm_add_epi32(
+                        _mm_madd_epi16(_mm_maddubs_epi16(values[0], _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights))), ones),
+                        _mm_madd_epi16(_mm_maddubs_epi16(values[1], _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + 16))), ones));
+                sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0x4E));
+                sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0xB1));
+                const uint32_t remainder = static_cast<uint32_t>(_mm_cvtsi128_si32(sums)) % 97;
+                results[i] = static_cast<uint8_t>(remainder == 1 ? ParseStatus::OK :
+                                                  ParseStatus::ChecksumMismatch);
+            }
+        }
+
+        /// Kernel using AVX2 instructions; processes an IBAN in one register
+        __attribute__((target("avx2"), no_sanitize_address))
+        void validateBatchAVX2(const char* const* ibans, const uint8_t* lengths,
+                               size_t count, uint8_t* results, const CountryTable* countries,
+                               uint32_t day) noexcept {
+            const ProfileTable& table = getProfileTable();
+            WeightCache caches[countryFormatCount];
+            for (auto& cache : caches) {
+                cache.letters = noLetters;
+            }
+            char buffer[vectorWidth];
+            const __m256i zero = _mm256_set1_epi8('0'), upperA = _mm256_set1_epi8('A');
+            const __m256i nine = _mm256_set1_epi8(9), twentyFive = _mm256_set1_epi8(25);
+            const __m256i ten = _mm256_set1_epi8(10), ones = _mm256_set1_epi16(1);
+
+            for (size_t i = 0; i < count; ++i) {
+                const char* iban = ibans[i];
+                const size_t length = lengths[i];
+                const CountryProfile* profile = getProfile(table, iban, length, countries, day);
+                if (!profile) {
+                    results[i] = validateScalar(iban, length);
+                    continue;
+                }
+                const char* source = getLoadSource(iban, length, buffer);
+
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+                const __m256i d = _mm256_sub_epi8(v, zero);
+                const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d);
+                const __m256i u = _mm256_sub_epi8(v, upperA);
+                const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(u, twentyFive), u);
+                const __m256i ok = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_and_si256(isDigit, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(profile->digits))),
+                                        _mm256_and_si256(isLetter, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(profile->letters)))),
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(profile->ignore)));
+                if (static_cast<uint32_t>(_mm256_movemask_epi8(ok)) != 0xFFFFFFFFu) {
+                    // let the scalar kernel find the reason
+                    results[i] = validateScalar(iban, length);
+                    continue;
+                }
+
+                const uint32_t letters = static_cast<uint32_t>(_mm256_movemask_epi8(isLetter)) &
+                                         profile->positions;
+                const int8_t* weights = getWeights(caches[profile - table.profiles], length, letters);
+                const __m256i values = _mm256_blendv_epi8(d, _mm256_add_epi8(u, ten), isLetter);
+                const __m256i products = _mm256_madd_epi16(
+                        _mm256_maddubs_epi16(values, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights))), ones);
+                __m128i sums = _mm_add_epi32(_mm256_castsi256_si128(products),
+                                             _mm256_extracti128_si256(products, 1));
+                sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0x4E));
+                sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0xB1));
+                const uint32_t remainder = static_cast<uint32_t>(_mm_cvtsi128_si32(sums)) % 97;
+                results[i] = static_cast<uint8_t>(remainder == 1 ? ParseStatus::OK :
+                                                  ParseStatus::ChecksumMismatch);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Returns the fastest batch validation kernel supported by the CPU. The
+     * CPU is queried on the first call only.
+     *
+     * @return The kernel used by \p validateBatch() with \p BatchKernel::Auto
+     */
+    BatchKernel getBestBatchKernel() noexcept {
+#if LIBIBAN_X86_KERNELS
+        static const BatchKernel best = []() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? BatchKernel::AVX2 :
+                   __builtin_cpu_supports("sse4.2") ? BatchKernel::SSE42 :
+                   BatchKernel::Scalar;
+        }();
+        return best;
+#else
+        return BatchKernel::Scalar;
+#endif
+    }
+
+    /**
+     * Validates \p count IBANs at once and stores one \p ParseStatus per IBAN
+     * (cast to \p uint8_t) in \p results. Each result equals the status
+     * \p IBAN::tryParse() returns for the IBAN, but IBANs in machine form are
+     * validated much faster. Neither exceptions are thrown nor memory is
+     * allocated.
+     *
+     * If \p kernel is not supported by the CPU, the fastest supported kernel
+     * is used instead.
+     *
+     * @param ibans Pointers to the IBAN strings, which need not be null
+     * terminated
+     * @param lengths The lengths of the IBAN strings
+     * @param count The number of IBANs
+     * @param results Array of \p count elements receiving the results
+     * @param kernel The kernel to use (default: the fastest one)
+     * @param nationalCheckDigits Whether to verify the check digits embedded
+     * in the BBANs as well, reported as
+     * \p ParseStatus::NationalChecksumMismatch (default: \p false); skipped
+     * for countries whose format in the country table differs from the
+     * compiled-in one
+     */
+    void validateBatch(const char* const* ibans, const uint8_t* lengths, size_t count,
+                       uint8_t* results, BatchKernel kernel, bool nationalCheckDigits) noexcept {
+        LIBIBAN_STATS_BATCH_SCOPE();
+        // a table set by setCountryTable() stays alive until the batch is done
+        EpochGuard guard;
+        const CountryTable* countries = getCountryTable();
+        const uint32_t day = countries ? getCurrentDay() : 0;
+        const BatchKernel best = getBestBatchKernel();
+        if (kernel == BatchKernel::Auto || static_cast<int>(kernel) > static_cast<int>(best)) {
+            kernel = best;
+        }
+        // the national checks follow block by block, while the IBANs of a
+        // block are still cached
+        const size_t blockSize = nationalCheckDigits ? 256 : count;
+        for (size_t begin = 0; begin < count; begin += blockSize) {
+            const size_t size = std::min(blockSize, count - begin);
+            switch (kernel) {
+#if LIBIBAN_X86_KERNELS
+                case BatchKernel::AVX2:
+                    validateBatchAVX2(ibans + begin, lengths + begin, size, results + begin, countries, day);
+                    break;
+                case BatchKernel::SSE42:
+                    validateBatchSSE42(ibans + begin, lengths + begin, size, results + begin, countries, day);
+                    break;
+#endif
+                default:
+                    validateBatchScalar(ibans + begin, lengths + begin, size, results + begin);
+            }
+            if (!nationalCheckDigits) {
+                continue;
+            }
+            for (size_t i = begin; i < begin + size; ++i) {
+                if (results[i] == static_cast<uint8_t>(ParseStatus::OK)) {
+                    results[i] = validateNational(ibans[i], lengths[i], countries, day);
+                }
+            }
+        }
+        LIBIBAN_STATS_BATCH(ibans, lengths, count, results);
+    }
+}
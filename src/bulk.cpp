@@ -0,0 +1,323 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        bulk.cpp
+ * \brief       Source file implementing the multi-threaded bulk validator
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the class \p BulkValidator.
+ */
+
+#include "bulk.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Number of records handed to \p validateBatch() at once
+        constexpr size_t batchSize = 256;
+
+        /// Pins the calling thread to CPU \p cpu; ignored on failure and on
+        /// platforms without thread affinity
+        void pinCurrentThread(size_t cpu) noexcept {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(static_cast<int>(cpu % CPU_SETSIZE), &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void) cpu;
+#endif
+        }
+
+        /// Returns the length of a record without a trailing carriage return
+        inline size_t trimRecord(const char* record, size_t length) noexcept {
+            return (length > 0 && record[length - 1] == '\r') ? length - 1 : length;
+        }
+
+        /// Validates the records of a chunk and stores their statuses in
+        /// \p results
+        void validateChunk(const char* begin, const char* end, uint8_t* results) noexcept {
+            const char* ibans[batchSize];
+            uint8_t lengths[batchSize];
+            size_t pending = 0;
+            while (begin < end) {
+                const char* newline = static_cast<const char*>(
+                        std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+                const char* recordEnd = newline ? newline : end;
+                const size_t length = trimRecord(begin, static_cast<size_t>(recordEnd - begin));
+                if (length > 0xFF) {
+                    // too long for a batch, but may still hold an IBAN with spaces
+                    validateBatch(ibans, lengths, pending, results);
+                    results += pending;
+                    pending = 0;
+                    *results++ = static_cast<uint8_t>(IBAN::tryParse(StringView(begin, length)));
+                } else {
+                    ibans[pending] = begin;
+                    lengths[pending] = static_cast<uint8_t>(length);
+                    if (++pending == batchSize) {
+                        validateBatch(ibans, lengths, pending, results);
+                        results += pending;
+                        pending = 0;
+                    }
+                }
+                begin = recordEnd + 1;
+            }
+            validateBatch(ibans, lengths, pending, results);
+        }
+    }
+
+    constexpr size_t BulkValidator::defaultChunkSize;
+
+    /**
+     * Constructs a validator and starts its worker threads.
+     *
+     * @param threads The number of worker threads; 0 uses one per hardware thread
+     * @param pinThreads If \p true, worker \p i is pinned to CPU \p i (Linux only)
+     * @param chunkSize The size of the chunks in bytes, at least 1
+     */
+    BulkValidator::BulkValidator(size_t threads, bool pinThreads, size_t chunkSize) :
+            m_chunkSize(std::max<size_t>(chunkSize, 1)), m_task(nullptr), m_generation(0),
+            m_finished(0), m_stop(false) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_queues.reset(new TaskQueue[threads]);
+        m_threads.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this, i, pinThreads]() {
+                if (pinThreads) {
+                    pinCurrentThread(i);
+                }
+                workerLoop(i);
+            });
+        }
+    }
+
+    /**
+     * Stops and joins the worker threads.
+     */
+    BulkValidator::~BulkValidator() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * @return The number of worker threads
+     */
+    size_t BulkValidator::getThreadCount() const noexcept {
+        return m_threads.size();
+    }
+
+    /**
+     * Returns the size of the chunks the buffers are split into.
+     *
+     * @return The chunk size in bytes
+     */
+    size_t BulkValidator::getChunkSize() const noexcept {
+        return m_chunkSize;
+    }
+
+    /**
+     * Counts the records of a buffer. Records are separated by newlines; a
+     * newline at the very end of the buffer does not start another record.
+     *
+     * @param data The buffer
+     * @param size The size of the buffer in bytes
+     * @return The number of records
+     */
+    size_t BulkValidator::countRecords(const char* data, size_t size) noexcept {
+        if (size == 0) {
+            return 0;
+        }
+        size_t count = data[size - 1] == '\n' ? 0 : 1;
+        const char* end = data + size;
+        while ((data = static_cast<const char*>(
+                std::memchr(data, '\n', static_cast<size_t>(end - data)))) != nullptr) {
+            ++count;
+            ++data;
+        }
+        return count;
+    }
+
+    /**
+     * Validates a buffer of newline delimited IBANs. A carriage return ending a
+     * record is ignored, so files with Windows line endings work, too.
+     *
+     * @param data The buffer
+     * @param size The size of the buffer in bytes
+     * @return One \p ParseStatus (cast to \p uint8_t) per record in input order
+     */
+    std::vector<uint8_t> BulkValidator::validate(const char* data, size_t size) {
+        std::vector<uint8_t> results;
+        validate(data, size, results);
+        return results;
+    }
+
+    /**
+     * Validates a buffer of newline delimited IBANs; see
+     * \p validate(const char*, size_t).
+     *
+     * @param data The buffer
+     * @param size The size of the buffer in bytes
+     * @param results Receives one \p ParseStatus (cast to \p uint8_t) per
+     * record in input order
+     */
+    void BulkValidator::validate(const char* data, size_t size, std::vector<uint8_t>& results) {
+        // split the buffer behind the first newline following each multiple
+        // of the chunk size
+        std::vector<const char*> bounds(1, data);
+        const char* end = data + size;
+        while (static_cast<size_t>(end - bounds.back()) > m_chunkSize) {
+            const char* from = bounds.back() + m_chunkSize - 1;
+            const char* newline = static_cast<const char*>(
+                    std::memchr(from, '\n', static_cast<size_t>(end - from)));
+            if (!newline || newline + 1 == end) {
+                break;
+            }
+            bounds.push_back(newline + 1);
+        }
+        bounds.push_back(end);
+        const size_t chunks = bounds.size() - 1;
+
+        std::vector<size_t> offsets(chunks + 1, 0);
+        runTasks(chunks, [&](size_t chunk) {
+            offsets[chunk + 1] = countRecords(bounds[chunk],
+                                              static_cast<size_t>(bounds[chunk + 1] - bounds[chunk]));
+        });
+        for (size_t i = 0; i < chunks; ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        results.assign(offsets.back(), 0);
+        uint8_t* output = results.data();
+        runTasks(chunks, [&](size_t chunk) {
+            validateChunk(bounds[chunk], bounds[chunk + 1], output + offsets[chunk]);
+        });
+    }
+
+    /**
+     * Calls \p task for every index in [0, \p count) on the worker threads and
+     * waits until all calls returned.
+     *
+     * @param count The number of tasks
+     * @param task The function to call with each index
+     */
+    void BulkValidator::runTasks(size_t count, const std::function<void(size_t)>& task) {
+        if (count == 0) {
+            return;
+        }
+        // give every worker a contiguous range of chunks
+        const size_t workers = m_threads.size();
+        for (size_t w = 0; w < workers; ++w) {
+            std::lock_guard<std::mutex> lock(m_queues[w].mutex);
+            for (size_t i = count * w / workers; i < count * (w + 1) / workers; ++i) {
+                m_queues[w].tasks.push_back(i);
+            }
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_finished = 0;
+        ++m_generation;
+        m_wake.notify_all();
+        m_done.wait(lock, [this, workers]() { return m_finished == workers; });
+        m_task = nullptr;
+    }
+
+    /**
+     * Body of the worker threads: waits for jobs and works on them until the
+     * instance is destroyed.
+     *
+     * @param worker The index of the worker
+     */
+    void BulkValidator::workerLoop(size_t worker) {
+        size_t generation = 0;
+        for (;;) {
+            const std::function<void(size_t)>* task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+                if (m_stop) {
+                    return;
+                }
+                generation = m_generation;
+                task = m_task;
+            }
+            size_t index;
+            while (popTask(worker, index)) {
+                (*task)(index);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_finished;
+            }
+            m_done.notify_one();
+        }
+    }
+
+    /**
+     * Takes the next task from the front of the worker's own queue or steals
+     * one from the back of another worker's queue.
+     *
+     * @param worker The index of the worker
+     * @param task Receives the task
+     * @return \p false if all queues are empty
+     */
+    bool BulkValidator::popTask(size_t worker, size_t& task) {
+        const size_t workers = m_threads.size();
+        for (size_t i = 0; i < workers; ++i) {
+            const size_t victim = (worker + i) % workers;
+            TaskQueue& queue = m_queues[victim];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (victim == worker) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            } else {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+}
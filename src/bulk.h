@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        bulk.h
+ * \brief       Header file declaring the multi-threaded bulk validator
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the class \p BulkValidator, which validates large
+ * buffers of newline delimited IBANs on all cores.
+ */
+
+#ifndef LIBIBAN_BULK_H
+#define LIBIBAN_BULK_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/**
+ * Validates buffers of newline delimited IBANs with a pool of worker threads.
+ *
+ * The buffer is split into chunks of about \p getChunkSize() bytes at record
+ * boundaries. The workers first count the records of every chunk, which gives
+ * each chunk its offset in the result array, and then validate the chunks
+ * with \p validateBatch(). Chunks are distributed evenly over per-worker
+ * queues; a worker running out of chunks steals from the back of the other
+ * queues. Besides the queues, the workers only share read-only data, so they
+ * do not contend with each other.
+ *
+ * The worker threads are started by the constructor and live as long as the
+ * instance. \p validate() must not be called concurrently on one instance.
+ */
+class BulkValidator {
+public:
+    /// Default size of the chunks in bytes; small enough for a chunk to stay
+    /// in the core's cache between counting and validating it
+    static constexpr size_t defaultChunkSize = 64 * 1024;
+
+    explicit BulkValidator(size_t threads = 0, bool pinThreads = false,
+                           size_t chunkSize = defaultChunkSize);
+    ~BulkValidator();
+
+    BulkValidator(const BulkValidator&) = delete;
+    BulkValidator& operator=(const BulkValidator&) = delete;
+
+    std::vector<uint8_t> validate(const char* data, size_t size);
+    void validate(const char* data, size_t size, std::vector<uint8_t>& results);
+
+    size_t getThreadCount() const noexcept;
+    size_t getChunkSize() const noexcept;
+
+    static size_t countRecords(const char* data, size_t size) noexcept;
+
+private:
+    /// Queue of chunk indices owned by one worker
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void runTasks(size_t count, const std::function<void(size_t)>& task);
+    void workerLoop(size_t worker);
+    bool popTask(size_t worker, size_t& task);
+
+    /// Size of the chunks in bytes
+    size_t m_chunkSize;
+    /// The worker threads
+    std::vector<std::thread> m_threads;
+    /// One queue per worker
+    std::unique_ptr<TaskQueue[]> m_queues;
+    /// Guards the members below
+    std::mutex m_mutex;
+    /// Signals the workers that a new job is available or that they must stop
+    std::condition_variable m_wake;
+    /// Signals \p runTasks() that a worker finished the current job
+    std::condition_variable m_done;
+    /// The task of the current job; called with the index of a chunk
+    const std::function<void(size_t)>* m_task;
+    /// Incremented for every job
+    size_t m_generation;
+    /// Number of workers that finished the current job
+    size_t m_finished;
+    /// Set when the instance is destroyed
+    bool m_stop;
+};
+}
+
+#endif //LIBIBAN_BULK_H
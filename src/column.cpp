@@ -0,0 +1,421 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        column.cpp
+ * \brief       Source file implementing the columnar IBAN container
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the class \p IBANColumn.
+ */
+
+#include "column.h"
+#include <limits>
+#include "countrytable.h"
+#include "normalize.h"
+#include "utils.h"
+
+namespace IBAN {
+
+    namespace {
+        /// Number of rows turned back into machine forms at once by
+        /// IBANColumn::validate()
+        constexpr size_t validateBlockSize = 256;
+    }
+
+    /**
+     * Constructs an empty column.
+     */
+    IBANColumn::IBANColumn() : m_offsets(1, 0) {
+    }
+
+    /**
+     * Builds a column from a buffer of delimited IBANs, e.g. one per line. A
+     * delimiter at the very end does not start another row; if the delimiter
+     * is a newline, a carriage return ending a row is ignored.
+     *
+     * @param data The buffer
+     * @param size The size of the buffer in bytes
+     * @param delimiter The character separating the IBANs (default: newline)
+     * @return The column
+     */
+    IBANColumn IBANColumn::fromBuffer(const char* data, size_t size, char delimiter) {
+        IBANColumn column;
+        // most IBANs have about 24 characters
+        column.reserve(size / 24 + 1, size);
+        const char* end = data + size;
+        while (data < end) {
+            const char* next = static_cast<const char*>(
+                    std::memchr(data, delimiter, static_cast<size_t>(end - data)));
+            const char* rowEnd = next ? next : end;
+            size_t length = static_cast<size_t>(rowEnd - data);
+            if (delimiter == '\n' && length > 0 && data[length - 1] == '\r') {
+                --length;
+            }
+            column.append(StringView(data, length));
+            data = rowEnd + 1;
+        }
+        return column;
+    }
+
+    /**
+     * Appends an IBAN, normalized by \p normalizeIBAN() just as
+     * \p IBAN::tryParse() does. If \p input is not shaped like an IBAN (two
+     * letters, two digits and up to 30 letters or digits), a null row is
+     * appended; its status is the one \p IBAN::tryParse() returns. Nothing
+     * depending on the registry is checked here, so a table set by
+     * \p setCountryTable() later applies to all rows; see \p validate().
+     *
+     * @param input The IBAN
+     * @return \p false if a null row was appended
+     */
+    bool IBANColumn::append(StringView input) {
+        char machineForm[maxIBANLength];
+        size_t length = 0;
+        const ParseStatus status = normalizeIBAN(input, machineForm, &length);
+        if (status != ParseStatus::OK) {
+            appendNull(status);
+            return false;
+        }
+        if (length < 5) {
+            appendNull(ParseStatus::InvalidLength);
+            return false;
+        }
+        const size_t country = getCountryIndex(machineForm[0], machineForm[1]);
+        if (country == countryCodeCount) {
+            appendNull(ParseStatus::InvalidCountryCode);
+            return false;
+        }
+        if (BBANStructure::classify(machineForm[2]) != BBANStructure::Digit ||
+            BBANStructure::classify(machineForm[3]) != BBANStructure::Digit) {
+            // an unknown country takes precedence, see validate()
+            appendNull(ParseStatus::InvalidChecksumDigits, static_cast<uint16_t>(country));
+            return false;
+        }
+        appendRow(static_cast<uint16_t>(country),
+                  static_cast<uint8_t>((machineForm[2] - '0') * 10 + (machineForm[3] - '0')),
+                  machineForm + 4, length - 4);
+        return true;
+    }
+
+    /**
+     * Appends many IBANs; see \p append(StringView).
+     *
+     * @param inputs Pointers to the IBAN strings
+     * @param lengths The lengths of the IBAN strings
+     * @param count The number of IBANs
+     */
+    void IBANColumn::append(const char* const* inputs, const uint8_t* lengths, size_t count) {
+        reserve(size() + count, m_bbans.size() + count * 20);
+        for (size_t i = 0; i < count; ++i) {
+            append(StringView(inputs[i], lengths[i]));
+        }
+    }
+
+    /**
+     * Reserves memory for a number of rows.
+     *
+     * @param rows The total number of rows
+     * @param bbanBytes The total number of characters of the BBANs
+     */
+    void IBANColumn::reserve(size_t rows, size_t bbanBytes) {
+        m_countries.reserve(rows);
+        m_checksums.reserve(rows);
+        m_offsets.reserve(rows + 1);
+        m_bbans.reserve(bbanBytes);
+        m_validity.reserve((rows + 7) / 8);
+    }
+
+    /**
+     * Removes all rows.
+     */
+    void IBANColumn::clear() noexcept {
+        m_countries.clear();
+        m_checksums.clear();
+        m_offsets.assign(1, 0);
+        m_bbans.clear();
+        m_validity.clear();
+        m_nullStatuses.clear();
+    }
+
+    /**
+     * Tests if a row is null.
+     *
+     * @param row The index of the row
+     * @return \p true if the input of the row was not shaped like an IBAN
+     */
+    bool IBANColumn::isNull(size_t row) const noexcept {
+        return !((m_validity[row / 8] >> (row % 8)) & 1);
+    }
+
+    /**
+     * Returns a row as \p CompactIBAN.
+     *
+     * @param row The index of the row
+     * @return The IBAN of the row or an empty instance if the row is null
+     */
+    CompactIBAN IBANColumn::get(size_t row) const noexcept {
+        if (isNull(row)) {
+            return CompactIBAN();
+        }
+        char machineForm[maxIBANLength] = {
+            static_cast<char>('A' + m_countries[row] / 26), static_cast<char>('A' + m_countries[row] % 26),
+            static_cast<char>('0' + m_checksums[row] / 10), static_cast<char>('0' + m_checksums[row] % 10)
+        };
+        const size_t length = static_cast<size_t>(m_offsets[row + 1] - m_offsets[row]);
+        std::memcpy(machineForm + 4, m_bbans.data() + m_offsets[row], length);
+        return CompactIBAN(StringView(machineForm, length + 4));
+    }
+
+    /**
+     * Validates all rows and stores one \p ParseStatus (cast to \p uint8_t)
+     * per row in \p results; each equals the status \p IBAN::tryParse()
+     * returns for the row's input, including the use of a table set by
+     * \p setCountryTable(). The rows are turned back into machine forms block
+     * by block and handed to the kernels of \p validateBatch(), so a block
+     * stays in the cache while it is validated.
+     *
+     * @param results Array of \p size() elements receiving the results
+     */
+    void IBANColumn::validate(uint8_t* results) const noexcept {
+        char machineForms[validateBlockSize][maxIBANLength];
+        const char* pointers[validateBlockSize];
+        uint8_t lengths[validateBlockSize];
+        uint32_t blockRows[validateBlockSize];
+        uint8_t blockResults[validateBlockSize];
+        const size_t rows = size();
+        auto nullStatus = m_nullStatuses.begin();
+        size_t row = 0;
+        while (row < rows) {
+            // null rows keep the status found by append() and stay out of
+            // the batches
+            size_t count = 0;
+            for (; row < rows && count < validateBlockSize; ++row) {
+                if (nullStatus != m_nullStatuses.end() && nullStatus->row == row) {
+                    const bool unknownCountry = nullStatus->status == ParseStatus::InvalidChecksumDigits &&
+                            !findBBANStructure(static_cast<char>('A' + nullStatus->country / 26),
+                                               static_cast<char>('A' + nullStatus->country % 26));
+                    results[row] = static_cast<uint8_t>(unknownCountry ? ParseStatus::InvalidCountryCode :
+                                                        nullStatus->status);
+                    ++nullStatus;
+                    continue;
+                }
+                char* machineForm = machineForms[count];
+                const uint16_t country = m_countries[row];
+                const size_t length = static_cast<size_t>(m_offsets[row + 1] - m_offsets[row]);
+                machineForm[0] = static_cast<char>('A' + country / 26);
+                machineForm[1] = static_cast<char>('A' + country % 26);
+                machineForm[2] = static_cast<char>('0' + m_checksums[row] / 10);
+                machineForm[3] = static_cast<char>('0' + m_checksums[row] % 10);
+                std::memcpy(machineForm + 4, m_bbans.data() + m_offsets[row], length);
+                pointers[count] = machineForm;
+                lengths[count] = static_cast<uint8_t>(length + 4);
+                blockRows[count++] = static_cast<uint32_t>(row);
+            }
+            validateBatch(pointers, lengths, count, blockResults);
+            for (size_t i = 0; i < count; ++i) {
+                results[blockRows[i]] = blockResults[i];
+            }
+        }
+    }
+
+    /**
+     * Groups the rows by country with a counting sort over the country column.
+     * Null rows are left out.
+     *
+     * @param groups Receives one group per country in ascending order of the
+     * country codes; the rows of a group are found at [\p begin, \p end) of the
+     * returned order
+     * @return The indices of the rows grouped by country, in input order within
+     * each group
+     */
+    std::vector<uint32_t> IBANColumn::groupByCountry(std::vector<CountryGroup>& groups) const {
+        std::vector<uint32_t> counts(countryCodeCount + 1, 0);
+        const size_t rows = size();
+        for (size_t row = 0; row < rows; ++row) {
+            ++counts[m_countries[row] + 1];
+        }
+        // null rows are stored with country index 0
+        counts[1] -= static_cast<uint32_t>(getNullCount());
+
+        groups.clear();
+        for (size_t country = 0; country < countryCodeCount; ++country) {
+            const uint32_t begin = counts[country];
+            counts[country + 1] += begin;
+            if (counts[country + 1] != begin) {
+                CountryGroup group = {{static_cast<char>('A' + country / 26),
+                                       static_cast<char>('A' + country % 26), '\0'},
+                                      begin, counts[country + 1]};
+                groups.push_back(group);
+            }
+        }
+
+        std::vector<uint32_t> order(rows - getNullCount());
+        for (size_t row = 0; row < rows; ++row) {
+            if (!isNull(row)) {
+                order[counts[m_countries[row]]++] = static_cast<uint32_t>(row);
+            }
+        }
+        return order;
+    }
+
+    /**
+     * Returns a new column with the rows of one country.
+     *
+     * @param countryCode The country code
+     * @return The rows whose country is \p countryCode, in input order
+     */
+    IBANColumn IBANColumn::filter(StringView countryCode) const {
+        IBANColumn result;
+        if (countryCode.size() != 2) {
+            return result;
+        }
+        const size_t index = getCountryIndex(countryCode[0], countryCode[1]);
+        if (index == countryCodeCount) {
+            return result;
+        }
+        const uint16_t country = static_cast<uint16_t>(index);
+        const size_t rows = size();
+        // select on the country column first, then gather
+        std::vector<uint32_t> selection;
+        for (size_t row = 0; row < rows; ++row) {
+            if (m_countries[row] == country) {
+                selection.push_back(static_cast<uint32_t>(row));
+            }
+        }
+        result.reserve(selection.size(), selection.size() * (getIBANLength(countryCode[0], countryCode[1]) + 4u));
+        for (const uint32_t row : selection) {
+            if (!isNull(row)) {
+                result.appendRow(country, m_checksums[row], m_bbans.data() + m_offsets[row],
+                                 static_cast<size_t>(m_offsets[row + 1] - m_offsets[row]));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Writes the machine forms of all rows back to back into \p data with
+     * \p size() + 1 offsets into \p offsets, like an Arrow \p utf8 array.
+     * Null rows are empty.
+     *
+     * @param data Receives the characters
+     * @param offsets Receives the offsets
+     */
+    void IBANColumn::formatMachine(std::vector<char>& data, std::vector<int32_t>& offsets) const {
+        const size_t rows = size();
+        data.resize(m_bbans.size() + 4 * (rows - getNullCount()));
+        offsets.resize(rows + 1);
+        char* out = data.data();
+        offsets[0] = 0;
+        for (size_t row = 0; row < rows; ++row) {
+            if (!isNull(row)) {
+                const uint16_t country = m_countries[row];
+                out[0] = static_cast<char>('A' + country / 26);
+                out[1] = static_cast<char>('A' + country % 26);
+                out[2] = static_cast<char>('0' + m_checksums[row] / 10);
+                out[3] = static_cast<char>('0' + m_checksums[row] % 10);
+                const size_t length = static_cast<size_t>(m_offsets[row + 1] - m_offsets[row]);
+                std::memcpy(out + 4, m_bbans.data() + m_offsets[row], length);
+                out += 4 + length;
+            }
+            offsets[row + 1] = static_cast<int32_t>(out - data.data());
+        }
+    }
+
+    /**
+     * Writes the human readable forms (see \p IBAN::getHumanReadable()) of all
+     * rows back to back into \p data with \p size() + 1 offsets into
+     * \p offsets, like an Arrow \p utf8 array. Null rows are empty.
+     *
+     * @param data Receives the characters
+     * @param offsets Receives the offsets
+     */
+    void IBANColumn::formatHumanReadable(std::vector<char>& data, std::vector<int32_t>& offsets) const {
+        const size_t rows = size();
+        // a space before every group of four BBAN characters
+        data.resize(m_bbans.size() + 5 * (rows - getNullCount()) + (m_bbans.size() + 3 * rows) / 4);
+        offsets.resize(rows + 1);
+        char* out = data.data();
+        offsets[0] = 0;
+        for (size_t row = 0; row < rows; ++row) {
+            if (!isNull(row)) {
+                const uint16_t country = m_countries[row];
+                *out++ = static_cast<char>('A' + country / 26);
+                *out++ = static_cast<char>('A' + country % 26);
+                *out++ = static_cast<char>('0' + m_checksums[row] / 10);
+                *out++ = static_cast<char>('0' + m_checksums[row] % 10);
+                const char* bban = m_bbans.data() + m_offsets[row];
+                const size_t length = static_cast<size_t>(m_offsets[row + 1] - m_offsets[row]);
+                for (size_t i = 0; i < length; ++i) {
+                    if (i % 4 == 0) {
+                        *out++ = ' ';
+                    }
+                    *out++ = bban[i];
+                }
+            }
+            offsets[row + 1] = static_cast<int32_t>(out - data.data());
+        }
+        data.resize(static_cast<size_t>(out - data.data()));
+    }
+
+    /**
+     * Appends a row holding an IBAN.
+     *
+     * @throws std::length_error If the BBAN column would exceed the 2 GiB a
+     * 32 bit offset can address
+     */
+    void IBANColumn::appendRow(uint16_t country, uint8_t checksum, const char* bban, size_t length) {
+        if (m_bbans.size() + length > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+            throw std::length_error("IBANColumn exceeds the capacity of 32 bit offsets");
+        }
+        const size_t row = size();
+        if (row % 8 == 0) {
+            m_validity.push_back(0);
+        }
+        m_validity.back() = static_cast<uint8_t>(m_validity.back() | (1u << (row % 8)));
+        m_countries.push_back(country);
+        m_checksums.push_back(checksum);
+        m_bbans.insert(m_bbans.end(), bban, bban + length);
+        m_offsets.push_back(static_cast<int32_t>(m_bbans.size()));
+    }
+
+    /**
+     * Appends a null row.
+     *
+     * @param status The reason why the input is not shaped like an IBAN
+     * @param country The country of an input with malformed check digits
+     */
+    void IBANColumn::appendNull(ParseStatus status, uint16_t country) {
+        const size_t row = size();
+        if (row % 8 == 0) {
+            m_validity.push_back(0);
+        }
+        NullRow nullRow = {static_cast<uint32_t>(row), country, status};
+        m_nullStatuses.push_back(nullRow);
+        m_countries.push_back(0);
+        m_checksums.push_back(0);
+        m_offsets.push_back(m_offsets.back());
+    }
+}
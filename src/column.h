@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        column.h
+ * \brief       Header file declaring the columnar IBAN container
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the class \p IBANColumn, which stores batches of
+ * IBANs column by column in buffers compatible with Apache Arrow.
+ */
+
+#ifndef LIBIBAN_COLUMN_H
+#define LIBIBAN_COLUMN_H
+
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/// Rows of one country in the result of \p IBANColumn::groupByCountry()
+struct CountryGroup {
+    /// The country code of the rows
+    char countryCode[3];
+    /// Index of the group's first row in the row order
+    uint32_t begin;
+    /// Index behind the group's last row in the row order
+    uint32_t end;
+};
+
+/**
+ * Batch of IBANs stored as columns ("structure of arrays"):
+ *
+ * - the country column holds the index of each country code in the registry
+ *   (see \p getCountryIndex()) as \p uint16_t,
+ * - the check sum column holds the check digits as \p uint8_t,
+ * - the BBAN column holds the BBANs back to back with an array of
+ *   \p count + 1 \p int32_t offsets, like an Arrow \p utf8 array,
+ * - the validity bitmap has a bit per row (least significant bit first, as in
+ *   Arrow) that is cleared for inputs that are not shaped like an IBAN; such
+ *   null rows have country index 0, check sum 0 and an empty BBAN.
+ *
+ * The buffers can be handed to Arrow or similar libraries without copying.
+ * Operations work column by column, which keeps the data they touch dense.
+ */
+class IBANColumn {
+public:
+    IBANColumn();
+
+    static IBANColumn fromBuffer(const char* data, size_t size, char delimiter = '\n');
+
+    bool append(StringView input);
+    void append(const char* const* inputs, const uint8_t* lengths, size_t count);
+    void reserve(size_t rows, size_t bbanBytes);
+    void clear() noexcept;
+
+    /**
+     * Returns the number of rows.
+     *
+     * @return The number of rows
+     */
+    size_t size() const noexcept {
+        return m_countries.size();
+    }
+
+    /**
+     * Returns the number of null rows, i.e. inputs not shaped like an IBAN.
+     *
+     * @return The number of null rows
+     */
+    size_t getNullCount() const noexcept {
+        return m_nullStatuses.size();
+    }
+
+    bool isNull(size_t row) const noexcept;
+    CompactIBAN get(size_t row) const noexcept;
+
+    void validate(uint8_t* results) const noexcept;
+    std::vector<uint32_t> groupByCountry(std::vector<CountryGroup>& groups) const;
+    IBANColumn filter(StringView countryCode) const;
+    void formatMachine(std::vector<char>& data, std::vector<int32_t>& offsets) const;
+    void formatHumanReadable(std::vector<char>& data, std::vector<int32_t>& offsets) const;
+
+    /// Returns the country column (one registry index per row)
+    const uint16_t* getCountryIndices() const noexcept {
+        return m_countries.data();
+    }
+
+    /// Returns the check sum column (one value in [0, 99] per row)
+    const uint8_t* getChecksums() const noexcept {
+        return m_checksums.data();
+    }
+
+    /// Returns the \p size() + 1 offsets into the BBAN data
+    const int32_t* getBBANOffsets() const noexcept {
+        return m_offsets.data();
+    }
+
+    /// Returns the characters of all BBANs back to back
+    const char* getBBANData() const noexcept {
+        return m_bbans.data();
+    }
+
+    /// Returns the number of characters of all BBANs
+    size_t getBBANDataSize() const noexcept {
+        return m_bbans.size();
+    }
+
+    /// Returns the validity bitmap with (\p size() + 7) / 8 bytes
+    const uint8_t* getValidityBitmap() const noexcept {
+        return m_validity.data();
+    }
+
+private:
+    /// Reason of a null row
+    struct NullRow {
+        /// The index of the row
+        uint32_t row;
+        /// The country of an input with malformed check digits, whose status
+        /// depends on whether the registry knows the country
+        uint16_t country;
+        /// The reason
+        ParseStatus status;
+    };
+
+    void appendRow(uint16_t country, uint8_t checksum, const char* bban, size_t length);
+    void appendNull(ParseStatus status, uint16_t country = 0);
+
+    /// The country column
+    std::vector<uint16_t> m_countries;
+    /// The check sum column
+    std::vector<uint8_t> m_checksums;
+    /// Offsets of the BBANs in \p m_bbans
+    std::vector<int32_t> m_offsets;
+    /// The BBAN column
+    std::vector<char> m_bbans;
+    /// The validity bitmap
+    std::vector<uint8_t> m_validity;
+    /// Reason of every null row in ascending order of the rows
+    std::vector<NullRow> m_nullStatuses;
+};
+}
+
+#endif //LIBIBAN_COLUMN_H
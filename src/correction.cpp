@@ -0,0 +1,459 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        correction.cpp
+ * \brief       Source file implementing the typo correction of IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p suggestCorrections(). The check sum of an IBAN
+ * is the remainder of its rearranged form (BBAN, country code, check digits),
+ * read as decimal number with letters expanded to two digits, mod 97. With the
+ * remainders of all prefixes and suffixes of the rearranged form computed
+ * once, the remainder of the IBAN with one or two characters replaced takes a
+ * handful of multiplications, as a replaced character only changes its own
+ * digits and the number of digits its prefix is shifted by.
+ *
+ * Pairs of replacements are not enumerated: for two fixed positions and the
+ * digit counts of the new characters the remainder is linear in their values,
+ * so the value of the second character follows from the first one.
+ */
+
+#include "correction.h"
+#include "national.h"
+#include "normalize.h"
+#include <algorithm>
+#include <utility>
+
+namespace IBAN {
+
+    namespace {
+        /// The modulus of the IBAN check sum
+        constexpr unsigned modulus = 97;
+        /// Maximum number of digits of a rearranged IBAN
+        constexpr size_t maxDigits = 2 * maxIBANLength;
+
+        /// Powers of ten and multiplicative inverses mod 97
+        struct Tables {
+            unsigned powers[maxDigits + 1];
+            unsigned inverses[modulus];
+
+            Tables() noexcept : inverses() {
+                powers[0] = 1;
+                for (size_t i = 1; i <= maxDigits; ++i) {
+                    powers[i] = powers[i - 1] * 10 % modulus;
+                }
+                for (unsigned i = 1; i < modulus; ++i) {
+                    for (unsigned j = 1; j < modulus; ++j) {
+                        if (i * j % modulus == 1) {
+                            inverses[i] = j;
+                            break;
+                        }
+                    }
+                }
+            }
+        };
+
+        const Tables& getTables() noexcept {
+            static const Tables tables;
+            return tables;
+        }
+
+        /// Returns the value of a character in the check sum: 0-9 for digits,
+        /// 10-35 for letters
+        inline unsigned charValue(char ch) noexcept {
+            return ch <= '9' ? static_cast<unsigned>(ch - '0') : static_cast<unsigned>(ch - 'A') + 10;
+        }
+
+        /// Returns the number of digits a character expands to
+        inline size_t charDigits(char ch) noexcept {
+            return ch <= '9' ? 1 : 2;
+        }
+
+        /// Remainders of the prefixes and suffixes of a rearranged IBAN
+        class Residues {
+        public:
+            Residues(const char* rearranged, size_t size) noexcept :
+                    m_tables(getTables()), m_prefixes(), m_suffixes(), m_suffixDigits() {
+                for (size_t i = 0; i < size; ++i) {
+                    m_prefixes[i + 1] = (m_prefixes[i] * power(charDigits(rearranged[i])) +
+                                         charValue(rearranged[i])) % modulus;
+                }
+                for (size_t i = size; i-- > 0;) {
+                    m_suffixes[i] = (charValue(rearranged[i]) * power(m_suffixDigits[i + 1]) +
+                                     m_suffixes[i + 1]) % modulus;
+                    m_suffixDigits[i] = m_suffixDigits[i + 1] + charDigits(rearranged[i]);
+                }
+            }
+
+            /// Returns the remainder with the character at \p index replaced
+            unsigned with(size_t index, char ch) const noexcept {
+                return ((m_prefixes[index] * power(charDigits(ch)) + charValue(ch)) % modulus *
+                        power(m_suffixDigits[index + 1]) + m_suffixes[index + 1]) % modulus;
+            }
+
+            /// Returns the remainder with the characters at \p first and
+            /// \p second replaced, where \p first < \p second
+            unsigned with(size_t first, char firstChar, size_t second, char secondChar) const noexcept {
+                const Linear linear = coefficients(first, charDigits(firstChar),
+                                                   second, charDigits(secondChar));
+                return (linear.constant + linear.first * charValue(firstChar) +
+                        linear.second * charValue(secondChar)) % modulus;
+            }
+
+            /// Remainder of an IBAN with two replaced characters as linear
+            /// function of their values
+            struct Linear {
+                unsigned constant;
+                unsigned first;
+                unsigned second;
+            };
+
+            /**
+             * Returns the remainder of the IBAN with the characters at
+             * \p first and \p second replaced by characters of the given digit
+             * counts, as linear function of the values of the new characters.
+             */
+            Linear coefficients(size_t first, size_t firstDigits, size_t second,
+                                size_t secondDigits) const noexcept {
+                // the characters between the replaced ones
+                const size_t middleDigits = m_suffixDigits[first + 1] - m_suffixDigits[second];
+                const unsigned middle = (m_prefixes[second] + modulus * modulus -
+                                         m_prefixes[first + 1] * power(middleDigits)) % modulus;
+                const unsigned tail = power(m_suffixDigits[second + 1]);
+                const unsigned shift = power(secondDigits) * tail % modulus;
+                Linear linear;
+                linear.second = tail;
+                linear.first = power(middleDigits) * shift % modulus;
+                linear.constant = (m_prefixes[first] * power(firstDigits) % modulus * linear.first +
+                                   middle * shift + m_suffixes[second + 1]) % modulus;
+                return linear;
+            }
+
+            /// Returns the inverse of \p value mod 97
+            unsigned inverse(unsigned value) const noexcept {
+                return m_tables.inverses[value];
+            }
+
+        private:
+            unsigned power(size_t exponent) const noexcept {
+                return m_tables.powers[exponent];
+            }
+
+            const Tables& m_tables;
+            /// Remainders of the first i characters
+            unsigned m_prefixes[maxIBANLength + 1];
+            /// Remainders of the characters from i on
+            unsigned m_suffixes[maxIBANLength + 1];
+            /// Number of digits of the characters from i on
+            size_t m_suffixDigits[maxIBANLength + 1];
+        };
+
+        /// Mistyped IBAN and the suggestions found so far
+        class Search {
+        public:
+            Search(const char* machineForm, size_t length, size_t maxResults,
+                   std::vector<CompactIBAN>& results) noexcept :
+                    m_length(length), m_maxResults(maxResults), m_results(results),
+                    m_structure(getBBANStructure(machineForm[0], machineForm[1])) {
+                std::memcpy(m_iban, machineForm, length);
+            }
+
+            /// Returns \p true if enough suggestions were found
+            bool isDone() const noexcept {
+                return m_results.size() >= m_maxResults;
+            }
+
+            /// Returns the character classes allowed at a position; the
+            /// country code is handled separately
+            uint8_t getClasses(size_t position) const noexcept {
+                return position < 4 ? static_cast<uint8_t>(BBANStructure::Digit) :
+                       m_structure->classes[position - 4];
+            }
+
+            /// Returns the index of a position of the IBAN in the rearranged
+            /// form
+            size_t rearrangedIndex(size_t position) const noexcept {
+                return position >= 4 ? position - 4 : m_length - 4 + position;
+            }
+
+            /// Builds the rearranged form of the IBAN
+            void rearrange(char* rearranged) const noexcept {
+                for (size_t i = 0; i < m_length; ++i) {
+                    const char ch = m_iban[(i + 4) % m_length];
+                    // characters not allowed anywhere are replaced anyway
+                    rearranged[i] = BBANStructure::classify(ch) == 0 ? '0' : ch;
+                }
+            }
+
+            /// Collects the positions whose characters do not match the
+            /// structure; returns \p false if there are more than \p limit
+            bool findMismatches(size_t limit) noexcept {
+                m_mismatchCount = 0;
+                for (size_t i = 2; i < m_length; ++i) {
+                    if ((BBANStructure::classify(m_iban[i]) & getClasses(i)) == 0) {
+                        if (m_mismatchCount == limit) {
+                            return false;
+                        }
+                        m_mismatches[m_mismatchCount++] = i;
+                    }
+                }
+                return true;
+            }
+
+            /// Returns \p true if editing the given positions fixes every
+            /// mismatch
+            bool coversMismatches(size_t first, size_t second) const noexcept {
+                for (size_t i = 0; i < m_mismatchCount; ++i) {
+                    if (m_mismatches[i] != first && m_mismatches[i] != second) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            /// Adds a suggestion with up to two replaced characters unless it
+            /// fails its national check digits or was found already
+            void add(size_t first, char firstChar, size_t second = 0, char secondChar = 0) {
+                char candidate[maxIBANLength];
+                std::memcpy(candidate, m_iban, m_length);
+                candidate[first] = firstChar;
+                if (secondChar != 0) {
+                    candidate[second] = secondChar;
+                }
+                const StringView machineForm(candidate, m_length);
+                if (!checkNationalDigits(machineForm)) {
+                    return;
+                }
+                const CompactIBAN suggestion(machineForm);
+                for (const auto& result : m_results) {
+                    if (result == suggestion) {
+                        return;
+                    }
+                }
+                m_results.push_back(suggestion);
+            }
+
+            void replaceCountryCode();
+            void replaceOne(const Residues& residues);
+            void transposeNeighbours(const Residues& residues);
+            void replaceTwo(const Residues& residues);
+
+        private:
+            /// Holds the mistyped IBAN in machine form
+            char m_iban[maxIBANLength];
+            /// Holds the length of the IBAN
+            size_t m_length;
+            /// Holds the maximum number of suggestions
+            size_t m_maxResults;
+            /// Holds the suggestions found so far
+            std::vector<CompactIBAN>& m_results;
+            /// Holds the BBAN structure of the IBAN's country
+            const BBANStructure* m_structure;
+            /// Holds the positions not matching the structure
+            size_t m_mismatches[2];
+            /// Holds the number of positions not matching the structure
+            size_t m_mismatchCount {0};
+        };
+
+        /// Iterates the characters of the classes in \p classes
+        template <class Function>
+        void forEachChar(uint8_t classes, Function function) {
+            if (classes & BBANStructure::Digit) {
+                for (char ch = '0'; ch <= '9'; ++ch) {
+                    function(ch);
+                }
+            }
+            if (classes & BBANStructure::Letter) {
+                for (char ch = 'A'; ch <= 'Z'; ++ch) {
+                    function(ch);
+                }
+            }
+        }
+
+        /**
+         * Tries other country codes with one letter replaced. There are few
+         * of them and they change the BBAN structure, so each is simply
+         * validated as a whole.
+         */
+        void Search::replaceCountryCode() {
+            for (size_t position = 0; position < 2 && !isDone(); ++position) {
+                const char original = m_iban[position];
+                for (char ch = 'A'; ch <= 'Z' && !isDone(); ++ch) {
+                    if (ch == original) {
+                        continue;
+                    }
+                    m_iban[position] = ch;
+                    if (IBAN::tryParse(StringView(m_iban, m_length)) == ParseStatus::OK) {
+                        m_iban[position] = original;
+                        add(position, ch);
+                    }
+                    m_iban[position] = original;
+                }
+            }
+        }
+
+        /// Tries every allowed replacement of a single character
+        void Search::replaceOne(const Residues& residues) {
+            for (size_t position = 2; position < m_length && !isDone(); ++position) {
+                if (!coversMismatches(position, position)) {
+                    continue;
+                }
+                const size_t index = rearrangedIndex(position);
+                const char original = m_iban[position];
+                forEachChar(getClasses(position), [&](char ch) {
+                    if (ch != original && !isDone() && residues.with(index, ch) == 1) {
+                        add(position, ch);
+                    }
+                });
+            }
+        }
+
+        /// Tries swapping every two neighbouring characters
+        void Search::transposeNeighbours(const Residues& residues) {
+            for (size_t position = 2; position + 1 < m_length && !isDone(); ++position) {
+                const char left = m_iban[position], right = m_iban[position + 1];
+                if (left == right || !coversMismatches(position, position + 1) ||
+                    (BBANStructure::classify(right) & getClasses(position)) == 0 ||
+                    (BBANStructure::classify(left) & getClasses(position + 1)) == 0) {
+                    continue;
+                }
+                // the check digits and the BBAN are not neighbours when
+                // rearranged
+                const size_t first = rearrangedIndex(position), second = rearrangedIndex(position + 1);
+                const unsigned remainder = first < second ? residues.with(first, right, second, left) :
+                                           residues.with(second, left, first, right);
+                if (remainder == 1) {
+                    add(position, right, position + 1, left);
+                }
+            }
+        }
+
+        /**
+         * Tries replacing every two characters. For each pair of positions and
+         * digit count of the new characters, the value of the second character
+         * is solved for instead of tried.
+         */
+        void Search::replaceTwo(const Residues& residues) {
+            for (size_t a = 2; a < m_length && !isDone(); ++a) {
+                for (size_t b = a + 1; b < m_length && !isDone(); ++b) {
+                    if (!coversMismatches(a, b)) {
+                        continue;
+                    }
+                    // order the positions as in the rearranged form
+                    size_t first = a, second = b;
+                    if (rearrangedIndex(first) > rearrangedIndex(second)) {
+                        std::swap(first, second);
+                    }
+                    const uint8_t firstClasses = getClasses(first), secondClasses = getClasses(second);
+                    for (size_t firstDigits = 1; firstDigits <= 2; ++firstDigits) {
+                        const uint8_t firstClass = firstDigits == 1 ? BBANStructure::Digit :
+                                                   BBANStructure::Letter;
+                        if ((firstClasses & firstClass) == 0) {
+                            continue;
+                        }
+                        for (size_t secondDigits = 1; secondDigits <= 2; ++secondDigits) {
+                            const uint8_t secondClass = secondDigits == 1 ? BBANStructure::Digit :
+                                                        BBANStructure::Letter;
+                            if ((secondClasses & secondClass) == 0) {
+                                continue;
+                            }
+                            const Residues::Linear linear = residues.coefficients(
+                                    rearrangedIndex(first), firstDigits, rearrangedIndex(second), secondDigits);
+                            const unsigned inverse = residues.inverse(linear.second);
+                            forEachChar(firstClass, [&](char firstChar) {
+                                if (firstChar == m_iban[first] || isDone()) {
+                                    return;
+                                }
+                                // solve constant + first * x + second * y = 1 for y
+                                const unsigned target = (1 + 2 * modulus - linear.constant -
+                                                         linear.first * charValue(firstChar) % modulus) % modulus;
+                                const unsigned value = target * inverse % modulus;
+                                const bool isDigit = value < 10;
+                                if (value >= 36 || isDigit != (secondDigits == 1)) {
+                                    return;
+                                }
+                                const char secondChar = isDigit ? static_cast<char>('0' + value) :
+                                                        static_cast<char>('A' + value - 10);
+                                if (secondChar != m_iban[second]) {
+                                    add(first, firstChar, second, secondChar);
+                                }
+                            });
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Suggests valid IBANs for a mistyped one, as needed when a user entered
+     * an invalid IBAN. Candidates differ from the input in up to \p maxEdits
+     * edits, where an edit replaces a character or swaps two neighbouring
+     * characters; with two edits, both replace a character. Only candidates
+     * matching the BBAN structure and national check digits of their
+     * country are suggested. Each candidate's check sum is computed in
+     * constant time, so a call takes microseconds.
+     *
+     * Suggestions with one edit come first. Note that the check sum detects
+     * every single edit but not every pair of edits, so there are many
+     * candidates with two edits.
+     *
+     * @param input The mistyped IBAN, normalized by \p normalizeIBAN() as in
+     * \p IBAN::tryParse()
+     * @param maxEdits The maximum number of edits, at most 2
+     * @param maxResults The maximum number of suggestions
+     * @return The suggestions; empty if the input cannot be normalized or its
+     * length does not match its country, as inserted and deleted characters
+     * are not corrected
+     */
+    std::vector<CompactIBAN> suggestCorrections(StringView input, size_t maxEdits, size_t maxResults) {
+        std::vector<CompactIBAN> results;
+        char machineForm[maxIBANLength];
+        size_t length = 0;
+        if (normalizeIBAN(input, machineForm, &length) != ParseStatus::OK ||
+            length < 5 || maxEdits == 0 || maxResults == 0) {
+            return results;
+        }
+        maxEdits = std::min<size_t>(maxEdits, 2);
+
+        Search search(machineForm, length, maxResults, results);
+        const BBANStructure* structure = getBBANStructure(machineForm[0], machineForm[1]);
+        if (structure && structure->length + 4u == length && search.findMismatches(maxEdits)) {
+            char rearranged[maxIBANLength];
+            search.rearrange(rearranged);
+            const Residues residues(rearranged, length);
+            search.replaceOne(residues);
+            search.transposeNeighbours(residues);
+            search.replaceCountryCode();
+            if (maxEdits == 2) {
+                search.replaceTwo(residues);
+            }
+        } else {
+            search.replaceCountryCode();
+        }
+        return results;
+    }
+}
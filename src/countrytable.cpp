@@ -0,0 +1,413 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        countrytable.cpp
+ * \brief       Source file implementing the loadable country registry
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p CountryTable, \p CountryTableBuilder and the
+ * process wide table behind \p findBBANStructure(), which is published
+ * through an \p RcuPointer.
+ *
+ * A snapshot consists of a 16 byte header (magic bytes and the number of
+ * versions) followed by one entry of 48 bytes per version, ordered by country
+ * and effective day: the country code, the BBAN length, the positions of the
+ * bank and branch codes, the effective day and the character class of every
+ * position. Numbers are stored in host byte order.
+ */
+
+#include "countrytable.h"
+#include "epoch.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace IBAN {
+
+    namespace {
+        /// Magic bytes at the start of a snapshot
+        constexpr char registryMagic[8] = {'I', 'B', 'A', 'N', 'R', 'E', 'G', '1'};
+        /// Size of the snapshot header
+        constexpr size_t registryHeaderSize = 16;
+        /// Size of a snapshot entry
+        constexpr size_t registryEntrySize = 48;
+        /// Offset of the character classes within an entry
+        constexpr size_t classesOffset = 12;
+
+        static_assert(classesOffset + maxBBANLength <= registryEntrySize, "entry too small");
+
+        /// Throws the exception for a snapshot that cannot be loaded
+        [[noreturn]] void throwMalformedRegistry() {
+            throw std::runtime_error("Malformed country table snapshot");
+        }
+
+        /// Tests if two structures accept the same BBANs
+        bool isSameFormat(const BBANStructure& lhs, const BBANStructure& rhs) noexcept {
+            return lhs.length == rhs.length && std::equal(lhs.classes, lhs.classes + lhs.length, rhs.classes);
+        }
+
+        /// Returns the index of a country code, which must consist of two
+        /// uppercase letters
+        size_t getCheckedCountryIndex(StringView countryCode) {
+            const size_t index = countryCode.size() == 2 ?
+                                 getCountryIndex(countryCode[0], countryCode[1]) : countryCodeCount;
+            if (index == countryCodeCount) {
+                throw std::invalid_argument("Invalid country code " + countryCode.toString());
+            }
+            return index;
+        }
+
+        /// Orders entries by country and effective day
+        bool isEntryBefore(const CountryTableEntry& lhs, const CountryTableEntry& rhs) noexcept {
+            const size_t lhsIndex = getCountryIndex(lhs.countryCode[0], lhs.countryCode[1]);
+            const size_t rhsIndex = getCountryIndex(rhs.countryCode[0], rhs.countryCode[1]);
+            return lhsIndex < rhsIndex || (lhsIndex == rhsIndex && lhs.effectiveDay < rhs.effectiveDay);
+        }
+
+        /// The process wide table used by \p findBBANStructure()
+        RcuPointer<CountryTable>& getGlobalCountryTable() {
+            static RcuPointer<CountryTable> table;
+            return table;
+        }
+    }
+
+    /**
+     * Adds the formats of the compiled-in registry.
+     *
+     * @param effectiveDay The first day the formats apply (default: always)
+     */
+    void CountryTableBuilder::addCompiledIn(uint32_t effectiveDay) {
+        for (const CountryFormat& format : CountryRegistry::formats) {
+            add(StringView(format.countryCode, 2), format.bban, effectiveDay, format.bankOffset,
+                format.bankLength, format.branchOffset, format.branchLength);
+        }
+    }
+
+    /**
+     * Adds the format of a country. A format added for a country and day a
+     * format was added for before replaces the earlier one.
+     *
+     * @param countryCode The country code
+     * @param bbanFormat The BBAN format in SWIFT notation, e.g. "8!n10!n"
+     * @param effectiveDay The first day the format applies, in days since
+     * 1970-01-01 (see \p getDayNumber())
+     * @param bankOffset The position of the bank code within the BBAN
+     * @param bankLength The length of the bank code
+     * @param branchOffset The position of the branch code within the BBAN
+     * @param branchLength The length of the branch code; 0 if there is none
+     * @throws std::invalid_argument If the country code or the format are
+     * malformed or the bank or branch code exceed the BBAN
+     */
+    void CountryTableBuilder::add(StringView countryCode, const char* bbanFormat, uint32_t effectiveDay,
+                                  uint8_t bankOffset, uint8_t bankLength,
+                                  uint8_t branchOffset, uint8_t branchLength) {
+        getCheckedCountryIndex(countryCode);
+        CountryTableEntry entry = {};
+        if (!bbanFormat || !compileBBANFormat(bbanFormat, entry.structure)) {
+            throw std::invalid_argument("Invalid BBAN format for " + countryCode.toString());
+        }
+        if (bankOffset + bankLength > entry.structure.length ||
+            branchOffset + branchLength > entry.structure.length) {
+            throw std::invalid_argument("Bank or branch code exceed the BBAN of " + countryCode.toString());
+        }
+        entry.countryCode[0] = countryCode[0];
+        entry.countryCode[1] = countryCode[1];
+        entry.effectiveDay = effectiveDay;
+        entry.structure.bankOffset = bankOffset;
+        entry.structure.bankLength = bankLength;
+        entry.structure.branchOffset = branchOffset;
+        entry.structure.branchLength = branchLength;
+        m_entries.push_back(entry);
+    }
+
+    /**
+     * Adds the end of IBAN support of a country.
+     *
+     * @param countryCode The country code
+     * @param effectiveDay The first day the country does not support IBAN
+     * @throws std::invalid_argument If the country code is malformed
+     */
+    void CountryTableBuilder::withdraw(StringView countryCode, uint32_t effectiveDay) {
+        getCheckedCountryIndex(countryCode);
+        CountryTableEntry entry = {};
+        entry.countryCode[0] = countryCode[0];
+        entry.countryCode[1] = countryCode[1];
+        entry.effectiveDay = effectiveDay;
+        m_entries.push_back(entry);
+    }
+
+    /**
+     * Builds the snapshot of the table of the formats added.
+     *
+     * @return The snapshot
+     */
+    std::vector<char> CountryTableBuilder::build() const {
+        // the last format added for a country and day wins
+        std::vector<CountryTableEntry> entries(m_entries.rbegin(), m_entries.rend());
+        std::stable_sort(entries.begin(), entries.end(), isEntryBefore);
+        entries.erase(std::unique(entries.begin(), entries.end(),
+                                  [](const CountryTableEntry& lhs, const CountryTableEntry& rhs) {
+                                      return !isEntryBefore(lhs, rhs) && !isEntryBefore(rhs, lhs);
+                                  }), entries.end());
+
+        std::vector<char> snapshot(registryHeaderSize + entries.size() * registryEntrySize);
+        std::memcpy(snapshot.data(), registryMagic, sizeof(registryMagic));
+        detail::writeNumber<uint64_t>(snapshot.data() + 8, entries.size());
+        char* out = snapshot.data() + registryHeaderSize;
+        for (const CountryTableEntry& entry : entries) {
+            const BBANStructure& structure = entry.structure;
+            out[0] = entry.countryCode[0];
+            out[1] = entry.countryCode[1];
+            out[2] = static_cast<char>(structure.length);
+            out[3] = static_cast<char>(structure.bankOffset);
+            out[4] = static_cast<char>(structure.bankLength);
+            out[5] = static_cast<char>(structure.branchOffset);
+            out[6] = static_cast<char>(structure.branchLength);
+            detail::writeNumber(out + 8, entry.effectiveDay);
+            std::memcpy(out + classesOffset, structure.classes, structure.length);
+            out += registryEntrySize;
+        }
+        return snapshot;
+    }
+
+    /**
+     * Writes the snapshot of the table of the formats added to a file.
+     *
+     * @param path The path of the file
+     * @throws std::system_error If the file cannot be written
+     */
+    void CountryTableBuilder::write(const std::string& path) const {
+        detail::writeSnapshot(path, build());
+    }
+
+    /**
+     * Loads a snapshot file.
+     *
+     * @param path The path of the snapshot
+     * @return The table
+     * @throws std::system_error If the file cannot be read
+     * @throws std::runtime_error If the file is not a valid snapshot
+     */
+    std::unique_ptr<CountryTable> CountryTable::open(const std::string& path) {
+        return fromBuffer(detail::readSnapshot(path));
+    }
+
+    /**
+     * Loads a snapshot held in memory, e.g. as returned by
+     * \p CountryTableBuilder::build(). The snapshot is copied.
+     *
+     * @param snapshot The snapshot
+     * @return The table
+     * @throws std::runtime_error If \p snapshot is not a valid snapshot
+     */
+    std::unique_ptr<CountryTable> CountryTable::fromBuffer(const std::vector<char>& snapshot) {
+        if (snapshot.size() < registryHeaderSize ||
+            std::memcmp(snapshot.data(), registryMagic, sizeof(registryMagic)) != 0) {
+            throwMalformedRegistry();
+        }
+        const uint64_t count = detail::readNumber<uint64_t>(snapshot.data() + 8);
+        if (count > UINT16_MAX || snapshot.size() != registryHeaderSize + count * registryEntrySize) {
+            throwMalformedRegistry();
+        }
+
+        std::unique_ptr<CountryTable> table(new CountryTable());
+        table->m_entries.resize(static_cast<size_t>(count));
+        const char* in = snapshot.data() + registryHeaderSize;
+        for (CountryTableEntry& entry : table->m_entries) {
+            BBANStructure& structure = entry.structure;
+            entry.countryCode[0] = in[0];
+            entry.countryCode[1] = in[1];
+            structure.length = static_cast<uint8_t>(in[2]);
+            structure.bankOffset = static_cast<uint8_t>(in[3]);
+            structure.bankLength = static_cast<uint8_t>(in[4]);
+            structure.branchOffset = static_cast<uint8_t>(in[5]);
+            structure.branchLength = static_cast<uint8_t>(in[6]);
+            entry.effectiveDay = detail::readNumber<uint32_t>(in + 8);
+            if (getCountryIndex(in[0], in[1]) == countryCodeCount || structure.length > maxBBANLength ||
+                structure.bankOffset + structure.bankLength > structure.length ||
+                structure.branchOffset + structure.branchLength > structure.length ||
+                (&entry != table->m_entries.data() && !isEntryBefore(*(&entry - 1), entry))) {
+                throwMalformedRegistry();
+            }
+            for (size_t i = 0; i < maxBBANLength; ++i) {
+                structure.classes[i] = static_cast<uint8_t>(in[classesOffset + i]);
+                if ((i < structure.length) != (structure.classes[i] != 0) ||
+                    structure.classes[i] > BBANStructure::Alphanumeric) {
+                    throwMalformedRegistry();
+                }
+            }
+            const BBANStructure* compiledIn = getBBANStructure(in[0], in[1]);
+            entry.compiledIn = structure.length != 0 && compiledIn && isSameFormat(structure, *compiledIn);
+            in += registryEntrySize;
+        }
+
+        size_t position = 0;
+        for (size_t index = 0; index < countryCodeCount; ++index) {
+            table->m_offsets[index] = static_cast<uint16_t>(position);
+            while (position < table->m_entries.size() &&
+                   getCountryIndex(table->m_entries[position].countryCode[0],
+                                   table->m_entries[position].countryCode[1]) == index) {
+                ++position;
+            }
+        }
+        table->m_offsets[countryCodeCount] = static_cast<uint16_t>(position);
+        return table;
+    }
+
+    /**
+     * Returns the version of a country's format that applies on a day.
+     *
+     * @param first The first letter of the country code
+     * @param second The second letter of the country code
+     * @param day The day in days since 1970-01-01
+     * @return The version or \p nullptr if the country does not support IBAN
+     * on \p day
+     */
+    const CountryTableEntry* CountryTable::findEntry(char first, char second, uint32_t day) const noexcept {
+        const size_t index = getCountryIndex(first, second);
+        if (index == countryCodeCount) {
+            return nullptr;
+        }
+        // countries have a handful of versions at most
+        const CountryTableEntry* result = nullptr;
+        for (size_t i = m_offsets[index]; i < m_offsets[index + 1] && m_entries[i].effectiveDay <= day; ++i) {
+            result = &m_entries[i];
+        }
+        return result && result->structure.length != 0 ? result : nullptr;
+    }
+
+    /**
+     * Returns the BBAN structure of a country that applies on a day.
+     *
+     * @param first The first letter of the country code
+     * @param second The second letter of the country code
+     * @param day The day in days since 1970-01-01
+     * @return The structure or \p nullptr if the country does not support IBAN
+     * on \p day
+     */
+    const BBANStructure* CountryTable::find(char first, char second, uint32_t day) const noexcept {
+        const CountryTableEntry* entry = findEntry(first, second, day);
+        return entry ? &entry->structure : nullptr;
+    }
+
+    /**
+     * Replaces the registry used for validation by \p IBAN::tryParse(),
+     * \p IBAN::validate(), \p validateBatch() and \p IBANColumn::validate(). Readers are not blocked;
+     * the call returns once no reader uses the old table anymore, which is
+     * then deleted. Must not be called while holding an \p EpochGuard.
+     *
+     * The compiled-in registry stays in use for everything depending on a
+     * stable encoding, such as \p PackedIBAN, \p PrefixIndex or
+     * \p IBANScanner, and for \p checkNationalDigits().
+     *
+     * @param table The new table or an empty pointer to return to the
+     * compiled-in registry
+     */
+    void setCountryTable(std::unique_ptr<CountryTable> table) {
+        getGlobalCountryTable().reset(std::move(table));
+    }
+
+    /**
+     * Loads a snapshot file and makes it the registry used for validation as
+     * \p setCountryTable() does. If the file cannot be loaded, the current
+     * registry stays in use.
+     *
+     * @param path The path of the snapshot
+     * @throws std::system_error If the file cannot be read
+     * @throws std::runtime_error If the file is not a valid snapshot
+     */
+    void loadCountryTable(const std::string& path) {
+        setCountryTable(CountryTable::open(path));
+    }
+
+    /**
+     * Returns the table set by \p setCountryTable(). The table may only be
+     * used while the calling thread holds an \p EpochGuard.
+     *
+     * @return The table or \p nullptr if the compiled-in registry is used
+     */
+    const CountryTable* getCountryTable() noexcept {
+        return getGlobalCountryTable().get();
+    }
+
+    /**
+     * Tells whether a table was set by \p setCountryTable(). Callers use the
+     * compiled-in registry without entering an \p EpochGuard if not.
+     *
+     * @return \p true if a table is set
+     */
+    bool hasCountryTable() noexcept {
+        return getGlobalCountryTable().get() != nullptr;
+    }
+
+    /**
+     * Returns the BBAN structure of a country that applies today in the
+     * registry used for validation: the table set by \p setCountryTable() or
+     * else the compiled-in registry. If a table is set, the structure may
+     * only be used while the calling thread holds an \p EpochGuard.
+     *
+     * @param first The first letter of the country code
+     * @param second The second letter of the country code
+     * @return The structure or \p nullptr if the country does not support IBAN
+     */
+    const BBANStructure* findBBANStructure(char first, char second) noexcept {
+        const CountryTable* table = getCountryTable();
+        return table ? table->find(first, second, getCurrentDay()) : getBBANStructure(first, second);
+    }
+
+    /**
+     * Tells whether the format of a country in the registry used for
+     * validation is the compiled-in one, i.e. whether features bound to the
+     * compiled-in registry, such as \p checkNationalDigits(), apply to the
+     * country's IBANs.
+     *
+     * @param first The first letter of the country code
+     * @param second The second letter of the country code
+     * @return \p true if no table is set by \p setCountryTable() or the
+     * version in effect today equals the compiled-in format
+     */
+    bool hasCompiledInFormat(char first, char second) noexcept {
+        if (!hasCountryTable()) {
+            return true;
+        }
+        EpochGuard guard;
+        const CountryTable* table = getCountryTable();
+        const CountryTableEntry* entry = table ? table->findEntry(first, second, getCurrentDay()) : nullptr;
+        return !table || (entry && entry->compiledIn);
+    }
+
+    /**
+     * Returns the current day of the system clock.
+     *
+     * @return The number of days since 1970-01-01 (UTC)
+     */
+    uint32_t getCurrentDay() noexcept {
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::hours>(now).count() / 24);
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        countrytable.h
+ * \brief       Header file declaring the loadable country registry
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p CountryTable, a registry of BBAN formats with
+ * effective dates that is loaded from a snapshot file, \p CountryTableBuilder
+ * writing its snapshots, and \p setCountryTable(), which replaces the
+ * compiled-in registry for validation at runtime. The table is published
+ * through an \p RcuPointer, so validating threads are never blocked while it
+ * is replaced.
+ */
+
+#ifndef LIBIBAN_COUNTRYTABLE_H
+#define LIBIBAN_COUNTRYTABLE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "libiban.h"
+#include "registry.h"
+
+namespace IBAN {
+
+/// Format of the BBANs of a country from a date on
+struct CountryTableEntry {
+    /// The country code
+    char countryCode[2];
+    /// The first day the format applies, in days since 1970-01-01 (UTC)
+    uint32_t effectiveDay;
+    /// The structure of the BBANs; length 0 if the country does not support
+    /// IBAN from \p effectiveDay on
+    BBANStructure structure;
+    /// Whether the structure equals the one of \p CountryRegistry, so the
+    /// vector kernels of \p validateBatch() can validate the country
+    bool compiledIn;
+};
+
+/**
+ * Collects the formats of a \p CountryTable and writes its snapshot. Formats
+ * of a country with different effective dates form its versions.
+ */
+class CountryTableBuilder {
+public:
+    void addCompiledIn(uint32_t effectiveDay = 0);
+    void add(StringView countryCode, const char* bbanFormat, uint32_t effectiveDay,
+             uint8_t bankOffset = 0, uint8_t bankLength = 0,
+             uint8_t branchOffset = 0, uint8_t branchLength = 0);
+    void withdraw(StringView countryCode, uint32_t effectiveDay);
+    /// Returns the number of formats added
+    size_t size() const noexcept { return m_entries.size(); }
+    std::vector<char> build() const;
+    void write(const std::string& path) const;
+
+private:
+    /// Holds the formats added
+    std::vector<CountryTableEntry> m_entries;
+};
+
+/**
+ * Read-only registry of the BBAN formats of the countries supporting IBAN,
+ * loaded from a snapshot written by \p CountryTableBuilder. Each country has
+ * one or more versions; a version applies from its effective day until the
+ * effective day of the next version. Before its first version a country
+ * does not support IBAN.
+ */
+class CountryTable {
+public:
+    static std::unique_ptr<CountryTable> open(const std::string& path);
+    static std::unique_ptr<CountryTable> fromBuffer(const std::vector<char>& snapshot);
+
+    /// Returns the number of versions of all countries
+    size_t size() const noexcept { return m_entries.size(); }
+    const CountryTableEntry* findEntry(char first, char second, uint32_t day) const noexcept;
+    const BBANStructure* find(char first, char second, uint32_t day) const noexcept;
+
+private:
+    CountryTable() noexcept = default;
+
+    /// Holds the versions ordered by country and effective day
+    std::vector<CountryTableEntry> m_entries;
+    /// Holds the index of the first version per country code and the number
+    /// of versions behind the last one
+    uint16_t m_offsets[countryCodeCount + 1];
+};
+
+void setCountryTable(std::unique_ptr<CountryTable> table);
+void loadCountryTable(const std::string& path);
+const CountryTable* getCountryTable() noexcept;
+bool hasCountryTable() noexcept;
+const BBANStructure* findBBANStructure(char first, char second) noexcept;
+bool hasCompiledInFormat(char first, char second) noexcept;
+
+uint32_t getCurrentDay() noexcept;
+
+/**
+ * Returns the number of days since 1970-01-01 of a date of the proleptic
+ * Gregorian calendar (after H. Hinnant's \p days_from_civil).
+ *
+ * @param year The year, at least 1970
+ * @param month The month, from 1 to 12
+ * @param day The day of the month, from 1 to 31
+ * @return The number of days since 1970-01-01
+ */
+constexpr uint32_t getDayNumber(unsigned year, unsigned month, unsigned day) noexcept {
+    return static_cast<uint32_t>(
+            ((month <= 2 ? year - 1 : year) / 400) * 146097 +
+            ((month <= 2 ? year - 1 : year) % 400) * 365 +
+            ((month <= 2 ? year - 1 : year) % 400) / 4 -
+            ((month <= 2 ? year - 1 : year) % 400) / 100 +
+            (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1 - 719468);
+}
+
+static_assert(getDayNumber(1970, 1, 1) == 0, "getDayNumber() is broken");
+static_assert(getDayNumber(2000, 3, 1) == 11017, "getDayNumber() is broken");
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_COUNTRYTABLE_H
@@ -0,0 +1,160 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        epoch.cpp
+ * \brief       Source file implementing epoch based reclamation
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p EpochGuard and \p synchronizeEpochs(). Every
+ * thread owns a record holding the epoch it reads in, or 0 while it does not
+ * read. The records form a list that only grows; records of finished threads
+ * are reused by new threads. Threads that cannot allocate a record count their
+ * guards in a shared counter, which writers wait to drop to zero.
+ */
+
+#include "epoch.h"
+#include <new>
+#include <thread>
+
+namespace IBAN {
+
+    namespace detail {
+        /// Announced epoch of one thread
+        struct EpochRecord {
+            /// Epoch the thread reads in or 0 if it does not read
+            std::atomic<uint64_t> epoch {0};
+            /// Whether a thread owns the record
+            std::atomic<bool> inUse {true};
+            /// Number of nested guards of the owning thread
+            unsigned depth {0};
+            /// Next record of the list
+            EpochRecord* next {nullptr};
+            /// Keeps records of different threads in different cache lines
+            char padding[64];
+        };
+    }
+
+    namespace {
+        /// Current epoch, starting at 1 as 0 marks threads not reading
+        std::atomic<uint64_t> globalEpoch {1};
+        /// Head of the list of all records
+        std::atomic<detail::EpochRecord*> records {nullptr};
+        /// Number of guards of the threads without a record
+        std::atomic<uint64_t> sharedReaders {0};
+
+        /// Takes a free record or adds a new one to the list; returns
+        /// \p nullptr if no record can be allocated
+        detail::EpochRecord* acquireRecord() noexcept {
+            for (detail::EpochRecord* record = records.load(); record; record = record->next) {
+                bool inUse = false;
+                if (record->inUse.compare_exchange_strong(inUse, true)) {
+                    return record;
+                }
+            }
+            detail::EpochRecord* record = new (std::nothrow) detail::EpochRecord();
+            if (!record) {
+                return nullptr;
+            }
+            record->next = records.load();
+            while (!records.compare_exchange_weak(record->next, record)) {
+            }
+            return record;
+        }
+
+        /// Owns the record of a thread and releases it when the thread ends
+        struct ThreadRecord {
+            detail::EpochRecord* record;
+
+            ThreadRecord() noexcept : record(acquireRecord()) {}
+            ~ThreadRecord() {
+                if (!record) {
+                    return;
+                }
+                record->epoch.store(0);
+                record->depth = 0;
+                record->inUse.store(false);
+            }
+        };
+    }
+
+    /**
+     * Returns the record of the calling thread.
+     *
+     * @return The record of the calling thread or \p nullptr if none could be
+     * allocated
+     */
+    detail::EpochRecord* detail::getEpochRecord() noexcept {
+        thread_local ThreadRecord threadRecord;
+        return threadRecord.record;
+    }
+
+    /**
+     * Enters a reader scope by announcing the current epoch.
+     */
+    EpochGuard::EpochGuard() noexcept : m_record(detail::getEpochRecord()) {
+        if (!m_record) {
+            // must be ordered before the reads of the guarded pointers
+            sharedReaders.fetch_add(1, std::memory_order_seq_cst);
+        } else if (m_record->depth++ == 0) {
+            // must be ordered before the reads of the guarded pointers
+            m_record->epoch.store(globalEpoch.load(), std::memory_order_seq_cst);
+        }
+    }
+
+    /**
+     * Leaves the reader scope.
+     */
+    EpochGuard::~EpochGuard() {
+        if (!m_record) {
+            sharedReaders.fetch_sub(1, std::memory_order_release);
+        } else if (--m_record->depth == 0) {
+            m_record->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Waits until every reader that entered its scope before the call has
+     * left it. Objects unlinked before the call can be deleted afterwards.
+     * Must not be called within an \p EpochGuard, as it would wait for itself.
+     */
+    void synchronizeEpochs() {
+        const uint64_t epoch = globalEpoch.fetch_add(1) + 1;
+        for (detail::EpochRecord* record = records.load(); record; record = record->next) {
+            for (;;) {
+                const uint64_t announced = record->epoch.load();
+                if (announced == 0 || announced >= epoch) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        // threads without a record cannot tell when they entered, so wait
+        // until none of them reads
+        while (sharedReaders.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        epoch.h
+ * \brief       Header file declaring epoch based reclamation
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p EpochGuard and \p RcuPointer, which let many
+ * threads read shared data that is replaced at runtime without locking:
+ * readers announce the epoch they read in, and a replaced object is deleted
+ * only after every reader that could still see it has left its epoch.
+ */
+
+#ifndef LIBIBAN_EPOCH_H
+#define LIBIBAN_EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace IBAN {
+
+namespace detail {
+struct EpochRecord;
+EpochRecord* getEpochRecord() noexcept;
+}
+
+/**
+ * Marks the scope of a reader. Objects read through an \p RcuPointer stay
+ * alive at least until the guard is destroyed. Entering and leaving a guard
+ * only touch memory of the calling thread, so readers never contend with each
+ * other; guards may be nested. A thread's first guard allocates the thread's
+ * record; if that fails, the thread counts its guards in a counter shared with
+ * the other threads in the same situation instead, so entering a guard never
+ * throws.
+ */
+class EpochGuard {
+public:
+    EpochGuard() noexcept;
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    /// Holds the announced epoch of the calling thread; \p nullptr if the
+    /// thread uses the shared counter
+    detail::EpochRecord* m_record;
+};
+
+void synchronizeEpochs();
+
+/**
+ * Pointer to an object shared by readers, which can be replaced while
+ * readers are running. Readers call \p get() within an \p EpochGuard and must
+ * not keep the returned pointer beyond the guard. Writers call \p reset(),
+ * which waits for the readers of the old object before deleting it; readers
+ * are never blocked.
+ */
+template <class T>
+class RcuPointer {
+public:
+    /**
+     * Constructs the pointer.
+     *
+     * @param initial The initial object, may be empty
+     */
+    explicit RcuPointer(std::unique_ptr<T> initial = std::unique_ptr<T>()) noexcept :
+            m_pointer(initial.release()) {}
+    ~RcuPointer() { delete m_pointer.load(); }
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    /**
+     * Returns the current object. Must be called within an \p EpochGuard.
+     *
+     * @return The current object or \p nullptr
+     */
+    const T* get() const noexcept {
+        // sequentially consistent to be ordered after the announced epoch
+        return m_pointer.load(std::memory_order_seq_cst);
+    }
+
+    /**
+     * Replaces the object and deletes the old one once no reader can access
+     * it anymore. Must not be called within an \p EpochGuard.
+     *
+     * @param value The new object, may be empty
+     */
+    void reset(std::unique_ptr<T> value) {
+        T* old = m_pointer.exchange(value.release());
+        if (old) {
+            synchronizeEpochs();
+            delete old;
+        }
+    }
+
+private:
+    /// Holds the current object
+    std::atomic<T*> m_pointer;
+};
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_EPOCH_H
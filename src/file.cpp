@@ -0,0 +1,289 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        file.cpp
+ * \brief       Source file implementing the file validation mode
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p validateFile(). The file is mapped window by
+ * window, so only one window is resident at a time no matter how large the
+ * file is. Each window ends behind the last complete record it holds; the
+ * next window starts at the page containing the following record.
+ */
+
+#include "file.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if LIBIBAN_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Number of records handed to \p validateBatch() at once
+        constexpr size_t recordBatchSize = 256;
+
+#if LIBIBAN_USE_MMAP
+        /// Read-only file whose parts are mapped into memory on demand
+        class InputFile {
+        public:
+            explicit InputFile(const std::string& path) : m_fd(::open(path.c_str(), O_RDONLY)),
+                                                          m_size(0), m_window(nullptr), m_length(0) {
+                if (m_fd < 0) {
+                    detail::throwSystemError("cannot open " + path, errno);
+                }
+                struct stat status;
+                if (::fstat(m_fd, &status) != 0) {
+                    // close() may overwrite errno
+                    const int error = errno;
+                    ::close(m_fd);
+                    detail::throwSystemError("cannot stat " + path, error);
+                }
+                m_size = static_cast<uint64_t>(status.st_size);
+            }
+
+            ~InputFile() {
+                unmap();
+                ::close(m_fd);
+            }
+
+            InputFile(const InputFile&) = delete;
+            InputFile& operator=(const InputFile&) = delete;
+
+            uint64_t size() const noexcept {
+                return m_size;
+            }
+
+            static size_t pageSize() noexcept {
+                return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            }
+
+            /// Maps \p length bytes starting at \p offset, which is a multiple
+            /// of the page size, and unmaps the previous window
+            const char* map(uint64_t offset, size_t length) {
+                unmap();
+                void* window = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, m_fd,
+                                      static_cast<off_t>(offset));
+                if (window == MAP_FAILED) {
+                    detail::throwSystemError("cannot map file", errno);
+                }
+                ::madvise(window, length, MADV_SEQUENTIAL);
+                m_window = window;
+                m_length = length;
+                return static_cast<const char*>(window);
+            }
+
+        private:
+            void unmap() noexcept {
+                if (m_window) {
+                    ::munmap(m_window, m_length);
+                    m_window = nullptr;
+                }
+            }
+
+            int m_fd;
+            uint64_t m_size;
+            void* m_window;
+            size_t m_length;
+        };
+#else
+        /// Read-only file whose parts are read into a buffer on demand
+        class InputFile {
+        public:
+            explicit InputFile(const std::string& path) : m_stream(path, std::ios::binary), m_size(0) {
+                if (!m_stream) {
+                    detail::throwSystemError("cannot open " + path, errno);
+                }
+                m_stream.seekg(0, std::ios::end);
+                m_size = static_cast<uint64_t>(m_stream.tellg());
+            }
+
+            uint64_t size() const noexcept {
+                return m_size;
+            }
+
+            static size_t pageSize() noexcept {
+                return 4096;
+            }
+
+            const char* map(uint64_t offset, size_t length) {
+                m_buffer.resize(length);
+                m_stream.seekg(static_cast<std::streamoff>(offset));
+                if (!m_stream.read(&m_buffer[0], static_cast<std::streamsize>(length))) {
+                    detail::throwSystemError("cannot read file", errno);
+                }
+                return m_buffer.data();
+            }
+
+        private:
+            std::ifstream m_stream;
+            uint64_t m_size;
+            std::vector<char> m_buffer;
+        };
+#endif
+
+        /// Collects the results of the records in the format requested
+        class ResultSink {
+        public:
+            ResultSink(FileValidationResult& result, const FileValidationOptions& options) noexcept :
+                    m_result(result), m_bitmap(options.format == FileResultFormat::Bitmap),
+                    m_delimiter(options.delimiter), m_pending(0) {
+            }
+
+            /// Validates the records in [\p begin, \p end); \p offset is the
+            /// position of \p begin in the file
+            void process(const char* begin, const char* end, uint64_t offset) {
+                const char* record = begin;
+                while (record < end) {
+                    const char* delimiter = static_cast<const char*>(
+                            std::memchr(record, m_delimiter, static_cast<size_t>(end - record)));
+                    const char* recordEnd = delimiter ? delimiter : end;
+                    size_t length = static_cast<size_t>(recordEnd - record);
+                    if (m_delimiter == '\n' && length > 0 && record[length - 1] == '\r') {
+                        --length;
+                    }
+                    const uint64_t position = offset + static_cast<uint64_t>(record - begin);
+                    if (length > 0xFF) {
+                        // too long for a batch, but may still hold an IBAN with spaces
+                        flush();
+                        add(position, static_cast<uint8_t>(IBAN::tryParse(StringView(record, length))));
+                    } else {
+                        m_ibans[m_pending] = record;
+                        m_lengths[m_pending] = static_cast<uint8_t>(length);
+                        m_offsets[m_pending] = position;
+                        if (++m_pending == recordBatchSize) {
+                            flush();
+                        }
+                    }
+                    record = recordEnd + 1;
+                }
+                // the records must be validated before the window is unmapped
+                flush();
+            }
+
+        private:
+            void flush() {
+                validateBatch(m_ibans, m_lengths, m_pending, m_statuses);
+                for (size_t i = 0; i < m_pending; ++i) {
+                    add(m_offsets[i], m_statuses[i]);
+                }
+                m_pending = 0;
+            }
+
+            void add(uint64_t offset, uint8_t status) {
+                const uint64_t record = m_result.records++;
+                const bool valid = status == static_cast<uint8_t>(ParseStatus::OK);
+                if (!valid) {
+                    ++m_result.invalidRecords;
+                }
+                if (m_bitmap) {
+                    if (record % 64 == 0) {
+                        m_result.validBits.push_back(0);
+                    }
+                    m_result.validBits.back() |= static_cast<uint64_t>(valid) << (record % 64);
+                } else if (!valid) {
+                    m_result.invalidOffsets.push_back(offset);
+                }
+            }
+
+            FileValidationResult& m_result;
+            bool m_bitmap;
+            char m_delimiter;
+            size_t m_pending;
+            const char* m_ibans[recordBatchSize];
+            uint8_t m_lengths[recordBatchSize];
+            uint64_t m_offsets[recordBatchSize];
+            uint8_t m_statuses[recordBatchSize];
+        };
+
+        /// Returns the position behind the last occurrence of \p ch in
+        /// [\p begin, \p end) or \p nullptr if there is none
+        const char* findBehindLast(const char* begin, const char* end, char ch) noexcept {
+            while (end != begin) {
+                if (*--end == ch) {
+                    return end + 1;
+                }
+            }
+            return nullptr;
+        }
+    }
+
+    constexpr size_t FileValidationOptions::defaultWindowSize;
+
+    /**
+     * Validates a file of delimited IBANs, e.g. one IBAN per line. The records
+     * are validated in place with \p validateBatch(); a record is valid if
+     * \p IBAN::tryParse() returns \p ParseStatus::OK for it. A delimiter at
+     * the very end of the file does not start another record.
+     *
+     * The file is mapped into memory one window of \p options.windowSize bytes
+     * after another, so the memory used stays bounded for files of any size.
+     * Only a record longer than a window makes the window grow.
+     *
+     * @param path The path of the file
+     * @param result Receives the results in the format given by \p options
+     * @param options The options
+     * @throws std::system_error If the file cannot be opened or read
+     */
+    void validateFile(const std::string& path, FileValidationResult& result,
+                      const FileValidationOptions& options) {
+        result = FileValidationResult();
+        InputFile file(path);
+        const uint64_t size = file.size();
+        const size_t page = InputFile::pageSize();
+        size_t window = std::max<size_t>((options.windowSize + page - 1) / page * page, page);
+        ResultSink sink(result, options);
+
+        uint64_t position = 0;
+        while (position < size) {
+            const uint64_t mapOffset = position / page * page;
+            const size_t mapLength = static_cast<size_t>(std::min<uint64_t>(size - mapOffset, window));
+            const char* data = file.map(mapOffset, mapLength);
+            const char* begin = data + (position - mapOffset);
+            const char* end = data + mapLength;
+            if (mapOffset + mapLength != size) {
+                // leave the incomplete record at the end to the next window
+                const char* behind = findBehindLast(begin, end, options.delimiter);
+                if (!behind) {
+                    window *= 2;
+                    continue;
+                }
+                end = behind;
+            }
+            sink.process(begin, end, position);
+            position += static_cast<uint64_t>(end - begin);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        file.h
+ * \brief       Header file declaring the file validation mode
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p validateFile(), which validates files of
+ * delimited IBANs in place without copying the records.
+ */
+
+#ifndef LIBIBAN_FILE_H
+#define LIBIBAN_FILE_H
+
+#include <string>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/// Formats in which \p validateFile() reports the results
+enum class FileResultFormat {
+    /// Report the byte offsets of the invalid records
+    InvalidOffsets,
+    /// Report a bitmap with one bit per record
+    Bitmap
+};
+
+/// Options of \p validateFile()
+struct FileValidationOptions {
+    /// Default size of the part of the file mapped at once in bytes
+    static constexpr size_t defaultWindowSize = 64 * 1024 * 1024;
+
+    /// The format of the results
+    FileResultFormat format = FileResultFormat::InvalidOffsets;
+    /// The character separating the records; if it is a newline, a carriage
+    /// return ending a record is ignored
+    char delimiter = '\n';
+    /// The size of the part of the file mapped at once in bytes, rounded up to
+    /// whole pages; bounds the memory used by \p validateFile()
+    size_t windowSize = defaultWindowSize;
+};
+
+/// Results of \p validateFile()
+struct FileValidationResult {
+    /// The number of records
+    uint64_t records = 0;
+    /// The number of invalid records
+    uint64_t invalidRecords = 0;
+    /// Byte offsets of the invalid records (\p FileResultFormat::InvalidOffsets)
+    std::vector<uint64_t> invalidOffsets;
+    /// Bit \p i % 64 of element \p i / 64 is set if record \p i is valid
+    /// (\p FileResultFormat::Bitmap)
+    std::vector<uint64_t> validBits;
+};
+
+void validateFile(const std::string& path, FileValidationResult& result,
+                  const FileValidationOptions& options = FileValidationOptions());
+}
+
+#endif //LIBIBAN_FILE_H
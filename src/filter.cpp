@@ -0,0 +1,438 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        filter.cpp
+ * \brief       Probabilistic membership filter for lists of IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p IBANFilter and \p IBANFilterBuilder after
+ * Graf and Lemire, "Binary Fuse Filters: Fast and Smaller Than Xor Filters"
+ * (2022). Every IBAN is mapped to three fingerprints in three consecutive
+ * segments of the array, and the fingerprints are assigned so that the three
+ * of every IBAN xor to the IBAN's own fingerprint.
+ */
+
+#include "filter.h"
+#include "hash.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace IBAN {
+
+    namespace {
+        /// Magic bytes at the start of a snapshot
+        constexpr char filterMagic[8] = {'I', 'B', 'A', 'N', 'F', 'L', 'T', '1'};
+        /// Size of the snapshot header
+        constexpr size_t filterHeaderSize = 48;
+        /// Number of IBANs whose probes are prefetched together
+        constexpr size_t prefetchDistance = 16;
+        /// Number of seeds tried before the array is enlarged
+        constexpr size_t seedAttempts = 4;
+
+        /// Throws the exception for a snapshot that cannot be loaded
+        [[noreturn]] void throwMalformedFilter() {
+            throw std::runtime_error("Malformed IBAN filter snapshot");
+        }
+
+        /// Reads up to 8 bytes in little endian byte order
+        inline uint64_t readLittleEndian(const char* data, size_t length) noexcept {
+            uint64_t value = 0;
+            for (size_t i = 0; i < length; ++i) {
+                value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        /// Hashes an IBAN independently of the platform, unlike \p hashBytes()
+        uint64_t hashKey(const char* data, size_t length) noexcept {
+            uint64_t state = 0xa0761d6478bd642full ^ length;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                state = detail::hashMix(readLittleEndian(data + i, 8) ^ 0xe7037ed1a0b428dbull,
+                                        state ^ 0x8ebc6af09c88c6e3ull);
+            }
+            return detail::hashMix(readLittleEndian(data + i, length - i) ^ 0x589965cc75374cc3ull,
+                                   state ^ 0xe7037ed1a0b428dbull);
+        }
+
+        /// Derives the hash of a key for a seed (the finalizer of SplitMix64)
+        inline uint64_t mixKey(uint64_t key, uint64_t seed) noexcept {
+            uint64_t h = key + seed;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+            return h ^ (h >> 31);
+        }
+
+        /// Returns the fingerprint of a hash
+        inline uint8_t getFingerprint(uint64_t hash) noexcept {
+            return static_cast<uint8_t>(hash ^ (hash >> 32));
+        }
+
+        /// Layout of the fingerprint array
+        struct Layout {
+            /// Length of a segment, a power of 2
+            uint32_t segmentLength;
+            /// Number of fingerprints the first probe can hit
+            uint32_t segmentCountLength;
+
+            /// Returns the number of fingerprints
+            size_t getLength() const noexcept {
+                return size_t(segmentCountLength) + 2 * size_t(segmentLength);
+            }
+
+            /// Computes the three positions of a hash
+            void getPositions(uint64_t hash, size_t* positions) const noexcept {
+                const uint64_t first = ((hash >> 32) * segmentCountLength) >> 32;
+                const uint64_t mask = segmentLength - 1;
+                positions[0] = static_cast<size_t>(first);
+                positions[1] = static_cast<size_t>((first + segmentLength) ^ ((hash >> 18) & mask));
+                positions[2] = static_cast<size_t>((first + 2 * segmentLength) ^ (hash & mask));
+            }
+        };
+
+        /// Returns the layout for \p count keys with the sizes recommended by
+        /// Graf and Lemire for three probes
+        Layout getLayout(size_t count) noexcept {
+            const double size = static_cast<double>(std::max<size_t>(count, 2));
+            const int exponent = static_cast<int>(std::floor(std::log(size) / std::log(3.33) + 2.25));
+            const uint32_t segmentLength = uint32_t(1) << std::min(exponent, 18);
+            const double factor = std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(size));
+            const size_t capacity = static_cast<size_t>(std::round(size * factor));
+            const size_t segments = (capacity + segmentLength - 1) / segmentLength;
+            Layout layout;
+            layout.segmentLength = segmentLength;
+            layout.segmentCountLength = static_cast<uint32_t>(std::max<size_t>(segments, 3) - 2) *
+                                        segmentLength;
+            return layout;
+        }
+
+        /// Mapping of the fingerprints of a built filter
+        struct Fingerprints {
+            Layout layout;
+            uint64_t seed;
+            std::vector<uint8_t> values;
+        };
+
+        /// Tries to assign the fingerprints of distinct keys by peeling: a
+        /// position only one remaining key maps to is assigned last to that
+        /// key, which is removed from its other positions
+        bool assignFingerprints(const std::vector<uint64_t>& keys, Fingerprints& result) {
+            const Layout& layout = result.layout;
+            const size_t length = layout.getLength();
+            std::vector<uint32_t> counts(length, 0);
+            std::vector<uint64_t> hashes(length, 0);
+            size_t positions[3];
+            for (const uint64_t key : keys) {
+                const uint64_t hash = mixKey(key, result.seed);
+                layout.getPositions(hash, positions);
+                for (const size_t position : positions) {
+                    ++counts[position];
+                    hashes[position] ^= hash;
+                }
+            }
+
+            std::vector<uint32_t> queue;
+            for (size_t i = 0; i < length; ++i) {
+                if (counts[i] == 1) {
+                    queue.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            std::vector<std::pair<uint64_t, uint32_t>> order;
+            order.reserve(keys.size());
+            while (!queue.empty()) {
+                const uint32_t position = queue.back();
+                queue.pop_back();
+                if (counts[position] != 1) {
+                    continue;
+                }
+                const uint64_t hash = hashes[position];
+                order.emplace_back(hash, position);
+                layout.getPositions(hash, positions);
+                for (const size_t other : positions) {
+                    hashes[other] ^= hash;
+                    if (--counts[other] == 1) {
+                        queue.push_back(static_cast<uint32_t>(other));
+                    }
+                }
+            }
+            if (order.size() != keys.size()) {
+                return false;
+            }
+
+            // in reverse order, every key has one position no later key uses
+            result.values.assign(length, 0);
+            for (size_t i = order.size(); i-- > 0;) {
+                const uint64_t hash = order[i].first;
+                layout.getPositions(hash, positions);
+                result.values[order[i].second] = static_cast<uint8_t>(
+                        getFingerprint(hash) ^ result.values[positions[0]] ^
+                        result.values[positions[1]] ^ result.values[positions[2]]);
+            }
+            return true;
+        }
+    }
+
+    /**
+     * Adds an IBAN.
+     *
+     * @param machineForm The IBAN in machine form; the filter hashes the
+     * characters as they are, so it must be queried with machine forms as well
+     */
+    void IBANFilterBuilder::add(StringView machineForm) {
+        m_keys.push_back(hashKey(machineForm.data(), machineForm.size()));
+    }
+
+    /**
+     * Adds an IBAN.
+     *
+     * @param iban The IBAN
+     */
+    void IBANFilterBuilder::add(const CompactIBAN& iban) {
+        add(iban.getMachineForm());
+    }
+
+    /**
+     * Adds a batch of IBANs.
+     *
+     * @param ibans The IBANs
+     * @param count The number of IBANs
+     */
+    void IBANFilterBuilder::add(const CompactIBAN* ibans, size_t count) {
+        m_keys.reserve(m_keys.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            add(ibans[i].getMachineForm());
+        }
+    }
+
+    /**
+     * Builds the snapshot of the filter over the IBANs added.
+     *
+     * @return The snapshot
+     */
+    std::vector<char> IBANFilterBuilder::build() const {
+        std::vector<uint64_t> keys = m_keys;
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        Fingerprints fingerprints;
+        fingerprints.layout = getLayout(keys.size());
+        fingerprints.seed = 0x9e3779b97f4a7c15ull;
+        for (size_t attempt = 1; !assignFingerprints(keys, fingerprints); ++attempt) {
+            // small sets fail more often, give them more room
+            if (attempt % seedAttempts == 0) {
+                fingerprints.layout.segmentCountLength += fingerprints.layout.segmentLength;
+            }
+            fingerprints.seed = mixKey(fingerprints.seed, attempt);
+        }
+
+        const Layout& layout = fingerprints.layout;
+        std::vector<char> snapshot(filterHeaderSize + fingerprints.values.size());
+        std::memcpy(snapshot.data(), filterMagic, sizeof(filterMagic));
+        detail::writeNumber<uint64_t>(snapshot.data() + 8, keys.size());
+        detail::writeNumber<uint64_t>(snapshot.data() + 16, fingerprints.seed);
+        detail::writeNumber<uint64_t>(snapshot.data() + 24, layout.segmentLength);
+        detail::writeNumber<uint64_t>(snapshot.data() + 32, layout.segmentCountLength / layout.segmentLength);
+        detail::writeNumber<uint64_t>(snapshot.data() + 40, fingerprints.values.size());
+        std::memcpy(snapshot.data() + filterHeaderSize, fingerprints.values.data(),
+                    fingerprints.values.size());
+        return snapshot;
+    }
+
+    /**
+     * Writes the snapshot of the filter over the IBANs added to a file.
+     *
+     * @param path The path of the file
+     * @throws std::system_error If the file cannot be written
+     */
+    void IBANFilterBuilder::write(const std::string& path) const {
+        detail::writeSnapshot(path, build());
+    }
+
+    IBANFilter::IBANFilter() noexcept : m_mapping(nullptr), m_mappingSize(0), m_fingerprints(nullptr),
+                                        m_count(0), m_seed(0), m_segmentLength(0),
+                                        m_segmentCountLength(0), m_length(0) {}
+
+    IBANFilter::~IBANFilter() {
+        detail::unmapSnapshot(m_mapping, m_mappingSize);
+    }
+
+    /**
+     * Opens a snapshot file. The file is mapped into memory and must not be
+     * modified while the filter exists; replace it by renaming a new file over
+     * it instead.
+     *
+     * @param path The path of the snapshot
+     * @return The filter
+     * @throws std::system_error If the file cannot be opened or mapped
+     * @throws std::runtime_error If the file is not a valid snapshot
+     */
+    std::unique_ptr<IBANFilter> IBANFilter::open(const std::string& path) {
+#if LIBIBAN_USE_MMAP
+        const detail::SnapshotMapping mapping = detail::mapSnapshot(path);
+        std::unique_ptr<IBANFilter> filter(new IBANFilter());
+        filter->m_mapping = mapping.data;
+        filter->m_mappingSize = mapping.size;
+        filter->load(static_cast<const char*>(mapping.data), mapping.size);
+        return filter;
+#else
+        return fromBuffer(detail::readSnapshot(path));
+#endif
+    }
+
+    /**
+     * Loads a snapshot held in memory, e.g. as returned by
+     * \p IBANFilterBuilder::build().
+     *
+     * @param snapshot The snapshot
+     * @return The filter
+     * @throws std::runtime_error If \p snapshot is not a valid snapshot
+     */
+    std::unique_ptr<IBANFilter> IBANFilter::fromBuffer(std::vector<char> snapshot) {
+        std::unique_ptr<IBANFilter> filter(new IBANFilter());
+        filter->m_buffer = std::move(snapshot);
+        filter->load(filter->m_buffer.data(), filter->m_buffer.size());
+        return filter;
+    }
+
+    /// Checks the header of the snapshot
+    void IBANFilter::load(const char* data, size_t size) {
+        if (size < filterHeaderSize || std::memcmp(data, filterMagic, sizeof(filterMagic)) != 0) {
+            throwMalformedFilter();
+        }
+        const uint64_t segmentLength = detail::readNumber<uint64_t>(data + 24);
+        const uint64_t segmentCount = detail::readNumber<uint64_t>(data + 32);
+        const uint64_t length = detail::readNumber<uint64_t>(data + 40);
+        if (segmentLength == 0 || (segmentLength & (segmentLength - 1)) != 0 ||
+            segmentLength > UINT32_MAX || segmentCount == 0 || segmentCount > UINT32_MAX / segmentLength ||
+            length != (segmentCount + 2) * segmentLength || length != size - filterHeaderSize) {
+            throwMalformedFilter();
+        }
+        m_count = static_cast<size_t>(detail::readNumber<uint64_t>(data + 8));
+        m_seed = detail::readNumber<uint64_t>(data + 16);
+        m_segmentLength = static_cast<uint32_t>(segmentLength);
+        m_segmentCountLength = static_cast<uint32_t>(segmentCount * segmentLength);
+        m_length = static_cast<size_t>(length);
+        m_fingerprints = reinterpret_cast<const uint8_t*>(data + filterHeaderSize);
+    }
+
+    /// Tests the hash of an IBAN against the filter
+    bool IBANFilter::containsKey(uint64_t key) const noexcept {
+        const uint64_t hash = mixKey(key, m_seed);
+        Layout layout;
+        layout.segmentLength = m_segmentLength;
+        layout.segmentCountLength = m_segmentCountLength;
+        size_t positions[3];
+        layout.getPositions(hash, positions);
+        return m_count > 0 && (getFingerprint(hash) ^ m_fingerprints[positions[0]] ^
+                               m_fingerprints[positions[1]] ^ m_fingerprints[positions[2]]) == 0;
+    }
+
+    /**
+     * Tests if an IBAN may be contained in the set.
+     *
+     * @param machineForm The IBAN in machine form
+     * @return \p false if the IBAN is not contained, \p true if it is contained
+     * or in rare cases if it is not
+     */
+    bool IBANFilter::contains(StringView machineForm) const noexcept {
+        return containsKey(hashKey(machineForm.data(), machineForm.size()));
+    }
+
+    /**
+     * Tests if an IBAN may be contained in the set.
+     *
+     * @param iban The IBAN
+     * @return \p false if the IBAN is not contained, \p true if it is contained
+     * or in rare cases if it is not
+     */
+    bool IBANFilter::contains(const CompactIBAN& iban) const noexcept {
+        return contains(iban.getMachineForm());
+    }
+
+    /**
+     * Tests a batch of IBANs like \p contains(). The fingerprints of the
+     * following IBANs are prefetched while the current ones are tested, so
+     * the memory latency of large filters overlaps.
+     *
+     * @param ibans Pointers to the IBANs in machine form, which need not be
+     * null terminated
+     * @param lengths The lengths of the IBANs
+     * @param count The number of IBANs
+     * @param results Array of \p count elements receiving 1 for the IBANs
+     * that may be contained and 0 for the others
+     */
+    void IBANFilter::containsBatch(const char* const* ibans, const uint8_t* lengths, size_t count,
+                                   uint8_t* results) const noexcept {
+        Layout layout;
+        layout.segmentLength = m_segmentLength;
+        layout.segmentCountLength = m_segmentCountLength;
+        uint64_t hashes[prefetchDistance];
+        size_t positions[prefetchDistance][3];
+        for (size_t begin = 0; begin < count; begin += prefetchDistance) {
+            const size_t size = std::min(prefetchDistance, count - begin);
+            for (size_t i = 0; i < size; ++i) {
+                hashes[i] = mixKey(hashKey(ibans[begin + i], lengths[begin + i]), m_seed);
+                layout.getPositions(hashes[i], positions[i]);
+#if defined(__GNUC__)
+                __builtin_prefetch(m_fingerprints + positions[i][0]);
+                __builtin_prefetch(m_fingerprints + positions[i][1]);
+                __builtin_prefetch(m_fingerprints + positions[i][2]);
+#endif
+            }
+            for (size_t i = 0; i < size; ++i) {
+                results[begin + i] = m_count > 0 &&
+                        (getFingerprint(hashes[i]) ^ m_fingerprints[positions[i][0]] ^
+                         m_fingerprints[positions[i][1]] ^ m_fingerprints[positions[i][2]]) == 0;
+            }
+        }
+    }
+
+    /**
+     * Tests a batch of IBANs like \p contains().
+     *
+     * @param ibans The IBANs
+     * @param count The number of IBANs
+     * @param results Array of \p count elements receiving 1 for the IBANs
+     * that may be contained and 0 for the others
+     */
+    void IBANFilter::containsBatch(const CompactIBAN* ibans, size_t count,
+                                   uint8_t* results) const noexcept {
+        const char* pointers[prefetchDistance];
+        uint8_t lengths[prefetchDistance];
+        for (size_t begin = 0; begin < count; begin += prefetchDistance) {
+            const size_t size = std::min(prefetchDistance, count - begin);
+            for (size_t i = 0; i < size; ++i) {
+                pointers[i] = ibans[begin + i].getMachineForm().data();
+                lengths[i] = static_cast<uint8_t>(ibans[begin + i].size());
+            }
+            containsBatch(pointers, lengths, size, results + begin);
+        }
+    }
+
+}
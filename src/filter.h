@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        filter.h
+ * \brief       Probabilistic membership filter for lists of IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p IBANFilter, a binary fuse filter telling if an
+ * IBAN may be on a list like a sanctions or block list, and the
+ * \p IBANFilterBuilder writing its snapshot files.
+ */
+
+#ifndef LIBIBAN_FILTER_H
+#define LIBIBAN_FILTER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/**
+ * Collects IBANs and builds an \p IBANFilter over them. The builder only keeps
+ * a 64 bit hash per IBAN; building needs about 40 bytes per IBAN temporarily.
+ */
+class IBANFilterBuilder {
+public:
+    void add(StringView machineForm);
+    void add(const CompactIBAN& iban);
+    void add(const CompactIBAN* ibans, size_t count);
+    /// Returns the number of IBANs added, including duplicates
+    size_t size() const noexcept { return m_keys.size(); }
+    std::vector<char> build() const;
+    void write(const std::string& path) const;
+
+private:
+    /// Holds the hashes of the IBANs added
+    std::vector<uint64_t> m_keys;
+};
+
+/**
+ * Binary fuse filter over a set of IBANs with 8 bit fingerprints. It takes
+ * about 9 bits per IBAN and answers every query with three probes into an
+ * array of fingerprints, which lie within a window of a few cache lines. IBANs
+ * of the set are always reported as contained; other IBANs are reported as
+ * contained with a probability of about 0.4%, so a positive answer has to be
+ * confirmed with the exact list while most negative ones are final.
+ *
+ * The IBANs are hashed in machine form with a hash function that is stable
+ * across platforms and versions of the library, so snapshots can be shared.
+ * The snapshot consists of a 48 byte header ("IBANFLT1", the number of IBANs,
+ * the seed, the length of a segment, the number of segments and the number of
+ * fingerprints as 64 bit numbers) followed by the fingerprints. Numbers are
+ * stored in host byte order. Snapshot files are memory mapped.
+ */
+class IBANFilter {
+public:
+    static std::unique_ptr<IBANFilter> open(const std::string& path);
+    static std::unique_ptr<IBANFilter> fromBuffer(std::vector<char> snapshot);
+    ~IBANFilter();
+
+    IBANFilter(const IBANFilter&) = delete;
+    IBANFilter& operator=(const IBANFilter&) = delete;
+
+    /// Returns the number of IBANs of the set
+    size_t size() const noexcept { return m_count; }
+    /// Returns the number of bits of the filter
+    size_t getBitCount() const noexcept { return m_length * 8; }
+    bool contains(StringView machineForm) const noexcept;
+    bool contains(const CompactIBAN& iban) const noexcept;
+    void containsBatch(const char* const* ibans, const uint8_t* lengths, size_t count,
+                       uint8_t* results) const noexcept;
+    void containsBatch(const CompactIBAN* ibans, size_t count, uint8_t* results) const noexcept;
+
+private:
+    IBANFilter() noexcept;
+    void load(const char* data, size_t size);
+    bool containsKey(uint64_t key) const noexcept;
+
+    /// Holds the snapshot if it was passed as buffer
+    std::vector<char> m_buffer;
+    /// Holds the mapping of the snapshot file or \p nullptr
+    void* m_mapping;
+    /// Holds the size of \p m_mapping
+    size_t m_mappingSize;
+    /// Points to the fingerprints
+    const uint8_t* m_fingerprints;
+    /// Holds the number of IBANs
+    size_t m_count;
+    /// Holds the seed of the hash function
+    uint64_t m_seed;
+    /// Holds the length of a segment, a power of 2
+    uint32_t m_segmentLength;
+    /// Holds the number of fingerprints the first probe can hit
+    uint32_t m_segmentCountLength;
+    /// Holds the number of fingerprints
+    size_t m_length;
+};
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_FILTER_H
@@ -0,0 +1,301 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        generator.cpp
+ * \brief       Source file implementing the fast IBAN generator
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the classes \p Xoshiro256 and \p IBANGenerator
+ * and the function \p generateRange().
+ */
+
+#include "generator.h"
+#include <algorithm>
+#include "utils.h"
+
+#if USE_BOOST
+#include <boost/random/random_device.hpp>
+#else
+#include <random>
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Characters allowed at alphanumeric positions of a BBAN
+        const char alphanumeric[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+        /// Weight of the last digit of the BBAN in the numerical, rearranged
+        /// IBAN: it is followed by the four digits of the country code and the
+        /// two check digits, so it counts 10^6 mod 97
+        constexpr unsigned lastDigitWeight = 1000000 % 97;
+
+        /// Returns the structure of a country's BBANs or throws an
+        /// \p IBANInvalidCountryCodeException if the country is unknown
+        const BBANStructure& getStructure(StringView countryCode) {
+            const BBANStructure* structure = countryCode.size() == 2 ?
+                    getBBANStructure(countryCode[0], countryCode[1]) : nullptr;
+            if (!structure) {
+                throw IBANInvalidCountryCodeException(countryCode.toString());
+            }
+            return *structure;
+        }
+    }
+
+    /**
+     * Constructs a generator from a seed. The state is initialised from the
+     * seed with SplitMix64 as recommended by the authors of the algorithm.
+     *
+     * @param seed The seed
+     */
+    Xoshiro256::Xoshiro256(uint64_t seed) noexcept : m_state() {
+        for (auto& word : m_state) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    /**
+     * Advances the generator by 2^128 numbers, which is equivalent to that
+     * many calls of \p operator()(). Calling it \p n times on copies of a
+     * generator yields non-overlapping sequences for parallel use.
+     */
+    void Xoshiro256::jump() noexcept {
+        static const uint64_t polynomial[] = {
+            0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+            0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+        };
+        uint64_t state[4] = {0, 0, 0, 0};
+        for (const uint64_t word : polynomial) {
+            for (int bit = 0; bit < 64; ++bit) {
+                if (word & (1ull << bit)) {
+                    for (size_t i = 0; i < 4; ++i) {
+                        state[i] ^= m_state[i];
+                    }
+                }
+                (*this)();
+            }
+        }
+        std::copy(state, state + 4, m_state);
+    }
+
+    /**
+     * Returns a seed drawn from the operating system's random device.
+     *
+     * @return A random seed
+     */
+    uint64_t Xoshiro256::randomSeed() {
+#if USE_BOOST
+        boost::random::random_device device;
+#else
+        std::random_device device;
+#endif
+        return static_cast<uint64_t>(device()) << 32 | device();
+    }
+
+    /**
+     * Constructs a generator with a random seed.
+     */
+    IBANGenerator::IBANGenerator() : m_random(Xoshiro256::randomSeed()) {
+    }
+
+    /**
+     * Constructs a generator with a fixed seed. Generators with equal seeds and
+     * different streams produce independent sequences of IBANs.
+     *
+     * @param seed The seed
+     * @param stream The index of the stream, e.g. the index of the thread (default: 0)
+     */
+    IBANGenerator::IBANGenerator(uint64_t seed, size_t stream) noexcept : m_random(seed) {
+        for (size_t i = 0; i < stream; ++i) {
+            m_random.jump();
+        }
+    }
+
+    /**
+     * Generates a single valid IBAN.
+     *
+     * @param countryCode The country of the IBAN
+     * @return The generated IBAN
+     * @throws IBANInvalidCountryCodeException If the country is unknown
+     */
+    CompactIBAN IBANGenerator::generate(StringView countryCode) {
+        CompactIBAN iban;
+        generate(countryCode.data(), getStructure(countryCode), iban);
+        return iban;
+    }
+
+    /**
+     * Fills an array with valid IBANs of one country.
+     *
+     * @param countryCode The country of the IBANs
+     * @param ibans The array receiving the IBANs
+     * @param count The number of IBANs to generate
+     * @throws IBANInvalidCountryCodeException If the country is unknown
+     */
+    void IBANGenerator::generate(StringView countryCode, CompactIBAN* ibans, size_t count) {
+        const BBANStructure& structure = getStructure(countryCode);
+        for (size_t i = 0; i < count; ++i) {
+            generate(countryCode.data(), structure, ibans[i]);
+        }
+    }
+
+    /**
+     * Fills an array with valid IBANs of several countries. The country of
+     * each IBAN is chosen randomly according to the weights of \p mix.
+     *
+     * @param mix The countries and their weights
+     * @param ibans The array receiving the IBANs
+     * @param count The number of IBANs to generate
+     * @throws IBANInvalidCountryCodeException If a country is unknown
+     * @throws std::invalid_argument If the sum of the weights is 0
+     */
+    void IBANGenerator::generate(const std::vector<CountryWeight>& mix, CompactIBAN* ibans,
+                                 size_t count) {
+        std::vector<const BBANStructure*> structures;
+        std::vector<uint32_t> bounds;
+        uint32_t total = 0;
+        for (const auto& entry : mix) {
+            structures.push_back(&getStructure(entry.countryCode));
+            total += entry.weight;
+            bounds.push_back(total);
+        }
+        if (total == 0) {
+            throw std::invalid_argument("The weights of the country mix sum up to 0");
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t value = m_random.uniform(total);
+            const size_t country = static_cast<size_t>(
+                    std::upper_bound(bounds.begin(), bounds.end(), value) - bounds.begin());
+            generate(mix[country].countryCode, *structures[country], ibans[i]);
+        }
+    }
+
+    /**
+     * Generates a random BBAN of the given structure and computes the check
+     * sum of the IBAN.
+     *
+     * @param countryCode The two letters of the country code
+     * @param structure The BBAN structure of the country
+     * @param iban The instance receiving the IBAN
+     */
+    void IBANGenerator::generate(const char* countryCode, const BBANStructure& structure,
+                                 CompactIBAN& iban) noexcept {
+        char machineForm[maxIBANLength] = {countryCode[0], countryCode[1], '0', '0'};
+        char* bban = machineForm + 4;
+        for (size_t i = 0; i < structure.length; ++i) {
+            switch (structure.classes[i]) {
+                case BBANStructure::Digit:
+                    bban[i] = static_cast<char>('0' + m_random.uniform(10));
+                    break;
+                case BBANStructure::Letter:
+                    bban[i] = static_cast<char>('A' + m_random.uniform(26));
+                    break;
+                default:
+                    bban[i] = alphanumeric[m_random.uniform(36)];
+            }
+        }
+
+        unsigned remainder = 0;
+        updateRemainder(remainder, bban, structure.length);
+        updateRemainder(remainder, machineForm, 4);
+        const unsigned checksum = 98 - remainder;
+        machineForm[2] = static_cast<char>('0' + checksum / 10);
+        machineForm[3] = static_cast<char>('0' + checksum % 10);
+        iban = CompactIBAN(StringView(machineForm, structure.length + 4u));
+    }
+
+    /**
+     * Generates the IBANs of consecutive account numbers: the BBAN of the
+     * \p i -th IBAN consists of \p bbanPrefix followed by \p startCounter + \p i,
+     * padded with zeros to the length of the country's BBANs.
+     *
+     * Incrementing the counter adds 10^6 to the numerical form of the IBAN, so
+     * the remainder is updated with a single addition instead of being
+     * recomputed from all digits.
+     *
+     * @param countryCode The country of the IBANs
+     * @param bbanPrefix The leading part of the BBANs, e.g. the bank code
+     * @param startCounter The counter of the first IBAN
+     * @param count The number of IBANs to generate
+     * @param ibans The array of \p count elements receiving the IBANs
+     * @throws IBANInvalidCountryCodeException If the country is unknown
+     * @throws std::invalid_argument If \p bbanPrefix does not match the BBAN
+     * structure, the positions following it are not all digits or the counter
+     * does not fit into them
+     */
+    void generateRange(StringView countryCode, StringView bbanPrefix, uint64_t startCounter,
+                       size_t count, CompactIBAN* ibans) {
+        const BBANStructure& structure = getStructure(countryCode);
+        if (bbanPrefix.size() >= structure.length) {
+            throw std::invalid_argument("The BBAN prefix leaves no room for the counter");
+        }
+        for (size_t i = 0; i < bbanPrefix.size(); ++i) {
+            if (!(BBANStructure::classify(bbanPrefix[i]) & structure.classes[i])) {
+                throw std::invalid_argument("The BBAN prefix does not match the BBAN structure");
+            }
+        }
+        const size_t digits = structure.length - bbanPrefix.size();
+        uint64_t capacity = 1;
+        for (size_t i = bbanPrefix.size(); i < structure.length; ++i) {
+            if (structure.classes[i] != BBANStructure::Digit) {
+                throw std::invalid_argument("The BBAN structure has no room for a numerical counter");
+            }
+            capacity = capacity > UINT64_MAX / 10 ? UINT64_MAX : capacity * 10;
+        }
+        if (count > 0 && (startCounter >= capacity || count - 1 > capacity - 1 - startCounter)) {
+            throw std::invalid_argument("The counter does not fit into the BBAN");
+        }
+
+        char machineForm[maxIBANLength] = {countryCode[0], countryCode[1], '0', '0'};
+        std::memcpy(machineForm + 4, bbanPrefix.data(), bbanPrefix.size());
+        char* counter = machineForm + 4 + bbanPrefix.size();
+        uint64_t value = startCounter;
+        for (size_t i = digits; i-- > 0;) {
+            counter[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        const size_t length = structure.length + 4u;
+
+        unsigned remainder = 0;
+        updateRemainder(remainder, machineForm + 4, structure.length);
+        updateRemainder(remainder, machineForm, 4);
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned checksum = 98 - remainder;
+            machineForm[2] = static_cast<char>('0' + checksum / 10);
+            machineForm[3] = static_cast<char>('0' + checksum % 10);
+            ibans[i] = CompactIBAN(StringView(machineForm, length));
+
+            // increment the counter in place
+            for (size_t d = digits; d-- > 0 && ++counter[d] > '9';) {
+                counter[d] = '0';
+            }
+            remainder = (remainder + lastDigitWeight) % 97;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        generator.h
+ * \brief       Header file declaring the fast IBAN generator
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the pseudo-random number generator \p Xoshiro256
+ * and the class \p IBANGenerator, which generates large amounts of valid IBANs
+ * for test data, as well as \p generateRange(), which generates IBANs for
+ * consecutive account numbers.
+ */
+
+#ifndef LIBIBAN_GENERATOR_H
+#define LIBIBAN_GENERATOR_H
+
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/**
+ * The pseudo-random number generator xoshiro256** by David Blackman and
+ * Sebastiano Vigna. It is small and fast, but not suitable for cryptographic
+ * purposes. An instance must not be shared between threads; use \p jump() to
+ * derive non-overlapping sequences for multiple threads instead.
+ */
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) noexcept;
+
+    /**
+     * Returns the next 64 bit number of the sequence.
+     *
+     * @return A pseudo-random number
+     */
+    uint64_t operator()() noexcept {
+        const uint64_t result = rotate(m_state[1] * 5, 7) * 9;
+        const uint64_t t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotate(m_state[3], 45);
+        return result;
+    }
+
+    /**
+     * Returns a pseudo-random number in [0, \p bound) with a negligible bias.
+     *
+     * @param bound The upper bound, at least 1
+     * @return A pseudo-random number smaller than \p bound
+     */
+    uint32_t uniform(uint32_t bound) noexcept {
+        return static_cast<uint32_t>(((*this)() >> 32) * bound >> 32);
+    }
+
+    void jump() noexcept;
+
+    static uint64_t randomSeed();
+
+private:
+    static uint64_t rotate(uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /// The state of the generator
+    uint64_t m_state[4];
+};
+
+/// Country and relative frequency of its IBANs in a country mix
+struct CountryWeight {
+    /// The country code
+    const char* countryCode;
+    /// The weight of the country
+    unsigned weight;
+};
+
+/**
+ * Generates valid IBANs with random BBANs matching the structure of their
+ * country. The IBANs are written into caller provided arrays without
+ * allocating memory per IBAN.
+ *
+ * Generators seeded equally produce equal IBANs, so runs can be reproduced.
+ * An instance must not be shared between threads; to generate in parallel,
+ * give every thread its own generator constructed with the same seed and a
+ * different \p stream.
+ */
+class IBANGenerator {
+public:
+    IBANGenerator();
+    explicit IBANGenerator(uint64_t seed, size_t stream = 0) noexcept;
+
+    CompactIBAN generate(StringView countryCode);
+    void generate(StringView countryCode, CompactIBAN* ibans, size_t count);
+    void generate(const std::vector<CountryWeight>& mix, CompactIBAN* ibans, size_t count);
+
+    /**
+     * Returns the underlying pseudo-random number generator.
+     *
+     * @return The pseudo-random number generator
+     */
+    Xoshiro256& getRandom() noexcept {
+        return m_random;
+    }
+
+private:
+    void generate(const char* countryCode, const BBANStructure& structure,
+                  CompactIBAN& iban) noexcept;
+
+    /// The pseudo-random number generator
+    Xoshiro256 m_random;
+};
+
+void generateRange(StringView countryCode, StringView bbanPrefix, uint64_t startCounter,
+                   size_t count, CompactIBAN* ibans);
+}
+
+#endif //LIBIBAN_GENERATOR_H
@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        hash.h
+ * \brief       Header file defining the hash function used for IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file defines \p hashBytes(), a fast non-cryptographic hash
+ * function in the style of wyhash. It backs the \p hash() methods of \p IBAN,
+ * \p CompactIBAN and \p PackedIBAN, their \p std::hash specializations and the
+ * hash tables in ibanset.h. Hash values are not stable across platforms and
+ * versions of the library and must not be persisted.
+ */
+
+#ifndef LIBIBAN_HASH_H
+#define LIBIBAN_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace IBAN {
+
+namespace detail {
+
+/**
+ * Multiplies two 64 bit numbers and folds the 128 bit product into 64 bits.
+ *
+ * @param lhs The first factor
+ * @param rhs The second factor
+ * @return The lower and the upper half of the product xor-ed together
+ */
+inline uint64_t hashMix(uint64_t lhs, uint64_t rhs) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    const uint128 product = static_cast<uint128>(lhs) * rhs;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    const uint64_t lhsLow = lhs & 0xFFFFFFFFu, lhsHigh = lhs >> 32;
+    const uint64_t rhsLow = rhs & 0xFFFFFFFFu, rhsHigh = rhs >> 32;
+    const uint64_t low = lhsLow * rhsLow, middle1 = lhsHigh * rhsLow;
+    const uint64_t middle2 = lhsLow * rhsHigh, high = lhsHigh * rhsHigh;
+    const uint64_t carry = ((low >> 32) + (middle1 & 0xFFFFFFFFu) + (middle2 & 0xFFFFFFFFu)) >> 32;
+    return (low + (middle1 << 32) + (middle2 << 32)) ^
+           (high + (middle1 >> 32) + (middle2 >> 32) + carry);
+#endif
+}
+
+/// Reads 8 bytes in native byte order
+inline uint64_t hashRead(const char* data) noexcept {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/// Reads up to 8 bytes in native byte order, filling the rest with zeros
+inline uint64_t hashReadPartial(const char* data, size_t length) noexcept {
+    uint64_t value = 0;
+    std::memcpy(&value, data, length);
+    return value;
+}
+
+} // end of namespace detail
+
+/**
+ * Computes a 64 bit hash of a byte sequence. The function is tuned for the
+ * short keys of IBANs: an IBAN in machine form takes two or three
+ * multiplications and never allocates memory.
+ *
+ * @param data The bytes to hash
+ * @param length The number of bytes
+ * @param seed Value to derive different hash functions from
+ * @return The hash value
+ */
+inline uint64_t hashBytes(const char* data, size_t length, uint64_t seed = 0) noexcept {
+    const uint64_t secret0 = 0xa0761d6478bd642full, secret1 = 0xe7037ed1a0b428dbull;
+    const uint64_t secret2 = 0x8ebc6af09c88c6e3ull, secret3 = 0x589965cc75374cc3ull;
+    uint64_t state = seed ^ secret0;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        state = detail::hashMix(detail::hashRead(data + i) ^ secret1,
+                                detail::hashRead(data + i + 8) ^ state);
+    }
+    uint64_t first = 0, second = 0;
+    const size_t rest = length - i;
+    if (rest > 8) {
+        first = detail::hashRead(data + i);
+        second = detail::hashReadPartial(data + i + 8, rest - 8);
+    } else {
+        first = detail::hashReadPartial(data + i, rest);
+    }
+    return detail::hashMix(secret1 ^ length,
+                           detail::hashMix(first ^ secret2, second ^ state ^ secret3));
+}
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_HASH_H
@@ -0,0 +1,563 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        ibanset.h
+ * \brief       Header file declaring hash tables keyed by IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p IBANSet and \p IBANMap, open-addressing hash
+ * tables for deduplicating and joining large amounts of IBANs. Both store the
+ * packed form of the IBANs (see \p PackedIBAN) inline in a single array, so an
+ * entry of \p IBANSet takes 23 bytes instead of the roughly 100 bytes a node
+ * of \p std::unordered_set<std::string> takes including its heap allocations.
+ */
+
+#ifndef LIBIBAN_IBANSET_H
+#define LIBIBAN_IBANSET_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+namespace detail {
+
+/**
+ * Packs an IBAN for the use as key of a hash table.
+ *
+ * @param machineForm The IBAN in machine form
+ * @return The packed IBAN
+ * @throws std::invalid_argument If the IBAN cannot be packed
+ */
+inline PackedIBAN packKey(StringView machineForm) {
+    PackedIBAN key;
+    if (!PackedIBAN::pack(machineForm, key)) {
+        throw std::invalid_argument("IBAN does not match the structure of its country");
+    }
+    return key;
+}
+
+/**
+ * Hash table with linear probing over entries holding a \p PackedIBAN named
+ * \p key. Empty packed IBANs mark free slots. The capacity is a power of two
+ * and the table grows once three quarters of the slots are taken.
+ */
+template <class Entry>
+class PackedHashTable {
+
+public:
+    /// Returns the number of entries
+    size_t size() const noexcept { return m_size; }
+    /// Returns the number of slots
+    size_t capacity() const noexcept { return m_entries.size(); }
+
+    /**
+     * Makes room for \p count entries without growing again.
+     *
+     * @param count The number of entries
+     */
+    void reserve(size_t count) {
+        size_t capacity = minCapacity;
+        while (capacity / 4 * 3 < count) {
+            capacity *= 2;
+        }
+        if (capacity > m_entries.size()) {
+            rehash(capacity);
+        }
+    }
+
+    /// Removes all entries, keeping the slots
+    void clear() {
+        std::fill(m_entries.begin(), m_entries.end(), Entry());
+        m_size = 0;
+    }
+
+    /**
+     * Looks up the entry of a key.
+     *
+     * @param key The key to look for
+     * @return The entry or \p nullptr if the key is not contained
+     */
+    const Entry* find(const PackedIBAN& key) const noexcept {
+        if (m_entries.empty() || key.empty()) {
+            return nullptr;
+        }
+        for (size_t slot = key.hash() & m_mask;; slot = (slot + 1) & m_mask) {
+            const Entry& entry = m_entries[slot];
+            if (entry.key == key) {
+                return &entry;
+            }
+            if (entry.key.empty()) {
+                return nullptr;
+            }
+        }
+    }
+
+    /// \overload
+    Entry* find(const PackedIBAN& key) noexcept {
+        return const_cast<Entry*>(static_cast<const PackedHashTable&>(*this).find(key));
+    }
+
+    /**
+     * Looks up the entry of a key and adds a default constructed entry if the
+     * key is not contained yet.
+     *
+     * @param key The key to look for; must not be empty
+     * @return The entry and \p true if it was added
+     */
+    std::pair<Entry*, bool> insert(const PackedIBAN& key) {
+        if ((m_size + 1) > m_entries.size() / 4 * 3) {
+            rehash(m_entries.empty() ? minCapacity : m_entries.size() * 2);
+        }
+        for (size_t slot = key.hash() & m_mask;; slot = (slot + 1) & m_mask) {
+            Entry& entry = m_entries[slot];
+            if (entry.key == key) {
+                return std::make_pair(&entry, false);
+            }
+            if (entry.key.empty()) {
+                entry.key = key;
+                ++m_size;
+                return std::make_pair(&entry, true);
+            }
+        }
+    }
+
+    /**
+     * Removes the entry of a key. Following entries of the probe sequence are
+     * shifted back instead of leaving tombstones, so lookups stay short.
+     *
+     * @param key The key to remove
+     * @return \p true if the key was contained
+     */
+    bool erase(const PackedIBAN& key) {
+        Entry* entry = find(key);
+        if (!entry) {
+            return false;
+        }
+        size_t hole = static_cast<size_t>(entry - m_entries.data());
+        for (size_t slot = (hole + 1) & m_mask; !m_entries[slot].key.empty();
+             slot = (slot + 1) & m_mask) {
+            // move the entry if the hole lies between its home slot and it
+            const size_t home = m_entries[slot].key.hash() & m_mask;
+            if (((slot - home) & m_mask) >= ((slot - hole) & m_mask)) {
+                m_entries[hole] = std::move(m_entries[slot]);
+                hole = slot;
+            }
+        }
+        m_entries[hole] = Entry();
+        --m_size;
+        return true;
+    }
+
+    /**
+     * Calls \p function for every entry in unspecified order.
+     *
+     * @param function Callable taking an entry
+     */
+    template <class Function>
+    void forEach(Function function) const {
+        for (const Entry& entry : m_entries) {
+            if (!entry.key.empty()) {
+                function(entry);
+            }
+        }
+    }
+
+    /// \overload
+    template <class Function>
+    void forEach(Function function) {
+        for (Entry& entry : m_entries) {
+            if (!entry.key.empty()) {
+                function(entry);
+            }
+        }
+    }
+
+private:
+    /// Smallest number of slots allocated
+    static constexpr size_t minCapacity = 16;
+    /// Holds the slots
+    std::vector<Entry> m_entries;
+    /// Holds the number of slots minus one
+    size_t m_mask {0};
+    /// Holds the number of entries
+    size_t m_size {0};
+
+    /// Moves all entries into a table with \p capacity slots
+    void rehash(size_t capacity) {
+        std::vector<Entry> entries(capacity);
+        const size_t mask = capacity - 1;
+        for (Entry& entry : m_entries) {
+            if (entry.key.empty()) {
+                continue;
+            }
+            size_t slot = entry.key.hash() & mask;
+            while (!entries[slot].key.empty()) {
+                slot = (slot + 1) & mask;
+            }
+            entries[slot] = std::move(entry);
+        }
+        m_entries.swap(entries);
+        m_mask = mask;
+    }
+
+}; // end of class PackedHashTable
+
+template <class Entry>
+constexpr size_t PackedHashTable<Entry>::minCapacity;
+
+/// Entry of \p IBANSet
+struct IBANSetEntry {
+    PackedIBAN key;
+};
+
+/// Entry of \p IBANMap
+template <class T>
+struct IBANMapEntry {
+    PackedIBAN key;
+    T value;
+};
+
+} // end of namespace detail
+
+/**
+ * Set of IBANs stored in packed form. IBANs are accepted as \p PackedIBAN,
+ * \p CompactIBAN or \p IBAN; IBANs whose length or BBAN structure does not
+ * match their country cannot be packed and thus not be inserted. Insertion
+ * may move entries, so references obtained through \p forEach() must not be
+ * kept.
+ */
+class IBANSet {
+
+public:
+    /// Constructs an empty set without allocating memory
+    IBANSet() {}
+
+    /**
+     * Constructs an empty set with room for \p count IBANs.
+     *
+     * @param count The number of IBANs to reserve room for
+     */
+    explicit IBANSet(size_t count) { m_table.reserve(count); }
+
+    /**
+     * Inserts an IBAN.
+     *
+     * @param iban The IBAN to insert; must not be empty
+     * @return \p true if the IBAN was inserted, \p false if it was contained
+     * already
+     * @throws std::invalid_argument If \p iban is empty
+     */
+    bool insert(const PackedIBAN& iban) {
+        if (iban.empty()) {
+            throw std::invalid_argument("Cannot insert an empty IBAN");
+        }
+        return m_table.insert(iban).second;
+    }
+
+    /**
+     * Inserts an IBAN.
+     *
+     * @param iban The IBAN to insert
+     * @return \p true if the IBAN was inserted, \p false if it was contained
+     * already
+     * @throws std::invalid_argument If the IBAN cannot be packed
+     */
+    bool insert(const CompactIBAN& iban) {
+        return m_table.insert(detail::packKey(iban.getMachineForm())).second;
+    }
+
+    /// \overload
+    bool insert(const IBAN& iban) { return insert(CompactIBAN(iban)); }
+
+    /**
+     * Checks whether an IBAN is contained in the set.
+     *
+     * @param iban The IBAN to look for
+     * @return \p true if the IBAN is contained
+     */
+    bool contains(const PackedIBAN& iban) const noexcept {
+        return m_table.find(iban) != nullptr;
+    }
+
+    /// \overload
+    bool contains(const CompactIBAN& iban) const noexcept {
+        PackedIBAN key;
+        return PackedIBAN::pack(iban.getMachineForm(), key) && contains(key);
+    }
+
+    /// \overload
+    bool contains(const IBAN& iban) const noexcept { return contains(CompactIBAN(iban)); }
+
+    /**
+     * Removes an IBAN from the set.
+     *
+     * @param iban The IBAN to remove
+     * @return \p true if the IBAN was contained
+     */
+    bool erase(const PackedIBAN& iban) { return m_table.erase(iban); }
+
+    /// \overload
+    bool erase(const CompactIBAN& iban) {
+        PackedIBAN key;
+        return PackedIBAN::pack(iban.getMachineForm(), key) && erase(key);
+    }
+
+    /// \overload
+    bool erase(const IBAN& iban) { return erase(CompactIBAN(iban)); }
+
+    /**
+     * Calls \p function with every IBAN of the set in unspecified order.
+     *
+     * @param function Callable taking a \p const \p PackedIBAN&
+     */
+    template <class Function>
+    void forEach(Function function) const {
+        m_table.forEach([&function](const detail::IBANSetEntry& entry) {
+            function(entry.key);
+        });
+    }
+
+    /// Returns the number of IBANs in the set
+    size_t size() const noexcept { return m_table.size(); }
+    /// Returns \p true if the set does not contain an IBAN
+    bool empty() const noexcept { return m_table.size() == 0; }
+    /// Returns the number of slots
+    size_t capacity() const noexcept { return m_table.capacity(); }
+    /// Returns the number of bytes allocated for the slots
+    size_t getMemoryUsage() const noexcept {
+        return m_table.capacity() * sizeof(detail::IBANSetEntry);
+    }
+
+    /**
+     * Makes room for \p count IBANs without growing again.
+     *
+     * @param count The number of IBANs
+     */
+    void reserve(size_t count) { m_table.reserve(count); }
+    /// Removes all IBANs, keeping the allocated memory
+    void clear() { m_table.clear(); }
+
+private:
+    /// Holds the IBANs
+    detail::PackedHashTable<detail::IBANSetEntry> m_table;
+
+}; // end of class IBANSet
+
+/**
+ * Map from IBANs to values of type \p T, with the IBANs stored in packed form
+ * next to their values. \p T must be default constructible and movable.
+ * IBANs are accepted like in \p IBANSet. Insertion may move entries, so
+ * pointers returned by \p find() and \p insert() are only valid until the
+ * next insertion or removal.
+ */
+template <class T>
+class IBANMap {
+
+public:
+    /// Constructs an empty map without allocating memory
+    IBANMap() {}
+
+    /**
+     * Constructs an empty map with room for \p count IBANs.
+     *
+     * @param count The number of IBANs to reserve room for
+     */
+    explicit IBANMap(size_t count) { m_table.reserve(count); }
+
+    /**
+     * Inserts an IBAN with a value unless the IBAN is contained already.
+     *
+     * @param iban The IBAN to insert; must not be empty
+     * @param value The value to insert
+     * @return The value stored for the IBAN and \p true if it was inserted,
+     * \p false if the IBAN was contained already
+     * @throws std::invalid_argument If \p iban is empty
+     */
+    std::pair<T*, bool> insert(const PackedIBAN& iban, T value) {
+        if (iban.empty()) {
+            throw std::invalid_argument("Cannot insert an empty IBAN");
+        }
+        const std::pair<Entry*, bool> result = m_table.insert(iban);
+        if (result.second) {
+            result.first->value = std::move(value);
+        }
+        return std::make_pair(&result.first->value, result.second);
+    }
+
+    /**
+     * Inserts an IBAN with a value unless the IBAN is contained already.
+     *
+     * @param iban The IBAN to insert
+     * @param value The value to insert
+     * @return The value stored for the IBAN and \p true if it was inserted,
+     * \p false if the IBAN was contained already
+     * @throws std::invalid_argument If the IBAN cannot be packed
+     */
+    std::pair<T*, bool> insert(const CompactIBAN& iban, T value) {
+        return insert(detail::packKey(iban.getMachineForm()), std::move(value));
+    }
+
+    /// \overload
+    std::pair<T*, bool> insert(const IBAN& iban, T value) {
+        return insert(CompactIBAN(iban), std::move(value));
+    }
+
+    /**
+     * Returns the value of an IBAN, inserting a default constructed value if
+     * the IBAN is not contained yet.
+     *
+     * @param iban The IBAN to look for
+     * @return The value stored for the IBAN
+     * @throws std::invalid_argument If the IBAN cannot be packed
+     */
+    T& operator[](const PackedIBAN& iban) {
+        if (iban.empty()) {
+            throw std::invalid_argument("Cannot insert an empty IBAN");
+        }
+        return m_table.insert(iban).first->value;
+    }
+
+    /// \overload
+    T& operator[](const CompactIBAN& iban) {
+        return m_table.insert(detail::packKey(iban.getMachineForm())).first->value;
+    }
+
+    /// \overload
+    T& operator[](const IBAN& iban) { return (*this)[CompactIBAN(iban)]; }
+
+    /**
+     * Looks up the value of an IBAN.
+     *
+     * @param iban The IBAN to look for
+     * @return The value or \p nullptr if the IBAN is not contained
+     */
+    T* find(const PackedIBAN& iban) noexcept {
+        Entry* entry = m_table.find(iban);
+        return entry ? &entry->value : nullptr;
+    }
+
+    /// \overload
+    const T* find(const PackedIBAN& iban) const noexcept {
+        const Entry* entry = m_table.find(iban);
+        return entry ? &entry->value : nullptr;
+    }
+
+    /// \overload
+    T* find(const CompactIBAN& iban) noexcept {
+        PackedIBAN key;
+        return PackedIBAN::pack(iban.getMachineForm(), key) ? find(key) : nullptr;
+    }
+
+    /// \overload
+    const T* find(const CompactIBAN& iban) const noexcept {
+        PackedIBAN key;
+        return PackedIBAN::pack(iban.getMachineForm(), key) ? find(key) : nullptr;
+    }
+
+    /// \overload
+    T* find(const IBAN& iban) noexcept { return find(CompactIBAN(iban)); }
+    /// \overload
+    const T* find(const IBAN& iban) const noexcept { return find(CompactIBAN(iban)); }
+
+    /**
+     * Checks whether an IBAN is contained in the map.
+     *
+     * @param iban The IBAN to look for
+     * @return \p true if the IBAN is contained
+     */
+    template <class Key>
+    bool contains(const Key& iban) const noexcept { return find(iban) != nullptr; }
+
+    /**
+     * Removes an IBAN and its value from the map.
+     *
+     * @param iban The IBAN to remove
+     * @return \p true if the IBAN was contained
+     */
+    bool erase(const PackedIBAN& iban) { return m_table.erase(iban); }
+
+    /// \overload
+    bool erase(const CompactIBAN& iban) {
+        PackedIBAN key;
+        return PackedIBAN::pack(iban.getMachineForm(), key) && erase(key);
+    }
+
+    /// \overload
+    bool erase(const IBAN& iban) { return erase(CompactIBAN(iban)); }
+
+    /**
+     * Calls \p function with every IBAN and its value in unspecified order.
+     *
+     * @param function Callable taking a \p const \p PackedIBAN& and a \p T&
+     */
+    template <class Function>
+    void forEach(Function function) {
+        m_table.forEach([&function](Entry& entry) { function(entry.key, entry.value); });
+    }
+
+    /**
+     * Calls \p function with every IBAN and its value in unspecified order.
+     *
+     * @param function Callable taking a \p const \p PackedIBAN& and a
+     * \p const \p T&
+     */
+    template <class Function>
+    void forEach(Function function) const {
+        m_table.forEach([&function](const Entry& entry) { function(entry.key, entry.value); });
+    }
+
+    /// Returns the number of IBANs in the map
+    size_t size() const noexcept { return m_table.size(); }
+    /// Returns \p true if the map does not contain an IBAN
+    bool empty() const noexcept { return m_table.size() == 0; }
+    /// Returns the number of slots
+    size_t capacity() const noexcept { return m_table.capacity(); }
+    /// Returns the number of bytes allocated for the slots
+    size_t getMemoryUsage() const noexcept { return m_table.capacity() * sizeof(Entry); }
+
+    /**
+     * Makes room for \p count IBANs without growing again.
+     *
+     * @param count The number of IBANs
+     */
+    void reserve(size_t count) { m_table.reserve(count); }
+    /// Removes all IBANs and their values, keeping the allocated memory
+    void clear() { m_table.clear(); }
+
+private:
+    typedef detail::IBANMapEntry<T> Entry;
+    /// Holds the IBANs and their values
+    detail::PackedHashTable<Entry> m_table;
+
+}; // end of class IBANMap
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_IBANSET_H
@@ -34,10 +34,89 @@
 
 #include <iostream>
 #include "libiban.h"
+#include "countrytable.h"
+#include "epoch.h"
+#include "generator.h"
+#include "normalize.h"
+#include "stats.h"
 #include "utils.h"
 
 namespace IBAN {
 
+    namespace {
+        /// Locale independent test for an uppercase latin letter
+        inline bool isUpper(char ch) noexcept {
+            return ch >= 'A' && ch <= 'Z';
+        }
+
+        /// Locale independent test for a decimal digit
+        inline bool isDigit(char ch) noexcept {
+            return ch >= '0' && ch <= '9';
+        }
+
+        /**
+         * Checks the country code, checksum digits, length and structure of
+         * an IBAN in machine form against the table set by
+         * \p setCountryTable(), in the order of the compiled-in checks.
+         */
+        ParseStatus checkTableFormat(const char* data, size_t length) noexcept {
+            EpochGuard guard;
+            const BBANStructure* structure = findBBANStructure(data[0], data[1]);
+            if (!structure) {
+                return ParseStatus::InvalidCountryCode;
+            }
+            if (!isDigit(data[2]) || !isDigit(data[3])) {
+                return ParseStatus::InvalidChecksumDigits;
+            }
+            if (length != structure->length + 4u) {
+                return ParseStatus::InvalidLength;
+            }
+            if (!structure->matches(data + 4, length - 4)) {
+                return ParseStatus::InvalidStructure;
+            }
+            return ParseStatus::OK;
+        }
+
+        /// Validates an IBAN in machine form against the table set by
+        /// \p setCountryTable()
+        ParseStatus getTableStatus(const char* data, size_t length) noexcept {
+            const ParseStatus formatStatus = checkTableFormat(data, length);
+            if (formatStatus != ParseStatus::OK) {
+                return formatStatus;
+            }
+            return getRemainderForIBAN(data, length) == 1 ? ParseStatus::OK : ParseStatus::ChecksumMismatch;
+        }
+
+        /**
+         * Writes \p machineForm into \p out in groups of \p groupSize
+         * characters separated by \p separator; in one piece if \p groupSize
+         * is 0. Returns the number of characters written or 0 if they do not
+         * fit into \p capacity characters.
+         */
+        size_t formatGroups(StringView machineForm, char* out, size_t capacity,
+                            size_t groupSize, char separator) noexcept {
+            const size_t length = machineForm.size();
+            const size_t separators = (groupSize == 0 || length == 0) ? 0 : (length - 1) / groupSize;
+            if (length + separators > capacity) {
+                return 0;
+            }
+            if (separators == 0) {
+                std::memcpy(out, machineForm.data(), length);
+                return length;
+            }
+            char* position = out;
+            for (size_t i = 0; i < length; i += groupSize) {
+                if (i != 0) {
+                    *position++ = separator;
+                }
+                const size_t group = std::min(groupSize, length - i);
+                std::memcpy(position, machineForm.data() + i, group);
+                position += group;
+            }
+            return length + separators;
+        }
+    }
+
     /**
      * Constructor of \p IBANParseException.
      *
@@ -89,30 +168,26 @@ namespace IBAN {
         return m_message.c_str();
     }
 
+    /**
+     * Builds the map of country codes from the compiled-in registry.
+     *
+     * @return Map mapping country codes to required IBAN length
+     */
+    static map_t createCountryCodeMap() {
+        map_t countryCodes;
+        for (size_t i = 0; i < countryCodeCount; ++i) {
+            if (CountryRegistry::lengths[i] != 0) {
+                const char code[2] = {
+                    static_cast<char>('A' + i / 26), static_cast<char>('A' + i % 26)
+                };
+                countryCodes.emplace(std::string(code, 2), CountryRegistry::lengths[i]);
+            }
+        }
+        return countryCodes;
+    }
+
     // initialize country code map
-    const map_t IBAN::m_countryCodes = {
-        {"AL", 28}, {"AD", 24}, {"AT", 20}, {"AZ", 28}, {"BE", 16},
-        {"BH", 22}, {"BA", 20}, {"BR", 29}, {"BG", 22}, {"CR", 22},
-        {"HR", 21}, {"CY", 28}, {"CZ", 24}, {"DK", 18}, {"DO", 28},
-        {"EE", 20}, {"FO", 18}, {"FI", 18}, {"FR", 27}, {"GE", 22},
-        {"DE", 22}, {"GI", 23}, {"GR", 27}, {"GL", 18}, {"GT", 28},
-        {"HU", 28}, {"IS", 26}, {"IE", 22}, {"IL", 23}, {"IT", 27},
-        {"KZ", 20}, {"KW", 30}, {"LV", 21}, {"LB", 28}, {"LI", 21},
-        {"LT", 20}, {"LU", 20}, {"MK", 19}, {"MT", 31}, {"MR", 27},
-        {"MU", 30}, {"MC", 27}, {"MD", 24}, {"ME", 22}, {"NL", 18},
-        {"NO", 15}, {"PK", 24}, {"PS", 29}, {"PL", 28}, {"PT", 25},
-        {"RO", 24}, {"SM", 27}, {"SA", 24}, {"RS", 22}, {"SK", 24},
-        {"SI", 19}, {"ES", 24}, {"SE", 24}, {"CH", 21}, {"TN", 24},
-        {"TR", 26}, {"AE", 23}, {"GB", 22}, {"VG", 24}, {"BJ", 28},
-        {"BF", 28}, {"BI", 16}, {"CM", 27}, {"CV", 25}, {"TL", 23},
-        {"IR", 26}, {"CI", 28}, {"JO", 30}, {"SA", 24}, {"MG", 27},
-        {"ML", 28}, {"MZ", 25}, {"QA", 29}, {"XK", 20}, {"SN", 28},
-        {"LC", 32}, {"ST", 25}, {"UA", 29}, {"SC", 31}, {"IQ", 23},
-        {"BY", 28}, {"SV", 28}, {"AO", 25}, {"CF", 27}, {"CG", 27},
-        {"EG", 27}, {"DJ", 27}, {"DZ", 24}, {"GA", 27}, {"GQ", 27},
-        {"GW", 25}, {"MA", 28}, {"NE", 28}, {"TD", 27}, {"TG", 28},
-        {"KM", 27}, {"HN", 28}, {"NI", 32},
-    };
+    const map_t IBAN::m_countryCodes = createCountryCodeMap();
 
     /**
      * Tries to create a new instance of \p IBAN from a string parameter. If
@@ -120,44 +195,247 @@ namespace IBAN {
      * if the string is too short to be an IBAN number or if it contains invalid
      * characters.
      *
-     * Note that this does not guarantee the validity of the IBAN number. Call
+     * The string is normalized by \p normalizeIBAN(), so separators and a prefix
+     * "IBAN" are removed and letters are converted to uppercase. Note that
+     * this does not guarantee the validity of the IBAN number. Call
      * \p validate() to test for validity.
      *
      * @param string The string to create an IBAN from
+     * @param policy Whether to validate now or on first use (default: on first
+     * use); the verdict is cached either way
      * @return A new instance of \p IBAN
      */
-    IBAN IBAN::createFromString(const std::string &string) {
-        std::string s;
-        std::string countryCode{}, accID{}, checkSum{};
-
-        s = const_cast<std::string&>(string);
-        trim(s);
-        std::transform(s.begin(), s.end(), s.begin(), ::toupper);
-        // too long or too short
-        if (s.length() > 34 || s.length() < 5) {
+    IBAN IBAN::createFromString(const std::string &string, ValidationPolicy policy) {
+        LIBIBAN_STATS_SCOPE(CreateFromString);
+        // remove separators and the prefix, convert to uppercase
+        char s[maxIBANLength];
+        size_t length = 0;
+        const ParseStatus status = normalizeIBAN(string, s, &length);
+        if (status != ParseStatus::OK) {
+            LIBIBAN_STATS_RESULT(status, s, length);
+            throw IBANParseException(string);
+        }
+        // too short
+        if (length < 5) {
+            LIBIBAN_STATS_RESULT(ParseStatus::InvalidLength, s, length);
             throw IBANParseException(string);
         }
 
         // first to chars are country code
-        countryCode = s.substr(0, 2);
-        if (!isalpha(countryCode[0]) || !isalpha(countryCode[1])) {
+        if (!isUpper(s[0]) || !isUpper(s[1])) {
+            LIBIBAN_STATS_RESULT(ParseStatus::InvalidCountryCode, s, length);
             throw IBANParseException(string);
         }
-        // then two chars for the check sum
-        checkSum = s.substr(2, 2);
-        if (!std::isdigit(checkSum[0]) || !std::isdigit(checkSum[1])) {
+        // then two chars for the check sum, the rest is account ID
+        if (!isDigit(s[2]) || !isDigit(s[3])) {
+            LIBIBAN_STATS_RESULT(ParseStatus::InvalidChecksumDigits, s, length);
             throw IBANParseException(string);
         }
 
-        // rest is account ID
-        accID = s.substr(4);
-        for (auto ch : accID) {
-            if (!isalnum(ch)) {
-                throw IBANParseException(string);
+        LIBIBAN_STATS_RESULT(ParseStatus::OK, s, length);
+        IBAN iban(s, length);
+        if (policy == ValidationPolicy::OnConstruction) {
+            iban.getStatus();
+        }
+        return iban;
+    }
+
+    /**
+     * Parses and validates an IBAN without throwing exceptions or allocating
+     * memory. The input is normalized by \p normalizeIBAN() just as
+     * \p createFromString() does, then the IBAN is validated just as
+     * \p validate() does. The first failing check determines the returned
+     * status.
+     *
+     * If \p machineForm is given, it must point to a buffer of at least
+     * \p maxIBANLength characters. It receives the normalized machine form of
+     * the IBAN (not null terminated), whose length is stored in \p length if
+     * parsing succeeds.
+     *
+     * @param input The string to parse
+     * @param machineForm Optional buffer for the normalized machine form
+     * @param length Optional pointer receiving the length of the machine form
+     * @return \p ParseStatus::OK if the IBAN is valid, otherwise the reason
+     * why it is not
+     */
+    ParseStatus IBAN::tryParse(StringView input, char* machineForm,
+                               size_t* length) noexcept {
+        char buffer[maxIBANLength];
+        char* out = machineForm ? machineForm : buffer;
+
+        size_t n = 0;
+        const ParseStatus status = normalizeIBAN(input, out, &n);
+        if (status != ParseStatus::OK) {
+            return status;
+        }
+        if (n < 5) {
+            return ParseStatus::InvalidLength;
+        }
+
+        if (!isUpper(out[0]) || !isUpper(out[1])) {
+            return ParseStatus::InvalidCountryCode;
+        }
+        if (hasCountryTable()) {
+            const ParseStatus formatStatus = checkTableFormat(out, n);
+            if (formatStatus != ParseStatus::OK) {
+                return formatStatus;
+            }
+        } else {
+            const size_t expectedLength = getIBANLength(out[0], out[1]);
+            if (expectedLength == 0) {
+                return ParseStatus::InvalidCountryCode;
+            }
+
+            if (!isDigit(out[2]) || !isDigit(out[3])) {
+                return ParseStatus::InvalidChecksumDigits;
+            }
+            if (n != expectedLength) {
+                return ParseStatus::InvalidLength;
+            }
+            const BBANStructure* structure = getBBANStructure(out[0], out[1]);
+            if (!structure || !structure->matches(out + 4, n - 4)) {
+                return ParseStatus::InvalidStructure;
             }
         }
 
-        return IBAN(countryCode, accID, checkSum);
+        if (getRemainderForIBAN(out, n) != 1) {
+            return ParseStatus::ChecksumMismatch;
+        }
+        if (length) {
+            *length = n;
+        }
+        return ParseStatus::OK;
+    }
+
+    /**
+     * Tests if \p input is a valid IBAN without throwing exceptions or
+     * allocating memory. This is a shortcut for \p IBAN::tryParse().
+     *
+     * @param input The string to test
+     * @return \p true if \p input is a valid IBAN, \p false otherwise
+     */
+    bool isValidIBAN(StringView input) noexcept {
+        return IBAN::tryParse(input) == ParseStatus::OK;
+    }
+
+    /**
+     * Constructs a \p CompactIBAN holding the machine form of \p iban.
+     *
+     * @param iban The IBAN to convert
+     */
+    CompactIBAN::CompactIBAN(const IBAN& iban) noexcept : m_data(), m_length(0) {
+        std::memcpy(m_data, iban.m_data, iban.m_length);
+        m_length = iban.m_length;
+    }
+
+    /**
+     * Constructs a \p CompactIBAN holding \p machineForm as it is. No checks
+     * are performed; characters exceeding \p maxIBANLength are cut off.
+     *
+     * @param machineForm The machine form of an IBAN
+     */
+    CompactIBAN::CompactIBAN(StringView machineForm) noexcept : m_data(), m_length(0) {
+        m_length = static_cast<uint8_t>(std::min(machineForm.size(), maxIBANLength));
+        std::memcpy(m_data, machineForm.data(), m_length);
+    }
+
+    /**
+     * Parses and validates \p input just as \p IBAN::tryParse() does and
+     * stores the result in \p result. \p result is only modified if parsing
+     * succeeds.
+     *
+     * @param input The string to parse
+     * @param result The instance receiving the parsed IBAN
+     * @return \p ParseStatus::OK if the IBAN is valid, otherwise the reason
+     * why it is not
+     */
+    ParseStatus CompactIBAN::tryParse(StringView input, CompactIBAN& result) noexcept {
+        CompactIBAN parsed;
+        size_t length = 0;
+        ParseStatus status = IBAN::tryParse(input, parsed.m_data, &length);
+        if (status == ParseStatus::OK) {
+            parsed.m_length = static_cast<uint8_t>(length);
+            result = parsed;
+        }
+        return status;
+    }
+
+    /**
+     * Converts the instance to an instance of \p IBAN.
+     *
+     * @return A new instance of \p IBAN holding the same IBAN
+     */
+    IBAN CompactIBAN::toIBAN() const {
+        return IBAN(m_data, m_length);
+    }
+
+    /**
+     * Returns the bank code of the IBAN. The position of the bank code within
+     * the BBAN depends on the country.
+     *
+     * @return The bank code or an empty view if the country is unknown or the
+     * BBAN is too short
+     */
+    StringView CompactIBAN::getBankCode() const noexcept {
+        const BBANStructure* structure = getBBANStructure(m_data[0], m_data[1]);
+        StringView bban = getBBAN();
+        if (!structure || bban.size() < structure->bankOffset + structure->bankLength) {
+            return StringView();
+        }
+        return StringView(bban.data() + structure->bankOffset, structure->bankLength);
+    }
+
+    /**
+     * Returns the branch code of the IBAN. The position of the branch code
+     * within the BBAN depends on the country.
+     *
+     * @return The branch code or an empty view if the country is unknown, does
+     * not use branch codes or the BBAN is too short
+     */
+    StringView CompactIBAN::getBranchCode() const noexcept {
+        const BBANStructure* structure = getBBANStructure(m_data[0], m_data[1]);
+        StringView bban = getBBAN();
+        if (!structure || bban.size() < structure->branchOffset + structure->branchLength) {
+            return StringView();
+        }
+        return StringView(bban.data() + structure->branchOffset, structure->branchLength);
+    }
+
+    /**
+     * Writes the human readable form of the IBAN into a caller provided
+     * buffer; see \p IBAN::formatHumanReadable().
+     *
+     * @param out The buffer to write to
+     * @param capacity The size of the buffer
+     * @param groupSize The number of characters per group (default: 4); 0
+     * writes the machine form
+     * @param separator The character separating the groups (default: space)
+     * @return The number of characters written or 0 if the buffer is too small
+     */
+    size_t CompactIBAN::formatHumanReadable(char* out, size_t capacity, size_t groupSize,
+                                            char separator) const noexcept {
+        return formatGroups(getMachineForm(), out, capacity, groupSize, separator);
+    }
+
+    /**
+     * Writes the machine form of the IBAN into a caller provided buffer; see
+     * \p IBAN::formatMachine().
+     *
+     * @param out The buffer to write to
+     * @param capacity The size of the buffer
+     * @return The number of characters written or 0 if the buffer is too small
+     */
+    size_t CompactIBAN::formatMachine(char* out, size_t capacity) const noexcept {
+        return formatGroups(getMachineForm(), out, capacity, 0, ' ');
+    }
+
+    /**
+     * Validates the IBAN just as \p IBAN::validate() does.
+     *
+     * @return \p true if IBAN is valid, \p false otherwise
+     */
+    bool CompactIBAN::validate() const noexcept {
+        return IBAN::tryParse(getMachineForm()) == ParseStatus::OK;
     }
 
     /**
@@ -166,7 +444,7 @@ namespace IBAN {
      * @return The account identifier of the IBAN
      */
     std::string IBAN::getBBAN() const {
-        return m_bban;
+        return std::string(m_data + 4, m_length - 4u);
     }
 
     /**
@@ -175,7 +453,29 @@ namespace IBAN {
      * @return The checksum of the IBAN
      */
     std::string IBAN::getChecksum() const {
-        return m_checkSum;
+        return std::string(m_data + 2, 2);
+    }
+
+    /**
+     * Return the bank code part of the IBAN number. The position of the bank
+     * code within the BBAN depends on the country.
+     *
+     * @return The bank code of the IBAN or an empty string if the country is
+     * unknown or the BBAN is too short
+     */
+    std::string IBAN::getBankCode() const {
+        return CompactIBAN(*this).getBankCode().toString();
+    }
+
+    /**
+     * Return the branch code part of the IBAN number. The position of the
+     * branch code within the BBAN depends on the country.
+     *
+     * @return The branch code of the IBAN or an empty string if the country is
+     * unknown, does not use branch codes or the BBAN is too short
+     */
+    std::string IBAN::getBranchCode() const {
+        return CompactIBAN(*this).getBranchCode().toString();
     }
 
     /**
@@ -184,7 +484,7 @@ namespace IBAN {
      * @return The country code of the IBAN
      */
     std::string IBAN::getCountryCode() const {
-        return m_countryCode;
+        return std::string(m_data, 2);
     }
 
     /**
@@ -194,7 +494,20 @@ namespace IBAN {
      * @return Machine friendly representation of the IBAN
      */
     std::string IBAN::getMachineForm() const {
-        return m_countryCode + m_checkSum + m_bban;
+        return std::string(m_data, m_length);
+    }
+
+    /**
+     * Returns the packed binary form of the IBAN (see \p PackedIBAN). The
+     * result is empty if the country code is unknown or the length of the IBAN
+     * does not match its country.
+     *
+     * @return Packed representation of the IBAN
+     */
+    PackedIBAN IBAN::getPackedForm() const {
+        PackedIBAN packed;
+        PackedIBAN::pack(CompactIBAN(*this).getMachineForm(), packed);
+        return packed;
     }
 
     /**
@@ -204,42 +517,129 @@ namespace IBAN {
      * @return Human readable representation of the IBAN
      */
     std::string IBAN::getHumanReadable() const {
-        std::stringstream result("");
-        result << m_countryCode << m_checkSum;
-        for (size_t i = 0; i < m_bban.length(); i += 4) {
-            result << " " << m_bban.substr(i, 4);
-        }
-        return result.str();
+        char humanReadable[maxHumanReadableLength];
+        return std::string(humanReadable, formatHumanReadable(humanReadable, sizeof(humanReadable)));
+    }
+
+    /**
+     * Writes the human readable form of the IBAN into a caller provided buffer
+     * without allocating memory. No terminating null character is written.
+     * A buffer of \p maxHumanReadableLength characters is large enough for
+     * the default groups.
+     *
+     * @param out The buffer to write to
+     * @param capacity The size of the buffer
+     * @param groupSize The number of characters per group (default: 4); 0
+     * writes the machine form
+     * @param separator The character separating the groups (default: space)
+     * @return The number of characters written or 0 if the buffer is too small
+     */
+    size_t IBAN::formatHumanReadable(char* out, size_t capacity, size_t groupSize,
+                                     char separator) const noexcept {
+        return formatGroups(StringView(m_data, m_length), out, capacity, groupSize, separator);
+    }
+
+    /**
+     * Writes the machine form of the IBAN into a caller provided buffer
+     * without allocating memory. No terminating null character is written.
+     *
+     * @param out The buffer to write to
+     * @param capacity The size of the buffer
+     * @return The number of characters written or 0 if the buffer is too small
+     */
+    size_t IBAN::formatMachine(char* out, size_t capacity) const noexcept {
+        return formatGroups(StringView(m_data, m_length), out, capacity, 0, ' ');
     }
 
     /**
      * Validates the underlying object according to the IBAN format
      * specification and returns a boolean value indicating validation status.
+     * The verdict is computed on the first call only and cached in the object.
      *
      * @return \p true if IBAN is valid, \p false otherwise
      */
     bool IBAN::validate() const {
+        return getStatus() == ParseStatus::OK;
+    }
+
+    /**
+     * Returns the detailed result of the validation (see \p validate()). The
+     * result is computed on the first call only and cached in the object;
+     * copies and swaps carry it along. While a table set by
+     * \p setCountryTable() is in use, the IBAN is validated against it on
+     * every call instead, so reloads and effective dates take effect.
+     *
+     * @return \p ParseStatus::OK if the IBAN is valid, otherwise the reason
+     * why it is not
+     */
+    ParseStatus IBAN::getStatus() const noexcept {
+        LIBIBAN_STATS_SCOPE(Validate);
+        uint8_t status;
+        if (hasCountryTable()) {
+            // the verdict changes with the table and the day, so it is not
+            // cached; the cache only holds the verdict of the compiled-in
+            // registry, which applies again once the table is removed
+            status = static_cast<uint8_t>(getTableStatus(m_data, m_length));
+        } else {
+            status = m_status.load(std::memory_order_relaxed);
+            if (status == statusUnknown) {
+                status = static_cast<uint8_t>(computeStatus());
+                m_status.store(status, std::memory_order_relaxed);
+            }
+        }
+        LIBIBAN_STATS_RESULT(static_cast<ParseStatus>(status), m_data, m_length);
+        return static_cast<ParseStatus>(status);
+    }
+
+    /**
+     * Tests if the verdict of the validation is already cached in the object.
+     * Cached verdicts are not used while a table set by \p setCountryTable()
+     * is in use.
+     *
+     * @return \p true if \p validate() will not compute anything
+     */
+    bool IBAN::isValidated() const noexcept {
+        return !hasCountryTable() && m_status.load(std::memory_order_relaxed) != statusUnknown;
+    }
+
+    /**
+     * Validates the IBAN from scratch. \p createFromString() guarantees its
+     * shape, so only the checks depending on the country remain. These use
+     * the compiled-in registry.
+     *
+     * @return The result of the validation
+     */
+    ParseStatus IBAN::computeStatus() const noexcept {
         // invalid country code
-        if (m_countryCodes.find(m_countryCode) == m_countryCodes.end()) {
-            return false;
+        const size_t expectedLength = getIBANLength(m_data[0], m_data[1]);
+        if (expectedLength == 0) {
+            return ParseStatus::InvalidCountryCode;
+        }
+
+        // check length
+        if (m_length != expectedLength) {
+            return ParseStatus::InvalidLength;
         }
-        size_t expectedLength = m_countryCodes.find(m_countryCode)->second;
 
-        // concat string and check length
-        std::string checkString = m_bban + m_countryCode + m_checkSum;
-        if (checkString.length() != expectedLength) {
-            return false;
+        // check structure before doing any arithmetic
+        const BBANStructure* structure = getBBANStructure(m_data[0], m_data[1]);
+        if (!structure || !structure->matches(m_data + 4, m_length - 4u)) {
+            return ParseStatus::InvalidStructure;
         }
 
-        std::string numeric = makeNumerical(checkString);
-        return getReminderForIBANString(numeric) == 1;
+        // BBAN first, then country code and check sum
+        unsigned remainder = 0;
+        const bool numerical = updateRemainder(remainder, m_data + 4, m_length - 4u) &&
+                               updateRemainder(remainder, m_data, 4);
+        return numerical && remainder == 1 ? ParseStatus::OK : ParseStatus::ChecksumMismatch;
     }
 
     /**
      * This function generates a IBAN number with a given country code. The
      * resulting IBAN number will be a valid IBAN according to the specification.
      * This function will throw a \p IBANInvalidCountryCodeException if the
-     * entered country codes is not valid.
+     * entered country codes is not valid. Each thread generates with its own
+     * \p IBANGenerator, so the function may be called concurrently.
      *
      * \b Note: The generated IBAN number is for testing purposes only. Do not
      * use them for banking, as only banks can generate and assign valid IBANs
@@ -251,23 +651,11 @@ namespace IBAN {
      * @return A newly generated valid IBAN
      */
     IBAN IBAN::generateIBAN(const std::string &countryCode) {
-        if (m_countryCodes.find(countryCode) == m_countryCodes.end()) {
-            throw IBANInvalidCountryCodeException(countryCode);
-        }
-        size_t ibanSize = m_countryCodes.find(countryCode)->second;
-
-        // generate string and append country code and '00' (initial checksum)
-        std::string ibanString = generateRandomString(ibanSize - 4);
-
-        std::string numeric = makeNumerical(ibanString + countryCode + "00");
-        auto checksum = std::to_string(98 - getReminderForIBANString(numeric));
-
-        // pad checksum
-        while (checksum.length() < 2) {
-            checksum = "0" + checksum;
-        }
-
-        IBAN iban = createFromString(countryCode + checksum + ibanString);
+        LIBIBAN_STATS_SCOPE(GenerateIBAN);
+        thread_local IBANGenerator generator;
+        IBAN iban = generator.generate(countryCode).toIBAN();
+        iban.m_status.store(static_cast<uint8_t>(ParseStatus::OK), std::memory_order_relaxed);
+        LIBIBAN_STATS_RESULT(ParseStatus::OK, iban.m_data, iban.m_length);
         return iban;
     }
 }
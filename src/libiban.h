@@ -40,12 +40,112 @@
 #include <stdexcept>
 #include <unordered_map>
 #include <memory>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+#include <functional>
+#include "hash.h"
+#include "registry.h"
 
 namespace IBAN {
 
 /// Used as a shortcut for the country codes map type
 typedef std::unordered_map<std::string, size_t> map_t;
 
+/// Maximum length of an IBAN in machine form
+constexpr size_t maxIBANLength = 34;
+
+/// Maximum size of an IBAN in packed binary form in bytes
+constexpr size_t maxPackedIBANSize = 22;
+
+/// Maximum length of an IBAN in human readable form with the default groups of
+/// four characters
+constexpr size_t maxHumanReadableLength = maxIBANLength + (maxIBANLength - 1) / 4;
+
+/// Result codes of the non-throwing parse and validation functions
+enum class ParseStatus {
+    /// The IBAN is valid
+    OK,
+    /// The IBAN is too short, too long or does not have the length required
+    /// for its country
+    InvalidLength,
+    /// The first two characters are not a known country code
+    InvalidCountryCode,
+    /// The third and fourth characters are not digits
+    InvalidChecksumDigits,
+    /// The IBAN contains characters other than letters, digits and separators
+    IllegalCharacter,
+    /// The BBAN does not match the structure required for its country
+    InvalidStructure,
+    /// The remainder (mod 97) of the IBAN is not 1
+    ChecksumMismatch,
+    /// The check digits embedded in the BBAN are wrong (see
+    /// \p checkNationalDigits())
+    NationalChecksumMismatch
+};
+
+/// Lightweight, non-owning reference to a sequence of characters
+class StringView {
+
+private:
+    /// Pointer to the first character
+    const char* m_data;
+    /// Number of characters
+    size_t m_size;
+
+public:
+    /// Constructs an empty view
+    constexpr StringView() noexcept : m_data(nullptr), m_size(0) {}
+    /// Constructs a view of \p size characters starting at \p data
+    constexpr StringView(const char* data, size_t size) noexcept :
+            m_data(data), m_size(size) {}
+    /// Constructs a view of a null terminated string
+    StringView(const char* string) noexcept :
+            m_data(string), m_size(std::strlen(string)) {}
+    /// Constructs a view of the characters of \p string
+    StringView(const std::string& string) noexcept :
+            m_data(string.data()), m_size(string.length()) {}
+
+    /// Returns a pointer to the first character
+    constexpr const char* data() const noexcept { return m_data; }
+    /// Returns the number of characters
+    constexpr size_t size() const noexcept { return m_size; }
+    /// Returns \p true if the view does not contain any characters
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    /// Returns the character at position \p pos (unchecked)
+    constexpr char operator[](size_t pos) const noexcept { return m_data[pos]; }
+    /// Returns an iterator to the first character
+    constexpr const char* begin() const noexcept { return m_data; }
+    /// Returns an iterator behind the last character
+    constexpr const char* end() const noexcept { return m_data + m_size; }
+    /// Returns a copy of the referenced characters as \p std::string
+    std::string toString() const { return std::string(m_data, m_size); }
+};
+
+/**
+ * Compares two instances of \p StringView character by character.
+ *
+ * @param lhs The first view
+ * @param rhs The second view
+ * @return \p true if both views reference equal character sequences
+ */
+inline bool operator==(const StringView& lhs, const StringView& rhs) noexcept {
+    return lhs.size() == rhs.size() &&
+           (lhs.size() == 0 || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+/**
+ * Compares two instances of \p StringView character by character.
+ *
+ * @param lhs The first view
+ * @param rhs The second view
+ * @return \p true if the views reference different character sequences
+ */
+inline bool operator!=(const StringView& lhs, const StringView& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
 /// Exception to be thrown when parsing an IBAN string fails
 class IBANParseException : public std::exception {
 
@@ -84,40 +184,96 @@ public:
     IBANInvalidCountryCodeException(const IBANInvalidCountryCodeException& other)=default;
 };
 
+class CompactIBAN;
+class PackedIBAN;
+
+namespace detail {
+/// Sequence of indices for expanding arrays in constant expressions
+template <size_t... I>
+struct IndexSequence {};
+
+/// Generates \p IndexSequence<0, ..., N - 1>
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> {
+    typedef IndexSequence<I...> type;
+};
+}
+
+/// Policies for validating IBANs created by \p IBAN::createFromString()
+enum class ValidationPolicy {
+    /// Validate on the first call of \p IBAN::validate() or \p IBAN::getStatus()
+    Deferred,
+    /// Validate right away, so later calls only read the cached verdict (unless
+    /// a table set by \p setCountryTable() is in use)
+    OnConstruction
+};
+
 /// Main class of the library
 class IBAN {
 
+    friend class CompactIBAN;
+
 private:
-    /// Holds the IBAN's country code
-    std::string m_countryCode {};
-    /// Holds the IBAN's Basic Bank Account Number
-    std::string m_bban {};
-    /// Holds the IBAN's check sum
-    std::string m_checkSum {};
-    IBAN(const std::string& cCode, const std::string& bban,
-         const std::string& checkSum) : m_countryCode(cCode),
-                                  m_bban(bban),
-                                  m_checkSum(checkSum) {}
+    /// Holds the IBAN in machine form: the country code, the check sum and
+    /// the Basic Bank Account Number. Stored inline, so an IBAN never
+    /// allocates memory on its own.
+    char m_data[maxIBANLength] {};
+    /// Holds the length of the machine form
+    uint8_t m_length {0};
+    /// Value of \p m_status while the IBAN has not been validated yet
+    enum : uint8_t { statusUnknown = 0xFF };
+    /// Caches the result of the validation against the compiled-in registry
+    /// as \p ParseStatus; written at most once per value, so relaxed accesses
+    /// suffice even if several threads validate the same instance
+    mutable std::atomic<uint8_t> m_status {statusUnknown};
+    IBAN(const char* machineForm, size_t length) noexcept : m_length(static_cast<uint8_t>(length)) {
+        std::memcpy(m_data, machineForm, length);
+    }
+    ParseStatus computeStatus() const noexcept;
 
 public:
-    /// Copy constructor for \p IBAN. Uses the default copy constructor
-    IBAN(const IBAN&)=default;
+    /// Copy constructor for \p IBAN. Copies the cached verdict as well
+    IBAN(const IBAN& other) noexcept : m_length(other.m_length),
+            m_status(other.m_status.load(std::memory_order_relaxed)) {
+        std::memcpy(m_data, other.m_data, maxIBANLength);
+    }
+    /// Move constructor for \p IBAN. Same as copying, as nothing is allocated
+    IBAN(IBAN&& other) noexcept : IBAN(static_cast<const IBAN&>(other)) {}
     ~IBAN() {}
     IBAN& operator=(IBAN other);
     bool operator==(const IBAN& other) const;
     bool operator!=(const IBAN& other) const;
+    /// Returns a hash of the machine form; equal to the hash of a
+    /// \p CompactIBAN holding the same IBAN
+    uint64_t hash() const noexcept { return hashBytes(m_data, m_length); }
     friend std::ostream& operator<<(std::ostream& stream, const IBAN& elem);
-    static IBAN createFromString(const std::string& string);
+    static IBAN createFromString(const std::string& string,
+                                 ValidationPolicy policy = ValidationPolicy::Deferred);
     static IBAN generateIBAN(const std::string& countryCode);
+    static ParseStatus tryParse(StringView input, char* machineForm = nullptr,
+                                size_t* length = nullptr) noexcept;
     std::string getCountryCode() const;
     std::string getBBAN() const;
     std::string getChecksum() const;
+    std::string getBankCode() const;
+    std::string getBranchCode() const;
     std::string getHumanReadable() const;
     std::string getMachineForm() const;
+    size_t formatHumanReadable(char* out, size_t capacity, size_t groupSize = 4,
+                               char separator = ' ') const noexcept;
+    size_t formatMachine(char* out, size_t capacity) const noexcept;
+    PackedIBAN getPackedForm() const;
     bool validate() const;
+    bool validateNational() const noexcept;
+    ParseStatus getStatus() const noexcept;
+    bool isValidated() const noexcept;
 
     /// Static map mapping country codes to required IBAN length; must be
-    /// initialized in a source file.
+    /// initialized in a source file. This is a view of \p CountryRegistry,
+    /// which should be preferred for lookups.
     static const map_t m_countryCodes;
 
     /**
@@ -128,13 +284,34 @@ public:
      */
     friend void swap(IBAN& first, IBAN& second) {
         using std::swap;
-        swap(first.m_checkSum, second.m_checkSum);
-        swap(first.m_bban, second.m_bban);
-        swap(first.m_countryCode, second.m_countryCode);
+        swap(first.m_data, second.m_data);
+        swap(first.m_length, second.m_length);
+        const uint8_t status = first.m_status.load(std::memory_order_relaxed);
+        first.m_status.store(second.m_status.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        second.m_status.store(status, std::memory_order_relaxed);
     }
 
 }; // end of class IBAN
 
+bool isValidIBAN(StringView input) noexcept;
+
+/// Kernels available for batch validation
+enum class BatchKernel {
+    /// Use the fastest kernel supported by the CPU
+    Auto,
+    /// Portable kernel validating one IBAN after another
+    Scalar,
+    /// Kernel using SSE4.2 instructions
+    SSE42,
+    /// Kernel using AVX2 instructions
+    AVX2
+};
+
+BatchKernel getBestBatchKernel() noexcept;
+void validateBatch(const char* const* ibans, const uint8_t* lengths, size_t count,
+                   uint8_t* results, BatchKernel kernel = BatchKernel::Auto,
+                   bool nationalCheckDigits = false) noexcept;
+
 /**
  * Overloads the comparison operator ==.
  *
@@ -142,9 +319,7 @@ public:
  * @return \p true if both objects are equal, \p false otherwise
  */
 inline bool IBAN::operator==(const IBAN &other) const {
-    return ((this->getCountryCode() == other.getCountryCode()) &&
-            (this->getChecksum() == other.getChecksum()) &&
-            (this->getBBAN() == other.getBBAN()));
+    return m_length == other.m_length && std::memcmp(m_data, other.m_data, m_length) == 0;
 }
 
 /**
@@ -158,17 +333,196 @@ inline bool IBAN::operator!=(const IBAN &other) const {
 }
 
 /**
- * Implements assignment operator.
+ * Implements assignment operator. \p other already is a copy (or has been
+ * moved from the assigned instance), so its members are simply swapped in.
  *
  * @param other The other instance to assign
  * @return An instance of \p IBAN
  */
 inline IBAN& IBAN::operator=(IBAN other) {
-    IBAN temp(other);
-    swap(*this, temp);
+    swap(*this, other);
     return *this;
 }
 
+/**
+ * Compact, trivially copyable value type holding an IBAN in its machine form.
+ * The characters are stored inline, so an instance never allocates memory and
+ * copying or comparing it is a matter of copying or comparing 35 bytes. Unused
+ * characters are always zero.
+ */
+class CompactIBAN {
+
+private:
+    /// Holds the machine form of the IBAN, padded with zeros
+    char m_data[maxIBANLength];
+    /// Holds the number of used characters of \p m_data
+    uint8_t m_length;
+
+public:
+    /// Constructs an empty instance
+    CompactIBAN() noexcept : m_data(), m_length(0) {}
+    /**
+     * Constructs an instance in constant expressions (see \p parseConstant()).
+     *
+     * @param source Provides the characters of the machine form by index
+     * through a \p constexpr \p operator[], and a null character beyond its end
+     * @param length The length of the machine form
+     */
+    template <class Source, size_t... I>
+    constexpr CompactIBAN(const Source& source, size_t length, detail::IndexSequence<I...>) noexcept :
+            m_data{source[I]...}, m_length(static_cast<uint8_t>(length)) {}
+    explicit CompactIBAN(const IBAN& iban) noexcept;
+    explicit CompactIBAN(StringView machineForm) noexcept;
+    static ParseStatus tryParse(StringView input, CompactIBAN& result) noexcept;
+    IBAN toIBAN() const;
+
+    /// Returns the IBAN's country code
+    constexpr StringView getCountryCode() const noexcept {
+        return StringView(m_data, m_length < 2 ? m_length : 2);
+    }
+    /// Returns the IBAN's check sum
+    constexpr StringView getChecksum() const noexcept {
+        return m_length < 4 ? StringView() : StringView(m_data + 2, 2);
+    }
+    /// Returns the Basic Bank Account Number of the IBAN
+    constexpr StringView getBBAN() const noexcept {
+        return m_length < 4 ? StringView() : StringView(m_data + 4, m_length - 4u);
+    }
+    /// Returns the machine form of the IBAN
+    constexpr StringView getMachineForm() const noexcept {
+        return StringView(m_data, m_length);
+    }
+    StringView getBankCode() const noexcept;
+    StringView getBranchCode() const noexcept;
+    size_t formatHumanReadable(char* out, size_t capacity, size_t groupSize = 4,
+                               char separator = ' ') const noexcept;
+    size_t formatMachine(char* out, size_t capacity) const noexcept;
+    /// Returns the length of the IBAN's machine form
+    size_t size() const noexcept { return m_length; }
+    /// Returns \p true if the instance does not hold an IBAN
+    bool empty() const noexcept { return m_length == 0; }
+    bool validate() const noexcept;
+    bool validateNational() const noexcept;
+    /// Returns a hash of the machine form; equal to the hash of an \p IBAN
+    /// holding the same IBAN
+    uint64_t hash() const noexcept { return hashBytes(m_data, m_length); }
+
+    /**
+     * Overloads the comparison operator ==.
+     *
+     * @param other The object to compare with
+     * @return \p true if both objects are equal, \p false otherwise
+     */
+    bool operator==(const CompactIBAN& other) const noexcept {
+        return m_length == other.m_length &&
+               std::memcmp(m_data, other.m_data, maxIBANLength) == 0;
+    }
+
+    /**
+     * Overloads the comparison operator !=.
+     *
+     * @param other The object to compare with
+     * @return \p true if the objects are not equal, \p false if they are equal
+     */
+    bool operator!=(const CompactIBAN& other) const noexcept {
+        return !(*this == other);
+    }
+
+    /**
+     * Overloads the comparison operator <. Instances are ordered like the
+     * strings of their machine forms.
+     *
+     * @param other The object to compare with
+     * @return \p true if this object is ordered before \p other
+     */
+    bool operator<(const CompactIBAN& other) const noexcept {
+        // unused characters are zero and thus ordered first
+        return std::memcmp(m_data, other.m_data, maxIBANLength) < 0;
+    }
+
+}; // end of class CompactIBAN
+
+static_assert(std::is_trivially_copyable<CompactIBAN>::value,
+              "CompactIBAN must be trivially copyable");
+static_assert(sizeof(CompactIBAN) == maxIBANLength + 1,
+              "CompactIBAN must not contain padding");
+
+/**
+ * Packed binary form of an IBAN for storage and transmission. The packed form
+ * is a big endian bit string consisting of the country code (10 bits, both
+ * letters in base 26), the check sum (7 bits) and the BBAN as a single number
+ * in mixed radix, using as many bits as the BBAN structure of the country
+ * requires: digit positions (n) have radix 10, letter positions (a) radix 26
+ * and alphanumeric positions (c) radix 36. It is padded with zero bits to full
+ * bytes.
+ *
+ * Packing is lossless and order preserving: comparing two packed IBANs
+ * bytewise gives the same result as comparing their machine forms.
+ */
+class PackedIBAN {
+
+private:
+    /// Holds the packed bytes, padded with zeros
+    uint8_t m_data[maxPackedIBANSize];
+    /// Holds the number of used bytes of \p m_data
+    uint8_t m_size;
+
+public:
+    /// Constructs an empty instance
+    PackedIBAN() noexcept : m_data(), m_size(0) {}
+    PackedIBAN(const uint8_t* data, size_t size) noexcept;
+    static bool pack(StringView machineForm, PackedIBAN& result) noexcept;
+    bool unpack(CompactIBAN& result) const noexcept;
+
+    /// Returns a pointer to the packed bytes
+    const uint8_t* data() const noexcept { return m_data; }
+    /// Returns the number of packed bytes
+    size_t size() const noexcept { return m_size; }
+    /// Returns \p true if the instance does not hold an IBAN
+    bool empty() const noexcept { return m_size == 0; }
+    /// Returns a hash of the packed bytes
+    uint64_t hash() const noexcept {
+        return hashBytes(reinterpret_cast<const char*>(m_data), m_size);
+    }
+
+    /**
+     * Overloads the comparison operator ==.
+     *
+     * @param other The object to compare with
+     * @return \p true if both objects are equal, \p false otherwise
+     */
+    bool operator==(const PackedIBAN& other) const noexcept {
+        return m_size == other.m_size &&
+               std::memcmp(m_data, other.m_data, maxPackedIBANSize) == 0;
+    }
+
+    /**
+     * Overloads the comparison operator !=.
+     *
+     * @param other The object to compare with
+     * @return \p true if the objects are not equal, \p false if they are equal
+     */
+    bool operator!=(const PackedIBAN& other) const noexcept {
+        return !(*this == other);
+    }
+
+    /**
+     * Overloads the comparison operator <. Instances are ordered like the
+     * machine forms of the IBANs they hold.
+     *
+     * @param other The object to compare with
+     * @return \p true if this object is ordered before \p other
+     */
+    bool operator<(const PackedIBAN& other) const noexcept {
+        // unused bytes are zero and thus ordered first
+        return std::memcmp(m_data, other.m_data, maxPackedIBANSize) < 0;
+    }
+
+}; // end of class PackedIBAN
+
+static_assert(std::is_trivially_copyable<PackedIBAN>::value,
+              "PackedIBAN must be trivially copyable");
+
 /**
  * Overrides the stream operator << for IBAN.
  *
@@ -177,10 +531,42 @@ inline IBAN& IBAN::operator=(IBAN other) {
  * @return The stream written to
  */
 inline std::ostream& operator<<(std::ostream& stream, const IBAN& elem) {
-    stream << "IBAN (" << elem.getHumanReadable() << ")";
+    char humanReadable[maxHumanReadableLength];
+    const size_t length = elem.formatHumanReadable(humanReadable, sizeof(humanReadable));
+    stream << "IBAN (";
+    stream.write(humanReadable, static_cast<std::streamsize>(length));
+    stream << ")";
     return stream;
 }
 
 } // end of namespace IBAN
 
+namespace std {
+
+/// Hashes an \p IBAN by its machine form
+template <>
+struct hash<IBAN::IBAN> {
+    size_t operator()(const IBAN::IBAN& iban) const noexcept {
+        return static_cast<size_t>(iban.hash());
+    }
+};
+
+/// Hashes a \p CompactIBAN by its machine form
+template <>
+struct hash<IBAN::CompactIBAN> {
+    size_t operator()(const IBAN::CompactIBAN& iban) const noexcept {
+        return static_cast<size_t>(iban.hash());
+    }
+};
+
+/// Hashes a \p PackedIBAN by its packed bytes
+template <>
+struct hash<IBAN::PackedIBAN> {
+    size_t operator()(const IBAN::PackedIBAN& iban) const noexcept {
+        return static_cast<size_t>(iban.hash());
+    }
+};
+
+} // end of namespace std
+
 #endif //LIBIBAN_LIBIBAN_H
@@ -0,0 +1,398 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        literal.h
+ * \brief       Header file declaring the validation of IBANs at compile time
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p getConstantStatus() and \p parseConstant(),
+ * which parse and validate IBANs in constant expressions, and the literal
+ * \p _iban. IBANs hard-coded in the source are thus validated by the compiler,
+ * and an invalid one fails to compile:
+ * \code
+ * using namespace IBAN::literals;
+ * constexpr IBAN::CompactIBAN treasury = "DE89 3704 0044 0532 0130 00"_iban;
+ * \endcode
+ *
+ * The functions only consist of single return statements, so they are
+ * \p constexpr in C++11 already. They normalize the input as
+ * \p normalizeIBAN() does, including the prefix "IBAN", separators and
+ * fullwidth forms, check the structure against the formats of
+ * \p CountryRegistry and thus give the same results as \p IBAN::tryParse()
+ * with the compiled-in registry.
+ */
+
+#ifndef LIBIBAN_LITERAL_H
+#define LIBIBAN_LITERAL_H
+
+#include "libiban.h"
+#include "registry.h"
+
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+/// Forces the evaluation at compile time where the language supports it
+#define LIBIBAN_CONSTEVAL consteval
+#else
+#define LIBIBAN_CONSTEVAL constexpr
+#endif
+
+namespace IBAN {
+
+namespace detail {
+/// Class of the characters \p normalizeIBAN() removes
+constexpr uint8_t constantSeparator = 1;
+/// Class of the colon, which may follow the prefix "IBAN"
+constexpr uint8_t constantColon = 2;
+
+/// Locale independent test for an uppercase latin letter
+constexpr bool isConstantUpper(char ch) noexcept {
+    return ch >= 'A' && ch <= 'Z';
+}
+
+/// Locale independent test for a decimal digit
+constexpr bool isConstantDigit(char ch) noexcept {
+    return ch >= '0' && ch <= '9';
+}
+
+/// Returns the byte at \p pos of \p input
+constexpr uint8_t getConstantByte(StringView input, size_t pos) noexcept {
+    return static_cast<uint8_t>(input[pos]);
+}
+
+/// Returns the class of an ASCII character as \p normalizeIBAN() does: the
+/// uppercase character for letters and digits, one of the classes above or 0
+/// for illegal characters
+constexpr uint8_t getConstantASCIIClass(uint32_t ch) noexcept {
+    return (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') ? static_cast<uint8_t>(ch) :
+           ch >= 'a' && ch <= 'z' ? static_cast<uint8_t>(ch - 'a' + 'A') :
+           ch == ' ' || ch == '-' || ch == '.' || (ch >= '\t' && ch <= '\r') ? constantSeparator :
+           ch == ':' ? constantColon : 0;
+}
+
+/// Tests for the Unicode spaces, dashes and invisible characters
+/// \p normalizeIBAN() removes
+constexpr bool isConstantUnicodeSeparator(uint32_t codePoint) noexcept {
+    return codePoint == 0x00A0 || codePoint == 0x00AD || (codePoint >= 0x2000 && codePoint <= 0x200B) ||
+           (codePoint >= 0x2010 && codePoint <= 0x2015) || codePoint == 0x202F || codePoint == 0x205F ||
+           codePoint == 0x2060 || codePoint == 0x2212 || codePoint == 0x3000 || codePoint == 0xFE63 ||
+           codePoint == 0xFEFF;
+}
+
+/// Returns the number of bytes of the UTF-8 sequence starting at \p pos; 1 for
+/// bytes that cannot start a sequence
+constexpr size_t getConstantSequenceLength(StringView input, size_t pos) noexcept {
+    return getConstantByte(input, pos) < 0xC2 || getConstantByte(input, pos) > 0xF4 ? 1 :
+           getConstantByte(input, pos) < 0xE0 ? 2 : getConstantByte(input, pos) < 0xF0 ? 3 : 4;
+}
+
+/// Tests if the \p count bytes at \p pos are UTF-8 continuation bytes
+constexpr bool areConstantContinuations(StringView input, size_t pos, size_t count) noexcept {
+    return count == 0 || (pos < input.size() && (getConstantByte(input, pos) & 0xC0) == 0x80 &&
+                          areConstantContinuations(input, pos + 1, count - 1));
+}
+
+/// Appends the bits of the \p count continuation bytes at \p pos to \p codePoint
+constexpr uint32_t decodeConstantContinuations(StringView input, size_t pos, size_t count,
+                                               uint32_t codePoint) noexcept {
+    return count == 0 ? codePoint :
+           decodeConstantContinuations(input, pos + 1, count - 1,
+                                       (codePoint << 6) | (getConstantByte(input, pos) & 0x3Fu));
+}
+
+/// Returns the code point of the UTF-8 sequence of \p length bytes at \p pos
+constexpr uint32_t decodeConstantSequence(StringView input, size_t pos, size_t length) noexcept {
+    return decodeConstantContinuations(input, pos + 1, length - 1, getConstantByte(input, pos) & (0x7Fu >> length));
+}
+
+/// Tests if a code point decoded from \p length bytes is a character in its
+/// shortest form
+constexpr bool isConstantCodePoint(uint32_t codePoint, size_t length) noexcept {
+    return codePoint >= (length == 2 ? 0x80u : length == 3 ? 0x800u : 0x10000u) && codePoint <= 0x10FFFF &&
+           (codePoint < 0xD800 || codePoint > 0xDFFF);
+}
+
+/// Returns the class of a character other than ASCII: fullwidth forms of ASCII
+/// characters are folded to these
+constexpr uint8_t getConstantUnicodeClass(uint32_t codePoint) noexcept {
+    return codePoint >= 0xFF01 && codePoint <= 0xFF5E ? getConstantASCIIClass(codePoint - 0xFEE0) :
+           isConstantUnicodeSeparator(codePoint) ? constantSeparator : 0;
+}
+
+/// Returns the class of the UTF-8 sequence of \p length bytes at \p pos
+constexpr uint8_t getConstantSequenceClass(StringView input, size_t pos, size_t length) noexcept {
+    return length == 1 ? (getConstantByte(input, pos) < 0x80 ? getConstantASCIIClass(getConstantByte(input, pos)) : 0) :
+           areConstantContinuations(input, pos + 1, length - 1) &&
+           isConstantCodePoint(decodeConstantSequence(input, pos, length), length) ?
+                   getConstantUnicodeClass(decodeConstantSequence(input, pos, length)) : 0;
+}
+
+/// Returns the class of the character at \p pos
+constexpr uint8_t getConstantClass(StringView input, size_t pos) noexcept {
+    return getConstantSequenceClass(input, pos, getConstantSequenceLength(input, pos));
+}
+
+/// Returns the position behind the character at \p pos
+constexpr size_t skipConstantCharacter(StringView input, size_t pos) noexcept {
+    return pos + getConstantSequenceLength(input, pos);
+}
+
+/// Returns the position of the first character other than a separator at or
+/// behind \p pos
+constexpr size_t skipConstantSeparators(StringView input, size_t pos) noexcept {
+    return pos < input.size() && getConstantClass(input, pos) == constantSeparator ?
+           skipConstantSeparators(input, skipConstantCharacter(input, pos)) : pos;
+}
+
+/// Returns the position behind the letters of "IBAN" from the \p k-th on at
+/// \p pos, or a position behind the end of \p input if they do not follow
+constexpr size_t findConstantPrefixEnd(StringView input, size_t pos, size_t k = 0) noexcept {
+    return k == 4 ? pos :
+           pos < input.size() && getConstantClass(input, pos) == static_cast<uint8_t>("IBAN"[k]) ?
+                   findConstantPrefixEnd(input, skipConstantCharacter(input, pos), k + 1) :
+           input.size() + 1;
+}
+
+/// Skips an optional colon at \p pos and the separators behind it
+constexpr size_t skipConstantColon(StringView input, size_t pos) noexcept {
+    return pos < input.size() && getConstantClass(input, pos) == constantColon ?
+           skipConstantSeparators(input, skipConstantCharacter(input, pos)) : pos;
+}
+
+/// Returns the position behind the prefix "IBAN", the separators around it
+/// and an optional colon, or \p pos if the input does not continue with it
+constexpr size_t skipConstantPrefix(StringView input, size_t pos) noexcept {
+    return findConstantPrefixEnd(input, pos) > input.size() ? pos :
+           skipConstantColon(input, skipConstantSeparators(input, findConstantPrefixEnd(input, pos)));
+}
+
+/// Returns the position of the first character \p normalizeIBAN() keeps
+constexpr size_t findConstantStart(StringView input) noexcept {
+    return skipConstantPrefix(input, skipConstantSeparators(input, 0));
+}
+
+/// Normalizes the input from \p pos just as \p normalizeIBAN() does, given the
+/// \p count letters and digits before, and returns its status
+constexpr ParseStatus getConstantNormalization(StringView input, size_t pos, size_t count = 0) noexcept {
+    return pos >= input.size() ? ParseStatus::OK :
+           getConstantClass(input, pos) >= '0' ?
+                   (count == maxIBANLength ? ParseStatus::InvalidLength :
+                    getConstantNormalization(input, skipConstantCharacter(input, pos), count + 1)) :
+           getConstantClass(input, pos) == constantSeparator ?
+                   getConstantNormalization(input, skipConstantCharacter(input, pos), count) :
+           ParseStatus::IllegalCharacter;
+}
+
+/// Returns the position of the \p k-th letter or digit at or behind \p pos,
+/// or the size of \p input if there is none
+constexpr size_t findConstantCharacter(StringView input, size_t pos, size_t k) noexcept {
+    return pos >= input.size() ? input.size() :
+           getConstantClass(input, pos) >= '0' ?
+                   (k == 0 ? pos : findConstantCharacter(input, skipConstantCharacter(input, pos), k - 1)) :
+           getConstantClass(input, pos) == constantSeparator ?
+                   findConstantCharacter(input, skipConstantCharacter(input, pos), k) :
+           input.size();
+}
+
+/// Returns the number of letters and digits at or behind \p pos up to the end
+/// or the first illegal character
+constexpr size_t countConstantCharacters(StringView input, size_t pos) noexcept {
+    return pos >= input.size() ? 0 :
+           getConstantClass(input, pos) >= '0' ? 1 + countConstantCharacters(input, skipConstantCharacter(input, pos)) :
+           getConstantClass(input, pos) == constantSeparator ?
+                   countConstantCharacters(input, skipConstantCharacter(input, pos)) :
+           0;
+}
+
+/// Returns the length of the machine form of \p input
+constexpr size_t getConstantLength(StringView input) noexcept {
+    return countConstantCharacters(input, findConstantStart(input));
+}
+
+/// Returns the \p k-th character of the machine form of \p input, or
+/// \p '\0' behind its end
+constexpr char getConstantCharacter(StringView input, size_t k) noexcept {
+    return findConstantCharacter(input, findConstantStart(input), k) < input.size() ?
+           static_cast<char>(getConstantClass(input, findConstantCharacter(input, findConstantStart(input), k))) :
+           '\0';
+}
+
+/// Returns the index of the format of a country in \p CountryRegistry::formats
+/// or \p countryFormatCount if it has none
+constexpr size_t findConstantFormat(char first, char second, size_t i = 0) noexcept {
+    return i == countryFormatCount ||
+           (CountryRegistry::formats[i].countryCode[0] == first &&
+            CountryRegistry::formats[i].countryCode[1] == second) ? i :
+           findConstantFormat(first, second, i + 1);
+}
+
+/// Reads the repetition count at the start of a group of a BBAN format
+constexpr size_t parseConstantCount(const char* format, size_t count = 0) noexcept {
+    return isConstantDigit(*format) ? parseConstantCount(format + 1, count * 10 + static_cast<size_t>(*format - '0')) :
+           count;
+}
+
+/// Skips the repetition count and the '!' of a group of a BBAN format
+constexpr const char* skipConstantCount(const char* format) noexcept {
+    return isConstantDigit(*format) ? skipConstantCount(format + 1) : *format == '!' ? format + 1 : format;
+}
+
+/// Tests if a character belongs to the class of a BBAN format (n, a or c)
+constexpr bool matchesConstantClass(char ch, char characterClass) noexcept {
+    return characterClass == 'n' ? isConstantDigit(ch) :
+           characterClass == 'a' ? isConstantUpper(ch) :
+           characterClass == 'c' && (isConstantDigit(ch) || isConstantUpper(ch));
+}
+
+constexpr bool matchesConstantFormat(StringView input, const char* format, size_t k, size_t length) noexcept;
+
+/// Matches \p count characters from \p k against the class at \p group, then
+/// the rest of the format
+constexpr bool matchesConstantGroup(StringView input, const char* group, size_t count, size_t k,
+                                    size_t length) noexcept {
+    return count == 0 ? matchesConstantFormat(input, group + 1, k, length) :
+           k < length && matchesConstantClass(getConstantCharacter(input, k), *group) &&
+           matchesConstantGroup(input, group, count - 1, k + 1, length);
+}
+
+/// Matches the characters from \p k of the machine form against \p format
+constexpr bool matchesConstantFormat(StringView input, const char* format, size_t k, size_t length) noexcept {
+    return *format == '\0' ? k == length :
+           matchesConstantGroup(input, skipConstantCount(format), parseConstantCount(format), k, length);
+}
+
+/// Returns the remainder (mod 97) of the rearranged IBAN from its \p j-th
+/// character on, given the remainder of the characters before
+constexpr uint32_t getConstantRemainder(StringView input, size_t j, size_t length, uint32_t remainder = 0) noexcept {
+    return j == length ? remainder :
+           getConstantRemainder(input, j + 1, length,
+                   isConstantDigit(getConstantCharacter(input, (j + 4) % length)) ?
+                   (remainder * 10 + static_cast<uint32_t>(getConstantCharacter(input, (j + 4) % length) - '0')) % 97 :
+                   (remainder * 100 + static_cast<uint32_t>(getConstantCharacter(input, (j + 4) % length) - 'A' + 10)) % 97);
+}
+
+/// Validates the machine form of the given length, which \p normalizeIBAN()
+/// produced without errors, in the order of \p IBAN::tryParse()
+constexpr ParseStatus getConstantStatus(StringView input, size_t length) noexcept {
+    return length < 5 ? ParseStatus::InvalidLength :
+           !isConstantUpper(getConstantCharacter(input, 0)) || !isConstantUpper(getConstantCharacter(input, 1)) ||
+           getIBANLength(getConstantCharacter(input, 0), getConstantCharacter(input, 1)) == 0 ?
+                   ParseStatus::InvalidCountryCode :
+           !isConstantDigit(getConstantCharacter(input, 2)) || !isConstantDigit(getConstantCharacter(input, 3)) ?
+                   ParseStatus::InvalidChecksumDigits :
+           length != getIBANLength(getConstantCharacter(input, 0), getConstantCharacter(input, 1)) ?
+                   ParseStatus::InvalidLength :
+           findConstantFormat(getConstantCharacter(input, 0), getConstantCharacter(input, 1)) == countryFormatCount ||
+           !matchesConstantFormat(input,
+                                  CountryRegistry::formats[findConstantFormat(getConstantCharacter(input, 0),
+                                                                              getConstantCharacter(input, 1))].bban,
+                                  4, length) ?
+                   ParseStatus::InvalidStructure :
+           getConstantRemainder(input, 0, length) != 1 ? ParseStatus::ChecksumMismatch :
+           ParseStatus::OK;
+}
+
+/// Provides the characters of a machine form to \p CompactIBAN
+struct ConstantSource {
+    /// The parsed string
+    StringView input;
+
+    constexpr char operator[](size_t k) const noexcept { return getConstantCharacter(input, k); }
+};
+}
+
+/**
+ * Parses and validates an IBAN just as \p IBAN::tryParse() does, but in
+ * constant expressions.
+ *
+ * @param input The string to parse
+ * @return \p ParseStatus::OK if the IBAN is valid, otherwise the reason why it
+ * is not
+ */
+constexpr ParseStatus getConstantStatus(StringView input) noexcept {
+    return detail::getConstantNormalization(input, detail::findConstantStart(input)) != ParseStatus::OK ?
+           detail::getConstantNormalization(input, detail::findConstantStart(input)) :
+           detail::getConstantStatus(input, detail::getConstantLength(input));
+}
+
+/**
+ * Parses and validates a string literal just as \p IBAN::tryParse() does, but
+ * in constant expressions.
+ *
+ * @param input The string literal to parse
+ * @return \p ParseStatus::OK if the IBAN is valid, otherwise the reason why it
+ * is not
+ */
+template <size_t N>
+constexpr ParseStatus getConstantStatus(const char (&input)[N]) noexcept {
+    return getConstantStatus(StringView(input, N - 1));
+}
+
+/**
+ * Parses an IBAN in constant expressions. If the IBAN is invalid, the
+ * expression is not constant, so the compiler rejects a \p constexpr
+ * variable initialized with it; evaluated at runtime, an exception is thrown.
+ *
+ * @param input The string to parse
+ * @return The IBAN in machine form
+ * @throws IBANParseException If the IBAN is invalid
+ */
+constexpr CompactIBAN parseConstant(StringView input) {
+    return getConstantStatus(input) == ParseStatus::OK ?
+           CompactIBAN(detail::ConstantSource{input}, detail::getConstantLength(input),
+                       detail::MakeIndexSequence<maxIBANLength>::type()) :
+           throw IBANParseException(input.toString());
+}
+
+/**
+ * Parses a string literal in constant expressions (see \p parseConstant()).
+ *
+ * @param input The string literal to parse
+ * @return The IBAN in machine form
+ * @throws IBANParseException If the IBAN is invalid
+ */
+template <size_t N>
+constexpr CompactIBAN parseConstant(const char (&input)[N]) {
+    return parseConstant(StringView(input, N - 1));
+}
+
+namespace literals {
+/**
+ * Parses an IBAN literal at compile time, e.g.
+ * \p "DE89370400440532013000"_iban. Since C++20 the literal is always
+ * evaluated at compile time, before only in constant expressions.
+ *
+ * @param string The characters of the literal
+ * @param length The number of characters
+ * @return The IBAN in machine form
+ * @throws IBANParseException If the IBAN is invalid
+ */
+LIBIBAN_CONSTEVAL CompactIBAN operator"" _iban(const char* string, size_t length) {
+    return parseConstant(StringView(string, length));
+}
+}
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_LITERAL_H
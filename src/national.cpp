@@ -0,0 +1,328 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        national.cpp
+ * \brief       Source file implementing the national check digit engine
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the national check digit algorithms and the
+ * table dispatching them by country. The built-in checks are listed in
+ * \p builtinChecks; they are copied into a table indexed by country code on
+ * first use, where \p setNationalCheck() can replace them.
+ */
+
+#include "national.h"
+#include "countrytable.h"
+#include <atomic>
+
+namespace IBAN {
+
+    namespace {
+        /// Returns the value of a digit
+        inline unsigned digit(char ch) noexcept {
+            return static_cast<unsigned>(ch - '0');
+        }
+
+        /// Returns the remainder of a string of digits mod \p modulus, which
+        /// is smaller than 100
+        unsigned remainder(const char* digits, size_t count, unsigned modulus) noexcept {
+            // 16 more digits behind a remainder below 100 fit into 64 bits
+            uint64_t result = 0;
+            for (size_t i = 0; i < count; ++i) {
+                result = result * 10 + digit(digits[i]);
+                if (i % 16 == 15) {
+                    result %= modulus;
+                }
+            }
+            return static_cast<unsigned>(result % modulus);
+        }
+
+        /// Returns the sum of the digits multiplied with cyclic weights
+        unsigned weightedSum(const char* digits, size_t count, const unsigned* weights,
+                             size_t weightCount) noexcept {
+            unsigned sum = 0;
+            for (size_t i = 0; i < count; ++i) {
+                sum += digit(digits[i]) * weights[i % weightCount];
+            }
+            return sum;
+        }
+
+        /// Verifies digits with a check digit according to ISO 7064 MOD 11,10
+        bool checkIso7064Mod1110(const char* digits, size_t count) noexcept {
+            unsigned product = 10;
+            for (size_t i = 0; i + 1 < count; ++i) {
+                unsigned sum = (digit(digits[i]) + product) % 10;
+                product = (2 * (sum == 0 ? 10 : sum)) % 11;
+            }
+            return (digit(digits[count - 1]) + product) % 10 == 1;
+        }
+
+        /// Verifies the check digit of a Spanish dígito de control
+        bool checkSpanishDigit(const char* digits, size_t count, char check) noexcept {
+            static const unsigned weights[] = {1, 2, 4, 8, 5, 10, 9, 7, 3, 6};
+            // the first digit of bank and branch is weighted with 4
+            const size_t offset = 10 - count;
+            unsigned sum = 0;
+            for (size_t i = 0; i < count; ++i) {
+                sum += digit(digits[i]) * weights[offset + i];
+            }
+            const unsigned value = 11 - sum % 11;
+            return (value == 11 ? 0 : value == 10 ? 1 : value) == digit(check);
+        }
+
+        /// Belgium: the last two digits are the first ten mod 97, or 97 for 0
+        bool checkBE(const char* bban, size_t) noexcept {
+            const unsigned value = remainder(bban, 10, 97);
+            return (value == 0 ? 97 : value) == digit(bban[10]) * 10 + digit(bban[11]);
+        }
+
+        /// Returns the number formed by digits of a RIB, where the letters A-I,
+        /// J-R and S-Z stand for the digits 1-9, 1-9 and 2-9
+        uint64_t ribNumber(const char* digits, size_t count) noexcept {
+            uint64_t result = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const char ch = digits[i];
+                result = result * 10 + (ch <= '9' ? digit(ch) :
+                         (static_cast<unsigned>(ch - 'A') + (ch >= 'S')) % 9 + 1);
+            }
+            return result;
+        }
+
+        /// Clé RIB of France, Monaco and Mauritania: the key is 97 minus bank,
+        /// branch and account weighted with 89, 15 and 3, mod 97
+        bool checkRIB(const char* bban, size_t) noexcept {
+            const uint64_t sum = 89 * ribNumber(bban, 5) + 15 * ribNumber(bban + 5, 5) +
+                                 3 * ribNumber(bban + 10, 11) + ribNumber(bban + 21, 2);
+            return sum % 97 == 0;
+        }
+
+        /// Spain: two check digits for bank and branch and for the account
+        bool checkES(const char* bban, size_t) noexcept {
+            return checkSpanishDigit(bban, 8, bban[8]) && checkSpanishDigit(bban + 10, 10, bban[9]);
+        }
+
+        /// CIN of Italy and San Marino: a letter computed from bank, branch and
+        /// account, with different values for odd and even positions
+        bool checkCIN(const char* bban, size_t) noexcept {
+            static const unsigned odd[] = {1, 0, 5, 7, 9, 13, 15, 17, 19, 21, 2, 4, 18, 20, 11,
+                                           3, 6, 8, 12, 14, 16, 10, 22, 25, 24, 23};
+            unsigned sum = 0;
+            for (size_t i = 1; i < 23; ++i) {
+                const char ch = bban[i];
+                const unsigned value = ch <= '9' ? digit(ch) : static_cast<unsigned>(ch - 'A');
+                sum += (i % 2 == 1) ? odd[value] : value;
+            }
+            return bban[0] == static_cast<char>('A' + sum % 26);
+        }
+
+        /// Portugal: the NIB's last two digits are 98 minus the others
+        /// multiplied by 100, mod 97
+        bool checkPT(const char* bban, size_t) noexcept {
+            return 98 - remainder(bban, 19, 97) * 100 % 97 == digit(bban[19]) * 10 + digit(bban[20]);
+        }
+
+        /// Norway: weighted mod 11 over the account number
+        bool checkNO(const char* bban, size_t) noexcept {
+            static const unsigned weights[] = {5, 4, 3, 2, 7, 6, 5, 4, 3, 2};
+            const unsigned value = 11 - weightedSum(bban, 10, weights, 10) % 11;
+            return value != 10 && (value == 11 ? 0 : value) == digit(bban[10]);
+        }
+
+        /// Poland: weighted mod 10 over the bank's sort code
+        bool checkPL(const char* bban, size_t) noexcept {
+            static const unsigned weights[] = {3, 9, 7, 1, 3, 9, 7};
+            return (10 - weightedSum(bban, 7, weights, 7) % 10) % 10 == digit(bban[7]);
+        }
+
+        /// Finland: Luhn over the whole BBAN
+        bool checkFI(const char* bban, size_t length) noexcept {
+            unsigned sum = 0;
+            for (size_t i = 0; i < length; ++i) {
+                unsigned value = digit(bban[length - 1 - i]);
+                if (i % 2 == 1) {
+                    value = value * 2 > 9 ? value * 2 - 9 : value * 2;
+                }
+                sum += value;
+            }
+            return sum % 10 == 0;
+        }
+
+        /// Albania: weighted mod 10 over bank and branch
+        bool checkAL(const char* bban, size_t) noexcept {
+            static const unsigned weights[] = {9, 7, 3, 1};
+            return weightedSum(bban, 8, weights, 4) % 10 == 0;
+        }
+
+        /// Czech Republic and Slovakia: weighted mod 11 over prefix and account
+        bool checkCZ(const char* bban, size_t) noexcept {
+            static const unsigned weights[] = {6, 3, 7, 9, 10, 5, 8, 4, 2, 1};
+            return weightedSum(bban + 4, 6, weights + 4, 6) % 11 == 0 &&
+                   weightedSum(bban + 10, 10, weights, 10) % 11 == 0;
+        }
+
+        /// Estonia: weights 7, 3, 1 from the right over the account
+        bool checkEE(const char* bban, size_t length) noexcept {
+            static const unsigned weights[] = {7, 3, 1};
+            unsigned sum = 0;
+            for (size_t i = 0; i + 3 < length; ++i) {
+                sum += digit(bban[length - 2 - i]) * weights[i % 3];
+            }
+            return (10 - sum % 10) % 10 == digit(bban[length - 1]);
+        }
+
+        /// Croatia: ISO 7064 MOD 11,10 over bank and account
+        bool checkHR(const char* bban, size_t) noexcept {
+            return checkIso7064Mod1110(bban, 7) && checkIso7064Mod1110(bban + 7, 10);
+        }
+
+        /// Countries whose whole BBAN is 1 mod 97, which fixes their IBAN
+        /// check sum (e.g. SI56, ME25, RS35)
+        bool checkMod9710(const char* bban, size_t length) noexcept {
+            return remainder(bban, length, 97) == 1;
+        }
+
+        /// Built-in check of a country
+        struct NationalCheck {
+            char countryCode[3];
+            NationalCheckFunction check;
+        };
+
+        /// The built-in checks
+        const NationalCheck builtinChecks[] = {
+            {"AL", checkAL},      {"BA", checkMod9710}, {"BE", checkBE},      {"CZ", checkCZ},
+            {"EE", checkEE},      {"ES", checkES},      {"FI", checkFI},      {"FR", checkRIB},
+            {"HR", checkHR},      {"IT", checkCIN},     {"MC", checkRIB},     {"ME", checkMod9710},
+            {"MK", checkMod9710}, {"MR", checkRIB},     {"NO", checkNO},      {"PL", checkPL},
+            {"PT", checkPT},      {"RS", checkMod9710}, {"SI", checkMod9710}, {"SK", checkCZ},
+            {"SM", checkCIN},     {"TL", checkMod9710},
+        };
+
+        /// Checks indexed by country code
+        struct CheckTable {
+            std::atomic<NationalCheckFunction> checks[countryCodeCount];
+
+            CheckTable() noexcept {
+                for (auto& check : checks) {
+                    check.store(nullptr, std::memory_order_relaxed);
+                }
+                for (const auto& entry : builtinChecks) {
+                    checks[getCountryIndex(entry.countryCode[0], entry.countryCode[1])]
+                            .store(entry.check, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        CheckTable& getCheckTable() noexcept {
+            static CheckTable table;
+            return table;
+        }
+    }
+
+    /**
+     * Verifies the national check digits of an IBAN. The IBAN's own check
+     * sum is not verified, see \p IBAN::validateNational() for both.
+     *
+     * @param machineForm The IBAN in machine form
+     * @return \p true if the country has no national check digits or they are
+     * correct, \p false if they are wrong or the IBAN does not match the BBAN
+     * structure of its country
+     */
+    bool checkNationalDigits(StringView machineForm) noexcept {
+        if (machineForm.size() < 4) {
+            return false;
+        }
+        const char* s = machineForm.data();
+        const size_t index = getCountryIndex(s[0], s[1]);
+        const BBANStructure* structure = getBBANStructure(s[0], s[1]);
+        if (index == countryCodeCount || !structure ||
+                !structure->matches(s + 4, machineForm.size() - 4)) {
+            return false;
+        }
+        const NationalCheckFunction check = getCheckTable().checks[index].load(std::memory_order_acquire);
+        return !check || check(s + 4, machineForm.size() - 4);
+    }
+
+    /**
+     * Tells whether the BBANs of a country are verified by
+     * \p checkNationalDigits().
+     *
+     * @param countryCode The country code
+     * @return \p true if a check is installed for the country
+     */
+    bool hasNationalCheck(StringView countryCode) noexcept {
+        if (countryCode.size() != 2) {
+            return false;
+        }
+        const size_t index = getCountryIndex(countryCode[0], countryCode[1]);
+        return index < countryCodeCount &&
+               getCheckTable().checks[index].load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * Installs the national check of a country, replacing the built-in one.
+     * Can be called while other threads validate IBANs.
+     *
+     * @param countryCode The country code
+     * @param check The check or \p nullptr to disable the checks of the country
+     * @throws IBANInvalidCountryCodeException If the country is unknown
+     */
+    void setNationalCheck(StringView countryCode, NationalCheckFunction check) {
+        const size_t index = countryCode.size() == 2 ?
+                getCountryIndex(countryCode[0], countryCode[1]) : countryCodeCount;
+        if (index == countryCodeCount || !getBBANStructure(countryCode[0], countryCode[1])) {
+            throw IBANInvalidCountryCodeException(countryCode.toString());
+        }
+        getCheckTable().checks[index].store(check, std::memory_order_release);
+    }
+
+    /**
+     * Validates the IBAN like \p validate() and additionally verifies the
+     * check digits embedded in the BBAN (see \p checkNationalDigits()). The
+     * national check digits are not verified if a table set by
+     * \p setCountryTable() gives the country a format other than the
+     * compiled-in one (see \p hasCompiledInFormat()).
+     *
+     * @return \p true if the IBAN and its national check digits are valid
+     */
+    bool IBAN::validateNational() const noexcept {
+        return getStatus() == ParseStatus::OK &&
+               (!hasCompiledInFormat(m_data[0], m_data[1]) || checkNationalDigits(StringView(m_data, m_length)));
+    }
+
+    /**
+     * Validates the IBAN like \p validate() and additionally verifies the
+     * check digits embedded in the BBAN (see \p checkNationalDigits()),
+     * unless its country has a format other than the compiled-in one (see
+     * \p IBAN::validateNational()).
+     *
+     * @return \p true if the IBAN and its national check digits are valid
+     */
+    bool CompactIBAN::validateNational() const noexcept {
+        const StringView machineForm = getMachineForm();
+        return validate() &&
+               (!hasCompiledInFormat(machineForm[0], machineForm[1]) || checkNationalDigits(machineForm));
+    }
+}
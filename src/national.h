@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        national.h
+ * \brief       Header file declaring the national check digit engine
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p checkNationalDigits(), which verifies the check
+ * digits many countries embed in their BBANs (e.g. the French clé RIB, the
+ * Spanish dígitos de control or the Italian CIN) in addition to the IBAN's
+ * check sum, and \p setNationalCheck(), which installs custom checks, e.g. the
+ * per-bank methods of German account numbers.
+ */
+
+#ifndef LIBIBAN_NATIONAL_H
+#define LIBIBAN_NATIONAL_H
+
+#include "libiban.h"
+
+namespace IBAN {
+
+/**
+ * Verifies the national check digits of a BBAN. The BBAN is known to match
+ * the BBAN structure of its country, so a check only has to compute the
+ * digits it verifies.
+ *
+ * @param bban The BBAN
+ * @param length The length of \p bban
+ * @return \p true if the check digits are correct
+ */
+typedef bool (*NationalCheckFunction)(const char* bban, size_t length);
+
+bool checkNationalDigits(StringView machineForm) noexcept;
+bool hasNationalCheck(StringView countryCode) noexcept;
+void setNationalCheck(StringView countryCode, NationalCheckFunction check);
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_NATIONAL_H
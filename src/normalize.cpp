@@ -0,0 +1,305 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        normalize.cpp
+ * \brief       Source file implementing the normalization of IBANs as entered
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p normalizeIBAN(). Every byte is classified by
+ * a table; UTF-8 sequences are decoded and folded to the ASCII characters
+ * they stand for. Blocks of 16 ASCII letters, digits and separators, by far
+ * the most common input, are classified and folded with SSE2 instructions.
+ */
+
+#include "normalize.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBIBAN_SSE2_NORMALIZE 1
+#include <emmintrin.h>
+#else
+#define LIBIBAN_SSE2_NORMALIZE 0
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Class of the characters that are removed
+        constexpr uint8_t separatorClass = 1;
+        /// Class of the colon, which may follow the prefix "IBAN"
+        constexpr uint8_t colonClass = 2;
+        /// Class of the first byte of a UTF-8 sequence
+        constexpr uint8_t sequenceClass = 3;
+        /// Number of characters of a block of the vector path
+        constexpr size_t blockSize = 16;
+
+        /// Classes of the bytes: the uppercase character for letters and
+        /// digits, one of the classes above or 0 for illegal characters
+        struct CharacterTable {
+            uint8_t classes[256];
+
+            CharacterTable() noexcept : classes() {
+                for (unsigned ch = '0'; ch <= '9'; ++ch) {
+                    classes[ch] = static_cast<uint8_t>(ch);
+                }
+                for (unsigned ch = 'A'; ch <= 'Z'; ++ch) {
+                    classes[ch] = static_cast<uint8_t>(ch);
+                    classes[ch - 'A' + 'a'] = static_cast<uint8_t>(ch);
+                }
+                for (unsigned ch = '\t'; ch <= '\r'; ++ch) {
+                    classes[ch] = separatorClass;
+                }
+                classes[static_cast<uint8_t>(' ')] = separatorClass;
+                classes[static_cast<uint8_t>('-')] = separatorClass;
+                classes[static_cast<uint8_t>('.')] = separatorClass;
+                classes[static_cast<uint8_t>(':')] = colonClass;
+                // lead bytes of sequences of two to four bytes
+                for (unsigned ch = 0xC2; ch <= 0xF4; ++ch) {
+                    classes[ch] = sequenceClass;
+                }
+            }
+        };
+
+        /// Returns the character table, which is built on first use
+        const CharacterTable& getCharacterTable() noexcept {
+            static const CharacterTable table;
+            return table;
+        }
+
+        /// Tests for the spaces, invisible characters and dashes of Unicode
+        /// that are removed like their ASCII counterparts
+        inline bool isUnicodeSeparator(uint32_t codePoint) noexcept {
+            return codePoint == 0x00A0 || codePoint == 0x00AD ||     // no-break space, soft hyphen
+                   (codePoint >= 0x2000 && codePoint <= 0x200B) ||   // spaces, zero width space
+                   (codePoint >= 0x2010 && codePoint <= 0x2015) ||   // hyphens and dashes
+                   codePoint == 0x202F || codePoint == 0x205F ||     // narrow and math spaces
+                   codePoint == 0x2060 || codePoint == 0x2212 ||     // word joiner, minus sign
+                   codePoint == 0x3000 || codePoint == 0xFE63 ||     // ideographic space, small hyphen
+                   codePoint == 0xFEFF;                              // byte order mark
+        }
+
+        /**
+         * Decodes the UTF-8 sequence at \p data[position] and advances
+         * \p position behind it. Returns the class of the character: the
+         * fullwidth forms of ASCII characters (U+FF01 to U+FF5E) are folded to
+         * these; invalid, overlong or surrogate sequences and other characters
+         * are illegal.
+         */
+        uint8_t readSequence(const CharacterTable& table, const uint8_t* data, size_t size,
+                             size_t& position) noexcept {
+            const uint8_t lead = data[position++];
+            const size_t continuations = lead < 0xE0 ? 1 : lead < 0xF0 ? 2 : 3;
+            uint32_t codePoint = lead & (0x3F >> continuations);
+            for (size_t i = 0; i < continuations; ++i) {
+                if (position == size || (data[position] & 0xC0) != 0x80) {
+                    return 0;
+                }
+                codePoint = (codePoint << 6) | (data[position++] & 0x3F);
+            }
+            // only the shortest sequence of a code point is valid, and
+            // surrogates are no characters
+            const uint32_t shortest = continuations == 1 ? 0x80 : continuations == 2 ? 0x800 : 0x10000;
+            if (codePoint < shortest || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+                return 0;
+            }
+            if (codePoint >= 0xFF01 && codePoint <= 0xFF5E) {
+                return table.classes[codePoint - 0xFEE0];
+            }
+            return isUnicodeSeparator(codePoint) ? separatorClass : 0;
+        }
+
+        /// Returns the class of the character at \p data[position] and
+        /// advances \p position behind it
+        inline uint8_t readCharacter(const CharacterTable& table, const uint8_t* data, size_t size,
+                                     size_t& position) noexcept {
+            const uint8_t characterClass = table.classes[data[position]];
+            if (characterClass != sequenceClass) {
+                ++position;
+                return characterClass;
+            }
+            return readSequence(table, data, size, position);
+        }
+
+        /// Skips separators and returns the position of the next character
+        size_t skipSeparators(const CharacterTable& table, const uint8_t* data, size_t size,
+                              size_t position) noexcept {
+            while (position < size) {
+                size_t next = position;
+                if (readCharacter(table, data, size, next) != separatorClass) {
+                    break;
+                }
+                position = next;
+            }
+            return position;
+        }
+
+        /// Returns the position behind the prefix "IBAN" (in any case), the
+        /// separators around it and an optional colon, or \p position if the
+        /// input does not start with the prefix
+        size_t skipPrefix(const CharacterTable& table, const uint8_t* data, size_t size,
+                          size_t position) noexcept {
+            size_t next = position;
+            for (const char ch : {'I', 'B', 'A', 'N'}) {
+                if (next == size || readCharacter(table, data, size, next) != static_cast<uint8_t>(ch)) {
+                    return position;
+                }
+            }
+            next = skipSeparators(table, data, size, next);
+            size_t colon = next;
+            if (next < size && readCharacter(table, data, size, colon) == colonClass) {
+                next = skipSeparators(table, data, size, colon);
+            }
+            return next;
+        }
+
+#if LIBIBAN_SSE2_NORMALIZE
+        /**
+         * Normalizes at once the block of the first \p count (at most 16)
+         * characters at \p data if all of them are ASCII letters, digits or
+         * separators and their letters and digits fit into \p maxIBANLength
+         * characters. Otherwise nothing is written and the characters are
+         * left to the scalar path, which reports the error. Up to 16
+         * characters are loaded even if \p count is smaller, and up to 16
+         * are written behind \p machineForm[length].
+         */
+        __attribute__((no_sanitize_address))
+        bool normalizeBlock(const uint8_t* data, size_t count, char* machineForm,
+                            size_t& length) noexcept {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            // letters without the bit of lowercase; bytes above 0x7F are
+            // negative and thus fall in none of the classes
+            const __m128i upper = _mm_and_si128(v, _mm_set1_epi8(static_cast<char>(0xDF)));
+            const __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(upper, _mm_set1_epi8('A' - 1)),
+                                                   _mm_cmplt_epi8(upper, _mm_set1_epi8('Z' + 1)));
+            const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+            const __m128i isSeparator = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')),
+                                 _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                                               _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1)))));
+            const uint32_t valid = count >= blockSize ? 0xFFFFu : (1u << count) - 1;
+            const uint32_t kept = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(isLetter, isDigit))) & valid;
+            if (((kept | static_cast<uint32_t>(_mm_movemask_epi8(isSeparator))) & valid) != valid) {
+                return false;
+            }
+            const size_t keptCount = static_cast<size_t>(__builtin_popcount(kept));
+            if (length + keptCount > maxIBANLength) {
+                return false;
+            }
+            const __m128i folded = _mm_or_si128(_mm_and_si128(isLetter, upper), _mm_andnot_si128(isLetter, v));
+            if (kept == 0xFFFFu) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(machineForm + length), folded);
+            } else {
+                // without branches: every character is written, but only the
+                // letters and digits advance the position
+                alignas(16) char characters[blockSize];
+                _mm_store_si128(reinterpret_cast<__m128i*>(characters), folded);
+                char* out = machineForm + length;
+                for (size_t i = 0; i < blockSize; ++i) {
+                    *out = characters[i];
+                    out += (kept >> i) & 1;
+                }
+            }
+            length += keptCount;
+            return true;
+        }
+
+        /// Tests if 16 bytes can be loaded from \p data without crossing a
+        /// page boundary (and thus without faulting)
+        inline bool isBlockLoadable(const uint8_t* data) noexcept {
+            return (reinterpret_cast<uintptr_t>(data) & 4095) <= 4096 - blockSize;
+        }
+#endif
+    }
+
+    /**
+     * Converts an IBAN as entered into its machine form in a single pass
+     * without allocating memory. Independent of the locale,
+     * - an optional prefix "IBAN" (in any case, optionally followed by a
+     *   colon) is removed,
+     * - spaces, tabs, line breaks, hyphens and full stops are removed, as well
+     *   as the Unicode spaces, dashes and invisible characters such as U+00A0
+     *   (no-break space), U+202F (narrow no-break space), U+2013 (en dash)
+     *   or U+FEFF (byte order mark),
+     * - fullwidth letters and digits (U+FF10 to U+FF5A) are folded to ASCII
+     *   and
+     * - letters are converted to uppercase.
+     * Any other character, e.g. '/', and invalid UTF-8 is illegal. The result
+     * is not validated in any way.
+     *
+     * @param input The IBAN as entered, in UTF-8
+     * @param machineForm Buffer of at least \p maxIBANLength characters
+     * receiving the machine form (not null terminated)
+     * @param length Optional pointer receiving the length of the machine form;
+     * set even if normalization fails
+     * @return \p ParseStatus::OK on success, \p ParseStatus::InvalidLength if
+     * there are more than \p maxIBANLength letters and digits or
+     * \p ParseStatus::IllegalCharacter if \p input contains an illegal
+     * character
+     */
+    ParseStatus normalizeIBAN(StringView input, char* machineForm, size_t* length) noexcept {
+        const CharacterTable& table = getCharacterTable();
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+        const size_t size = input.size();
+        // room for a whole block behind the longest machine form
+        char buffer[maxIBANLength + blockSize];
+        size_t n = 0;
+        size_t position = skipPrefix(table, data, size, skipSeparators(table, data, size, 0));
+        ParseStatus status = ParseStatus::OK;
+        while (position < size && status == ParseStatus::OK) {
+            const size_t remaining = size - position;
+#if LIBIBAN_SSE2_NORMALIZE
+            if ((remaining >= blockSize || isBlockLoadable(data + position)) &&
+                normalizeBlock(data + position, remaining, buffer, n)) {
+                position += std::min(remaining, blockSize);
+                continue;
+            }
+#endif
+            // one block at a time, so the vector path can take over again
+            const size_t blockEnd = position + std::min(remaining, blockSize);
+            while (position < blockEnd) {
+                const uint8_t characterClass = readCharacter(table, data, size, position);
+                if (characterClass >= '0') {
+                    if (n == maxIBANLength) {
+                        status = ParseStatus::InvalidLength;
+                        break;
+                    }
+                    buffer[n++] = static_cast<char>(characterClass);
+                } else if (characterClass != separatorClass) {
+                    status = ParseStatus::IllegalCharacter;
+                    break;
+                }
+            }
+        }
+        std::memcpy(machineForm, buffer, n);
+        if (length) {
+            *length = n;
+        }
+        return status;
+    }
+}
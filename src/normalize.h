@@ -0,0 +1,49 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        normalize.h
+ * \brief       Header file declaring the normalization of IBANs as entered
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p normalizeIBAN(), which turns an IBAN as it is
+ * entered or pasted, e.g. "IBAN: de89-3704-0044-0532-0130-00" with non
+ * breaking spaces or fullwidth digits, into its machine form. It does not
+ * depend on the locale; \p IBAN::tryParse() and \p IBAN::createFromString()
+ * use it, and thus every batch and file validation does.
+ */
+
+#ifndef LIBIBAN_NORMALIZE_H
+#define LIBIBAN_NORMALIZE_H
+
+#include "libiban.h"
+
+namespace IBAN {
+
+ParseStatus normalizeIBAN(StringView input, char* machineForm, size_t* length) noexcept;
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_NORMALIZE_H
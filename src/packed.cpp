@@ -0,0 +1,378 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        packed.cpp
+ * \brief       Source file implementing the packed binary form of IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the class \p PackedIBAN, which converts IBANs
+ * to and from a compact, order preserving binary form.
+ */
+
+#include "libiban.h"
+
+namespace IBAN {
+
+    namespace {
+        /// Number of bits used for the country code
+        constexpr size_t countryBits = 10;
+        /// Number of bits used for the check sum
+        constexpr size_t checksumBits = 7;
+        /// Number of 32 bit limbs of \p BigNumber; enough for every packed IBAN
+        constexpr size_t limbCount = 6;
+
+        static_assert(limbCount * 32 >= maxPackedIBANSize * 8,
+                      "BigNumber must be able to hold every packed IBAN");
+
+        /// Unsigned integer with a fixed number of bits, least significant
+        /// limb first
+        struct BigNumber {
+            uint32_t limbs[limbCount];
+        };
+
+        /// Sets \p n to \p n * \p mul + \p add
+        void mulAdd(BigNumber& n, uint32_t mul, uint32_t add) noexcept {
+            uint64_t carry = add;
+            for (auto& limb : n.limbs) {
+                uint64_t value = static_cast<uint64_t>(limb) * mul + carry;
+                limb = static_cast<uint32_t>(value);
+                carry = value >> 32;
+            }
+        }
+
+        /// Divides \p n by \p div and returns the remainder
+        uint32_t divMod(BigNumber& n, uint32_t div) noexcept {
+            // leading zero limbs stay zero
+            size_t limbs = limbCount;
+            while (limbs > 0 && n.limbs[limbs - 1] == 0) {
+                --limbs;
+            }
+            uint64_t remainder = 0;
+            for (size_t i = limbs; i-- > 0;) {
+                uint64_t value = (remainder << 32) | n.limbs[i];
+                n.limbs[i] = static_cast<uint32_t>(value / div);
+                remainder = value % div;
+            }
+            return static_cast<uint32_t>(remainder);
+        }
+
+        /// Shifts \p n to the left by \p bits bits
+        void shiftLeft(BigNumber& n, size_t bits) noexcept {
+            const size_t limbs = bits / 32, rest = bits % 32;
+            for (size_t i = limbCount; i-- > 0;) {
+                uint64_t value = 0;
+                if (i >= limbs) {
+                    value = static_cast<uint64_t>(n.limbs[i - limbs]) << rest;
+                    if (rest != 0 && i > limbs) {
+                        value |= n.limbs[i - limbs - 1] >> (32 - rest);
+                    }
+                }
+                n.limbs[i] = static_cast<uint32_t>(value);
+            }
+        }
+
+        /// Shifts \p n to the right by \p bits bits
+        void shiftRight(BigNumber& n, size_t bits) noexcept {
+            const size_t limbs = bits / 32, rest = bits % 32;
+            for (size_t i = 0; i < limbCount; ++i) {
+                uint64_t value = 0;
+                if (i + limbs < limbCount) {
+                    value = n.limbs[i + limbs] >> rest;
+                    if (rest != 0 && i + limbs + 1 < limbCount) {
+                        value |= static_cast<uint64_t>(n.limbs[i + limbs + 1]) << (32 - rest);
+                    }
+                }
+                n.limbs[i] = static_cast<uint32_t>(value);
+            }
+        }
+
+        /// Returns the number of significant bits of \p n
+        size_t bitLength(const BigNumber& n) noexcept {
+            for (size_t i = limbCount; i-- > 0;) {
+                for (size_t bit = 32; bit-- > 0;) {
+                    if ((n.limbs[i] >> bit) & 1) {
+                        return i * 32 + bit + 1;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        /// Returns \p true if \p lhs is smaller than \p rhs
+        bool less(const BigNumber& lhs, const BigNumber& rhs) noexcept {
+            for (size_t i = limbCount; i-- > 0;) {
+                if (lhs.limbs[i] != rhs.limbs[i]) {
+                    return lhs.limbs[i] < rhs.limbs[i];
+                }
+            }
+            return false;
+        }
+
+        /// Returns the radix used for a position of the given character class
+        inline uint32_t radix(uint8_t charClass) noexcept {
+            return charClass == BBANStructure::Digit ? 10 :
+                   charClass == BBANStructure::Letter ? 26 : 36;
+        }
+
+        /// Returns the value of \p ch in the radix of a position of the given
+        /// character class or a value not smaller than the radix if \p ch is
+        /// not allowed there. The values are ordered like the characters.
+        inline uint32_t digitValue(char ch, uint8_t charClass) noexcept {
+            if (ch >= '0' && ch <= '9') {
+                return (charClass & BBANStructure::Digit) ?
+                       static_cast<uint32_t>(ch - '0') : 36;
+            }
+            if (ch >= 'A' && ch <= 'Z') {
+                const uint32_t letter = static_cast<uint32_t>(ch - 'A');
+                return charClass == BBANStructure::Letter ? letter :
+                       charClass == BBANStructure::Alphanumeric ? letter + 10 : 36;
+            }
+            return 36;
+        }
+
+        /// Divides \p chunk by the radix of the given character class and
+        /// returns the remainder. Dividing by constants lets the compiler
+        /// replace the divisions by multiplications.
+        inline uint32_t splitDigit(uint32_t& chunk, uint8_t charClass) noexcept {
+            uint32_t quotient;
+            if (charClass == BBANStructure::Digit) {
+                quotient = chunk / 10;
+            } else if (charClass == BBANStructure::Letter) {
+                quotient = chunk / 26;
+            } else {
+                quotient = chunk / 36;
+            }
+            const uint32_t digit = chunk - quotient * radix(charClass);
+            chunk = quotient;
+            return digit;
+        }
+
+        /// Inverse of \p digitValue()
+        inline char digitChar(uint32_t value, uint8_t charClass) noexcept {
+            if (charClass == BBANStructure::Letter) {
+                return static_cast<char>('A' + value);
+            }
+            return static_cast<char>(value < 10 ? '0' + value : 'A' + value - 10);
+        }
+
+        /// Returns the number of bits needed for the BBANs of a structure, i.e.
+        /// the bit length of the largest BBAN number
+        size_t computeBBANBits(const BBANStructure& structure) noexcept {
+            BigNumber max = {{1}};
+            for (size_t i = 0; i < structure.length; ++i) {
+                mulAdd(max, radix(structure.classes[i]), 0);
+            }
+            // the largest number is the product of all radixes minus one, which
+            // only needs one bit less than the product if that is a power of 2
+            size_t bits = bitLength(max);
+            BigNumber power = {{1}};
+            shiftLeft(power, bits - 1);
+            return (bits > 0 && !less(power, max)) ? bits - 1 : bits;
+        }
+
+        /// Number of BBAN bits per country, computed once
+        struct BitTable {
+            uint8_t bits[countryCodeCount];
+
+            BitTable() noexcept : bits() {
+                for (size_t i = 0; i < countryFormatCount; ++i) {
+                    const char* code = CountryRegistry::formats[i].countryCode;
+                    const BBANStructure* structure = getBBANStructure(code[0], code[1]);
+                    if (structure) {
+                        bits[getCountryIndex(code[0], code[1])] =
+                                static_cast<uint8_t>(computeBBANBits(*structure));
+                    }
+                }
+            }
+        };
+
+        /// Returns the number of bits needed for the BBANs of a country
+        inline size_t bbanBits(char a, char b) noexcept {
+            static const BitTable table;
+            return table.bits[getCountryIndex(a, b)];
+        }
+    }
+
+    /**
+     * Constructs a \p PackedIBAN from bytes received from storage or the wire.
+     * Bytes exceeding \p maxPackedIBANSize are cut off; call \p unpack() to
+     * find out if the bytes form a valid packed IBAN.
+     *
+     * @param data The packed bytes
+     * @param size The number of packed bytes
+     */
+    PackedIBAN::PackedIBAN(const uint8_t* data, size_t size) noexcept :
+            m_data(), m_size(0) {
+        m_size = static_cast<uint8_t>(std::min(size, maxPackedIBANSize));
+        std::memcpy(m_data, data, m_size);
+    }
+
+    /**
+     * Packs an IBAN given in machine form. Packing fails if the country code is
+     * unknown or if the IBAN does not match the length and BBAN structure of
+     * its country. The check sum itself is not verified.
+     *
+     * @param machineForm The IBAN in machine form (see \p IBAN::getMachineForm())
+     * @param result The instance receiving the packed IBAN
+     * @return \p true if packing succeeded, \p false otherwise
+     */
+    bool PackedIBAN::pack(StringView machineForm, PackedIBAN& result) noexcept {
+        const size_t length = machineForm.size();
+        if (length < 5 || length > maxIBANLength) {
+            return false;
+        }
+        const char* s = machineForm.data();
+        if (s[0] < 'A' || s[0] > 'Z' || s[1] < 'A' || s[1] > 'Z' ||
+            s[2] < '0' || s[2] > '9' || s[3] < '0' || s[3] > '9') {
+            return false;
+        }
+        const size_t bban = length - 4;
+        const BBANStructure* structure = getBBANStructure(s[0], s[1]);
+        if (!structure || structure->length != bban) {
+            return false;
+        }
+
+        // collect as many digits in a machine word as fit before multiplying
+        // them into the big number
+        BigNumber number = {{0}};
+        uint64_t chunk = 0, scale = 1;
+        for (size_t i = 0; i < bban; ++i) {
+            const uint8_t charClass = structure->classes[i];
+            const uint32_t base = radix(charClass);
+            const uint32_t value = digitValue(s[4 + i], charClass);
+            if (value >= base) {
+                return false;
+            }
+            if (scale * base > UINT32_MAX) {
+                mulAdd(number, static_cast<uint32_t>(scale), static_cast<uint32_t>(chunk));
+                chunk = 0;
+                scale = 1;
+            }
+            chunk = chunk * base + value;
+            scale *= base;
+        }
+        mulAdd(number, static_cast<uint32_t>(scale), static_cast<uint32_t>(chunk));
+
+        // prepend country code and check sum, then align to the left
+        const size_t bits = bbanBits(s[0], s[1]);
+        const size_t totalBits = countryBits + checksumBits + bits;
+        const size_t size = (totalBits + 7) / 8;
+        BigNumber header = {{0}};
+        header.limbs[0] = static_cast<uint32_t>((s[0] - 'A') * 26 + (s[1] - 'A')) << checksumBits |
+                          static_cast<uint32_t>((s[2] - '0') * 10 + (s[3] - '0'));
+        shiftLeft(header, bits);
+        for (size_t i = 0; i < limbCount; ++i) {
+            number.limbs[i] |= header.limbs[i];
+        }
+        shiftLeft(number, size * 8 - totalBits);
+
+        PackedIBAN packed;
+        for (size_t i = 0; i < size; ++i) {
+            const size_t bit = (size - 1 - i) * 8;
+            packed.m_data[i] = static_cast<uint8_t>(number.limbs[bit / 32] >> (bit % 32));
+        }
+        packed.m_size = static_cast<uint8_t>(size);
+        result = packed;
+        return true;
+    }
+
+    /**
+     * Unpacks the IBAN. Unpacking fails if the bytes do not form a valid packed
+     * IBAN, including set padding bits and BBAN numbers out of range, so every
+     * IBAN has exactly one packed form; \p result is only modified if
+     * unpacking succeeds.
+     *
+     * @param result The instance receiving the machine form of the IBAN
+     * @return \p true if unpacking succeeded, \p false otherwise
+     */
+    bool PackedIBAN::unpack(CompactIBAN& result) const noexcept {
+        if (m_size < 3) {
+            return false;
+        }
+        const uint32_t country = static_cast<uint32_t>(m_data[0]) << 2 | m_data[1] >> 6;
+        const uint32_t checksum = static_cast<uint32_t>(m_data[1] & 0x3F) << 1 | m_data[2] >> 7;
+        if (country >= 26 * 26 || checksum > 99) {
+            return false;
+        }
+        char machineForm[maxIBANLength] = {
+            static_cast<char>('A' + country / 26), static_cast<char>('A' + country % 26),
+            static_cast<char>('0' + checksum / 10), static_cast<char>('0' + checksum % 10)
+        };
+        const BBANStructure* structure = getBBANStructure(machineForm[0], machineForm[1]);
+        if (!structure) {
+            return false;
+        }
+        const size_t bban = structure->length;
+        const size_t bits = bbanBits(machineForm[0], machineForm[1]);
+        const size_t totalBits = countryBits + checksumBits + bits;
+        if (m_size != (totalBits + 7) / 8) {
+            return false;
+        }
+        // the padding behind the number must be zero, so every IBAN has a
+        // single packed form
+        const size_t padding = m_size * 8 - totalBits;
+        if ((m_data[m_size - 1] & ((1u << padding) - 1)) != 0) {
+            return false;
+        }
+
+        BigNumber number = {{0}};
+        for (size_t i = 0; i < m_size; ++i) {
+            shiftLeft(number, 8);
+            number.limbs[0] |= m_data[i];
+        }
+        shiftRight(number, padding);
+        // drop the header
+        BigNumber header = number;
+        shiftRight(header, bits);
+        shiftLeft(header, bits);
+        for (size_t i = 0; i < limbCount; ++i) {
+            number.limbs[i] ^= header.limbs[i];
+        }
+
+        // divide by as large a product of radixes as fits into 32 bits, then
+        // split the remainder into digits with machine arithmetic
+        for (size_t end = bban; end > 0;) {
+            size_t begin = end;
+            uint64_t scale = 1;
+            while (begin > 0 && scale * radix(structure->classes[begin - 1]) <= UINT32_MAX) {
+                scale *= radix(structure->classes[--begin]);
+            }
+            uint32_t chunk = divMod(number, static_cast<uint32_t>(scale));
+            for (size_t i = end; i-- > begin;) {
+                const uint8_t charClass = structure->classes[i];
+                machineForm[4 + i] = digitChar(splitDigit(chunk, charClass), charClass);
+            }
+            end = begin;
+        }
+        // the number must be below the product of the radixes, i.e. not exceed
+        // the largest BBAN number
+        if (bitLength(number) != 0) {
+            return false;
+        }
+        result = CompactIBAN(StringView(machineForm, bban + 4));
+        return true;
+    }
+}
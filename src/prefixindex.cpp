@@ -0,0 +1,695 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        prefixindex.cpp
+ * \brief       Read-only sorted index for prefix and range queries over IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p PrefixIndex and \p PrefixIndexBuilder.
+ * Prefixes are turned into the smallest IBAN of a country that is not ordered
+ * before them, whose packed form is then looked up in the records of the
+ * country.
+ */
+
+#include "prefixindex.h"
+#include "registry.h"
+#include "snapshot.h"
+#include <algorithm>
+
+#if LIBIBAN_USE_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace IBAN {
+
+    namespace {
+        /// Magic bytes at the start of a snapshot
+        constexpr char indexMagic[8] = {'I', 'B', 'A', 'N', 'I', 'D', 'X', '1'};
+        /// Size of the snapshot header
+        constexpr size_t indexHeaderSize = 24;
+        /// Size of an entry of the country table
+        constexpr size_t sectionSize = 40;
+        /// Number of records per fence key, and of fence keys per fence key of
+        /// the next level, as power of 2
+        constexpr size_t fenceShift = 6;
+        /// Number of records per fence key
+        constexpr size_t fenceInterval = size_t(1) << fenceShift;
+        /// Maximum number of fence levels, enough for 64 bit positions
+        constexpr size_t maxFenceLevels = 11;
+
+        /// Throws the exception for a snapshot that cannot be loaded
+        [[noreturn]] void throwMalformedIndex() {
+            throw std::runtime_error("Malformed prefix index snapshot");
+        }
+
+        /// Rounds \p size up to a multiple of 8
+        inline size_t alignSize(size_t size) noexcept {
+            return (size + 7) & ~size_t(7);
+        }
+
+        /// Returns the number of fence keys of each level for \p count records
+        /// and the number of levels: every 64th record has a fence key, every
+        /// 64th of these one in the next level and so on, up to the first
+        /// level with at most 64 keys
+        size_t getFenceCounts(uint64_t count, uint64_t* counts) noexcept {
+            size_t levels = 0;
+            uint64_t keys = count;
+            do {
+                keys = (keys + fenceInterval - 1) / fenceInterval;
+                counts[levels++] = keys;
+            } while (keys > fenceInterval);
+            return levels;
+        }
+
+        /// Returns the total number of fence keys for \p count records
+        uint64_t getFenceCount(uint64_t count) noexcept {
+            uint64_t counts[maxFenceLevels];
+            const size_t levels = getFenceCounts(count, counts);
+            uint64_t total = 0;
+            for (size_t i = 0; i < levels; ++i) {
+                total += counts[i];
+            }
+            return total;
+        }
+
+        /// Returns the fence key of a record: its first 8 bytes as big endian
+        /// number, padded with zeros
+        inline uint64_t getFenceKey(const uint8_t* record, size_t width) noexcept {
+            uint64_t key = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                key = key << 8 | (i < width ? record[i] : 0);
+            }
+            return key;
+        }
+
+        /// Returns the smallest character of a character class
+        inline char getMinCharacter(uint8_t charClass) noexcept {
+            return charClass == BBANStructure::Letter ? 'A' : '0';
+        }
+
+        /// Sets \p result to the smallest character of a character class that
+        /// is greater than \p ch; returns \p false if there is none
+        bool getNextCharacter(uint8_t charClass, char ch, char& result) noexcept {
+            for (unsigned c = static_cast<unsigned char>(ch) + 1u; c <= 'Z'; ++c) {
+                if (BBANStructure::classify(static_cast<char>(c)) & charClass) {
+                    result = static_cast<char>(c);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Fills \p classes with the character classes of the check digits and
+        /// the BBAN and returns their number
+        size_t getClasses(const BBANStructure& structure, uint8_t* classes) noexcept {
+            classes[0] = classes[1] = BBANStructure::Digit;
+            std::memcpy(classes + 2, structure.classes, structure.length);
+            return 2u + structure.length;
+        }
+
+        /// Packs the smallest IBAN of a country; returns \p false if the
+        /// country does not support IBAN
+        bool packSmallest(size_t country, PackedIBAN& result) noexcept {
+            char iban[maxIBANLength];
+            iban[0] = static_cast<char>('A' + country / 26);
+            iban[1] = static_cast<char>('A' + country % 26);
+            const BBANStructure* structure = getBBANStructure(iban[0], iban[1]);
+            if (!structure) {
+                return false;
+            }
+            uint8_t classes[2 + maxBBANLength];
+            const size_t length = getClasses(*structure, classes);
+            for (size_t i = 0; i < length; ++i) {
+                iban[2 + i] = getMinCharacter(classes[i]);
+            }
+            return PackedIBAN::pack(StringView(iban, 2 + length), result);
+        }
+
+        /// Sorts records of \p width bytes with a least significant digit
+        /// radix sort, skipping the bytes that are equal in all records
+        void sortRecords(std::vector<uint8_t>& records, size_t width) {
+            const size_t count = records.size() / width;
+            std::vector<uint8_t> sorted(records.size());
+            for (size_t byte = width; byte-- > 0;) {
+                size_t offsets[256] = {0};
+                for (size_t i = 0; i < count; ++i) {
+                    ++offsets[records[i * width + byte]];
+                }
+                if (offsets[records[byte]] == count) {
+                    continue;
+                }
+                size_t offset = 0;
+                for (auto& bucket : offsets) {
+                    const size_t size = bucket;
+                    bucket = offset;
+                    offset += size;
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    const uint8_t* record = &records[i * width];
+                    std::memcpy(&sorted[offsets[record[byte]]++ * width], record, width);
+                }
+                records.swap(sorted);
+            }
+        }
+    }
+
+    /// Constructs an empty builder
+    PrefixIndexBuilder::PrefixIndexBuilder() : m_records(countryCodeCount), m_size(0) {}
+
+    /**
+     * Adds an IBAN.
+     *
+     * @param machineForm The IBAN in machine form
+     * @throws std::invalid_argument If the IBAN does not match the structure
+     * of its country
+     */
+    void PrefixIndexBuilder::add(StringView machineForm) {
+        PackedIBAN packed;
+        if (!PackedIBAN::pack(machineForm, packed)) {
+            throw std::invalid_argument("IBAN does not match the structure of its country");
+        }
+        std::vector<uint8_t>& records = m_records[getCountryIndex(machineForm[0], machineForm[1])];
+        records.insert(records.end(), packed.data() + 1, packed.data() + packed.size());
+        ++m_size;
+    }
+
+    /**
+     * Adds an IBAN.
+     *
+     * @param iban The IBAN
+     * @throws std::invalid_argument If the IBAN does not match the structure
+     * of its country
+     */
+    void PrefixIndexBuilder::add(const CompactIBAN& iban) {
+        add(iban.getMachineForm());
+    }
+
+    /**
+     * Adds a batch of IBANs.
+     *
+     * @param ibans The IBANs
+     * @param count The number of IBANs
+     * @throws std::invalid_argument If an IBAN does not match the structure of
+     * its country; the IBANs before it have been added
+     */
+    void PrefixIndexBuilder::add(const CompactIBAN* ibans, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            add(ibans[i].getMachineForm());
+        }
+    }
+
+    /**
+     * Builds the snapshot of the IBANs added. The countries are sorted one
+     * after the other, so building needs twice the memory of the largest
+     * country in addition to the builder and the snapshot.
+     *
+     * @return The snapshot
+     */
+    std::vector<char> PrefixIndexBuilder::build() const {
+        size_t capacity = indexHeaderSize + countryCodeCount * sectionSize;
+        for (const auto& records : m_records) {
+            capacity += alignSize(records.size()) + getFenceCount(records.size()) * 8;
+        }
+        std::vector<char> snapshot;
+        snapshot.reserve(capacity);
+        snapshot.resize(indexHeaderSize + countryCodeCount * sectionSize);
+        std::memcpy(snapshot.data(), indexMagic, sizeof(indexMagic));
+
+        uint64_t total = 0;
+        std::vector<uint8_t> records;
+        for (size_t country = 0; country < countryCodeCount; ++country) {
+            char* section = snapshot.data() + indexHeaderSize + country * sectionSize;
+            detail::writeNumber<uint64_t>(section, total);
+            if (m_records[country].empty()) {
+                continue;
+            }
+            PackedIBAN smallest;
+            packSmallest(country, smallest);
+            const size_t width = smallest.size() - 1;
+            records = m_records[country];
+            sortRecords(records, width);
+            size_t count = 0;
+            for (size_t i = 0; i < records.size(); i += width) {
+                if (count == 0 || std::memcmp(&records[(count - 1) * width], &records[i], width) != 0) {
+                    std::memmove(&records[count * width], &records[i], width);
+                    ++count;
+                }
+            }
+
+            const size_t recordOffset = snapshot.size();
+            const size_t fenceOffset = recordOffset + alignSize(count * width);
+            snapshot.resize(fenceOffset + getFenceCount(count) * 8);
+            section = snapshot.data() + indexHeaderSize + country * sectionSize;
+            std::memcpy(snapshot.data() + recordOffset, records.data(), count * width);
+            uint64_t fenceCounts[maxFenceLevels];
+            const size_t levels = getFenceCounts(count, fenceCounts);
+            char* fence = snapshot.data() + fenceOffset;
+            size_t stride = fenceInterval;
+            for (size_t level = 0; level < levels; ++level, stride *= fenceInterval) {
+                for (size_t i = 0; i < fenceCounts[level]; ++i, fence += 8) {
+                    detail::writeNumber<uint64_t>(fence, getFenceKey(&records[i * stride * width], width));
+                }
+            }
+            detail::writeNumber<uint64_t>(section + 8, count);
+            detail::writeNumber<uint64_t>(section + 16, width);
+            detail::writeNumber<uint64_t>(section + 24, recordOffset);
+            detail::writeNumber<uint64_t>(section + 32, fenceOffset);
+            total += count;
+        }
+        detail::writeNumber<uint64_t>(snapshot.data() + 8, total);
+        detail::writeNumber<uint64_t>(snapshot.data() + 16, snapshot.size());
+        return snapshot;
+    }
+
+    /**
+     * Writes the snapshot of the IBANs added to a file.
+     *
+     * @param path The path of the file
+     * @throws std::system_error If the file cannot be written
+     */
+    void PrefixIndexBuilder::write(const std::string& path) const {
+        detail::writeSnapshot(path, build());
+    }
+
+    PrefixIndex::PrefixIndex() noexcept : m_mapping(nullptr), m_mappingSize(0), m_count(0) {}
+
+    PrefixIndex::~PrefixIndex() {
+        detail::unmapSnapshot(m_mapping, m_mappingSize);
+    }
+
+    /**
+     * Opens a snapshot file. The file is mapped into memory and must not be
+     * modified while the index exists; replace it by renaming a new file over
+     * it instead.
+     *
+     * @param path The path of the snapshot
+     * @return The index
+     * @throws std::system_error If the file cannot be opened or mapped
+     * @throws std::runtime_error If the file is not a valid snapshot
+     */
+    std::unique_ptr<PrefixIndex> PrefixIndex::open(const std::string& path) {
+#if LIBIBAN_USE_MMAP
+        const detail::SnapshotMapping mapping = detail::mapSnapshot(path);
+        std::unique_ptr<PrefixIndex> index(new PrefixIndex());
+        index->m_mapping = mapping.data;
+        index->m_mappingSize = mapping.size;
+        index->load(static_cast<const char*>(mapping.data), mapping.size);
+        // lookups touch a few pages anywhere in the file
+        ::madvise(mapping.data, mapping.size, MADV_RANDOM);
+        return index;
+#else
+        return fromBuffer(detail::readSnapshot(path));
+#endif
+    }
+
+    /**
+     * Loads a snapshot held in memory, e.g. as returned by
+     * \p PrefixIndexBuilder::build().
+     *
+     * @param snapshot The snapshot
+     * @return The index
+     * @throws std::runtime_error If \p snapshot is not a valid snapshot
+     */
+    std::unique_ptr<PrefixIndex> PrefixIndex::fromBuffer(std::vector<char> snapshot) {
+        std::unique_ptr<PrefixIndex> index(new PrefixIndex());
+        index->m_buffer = std::move(snapshot);
+        index->load(index->m_buffer.data(), index->m_buffer.size());
+        return index;
+    }
+
+    /// Checks the header and the country table of the snapshot; the records
+    /// are not read, so loading does not depend on their number
+    void PrefixIndex::load(const char* data, size_t size) {
+        if (size < indexHeaderSize + countryCodeCount * sectionSize ||
+            std::memcmp(data, indexMagic, sizeof(indexMagic)) != 0 ||
+            detail::readNumber<uint64_t>(data + 16) != size) {
+            throwMalformedIndex();
+        }
+        m_count = static_cast<size_t>(detail::readNumber<uint64_t>(data + 8));
+        m_sections.resize(countryCodeCount + 1);
+        uint64_t total = 0;
+        for (size_t country = 0; country < countryCodeCount; ++country) {
+            const char* entry = data + indexHeaderSize + country * sectionSize;
+            Section& section = m_sections[country];
+            section.first = static_cast<size_t>(total);
+            section.count = 0;
+            section.width = 0;
+            section.prefix = 0;
+            section.records = section.fences = nullptr;
+            const uint64_t count = detail::readNumber<uint64_t>(entry + 8);
+            if (detail::readNumber<uint64_t>(entry) != total) {
+                throwMalformedIndex();
+            }
+            if (count == 0) {
+                continue;
+            }
+            PackedIBAN smallest;
+            const uint64_t width = detail::readNumber<uint64_t>(entry + 16);
+            const uint64_t recordOffset = detail::readNumber<uint64_t>(entry + 24);
+            const uint64_t fenceOffset = detail::readNumber<uint64_t>(entry + 32);
+            if (!packSmallest(country, smallest) || width != smallest.size() - 1 ||
+                count > size || recordOffset > size || fenceOffset > size ||
+                size - recordOffset < count * width ||
+                size - fenceOffset < getFenceCount(count) * 8) {
+                throwMalformedIndex();
+            }
+            section.records = data + recordOffset;
+            section.fences = data + fenceOffset;
+            section.count = static_cast<size_t>(count);
+            section.width = static_cast<size_t>(width);
+            section.prefix = smallest.data()[0];
+            m_countries.push_back(static_cast<uint16_t>(country));
+            total += count;
+        }
+        if (total != m_count) {
+            throwMalformedIndex();
+        }
+        m_sections[countryCodeCount].first = m_count;
+        m_sections[countryCodeCount].count = 0;
+    }
+
+    /// Returns the position within a section of the first record that is not
+    /// smaller than \p key, which holds \p section.width bytes
+    size_t PrefixIndex::findInSection(const Section& section, const uint8_t* key) const noexcept {
+        const size_t width = section.width;
+        const uint64_t target = getFenceKey(key, width);
+        uint64_t fenceCounts[maxFenceLevels];
+        const size_t levels = getFenceCounts(section.count, fenceCounts);
+        size_t offsets[maxFenceLevels];
+        for (size_t level = 0, offset = 0; level < levels; offset += fenceCounts[level++]) {
+            offsets[level] = offset;
+        }
+
+        // narrow the positions the result can take from the top level down:
+        // the first record not smaller than the key is after every fence key
+        // smaller than the key's and at or before every greater one
+        size_t first = 0, last = section.count;
+        for (size_t level = levels; level-- > 0;) {
+            const char* fences = section.fences + offsets[level] * 8;
+            const size_t shift = (level + 1) * fenceShift;
+            const size_t stride = size_t(1) << shift;
+            const size_t begin = (first + stride - 1) >> shift;
+            const size_t end = std::min<size_t>(fenceCounts[level], (last >> shift) + 1);
+            size_t lower = begin, upper = end;
+            while (lower < upper) {
+                const size_t middle = lower + (upper - lower) / 2;
+                if (detail::readNumber<uint64_t>(fences + middle * 8) < target) {
+                    lower = middle + 1;
+                } else {
+                    upper = middle;
+                }
+            }
+            if (lower > begin) {
+                first = std::max(first, (lower - 1) * stride + 1);
+            }
+            upper = end;
+            while (lower < upper) {
+                const size_t middle = lower + (upper - lower) / 2;
+                if (detail::readNumber<uint64_t>(fences + middle * 8) <= target) {
+                    lower = middle + 1;
+                } else {
+                    upper = middle;
+                }
+            }
+            if (lower < end) {
+                last = std::min(last, lower * stride);
+            }
+        }
+        while (first < last) {
+            const size_t middle = first + (last - first) / 2;
+            if (std::memcmp(section.records + middle * width, key, width) < 0) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return first;
+    }
+
+    /// Returns the number of IBANs of a country that are ordered before all
+    /// IBANs starting with the country code followed by \p rest
+    size_t PrefixIndex::lowerBoundInCountry(size_t country, StringView rest) const noexcept {
+        const Section& section = m_sections[country];
+        if (section.count == 0) {
+            return 0;
+        }
+        char iban[maxIBANLength];
+        iban[0] = static_cast<char>('A' + country / 26);
+        iban[1] = static_cast<char>('A' + country % 26);
+        uint8_t classes[2 + maxBBANLength];
+        const size_t length = getClasses(*getBBANStructure(iban[0], iban[1]), classes);
+
+        // the smallest IBAN of the country which is not ordered before the
+        // prefix: copy the matching characters, then raise the first one that
+        // does not match, or the one before it if it cannot be raised
+        char* target = iban + 2;
+        const size_t prefixLength = std::min(rest.size(), length);
+        size_t i = 0;
+        while (i < prefixLength && (BBANStructure::classify(rest[i]) & classes[i])) {
+            target[i] = rest[i];
+            ++i;
+        }
+        size_t fill = i + 1;
+        if (i == prefixLength && rest.size() <= length) {
+            fill = i;
+        } else if (i == prefixLength || !getNextCharacter(classes[i], rest[i], target[i])) {
+            while (i > 0 && !getNextCharacter(classes[i - 1], target[i - 1], target[i - 1])) {
+                --i;
+            }
+            if (i == 0) {
+                return section.count;
+            }
+            fill = i;
+        }
+        for (; fill < length; ++fill) {
+            target[fill] = getMinCharacter(classes[fill]);
+        }
+
+        PackedIBAN packed;
+        PackedIBAN::pack(StringView(iban, 2 + length), packed);
+        return findInSection(section, packed.data() + 1);
+    }
+
+    /**
+     * Returns the IBAN at a position.
+     *
+     * @param position The position
+     * @return The IBAN or an empty IBAN if \p position is not less than
+     * \p size()
+     */
+    CompactIBAN PrefixIndex::getIBAN(size_t position) const noexcept {
+        CompactIBAN result;
+        if (position >= m_count) {
+            return result;
+        }
+        const auto country = std::upper_bound(m_countries.begin(), m_countries.end(), position,
+                                              [this](size_t value, uint16_t index) {
+                                                  return value < m_sections[index].first;
+                                              }) - 1;
+        const Section& section = m_sections[*country];
+        uint8_t data[maxPackedIBANSize];
+        data[0] = section.prefix;
+        std::memcpy(data + 1, section.records + (position - section.first) * section.width,
+                    section.width);
+        PackedIBAN(data, section.width + 1).unpack(result);
+        return result;
+    }
+
+    /**
+     * Tests if the index contains an IBAN.
+     *
+     * @param machineForm The IBAN in machine form
+     * @return \p true if the IBAN is contained
+     */
+    bool PrefixIndex::contains(StringView machineForm) const noexcept {
+        PackedIBAN packed;
+        if (!PackedIBAN::pack(machineForm, packed)) {
+            return false;
+        }
+        const Section& section = m_sections[getCountryIndex(machineForm[0], machineForm[1])];
+        const size_t position = findInSection(section, packed.data() + 1);
+        return position < section.count &&
+               std::memcmp(section.records + position * section.width, packed.data() + 1,
+                           section.width) == 0;
+    }
+
+    /**
+     * Tests if the index contains an IBAN.
+     *
+     * @param iban The IBAN
+     * @return \p true if the IBAN is contained
+     */
+    bool PrefixIndex::contains(const CompactIBAN& iban) const noexcept {
+        return contains(iban.getMachineForm());
+    }
+
+    /**
+     * Returns the position of the first IBAN that is not ordered before the
+     * IBANs starting with a prefix, comparing the machine forms bytewise.
+     *
+     * @param prefix The prefix of the machine form, of any length
+     * @return The position of the first IBAN starting with \p prefix or
+     * ordered after it
+     */
+    size_t PrefixIndex::lowerBound(StringView prefix) const noexcept {
+        if (prefix.empty()) {
+            return 0;
+        }
+        const unsigned first = static_cast<unsigned char>(prefix[0]);
+        if (first < 'A') {
+            return 0;
+        }
+        if (first > 'Z') {
+            return m_count;
+        }
+        const size_t letter = (first - 'A') * 26;
+        if (prefix.size() == 1) {
+            return m_sections[letter].first;
+        }
+        const unsigned second = static_cast<unsigned char>(prefix[1]);
+        if (second < 'A' || second > 'Z') {
+            return m_sections[second < 'A' ? letter : letter + 26].first;
+        }
+        const size_t country = letter + (second - 'A');
+        if (prefix.size() == 2) {
+            return m_sections[country].first;
+        }
+        return m_sections[country].first +
+               lowerBoundInCountry(country, StringView(prefix.data() + 2, prefix.size() - 2));
+    }
+
+    /**
+     * Returns the position after the last IBAN that is not ordered after the
+     * IBANs starting with a prefix, comparing the machine forms bytewise.
+     *
+     * @param prefix The prefix of the machine form, of any length
+     * @return The position of the first IBAN ordered after \p prefix and not
+     * starting with it
+     */
+    size_t PrefixIndex::upperBound(StringView prefix) const noexcept {
+        if (prefix.size() > maxIBANLength) {
+            // no IBAN starts with the prefix
+            return lowerBound(prefix);
+        }
+        // the IBANs ordered before the smallest string greater than all
+        // strings starting with the prefix
+        char successor[maxIBANLength];
+        size_t length = prefix.size();
+        std::memcpy(successor, prefix.data(), length);
+        while (length > 0 && static_cast<unsigned char>(successor[length - 1]) == 0xFF) {
+            --length;
+        }
+        if (length == 0) {
+            return m_count;
+        }
+        successor[length - 1] = static_cast<char>(static_cast<unsigned char>(successor[length - 1]) + 1);
+        return lowerBound(StringView(successor, length));
+    }
+
+    /**
+     * Finds the IBANs starting with a prefix, e.g. \p "DE" for all German
+     * IBANs or \p "DE893704" for the German IBANs with check digits 89 and a
+     * BBAN starting with 3704.
+     *
+     * @param prefix The prefix of the machine form
+     * @return The range of the IBANs starting with \p prefix
+     */
+    IndexRange PrefixIndex::findPrefix(StringView prefix) const noexcept {
+        return IndexRange{lowerBound(prefix), upperBound(prefix)};
+    }
+
+    /**
+     * Finds the IBANs between two bounds, where bounds shorter than an IBAN
+     * are treated as prefixes: the range starts with the first IBAN starting
+     * with \p first or ordered after it and ends with the last IBAN starting
+     * with \p last or ordered before it.
+     *
+     * @param first The lower bound
+     * @param last The upper bound
+     * @return The range of the IBANs between the bounds; empty if \p last is
+     * ordered before \p first
+     */
+    IndexRange PrefixIndex::findRange(StringView first, StringView last) const noexcept {
+        const size_t begin = lowerBound(first);
+        return IndexRange{begin, std::max(begin, upperBound(last))};
+    }
+
+    /**
+     * Finds the IBANs of a bank. The bank code follows the check digits in
+     * the IBANs, so the IBANs of a bank form a range per check digits and per
+     * combination of the BBAN characters before the bank code (as the CIN of
+     * IT and SM), which are looked up one after the other.
+     *
+     * @param countryCode The country code
+     * @param bankCode The bank code
+     * @return The non-empty ranges of the IBANs of the bank in ascending
+     * order; empty if the country has no bank codes or \p bankCode does not
+     * match them
+     */
+    std::vector<IndexRange> PrefixIndex::findBank(StringView countryCode, StringView bankCode) const {
+        std::vector<IndexRange> result;
+        const BBANStructure* structure = countryCode.size() == 2 ?
+                getBBANStructure(countryCode[0], countryCode[1]) : nullptr;
+        if (!structure || structure->bankLength == 0 || bankCode.size() != structure->bankLength) {
+            return result;
+        }
+        uint8_t classes[2 + maxBBANLength];
+        getClasses(*structure, classes);
+        const size_t fixed = 2u + structure->bankOffset;
+        char prefix[maxIBANLength];
+        std::memcpy(prefix, countryCode.data(), 2);
+        for (size_t i = 0; i < fixed; ++i) {
+            prefix[2 + i] = getMinCharacter(classes[i]);
+        }
+        for (size_t i = 0; i < bankCode.size(); ++i) {
+            if ((BBANStructure::classify(bankCode[i]) & classes[fixed + i]) == 0) {
+                return result;
+            }
+            prefix[2 + fixed + i] = bankCode[i];
+        }
+
+        // count through the characters before the bank code like an odometer
+        size_t position;
+        do {
+            const IndexRange range = findPrefix(StringView(prefix, 2 + fixed + bankCode.size()));
+            if (!range.empty()) {
+                if (!result.empty() && result.back().last == range.first) {
+                    result.back().last = range.last;
+                } else {
+                    result.push_back(range);
+                }
+            }
+            position = fixed;
+            while (position > 0 && !getNextCharacter(classes[position - 1], prefix[position + 1],
+                                                     prefix[position + 1])) {
+                --position;
+                prefix[2 + position] = getMinCharacter(classes[position]);
+            }
+        } while (position > 0);
+        return result;
+    }
+
+}
@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        prefixindex.h
+ * \brief       Read-only sorted index for prefix and range queries over IBANs
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p PrefixIndex, a read-only index over large sets
+ * of IBANs answering membership tests, prefix queries, range queries and bank
+ * code queries, and the \p PrefixIndexBuilder writing its snapshot files.
+ */
+
+#ifndef LIBIBAN_PREFIXINDEX_H
+#define LIBIBAN_PREFIXINDEX_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "libiban.h"
+
+namespace IBAN {
+
+/// Half-open range of positions of a \p PrefixIndex
+struct IndexRange {
+    /// The first position of the range
+    size_t first;
+    /// The position after the last one of the range
+    size_t last;
+
+    /// Returns the number of IBANs in the range
+    size_t size() const noexcept { return last - first; }
+    /// Returns \p true if the range does not contain any IBAN
+    bool empty() const noexcept { return first == last; }
+};
+
+/**
+ * Collects IBANs and writes them as a snapshot for \p PrefixIndex. The IBANs
+ * are held in their packed form (see \p PackedIBAN) without the first byte,
+ * which only depends on the country, so about 11 bytes per IBAN are needed
+ * for most countries. IBANs added more than once are stored once.
+ */
+class PrefixIndexBuilder {
+public:
+    PrefixIndexBuilder();
+    void add(StringView machineForm);
+    void add(const CompactIBAN& iban);
+    void add(const CompactIBAN* ibans, size_t count);
+    /// Returns the number of IBANs added, including duplicates
+    size_t size() const noexcept { return m_size; }
+    std::vector<char> build() const;
+    void write(const std::string& path) const;
+
+private:
+    /// Holds the packed IBANs without their first byte per country, in the
+    /// order they were added
+    std::vector<std::vector<uint8_t>> m_records;
+    /// Holds the number of IBANs added
+    size_t m_size;
+};
+
+/**
+ * Read-only index over a set of IBANs, loaded from a snapshot written by
+ * \p PrefixIndexBuilder. The IBANs are ordered like their machine forms and
+ * addressed by their position in that order, so prefix and range queries
+ * result in ranges of positions. Snapshot files are memory mapped and opening
+ * an index only reads its header, regardless of the number of IBANs.
+ *
+ * The IBANs of a country are stored as an array of packed IBANs of the fixed
+ * size of the country. The first 8 bytes of every 64th of them are repeated
+ * as fence key, those of every 64th of these in a second level and so on up
+ * to a level of at most 64 keys. A lookup walks down the levels, whose upper
+ * ones stay in the cache, and ends in one or two blocks of 64 records.
+ *
+ * The snapshot consists of a 24 byte header ("IBANIDX1", the number of IBANs
+ * and the size of the snapshot as 64 bit numbers), a table of 40 bytes per
+ * country code (the position of the country's first IBAN, the number of its
+ * IBANs, the size of their records and the offsets of the records and of the
+ * fence keys as 64 bit numbers), and the records and fence keys of the
+ * countries, the fence keys level by level starting with the lowest one.
+ * Numbers are stored in host byte order.
+ */
+class PrefixIndex {
+public:
+    static std::unique_ptr<PrefixIndex> open(const std::string& path);
+    static std::unique_ptr<PrefixIndex> fromBuffer(std::vector<char> snapshot);
+    ~PrefixIndex();
+
+    PrefixIndex(const PrefixIndex&) = delete;
+    PrefixIndex& operator=(const PrefixIndex&) = delete;
+
+    /// Returns the number of IBANs
+    size_t size() const noexcept { return m_count; }
+    CompactIBAN getIBAN(size_t position) const noexcept;
+    bool contains(StringView machineForm) const noexcept;
+    bool contains(const CompactIBAN& iban) const noexcept;
+    size_t lowerBound(StringView prefix) const noexcept;
+    size_t upperBound(StringView prefix) const noexcept;
+    IndexRange findPrefix(StringView prefix) const noexcept;
+    IndexRange findRange(StringView first, StringView last) const noexcept;
+    std::vector<IndexRange> findBank(StringView countryCode, StringView bankCode) const;
+
+    /**
+     * Calls a function for the IBANs of a range in their order.
+     *
+     * @param range The range, e.g. as returned by \p findPrefix()
+     * @param function The function taking a <tt>const CompactIBAN&</tt>
+     */
+    template <class Function>
+    void forEach(IndexRange range, Function function) const {
+        for (size_t i = range.first; i < range.last; ++i) {
+            function(getIBAN(i));
+        }
+    }
+
+private:
+    /// IBANs of a country
+    struct Section {
+        /// Points to the records
+        const char* records;
+        /// Points to the fence keys
+        const char* fences;
+        /// Position of the first IBAN
+        size_t first;
+        /// Number of IBANs
+        size_t count;
+        /// Size of a record
+        size_t width;
+        /// First byte of the packed IBANs, which is not stored
+        uint8_t prefix;
+    };
+
+    PrefixIndex() noexcept;
+    void load(const char* data, size_t size);
+    size_t findInSection(const Section& section, const uint8_t* key) const noexcept;
+    size_t lowerBoundInCountry(size_t country, StringView rest) const noexcept;
+
+    /// Holds the snapshot if it was passed as buffer
+    std::vector<char> m_buffer;
+    /// Holds the mapping of the snapshot file or \p nullptr
+    void* m_mapping;
+    /// Holds the size of \p m_mapping
+    size_t m_mappingSize;
+    /// Holds the number of IBANs
+    size_t m_count;
+    /// Holds the sections per country code and one past the last with the
+    /// position \p m_count
+    std::vector<Section> m_sections;
+    /// Holds the indices of the countries with IBANs in the order of their
+    /// positions
+    std::vector<uint16_t> m_countries;
+};
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_PREFIXINDEX_H
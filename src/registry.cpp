@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        registry.cpp
+ * \brief       Source file defining the compiled-in country registry
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file provides the definitions of the country registry tables.
+ */
+
+#include "registry.h"
+#include <cstring>
+
+namespace IBAN {
+
+    // the tables are initialized in the header; C++11 requires a definition
+    constexpr uint8_t CountryRegistry::lengths[countryCodeCount];
+    constexpr CountryFormat CountryRegistry::formats[];
+
+    namespace {
+        /// The compiled structures of all formats in \p CountryRegistry
+        struct StructureTable {
+            /// Index into \p structures plus one per country code; 0 if the
+            /// country is unknown
+            uint8_t slots[countryCodeCount];
+            /// The compiled structures
+            BBANStructure structures[countryFormatCount];
+
+            StructureTable() noexcept : slots(), structures() {
+                for (size_t i = 0; i < countryFormatCount; ++i) {
+                    const CountryFormat& format = CountryRegistry::formats[i];
+                    if (!compileBBANFormat(format.bban, structures[i])) {
+                        continue;
+                    }
+                    structures[i].bankOffset = format.bankOffset;
+                    structures[i].bankLength = format.bankLength;
+                    structures[i].branchOffset = format.branchOffset;
+                    structures[i].branchLength = format.branchLength;
+                    slots[getCountryIndex(format.countryCode[0], format.countryCode[1])] =
+                            static_cast<uint8_t>(i + 1);
+                }
+            }
+        };
+
+        static_assert(countryFormatCount < 255, "slots of StructureTable overflow");
+
+        /// Returns the structure table, which is compiled on first use
+        const StructureTable& getStructureTable() noexcept {
+            static const StructureTable table;
+            return table;
+        }
+    }
+
+    /**
+     * Compiles a BBAN format in SWIFT notation (e.g. "4!a6!n8!n") into a
+     * \p BBANStructure. The format consists of groups of a length followed by
+     * an optional '!' and one of the character classes 'n' (digits),
+     * 'a' (uppercase letters) or 'c' (both). Bank and branch code positions of
+     * \p result are reset.
+     *
+     * @param format The null terminated format string
+     * @param result The structure receiving the compiled format
+     * @return \p false if \p format is malformed or longer than
+     * \p maxBBANLength, in which case \p result is left unchanged
+     */
+    bool compileBBANFormat(const char* format, BBANStructure& result) noexcept {
+        BBANStructure structure = {};
+        size_t length = 0;
+        const char* p = format;
+        while (*p != '\0') {
+            size_t count = 0;
+            for (; *p >= '0' && *p <= '9'; ++p) {
+                count = count * 10 + static_cast<size_t>(*p - '0');
+                if (count > maxBBANLength) {
+                    return false;
+                }
+            }
+            if (*p == '!') {
+                ++p;
+            }
+            uint8_t charClass = 0;
+            switch (*p) {
+                case 'n': charClass = BBANStructure::Digit; break;
+                case 'a': charClass = BBANStructure::Letter; break;
+                case 'c': charClass = BBANStructure::Alphanumeric; break;
+                default: return false;
+            }
+            ++p;
+            if (count == 0 || length + count > maxBBANLength) {
+                return false;
+            }
+            std::memset(structure.classes + length, charClass, count);
+            length += count;
+        }
+        if (length == 0) {
+            return false;
+        }
+        structure.length = static_cast<uint8_t>(length);
+        result = structure;
+        return true;
+    }
+
+    /**
+     * Returns the BBAN structure of a country. The structures of all countries
+     * are compiled on the first call.
+     *
+     * @param first The first letter of the country code
+     * @param second The second letter of the country code
+     * @return The structure of the country's BBANs or \p nullptr if the
+     * country is unknown
+     */
+    const BBANStructure* getBBANStructure(char first, char second) noexcept {
+        const size_t index = getCountryIndex(first, second);
+        if (index == countryCodeCount) {
+            return nullptr;
+        }
+        const StructureTable& table = getStructureTable();
+        const size_t slot = table.slots[index];
+        return slot == 0 ? nullptr : &table.structures[slot - 1];
+    }
+
+}
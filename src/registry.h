@@ -0,0 +1,250 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        registry.h
+ * \brief       Header file declaring the compiled-in country registry
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the registry of IBAN countries. The registry is a
+ * dense table indexed by the two letters of the country code, so looking up a
+ * country neither hashes nor allocates and the table is available at compile
+ * time.
+ */
+
+#ifndef LIBIBAN_REGISTRY_H
+#define LIBIBAN_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace IBAN {
+
+/// Number of possible country codes (two uppercase latin letters)
+constexpr size_t countryCodeCount = 26 * 26;
+
+/// Maximum length of a BBAN
+constexpr size_t maxBBANLength = 30;
+
+/// Format of the BBANs of a country as published in the SWIFT IBAN registry
+struct CountryFormat {
+    /// The country code
+    char countryCode[3];
+    /// The BBAN format, e.g. "8!n10!n": fixed length groups of digits (n),
+    /// uppercase letters (a) or both (c)
+    const char* bban;
+    /// Position of the bank code within the BBAN
+    uint8_t bankOffset;
+    /// Length of the bank code
+    uint8_t bankLength;
+    /// Position of the branch code within the BBAN
+    uint8_t branchOffset;
+    /// Length of the branch code; 0 if the country does not have branch codes
+    uint8_t branchLength;
+};
+
+/// Compiled-in registry of the countries supporting IBAN
+struct CountryRegistry {
+    /// IBAN length per country code, indexed by \p getCountryIndex(); 0 if
+    /// the country does not support IBAN
+    static constexpr uint8_t lengths[countryCodeCount] = {
+    //   A   B   C   D   E   F   G   H   I   J   K   L   M   N   O   P   Q   R   S   T   U   V   W   X   Y   Z
+         0,  0,  0, 24, 23,  0,  0,  0,  0,  0,  0, 28,  0,  0, 25,  0,  0,  0,  0, 20,  0,  0,  0,  0,  0, 28,  // A
+        20,  0,  0,  0, 16, 28, 22, 22, 16, 28,  0,  0,  0,  0,  0,  0,  0, 29,  0,  0,  0,  0,  0,  0, 28,  0,  // B
+         0,  0,  0,  0,  0, 27, 27, 21, 28,  0,  0,  0, 27,  0,  0,  0,  0, 22,  0,  0,  0, 25,  0,  0, 28, 24,  // C
+         0,  0,  0,  0, 22,  0,  0,  0,  0, 27, 18,  0,  0,  0, 28,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 24,  // D
+         0,  0,  0,  0, 20,  0, 27,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 24,  0,  0,  0,  0,  0,  0,  0,  // E
+         0,  0,  0,  0,  0,  0,  0,  0, 18,  0,  0,  0,  0,  0, 18,  0,  0, 27,  0,  0,  0,  0,  0,  0,  0,  0,  // F
+        27, 22,  0,  0, 22,  0,  0,  0, 23,  0,  0, 18,  0,  0,  0,  0, 27, 27,  0, 28,  0,  0, 25,  0,  0,  0,  // G
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 28,  0,  0,  0, 21,  0,  0, 28,  0,  0,  0,  0,  0,  // H
+         0,  0,  0,  0, 22,  0,  0,  0,  0,  0,  0, 23,  0,  0,  0,  0, 23, 26, 26, 27,  0,  0,  0,  0,  0,  0,  // I
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 30,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // J
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 27,  0,  0,  0,  0,  0,  0,  0,  0,  0, 30,  0,  0, 20,  // K
+         0, 28, 32,  0,  0,  0,  0,  0, 21,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 20, 20, 21,  0,  0,  0,  0,  // L
+        28,  0, 27, 24, 22,  0, 27,  0,  0,  0, 19, 28,  0,  0,  0,  0,  0, 27,  0, 31, 30,  0,  0,  0,  0, 25,  // M
+         0,  0,  0,  0, 28,  0,  0,  0, 32,  0,  0, 18,  0,  0, 15,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // N
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // O
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 24, 28,  0,  0,  0,  0,  0,  0, 29, 25,  0,  0,  0,  0,  0,  0,  // P
+        29,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // Q
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 24,  0,  0,  0, 22,  0,  0,  0,  0,  0,  0,  0,  // R
+        24,  0, 31,  0, 24,  0,  0,  0, 19,  0, 24,  0, 27, 28,  0,  0,  0,  0,  0, 25,  0, 28,  0,  0,  0,  0,  // S
+         0,  0,  0, 27,  0,  0, 28,  0,  0,  0,  0, 23,  0, 24,  0,  0,  0, 26,  0,  0,  0,  0,  0,  0,  0,  0,  // T
+        29,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // U
+         0,  0,  0,  0,  0,  0, 24,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // V
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // W
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 20,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // X
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // Y
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // Z
+    };
+
+    /// BBAN formats of all countries supporting IBAN, ordered by country code
+    static constexpr CountryFormat formats[] = {
+        {"AD", "4!n4!n12!c", 0, 4, 4, 4},        {"AE", "3!n16!n", 0, 3, 0, 0},
+        {"AL", "8!n16!c", 0, 3, 3, 4},           {"AO", "21!n", 0, 4, 4, 4},
+        {"AT", "5!n11!n", 0, 5, 0, 0},           {"AZ", "4!a20!c", 0, 4, 0, 0},
+        {"BA", "3!n3!n8!n2!n", 0, 3, 3, 3},      {"BE", "3!n7!n2!n", 0, 3, 0, 0},
+        {"BF", "2!c22!n", 0, 5, 5, 5},           {"BG", "4!a4!n2!n8!c", 0, 4, 4, 4},
+        {"BH", "4!a14!c", 0, 4, 0, 0},           {"BI", "12!n", 0, 5, 5, 5},
+        {"BJ", "2!c22!n", 0, 5, 5, 5},           {"BR", "8!n5!n10!n1!a1!c", 0, 8, 8, 5},
+        {"BY", "4!c4!n16!c", 0, 4, 0, 0},        {"CF", "23!n", 0, 5, 5, 5},
+        {"CG", "23!n", 0, 5, 5, 5},              {"CH", "5!n12!c", 0, 5, 0, 0},
+        {"CI", "2!c22!n", 0, 5, 5, 5},           {"CM", "23!n", 0, 5, 5, 5},
+        {"CR", "4!n14!n", 0, 4, 0, 0},           {"CV", "21!n", 0, 4, 4, 4},
+        {"CY", "3!n5!n16!c", 0, 3, 3, 5},        {"CZ", "4!n6!n10!n", 0, 4, 0, 0},
+        {"DE", "8!n10!n", 0, 8, 0, 0},           {"DJ", "23!n", 0, 5, 5, 5},
+        {"DK", "4!n9!n1!n", 0, 4, 0, 0},         {"DO", "4!c20!n", 0, 4, 0, 0},
+        {"DZ", "20!n", 0, 3, 3, 5},              {"EE", "2!n2!n11!n1!n", 0, 2, 0, 0},
+        {"EG", "23!n", 0, 4, 4, 4},              {"ES", "4!n4!n1!n1!n10!n", 0, 4, 4, 4},
+        {"FI", "3!n11!n", 0, 3, 0, 0},           {"FO", "4!n9!n1!n", 0, 4, 0, 0},
+        {"FR", "5!n5!n11!c2!n", 0, 5, 5, 5},     {"GA", "23!n", 0, 5, 5, 5},
+        {"GB", "4!a6!n8!n", 0, 4, 4, 6},         {"GE", "2!a16!n", 0, 2, 0, 0},
+        {"GI", "4!a15!c", 0, 4, 0, 0},           {"GL", "4!n9!n1!n", 0, 4, 0, 0},
+        {"GQ", "23!n", 0, 5, 5, 5},              {"GR", "3!n4!n16!c", 0, 3, 3, 4},
+        {"GT", "4!c20!c", 0, 4, 0, 0},           {"GW", "2!c19!n", 0, 4, 4, 4},
+        {"HN", "4!a20!n", 0, 4, 0, 0},           {"HR", "7!n10!n", 0, 7, 0, 0},
+        {"HU", "3!n4!n1!n15!n1!n", 0, 3, 3, 4},  {"IE", "4!a6!n8!n", 0, 4, 4, 6},
+        {"IL", "3!n3!n13!n", 0, 3, 3, 3},        {"IQ", "4!a3!n12!n", 0, 4, 4, 3},
+        {"IR", "22!n", 0, 3, 0, 0},              {"IS", "4!n2!n6!n10!n", 0, 2, 2, 2},
+        {"IT", "1!a5!n5!n12!c", 1, 5, 6, 5},     {"JO", "4!a4!n18!c", 0, 4, 4, 4},
+        {"KM", "23!n", 0, 5, 5, 5},              {"KW", "4!a22!c", 0, 4, 0, 0},
+        {"KZ", "3!n13!c", 0, 3, 0, 0},           {"LB", "4!n20!c", 0, 4, 0, 0},
+        {"LC", "4!a24!c", 0, 4, 0, 0},           {"LI", "5!n12!c", 0, 5, 0, 0},
+        {"LT", "5!n11!n", 0, 5, 0, 0},           {"LU", "3!n13!c", 0, 3, 0, 0},
+        {"LV", "4!a13!c", 0, 4, 0, 0},           {"MA", "24!n", 0, 3, 3, 5},
+        {"MC", "5!n5!n11!c2!n", 0, 5, 5, 5},     {"MD", "2!c18!c", 0, 2, 0, 0},
+        {"ME", "3!n13!n2!n", 0, 3, 0, 0},        {"MG", "23!n", 0, 5, 5, 5},
+        {"MK", "3!n10!c2!n", 0, 3, 0, 0},        {"ML", "2!c22!n", 0, 5, 5, 5},
+        {"MR", "5!n5!n11!n2!n", 0, 5, 5, 5},     {"MT", "4!a5!n18!c", 0, 4, 4, 5},
+        {"MU", "4!a2!n2!n12!n3!n3!a", 0, 6, 6, 2}, {"MZ", "21!n", 0, 4, 4, 4},
+        {"NE", "2!c22!n", 0, 5, 5, 5},           {"NI", "4!a24!n", 0, 4, 0, 0},
+        {"NL", "4!a10!n", 0, 4, 0, 0},           {"NO", "4!n6!n1!n", 0, 4, 0, 0},
+        {"PK", "4!a16!c", 0, 4, 0, 0},           {"PL", "8!n16!n", 0, 8, 0, 0},
+        {"PS", "4!a21!c", 0, 4, 0, 0},           {"PT", "4!n4!n11!n2!n", 0, 4, 4, 4},
+        {"QA", "4!a21!c", 0, 4, 0, 0},           {"RO", "4!a16!c", 0, 4, 0, 0},
+        {"RS", "3!n13!n2!n", 0, 3, 0, 0},        {"SA", "2!n18!c", 0, 2, 0, 0},
+        {"SC", "4!a2!n2!n16!n3!a", 0, 6, 6, 2},  {"SE", "3!n16!n1!n", 0, 3, 0, 0},
+        {"SI", "5!n8!n2!n", 0, 5, 0, 0},         {"SK", "4!n6!n10!n", 0, 4, 0, 0},
+        {"SM", "1!a5!n5!n12!c", 1, 5, 6, 5},     {"SN", "2!c22!n", 0, 5, 5, 5},
+        {"ST", "4!n4!n11!n2!n", 0, 4, 4, 4},     {"SV", "4!a20!n", 0, 4, 0, 0},
+        {"TD", "23!n", 0, 5, 5, 5},              {"TG", "2!c22!n", 0, 5, 5, 5},
+        {"TL", "3!n14!n2!n", 0, 3, 0, 0},        {"TN", "2!n3!n13!n2!n", 0, 2, 2, 3},
+        {"TR", "5!n1!n16!c", 0, 5, 0, 0},        {"UA", "6!n19!c", 0, 6, 0, 0},
+        {"VG", "4!a16!n", 0, 4, 0, 0},           {"XK", "4!n10!n2!n", 0, 2, 2, 2},
+    };
+};
+
+/// Number of entries of \p CountryRegistry::formats
+constexpr size_t countryFormatCount = sizeof(CountryRegistry::formats) /
+                                      sizeof(CountryRegistry::formats[0]);
+
+/// Structure of the BBANs of a country, compiled from a \p CountryFormat
+struct BBANStructure {
+    /// Character classes, usable as bit mask
+    enum CharacterClass : uint8_t {
+        Digit = 1,
+        Letter = 2,
+        Alphanumeric = Digit | Letter
+    };
+
+    /// Length of the BBAN
+    uint8_t length;
+    /// Position of the bank code within the BBAN
+    uint8_t bankOffset;
+    /// Length of the bank code
+    uint8_t bankLength;
+    /// Position of the branch code within the BBAN
+    uint8_t branchOffset;
+    /// Length of the branch code
+    uint8_t branchLength;
+    /// Allowed character classes per position of the BBAN
+    uint8_t classes[maxBBANLength];
+
+    /**
+     * Returns the character class of \p ch: \p Digit for decimal digits,
+     * \p Letter for uppercase latin letters and 0 otherwise.
+     *
+     * @param ch The character to classify
+     * @return The character class of \p ch
+     */
+    static uint8_t classify(char ch) noexcept {
+        const unsigned c = static_cast<unsigned char>(ch);
+        return static_cast<uint8_t>((c - '0' < 10u ? Digit : 0) |
+                                    (c - 'A' < 26u ? Letter : 0));
+    }
+
+    /**
+     * Tests if a BBAN matches the structure in a single scan without branching
+     * on the characters.
+     *
+     * @param bban The BBAN to test
+     * @param size The length of \p bban
+     * @return \p true if \p bban matches, \p false otherwise
+     */
+    bool matches(const char* bban, size_t size) const noexcept {
+        if (size != length) {
+            return false;
+        }
+        unsigned mismatch = 0;
+        for (size_t i = 0; i < size; ++i) {
+            mismatch |= (classify(bban[i]) & classes[i]) == 0;
+        }
+        return mismatch == 0;
+    }
+};
+
+bool compileBBANFormat(const char* format, BBANStructure& result) noexcept;
+const BBANStructure* getBBANStructure(char first, char second) noexcept;
+
+/**
+ * Returns the index of a country code in the registry tables, which is the
+ * country code read as a two digit number in base 26. Indices are ordered like
+ * the country codes.
+ *
+ * @param first The first letter of the country code
+ * @param second The second letter of the country code
+ * @return The index of the country code or \p countryCodeCount if the
+ * characters are not uppercase latin letters
+ */
+constexpr size_t getCountryIndex(char first, char second) noexcept {
+    return (first >= 'A' && first <= 'Z' && second >= 'A' && second <= 'Z') ?
+           static_cast<size_t>(first - 'A') * 26 + static_cast<size_t>(second - 'A') :
+           countryCodeCount;
+}
+
+/**
+ * Returns the IBAN length required for a country.
+ *
+ * @param first The first letter of the country code
+ * @param second The second letter of the country code
+ * @return The required IBAN length or 0 if the country code is unknown
+ */
+constexpr size_t getIBANLength(char first, char second) noexcept {
+    return getCountryIndex(first, second) < countryCodeCount ?
+           CountryRegistry::lengths[getCountryIndex(first, second)] : 0;
+}
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_REGISTRY_H
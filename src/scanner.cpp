@@ -0,0 +1,262 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        scanner.cpp
+ * \brief       Source file implementing the streaming IBAN scanner
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p IBANScanner. The scanner is an automaton
+ * whose state is the current candidate: the country, the position within the
+ * IBAN, whether the IBAN is grouped and the remainder of the BBAN so far. Its
+ * transitions are taken from the BBAN structures of the registry, which give
+ * the allowed character class at each position. A candidate starts at a
+ * letter following a character other than a letter or digit, and it ends
+ * without match at the first character the structure does not allow; this
+ * character may start the next candidate.
+ */
+
+#include "scanner.h"
+#include "national.h"
+
+namespace IBAN {
+
+    namespace {
+        /// Size of the chunks \p scanStream() reads at once
+        constexpr size_t streamChunkSize = 64 * 1024;
+
+        /// Tests if \p ch is an ASCII letter or digit
+        inline bool isAlphanumeric(char ch) noexcept {
+            const unsigned c = static_cast<unsigned char>(ch);
+            return c - '0' < 10u || (c | 0x20u) - 'a' < 26u;
+        }
+
+        /// Returns the numerical value of a digit or letter of the check sum
+        inline uint32_t getValue(char ch) noexcept {
+            return ch <= '9' ? static_cast<uint32_t>(ch - '0') : static_cast<uint32_t>(ch - 'A' + 10);
+        }
+    }
+
+    /**
+     * Creates a scanner at the beginning of a stream.
+     *
+     * @param handler Function called for every IBAN found, in the order of the
+     * stream
+     * @param options The options of the scanner
+     */
+    IBANScanner::IBANScanner(MatchHandler handler, const ScannerOptions& options) :
+            m_handler(std::move(handler)), m_options(options) {}
+
+    /**
+     * Scans the next chunk of the stream. \p handler is called for every IBAN
+     * ending in the chunk, except for an IBAN ending at the last character of
+     * the chunk, which is only reported once the following character is known
+     * (or by \p finish()).
+     *
+     * @param data The characters of the chunk
+     * @param size The number of characters
+     */
+    void IBANScanner::feed(const char* data, size_t size) {
+        const uint64_t base = m_offset;
+        for (size_t i = 0; i < size; ++i) {
+            const char ch = data[i];
+            // fast path for the text between the candidates
+            if (m_length == 0 && (m_previousAlphanumeric || !isAlphanumeric(ch))) {
+                m_previousAlphanumeric = isAlphanumeric(ch);
+                continue;
+            }
+            process(ch, base + i);
+        }
+        m_offset = base + size;
+    }
+
+    /**
+     * Ends the stream, reporting an IBAN at its very end, and resets the
+     * scanner for the next stream.
+     */
+    void IBANScanner::finish() {
+        if (m_length != 0 && m_length == m_expectedLength) {
+            m_handler(IBANMatch{m_start, static_cast<size_t>(m_offset - m_start),
+                                CompactIBAN(StringView(m_candidate, m_length))});
+        }
+        m_offset = 0;
+        m_previousAlphanumeric = false;
+        m_length = 0;
+    }
+
+    /**
+     * Processes one character.
+     *
+     * @param ch The character
+     * @param offset The offset of \p ch in the stream
+     */
+    void IBANScanner::process(char ch, uint64_t offset) {
+        if (m_length != 0 && advance(ch, offset)) {
+            m_previousAlphanumeric = isAlphanumeric(ch);
+            return;
+        }
+        // the candidate ended, maybe the character starts the next one
+        if (!m_previousAlphanumeric && isAlphanumeric(ch)) {
+            startCandidate(ch, offset);
+        }
+        m_previousAlphanumeric = isAlphanumeric(ch);
+    }
+
+    /**
+     * Starts a candidate if \p ch is a letter.
+     *
+     * @param ch The first character of the candidate
+     * @param offset The offset of \p ch in the stream
+     */
+    void IBANScanner::startCandidate(char ch, uint64_t offset) noexcept {
+        if (m_options.allowLowercase && ch >= 'a' && ch <= 'z') {
+            ch = static_cast<char>(ch - 'a' + 'A');
+        }
+        if (ch < 'A' || ch > 'Z') {
+            return;
+        }
+        m_start = offset;
+        m_candidate[0] = ch;
+        m_length = 1;
+        m_remainder = 0;
+        m_grouped = -1;
+        m_afterSpace = false;
+    }
+
+    /**
+     * Feeds a character to the current candidate and reports the candidate if
+     * \p ch ends a valid IBAN.
+     *
+     * @param ch The character
+     * @param offset The offset of \p ch in the stream
+     * @return \p true if the candidate goes on, \p false if it ended
+     */
+    bool IBANScanner::advance(char ch, uint64_t offset) {
+        // complete candidates end at the next character
+        if (m_length == m_expectedLength) {
+            m_length = 0;
+            if (!isAlphanumeric(ch)) {
+                m_handler(IBANMatch{m_start, static_cast<size_t>(offset - m_start),
+                                    CompactIBAN(StringView(m_candidate, m_expectedLength))});
+            }
+            return false;
+        }
+
+        // single spaces separate groups of four characters
+        if (ch == ' ') {
+            if (m_afterSpace || m_length % 4 != 0 || m_grouped == 0) {
+                m_length = 0;
+                return false;
+            }
+            m_grouped = 1;
+            m_afterSpace = true;
+            return true;
+        }
+        if (m_length % 4 == 0 && !m_afterSpace) {
+            if (m_grouped == 1) {
+                m_length = 0;
+                return false;
+            }
+            m_grouped = 0;
+        }
+        m_afterSpace = false;
+
+        if (m_options.allowLowercase && ch >= 'a' && ch <= 'z') {
+            ch = static_cast<char>(ch - 'a' + 'A');
+        }
+        const uint8_t characterClass = BBANStructure::classify(ch);
+        if (m_length == 1) {
+            // the country code selects the structure
+            m_structure = getBBANStructure(m_candidate[0], ch);
+            if (!m_structure || characterClass != BBANStructure::Letter) {
+                m_length = 0;
+                return false;
+            }
+            m_expectedLength = m_structure->length + 4u;
+        } else if (m_length < 4) {
+            if (characterClass != BBANStructure::Digit) {
+                m_length = 0;
+                return false;
+            }
+        } else {
+            if ((characterClass & m_structure->classes[m_length - 4]) == 0) {
+                m_length = 0;
+                return false;
+            }
+            m_remainder = characterClass == BBANStructure::Digit ?
+                          (m_remainder * 10 + getValue(ch)) % 97 :
+                          (m_remainder * 100 + getValue(ch)) % 97;
+        }
+        m_candidate[m_length++] = ch;
+
+        if (m_length == m_expectedLength) {
+            // move the country code and the check sum behind the BBAN
+            uint32_t remainder = m_remainder;
+            remainder = (remainder * 100 + getValue(m_candidate[0])) % 97;
+            remainder = (remainder * 100 + getValue(m_candidate[1])) % 97;
+            remainder = (remainder * 100 + getValue(m_candidate[2]) * 10 + getValue(m_candidate[3])) % 97;
+            if (remainder != 1 || (m_options.nationalCheckDigits &&
+                                   !checkNationalDigits(StringView(m_candidate, m_length)))) {
+                m_length = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Scans a stream in chunks of 64 KiB until its end, so it needs a fixed
+     * amount of memory regardless of the size of the stream.
+     *
+     * @param in The stream to scan
+     * @param handler Function called for every IBAN found
+     * @param options The options of the scanner
+     */
+    void scanStream(std::istream& in, const IBANScanner::MatchHandler& handler,
+                    const ScannerOptions& options) {
+        IBANScanner scanner(handler, options);
+        std::vector<char> buffer(streamChunkSize);
+        while (in) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            scanner.feed(buffer.data(), static_cast<size_t>(in.gcount()));
+        }
+        scanner.finish();
+    }
+
+    /**
+     * Finds the valid IBANs in a text.
+     *
+     * @param text The text to scan
+     * @param options The options of the scanner
+     * @return The IBANs found in the order of the text
+     */
+    std::vector<IBANMatch> findIBANs(StringView text, const ScannerOptions& options) {
+        std::vector<IBANMatch> matches;
+        IBANScanner scanner([&matches](const IBANMatch& match) { matches.push_back(match); }, options);
+        scanner.feed(text);
+        scanner.finish();
+        return matches;
+    }
+}
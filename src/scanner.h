@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        scanner.h
+ * \brief       Header file declaring the streaming IBAN scanner
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p IBANScanner, which finds and validates IBANs
+ * inside text of any size, e.g. payment references, CSV or XML files, which is
+ * pushed in chunks of arbitrary sizes.
+ */
+
+#ifndef LIBIBAN_SCANNER_H
+#define LIBIBAN_SCANNER_H
+
+#include <functional>
+#include <istream>
+#include <vector>
+#include "libiban.h"
+#include "registry.h"
+
+namespace IBAN {
+
+/// IBAN found by \p IBANScanner
+struct IBANMatch {
+    /// Offset of the first character of the IBAN in the stream
+    uint64_t offset;
+    /// Number of characters the IBAN spans in the stream, including the spaces
+    /// between the groups
+    size_t length;
+    /// The IBAN in machine form
+    CompactIBAN iban;
+};
+
+/// Options of \p IBANScanner
+struct ScannerOptions {
+    /// Whether to verify the check digits embedded in the BBANs as well (see
+    /// \p checkNationalDigits())
+    bool nationalCheckDigits = false;
+    /// Whether to accept lowercase letters, which are converted to uppercase
+    bool allowLowercase = true;
+};
+
+/**
+ * Finds the valid IBANs in a stream of text. The text is pushed in chunks with
+ * \p feed(); IBANs may span chunk boundaries, as the scanner carries its state
+ * between the calls, which takes a fixed amount of memory regardless of the
+ * size of the stream.
+ *
+ * An IBAN is found in compact form ("DE89370400440532013000") or in groups of
+ * four characters separated by single spaces ("DE89 3704 0044 0532 0130 00").
+ * It must neither be preceded nor followed by a letter or digit. Each
+ * character is matched against the BBAN structure of the country as soon as
+ * it is read, and the remainder of the check sum is computed along the way,
+ * so no character is read twice.
+ */
+class IBANScanner {
+public:
+    /// Function receiving the IBANs found
+    typedef std::function<void(const IBANMatch&)> MatchHandler;
+
+    explicit IBANScanner(MatchHandler handler, const ScannerOptions& options = ScannerOptions());
+
+    void feed(const char* data, size_t size);
+    void feed(StringView chunk) { feed(chunk.data(), chunk.size()); }
+    void finish();
+
+    /**
+     * Returns the number of characters fed since the construction or the last
+     * call of \p finish().
+     *
+     * @return The offset of the next character in the stream
+     */
+    uint64_t getOffset() const noexcept { return m_offset; }
+
+private:
+    void process(char ch, uint64_t offset);
+    bool advance(char ch, uint64_t offset);
+    void startCandidate(char ch, uint64_t offset) noexcept;
+
+    /// Receives the IBANs found
+    MatchHandler m_handler;
+    /// The options of the scanner
+    ScannerOptions m_options;
+    /// Offset of the next character in the stream
+    uint64_t m_offset {0};
+    /// Whether the last character was a letter or digit
+    bool m_previousAlphanumeric {false};
+
+    /// Offset of the first character of the current candidate
+    uint64_t m_start {0};
+    /// Machine form of the current candidate
+    char m_candidate[maxIBANLength];
+    /// Number of characters of \p m_candidate; 0 if there is no candidate
+    size_t m_length {0};
+    /// Required length of the candidate once the country code is known
+    size_t m_expectedLength {0};
+    /// BBAN structure of the candidate's country
+    const BBANStructure* m_structure {nullptr};
+    /// Remainder (mod 97) of the BBAN read so far
+    uint32_t m_remainder {0};
+    /// 1 if the candidate is grouped, 0 if it is compact, -1 if not yet known
+    int m_grouped {-1};
+    /// Whether the last character of the candidate was a space
+    bool m_afterSpace {false};
+};
+
+void scanStream(std::istream& in, const IBANScanner::MatchHandler& handler,
+                const ScannerOptions& options = ScannerOptions());
+std::vector<IBANMatch> findIBANs(StringView text, const ScannerOptions& options = ScannerOptions());
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_SCANNER_H
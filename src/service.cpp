@@ -0,0 +1,354 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        service.cpp
+ * \brief       Source file implementing the asynchronous validation service
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements \p ValidationService. The jobs are passed to
+ * the batching thread through an intrusive multi-producer single-consumer
+ * queue: a producer links its job in with a single atomic exchange, and the
+ * batching thread unlinks the jobs from the other end without any atomic
+ * read-modify-write. The batching thread only sleeps when the queue is empty;
+ * producers take the mutex to wake it in that case only.
+ */
+
+#include "service.h"
+#include <algorithm>
+
+namespace IBAN {
+
+    /// Job of \p ValidationService and node of its queue
+    struct ValidationService::Job {
+        /// The next job of the queue
+        std::atomic<Job*> next {nullptr};
+        /// The IBANs to validate
+        std::vector<std::string> ibans;
+        /// Receives the results
+        CompletionHandler handler;
+        /// Time the job was submitted at
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    namespace {
+        /// Number of batches per worker that may wait for a worker, which
+        /// bounds the memory if jobs are submitted faster than validated
+        constexpr size_t maxPendingBatches = 2;
+    }
+
+    /**
+     * Starts the batching thread and the worker threads. If a thread cannot
+     * be started, the threads started so far are stopped before the
+     * exception is rethrown.
+     *
+     * @param options The options of the service
+     * @throws std::system_error If a thread cannot be started
+     */
+    ValidationService::ValidationService(const ServiceOptions& options) :
+            m_options(options), m_stub(new Job()), m_head(m_stub.get()), m_tail(m_stub.get()),
+            m_sleeping(false), m_stop(false), m_workersStop(false), m_batchCount(0) {
+        m_options.maxBatchSize = std::max<size_t>(m_options.maxBatchSize, 1);
+        size_t threads = m_options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_workers.reserve(threads);
+        try {
+            for (size_t i = 0; i < threads; ++i) {
+                m_workers.emplace_back([this]() { workerLoop(); });
+            }
+            m_batcher = std::thread([this]() { batchLoop(); });
+        } catch (...) {
+            // joinable threads would terminate the process when destroyed
+            stopWorkers();
+            throw;
+        }
+    }
+
+    /**
+     * Completes the submitted jobs and stops the threads.
+     */
+    ValidationService::~ValidationService() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop.store(true);
+        }
+        m_wake.notify_one();
+        m_batcher.join();
+        stopWorkers();
+    }
+
+    /**
+     * Lets the workers finish the pending batches and joins them.
+     */
+    void ValidationService::stopWorkers() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(m_batchMutex);
+            m_workersStop = true;
+        }
+        m_batchReady.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * Submits a job whose results are delivered through a future.
+     *
+     * @param ibans The IBANs to validate
+     * @return The future receiving one status per IBAN
+     */
+    std::future<std::vector<ParseStatus>> ValidationService::submit(std::vector<std::string> ibans) {
+        std::shared_ptr<std::promise<std::vector<ParseStatus>>> promise =
+                std::make_shared<std::promise<std::vector<ParseStatus>>>();
+        std::future<std::vector<ParseStatus>> future = promise->get_future();
+        submit(std::move(ibans), [promise](std::vector<ParseStatus> results) {
+            promise->set_value(std::move(results));
+        });
+        return future;
+    }
+
+    /**
+     * Submits a job whose results are passed to a handler. The handler is
+     * called on a worker thread, so it should return quickly, e.g. by posting
+     * the results to the event loop of the caller.
+     *
+     * @param ibans The IBANs to validate
+     * @param handler Function receiving one status per IBAN
+     */
+    void ValidationService::submit(std::vector<std::string> ibans, CompletionHandler handler) {
+        Job* job = new Job();
+        job->ibans = std::move(ibans);
+        job->handler = std::move(handler);
+        job->submitted = std::chrono::steady_clock::now();
+        // the exchange in push() and the load of m_sleeping pair with the
+        // store of m_sleeping and the load of m_head in waitForJob(): either
+        // the batching thread sees the job or this thread sees it sleeping
+        push(job);
+        if (m_sleeping.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+        }
+    }
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * @return The number of worker threads
+     */
+    size_t ValidationService::getThreadCount() const noexcept {
+        return m_workers.size();
+    }
+
+    /**
+     * Returns the number of batches started so far, e.g. for tuning the
+     * batching window.
+     *
+     * @return The number of batches
+     */
+    uint64_t ValidationService::getBatchCount() const noexcept {
+        return m_batchCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Appends a job to the queue; may be called by any thread.
+     *
+     * @param job The job to append
+     */
+    void ValidationService::push(Job* job) noexcept {
+        job->next.store(nullptr, std::memory_order_relaxed);
+        Job* previous = m_head.exchange(job);
+        previous->next.store(job, std::memory_order_release);
+    }
+
+    /**
+     * Removes the oldest job from the queue; only called by the batching
+     * thread. Returns \p nullptr as well while a producer is appending the
+     * only job of the queue.
+     *
+     * @return The oldest job or \p nullptr
+     */
+    ValidationService::Job* ValidationService::pop() noexcept {
+        Job* tail = m_tail;
+        Job* next = tail->next.load(std::memory_order_acquire);
+        if (tail == m_stub.get()) {
+            if (!next) {
+                return nullptr;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            m_tail = next;
+            return tail;
+        }
+        if (tail != m_head.load()) {
+            return nullptr;
+        }
+        // keep a node in the queue to unlink the last job
+        push(m_stub.get());
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            m_tail = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Returns the next job, waiting for one if the queue is empty.
+     *
+     * @param timed Whether to give up at \p deadline
+     * @param deadline The time to give up at
+     * @return The next job or \p nullptr if there is none at the deadline or
+     * the service stops
+     */
+    ValidationService::Job* ValidationService::waitForJob(bool timed,
+                                                          std::chrono::steady_clock::time_point deadline) {
+        Job* job = pop();
+        if (job || m_stop.load()) {
+            return job;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.store(true);
+        for (;;) {
+            job = pop();
+            if (job || m_stop.load()) {
+                break;
+            }
+            if (m_head.load() != m_tail) {
+                // a producer is still linking its job in
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+                continue;
+            }
+            if (!timed) {
+                m_wake.wait(lock);
+            } else if (m_wake.wait_until(lock, deadline) == std::cv_status::timeout) {
+                job = pop();
+                break;
+            }
+        }
+        m_sleeping.store(false);
+        return job;
+    }
+
+    /**
+     * Collects the jobs into batches and hands them to the workers until the
+     * service stops and the queue is empty.
+     */
+    void ValidationService::batchLoop() {
+        const size_t maxPending = maxPendingBatches * m_workers.size();
+        for (;;) {
+            // only returns nullptr once the service stops and the queue is
+            // empty, as no jobs are submitted anymore
+            Job* job = waitForJob(false, std::chrono::steady_clock::time_point());
+            if (!job) {
+                break;
+            }
+            std::vector<Job*> batch(1, job);
+            size_t size = job->ibans.size();
+            const std::chrono::steady_clock::time_point deadline = job->submitted + m_options.maxDelay;
+            while (size < m_options.maxBatchSize) {
+                job = m_stop.load() || std::chrono::steady_clock::now() >= deadline ?
+                      pop() : waitForJob(true, deadline);
+                if (!job) {
+                    break;
+                }
+                batch.push_back(job);
+                size += job->ibans.size();
+            }
+
+            m_batchCount.fetch_add(1, std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(m_batchMutex);
+            m_batchTaken.wait(lock, [&]() { return m_batches.size() < maxPending; });
+            m_batches.push_back(std::move(batch));
+            lock.unlock();
+            m_batchReady.notify_one();
+        }
+    }
+
+    /**
+     * Validates the batches until the service stops.
+     */
+    void ValidationService::workerLoop() {
+        for (;;) {
+            std::vector<Job*> batch;
+            {
+                std::unique_lock<std::mutex> lock(m_batchMutex);
+                m_batchReady.wait(lock, [this]() { return m_workersStop || !m_batches.empty(); });
+                if (m_batches.empty()) {
+                    return;
+                }
+                batch = std::move(m_batches.front());
+                m_batches.pop_front();
+            }
+            m_batchTaken.notify_one();
+            validate(batch);
+        }
+    }
+
+    /**
+     * Validates a batch, completes its jobs and deletes them.
+     *
+     * @param batch The jobs of the batch
+     */
+    void ValidationService::validate(const std::vector<Job*>& batch) const {
+        std::vector<const char*> ibans;
+        std::vector<uint8_t> lengths;
+        for (const Job* job : batch) {
+            for (const std::string& iban : job->ibans) {
+                ibans.push_back(iban.data());
+                lengths.push_back(static_cast<uint8_t>(std::min<size_t>(iban.size(), UINT8_MAX)));
+            }
+        }
+        std::vector<uint8_t> results(ibans.size());
+        validateBatch(ibans.data(), lengths.data(), ibans.size(), results.data(), BatchKernel::Auto,
+                      m_options.nationalCheckDigits);
+
+        size_t offset = 0;
+        for (Job* job : batch) {
+            std::vector<ParseStatus> statuses(job->ibans.size());
+            for (size_t i = 0; i < statuses.size(); ++i, ++offset) {
+                statuses[i] = static_cast<ParseStatus>(results[offset]);
+                // strings too long for the batch lengths cannot be IBANs
+                // unless they are mostly whitespace
+                if (job->ibans[i].size() > UINT8_MAX) {
+                    CompactIBAN iban;
+                    statuses[i] = CompactIBAN::tryParse(job->ibans[i], iban);
+                    if (statuses[i] == ParseStatus::OK && m_options.nationalCheckDigits &&
+                        !iban.validateNational()) {
+                        statuses[i] = ParseStatus::NationalChecksumMismatch;
+                    }
+                }
+            }
+            job->handler(std::move(statuses));
+            delete job;
+        }
+    }
+}
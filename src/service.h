@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        service.h
+ * \brief       Header file declaring the asynchronous validation service
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares \p ValidationService, which validates IBANs
+ * submitted by many threads asynchronously. Small jobs are coalesced into
+ * batches for \p validateBatch(), so servers handling many small requests get
+ * the throughput of the batch kernels.
+ */
+
+#ifndef LIBIBAN_SERVICE_H
+#define LIBIBAN_SERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libiban.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define LIBIBAN_HAS_COROUTINES 1
+#else
+#define LIBIBAN_HAS_COROUTINES 0
+#endif
+
+namespace IBAN {
+
+/// Options of \p ValidationService
+struct ServiceOptions {
+    /// Number of threads validating the batches; 0 means one per hardware
+    /// thread
+    size_t threads = 1;
+    /// A batch is started once it holds this many IBANs
+    size_t maxBatchSize = 4096;
+    /// A batch is started at the latest this long after its first job was
+    /// submitted; 0 starts the jobs submitted so far right away
+    std::chrono::microseconds maxDelay = std::chrono::microseconds(200);
+    /// Whether to verify the check digits embedded in the BBANs as well (see
+    /// \p validateBatch())
+    bool nationalCheckDigits = false;
+};
+
+/**
+ * Validates jobs of IBANs asynchronously. Any number of threads submit jobs,
+ * which are passed to a batching thread through a lock-free queue, so
+ * submitting a job never blocks on other producers. The batching thread
+ * collects jobs until the batch holds \p ServiceOptions::maxBatchSize IBANs or
+ * \p ServiceOptions::maxDelay passed since the first job of the batch was
+ * submitted, and hands the batch to a pool of worker threads, which validate
+ * it with \p validateBatch() and complete the jobs. A small maximum delay
+ * favours latency, a large one throughput.
+ *
+ * The results of a job are the statuses \p IBAN::tryParse() returns for its
+ * IBANs. Jobs complete by fulfilling a future or by calling a handler on a
+ * worker thread; with C++20, \p validateAsync() can be awaited in coroutines.
+ * The destructor completes all jobs submitted before; no job may be submitted
+ * once the destruction started.
+ */
+class ValidationService {
+public:
+    /// Function receiving the results of a job
+    typedef std::function<void(std::vector<ParseStatus>)> CompletionHandler;
+
+    explicit ValidationService(const ServiceOptions& options = ServiceOptions());
+    ~ValidationService();
+
+    ValidationService(const ValidationService&) = delete;
+    ValidationService& operator=(const ValidationService&) = delete;
+
+    std::future<std::vector<ParseStatus>> submit(std::vector<std::string> ibans);
+    void submit(std::vector<std::string> ibans, CompletionHandler handler);
+
+    size_t getThreadCount() const noexcept;
+    uint64_t getBatchCount() const noexcept;
+
+#if LIBIBAN_HAS_COROUTINES
+    /// Awaitable validating a job; the coroutine resumes on a worker thread
+    class Awaitable {
+    public:
+        Awaitable(ValidationService& service, std::vector<std::string> ibans) :
+                m_service(service), m_ibans(std::move(ibans)) {}
+
+        bool await_ready() const noexcept { return m_ibans.empty(); }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_service.submit(std::move(m_ibans), [this, handle](std::vector<ParseStatus> results) {
+                m_results = std::move(results);
+                handle.resume();
+            });
+        }
+
+        std::vector<ParseStatus> await_resume() { return std::move(m_results); }
+
+    private:
+        /// The service validating the job
+        ValidationService& m_service;
+        /// The IBANs of the job
+        std::vector<std::string> m_ibans;
+        /// The results of the job
+        std::vector<ParseStatus> m_results;
+    };
+
+    /**
+     * Submits a job to be awaited in a coroutine:
+     * \code auto results = co_await service.validateAsync(ibans); \endcode
+     *
+     * @param ibans The IBANs to validate
+     * @return The awaitable yielding the results
+     */
+    Awaitable validateAsync(std::vector<std::string> ibans) {
+        return Awaitable(*this, std::move(ibans));
+    }
+#endif
+
+private:
+    struct Job;
+
+    void push(Job* job) noexcept;
+    Job* pop() noexcept;
+    Job* waitForJob(bool timed, std::chrono::steady_clock::time_point deadline);
+    void batchLoop();
+    void workerLoop();
+    void stopWorkers() noexcept;
+    void validate(const std::vector<Job*>& batch) const;
+
+    /// The options of the service
+    ServiceOptions m_options;
+    /// Node the queue starts with and returns to when it runs empty
+    std::unique_ptr<Job> m_stub;
+    /// Job submitted last; producers append behind it
+    std::atomic<Job*> m_head;
+    /// Oldest node of the queue; only used by the batching thread
+    Job* m_tail;
+    /// Set while the batching thread waits for jobs
+    std::atomic<bool> m_sleeping;
+    /// Set when the instance is destroyed
+    std::atomic<bool> m_stop;
+    /// Guards the waiting of the batching thread
+    std::mutex m_mutex;
+    /// Wakes the batching thread
+    std::condition_variable m_wake;
+
+    /// Guards the members below
+    std::mutex m_batchMutex;
+    /// Signals the workers that a batch is available or that they must stop
+    std::condition_variable m_batchReady;
+    /// Signals the batching thread that a worker took a batch
+    std::condition_variable m_batchTaken;
+    /// Batches waiting for a worker
+    std::deque<std::vector<Job*>> m_batches;
+    /// Set when the workers must stop
+    bool m_workersStop;
+    /// Number of batches started
+    std::atomic<uint64_t> m_batchCount;
+
+    /// The worker threads
+    std::vector<std::thread> m_workers;
+    /// The batching thread
+    std::thread m_batcher;
+};
+}
+
+#endif //LIBIBAN_SERVICE_H
@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        snapshot.cpp
+ * \brief       Source file implementing helpers for snapshot files
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the helpers declared in snapshot.h. Snapshots
+ * are mapped with \p mmap() where available; elsewhere they are read into
+ * memory.
+ */
+
+#include "snapshot.h"
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#if LIBIBAN_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace IBAN {
+
+    namespace detail {
+        /**
+         * Throws the \p std::system_error for a failed system call.
+         *
+         * @param what The description of the failed operation
+         * @param error The \p errno value of the failure
+         * @throws std::system_error Always
+         */
+        void throwSystemError(const std::string& what, int error) {
+            throw std::system_error(error, std::generic_category(), what);
+        }
+
+#if LIBIBAN_USE_MMAP
+        /**
+         * Maps a snapshot file into memory read-only. An empty file is not
+         * mapped; the mapping then has no data and size 0.
+         *
+         * @param path The path of the file
+         * @return The mapping, to be released with \p unmapSnapshot()
+         * @throws std::system_error If the file cannot be opened or mapped
+         */
+        SnapshotMapping mapSnapshot(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throwSystemError("cannot open " + path, errno);
+            }
+            struct stat status;
+            if (::fstat(fd, &status) != 0) {
+                // close() may overwrite errno
+                const int error = errno;
+                ::close(fd);
+                throwSystemError("cannot stat " + path, error);
+            }
+            const size_t size = static_cast<size_t>(status.st_size);
+            void* data = nullptr;
+            if (size > 0) {
+                data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                const int error = errno;
+                ::close(fd);
+                if (data == MAP_FAILED) {
+                    throwSystemError("cannot map " + path, error);
+                }
+            } else {
+                ::close(fd);
+            }
+            return SnapshotMapping{data, size};
+        }
+#endif
+
+        /**
+         * Releases a mapping returned by \p mapSnapshot(). Does nothing if
+         * \p data is \p nullptr.
+         *
+         * @param data The mapped bytes
+         * @param size The size of the mapping
+         */
+        void unmapSnapshot(void* data, size_t size) noexcept {
+#if LIBIBAN_USE_MMAP
+            if (data) {
+                ::munmap(data, size);
+            }
+#else
+            (void) data;
+            (void) size;
+#endif
+        }
+
+        /**
+         * Reads a snapshot file into memory.
+         *
+         * @param path The path of the file
+         * @return The contents of the file
+         * @throws std::system_error If the file cannot be read
+         */
+        std::vector<char> readSnapshot(const std::string& path) {
+            std::ifstream stream(path, std::ios::binary);
+            if (!stream) {
+                throwSystemError("cannot open " + path, errno);
+            }
+            std::vector<char> snapshot((std::istreambuf_iterator<char>(stream)),
+                                       std::istreambuf_iterator<char>());
+            if (stream.bad()) {
+                throwSystemError("cannot read " + path, errno);
+            }
+            return snapshot;
+        }
+
+        /**
+         * Writes a snapshot to a file, replacing its contents.
+         *
+         * @param path The path of the file
+         * @param snapshot The snapshot
+         * @throws std::system_error If the file cannot be written
+         */
+        void writeSnapshot(const std::string& path, const std::vector<char>& snapshot) {
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(snapshot.data(), static_cast<std::streamsize>(snapshot.size()));
+            stream.close();
+            if (!stream) {
+                throwSystemError("cannot write " + path, errno);
+            }
+        }
+    }
+}
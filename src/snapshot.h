@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        snapshot.h
+ * \brief       Header file declaring helpers for snapshot files
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the helpers shared by the classes loading binary
+ * snapshots (\p BankDirectory, \p PrefixIndex, \p IBANFilter and
+ * \p CountryTable): mapping a snapshot file into memory, reading and writing
+ * it, and accessing the numbers it holds. \p validateFile() reports its
+ * failed system calls like them.
+ */
+
+#ifndef LIBIBAN_SNAPSHOT_H
+#define LIBIBAN_SNAPSHOT_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LIBIBAN_USE_MMAP 1
+#else
+#define LIBIBAN_USE_MMAP 0
+#endif
+
+namespace IBAN {
+
+namespace detail {
+/// Read-only memory mapping of a snapshot file
+struct SnapshotMapping {
+    /// The mapped bytes or \p nullptr if the file is empty
+    void* data;
+    /// The size of the file in bytes
+    size_t size;
+};
+
+[[noreturn]] void throwSystemError(const std::string& what, int error);
+#if LIBIBAN_USE_MMAP
+SnapshotMapping mapSnapshot(const std::string& path);
+#endif
+void unmapSnapshot(void* data, size_t size) noexcept;
+std::vector<char> readSnapshot(const std::string& path);
+void writeSnapshot(const std::string& path, const std::vector<char>& snapshot);
+
+/// Reads a number in host byte order
+template <class T>
+inline T readNumber(const char* data) noexcept {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/// Writes a number in host byte order
+template <class T>
+inline void writeNumber(char* data, T value) noexcept {
+    std::memcpy(data, &value, sizeof(value));
+}
+}
+}
+
+#endif //LIBIBAN_SNAPSHOT_H
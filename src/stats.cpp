@@ -0,0 +1,402 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        stats.cpp
+ * \brief       Source file implementing the optional usage statistics
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This source file implements the statistics layer. Every thread counts into
+ * its own record, so recording a call neither locks nor executes atomic
+ * read-modify-write instructions: the counters are only written by their
+ * thread, with relaxed loads and stores compiling to plain moves, and are
+ * summed up by \p getStats(). Just like the records of \p EpochGuard the
+ * records form a list that only grows, and records of finished threads are
+ * reused by new threads, so their counts are never lost.
+ */
+
+#include "stats.h"
+#include "libiban.h"
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace IBAN {
+
+    namespace {
+        /// Names of the operations in the exported metrics
+        const char* const operationNames[statsOperationCount] = {
+                "createFromString", "validate", "generateIBAN", "validateBatch"
+        };
+
+        /// Names of the results in the exported metrics
+        const char* const statusNames[parseStatusCount] = {
+                "OK", "InvalidLength", "InvalidCountryCode", "InvalidChecksumDigits",
+                "IllegalCharacter", "InvalidStructure", "ChecksumMismatch",
+                "NationalChecksumMismatch"
+        };
+
+        /**
+         * Calls \p function for each pair of corresponding counters of
+         * \p target and \p source, which have the members of
+         * \p StatsSnapshot.
+         *
+         * @param target The first structure of counters
+         * @param source The second structure of counters
+         * @param function The function to call with both counters
+         */
+        template <class Target, class Source, class Function>
+        void forEachCounter(Target& target, Source& source, Function function) {
+            for (size_t i = 0; i < statsOperationCount; ++i) {
+                function(target.calls[i], source.calls[i]);
+                function(target.ibans[i], source.ibans[i]);
+                function(target.latencySum[i], source.latencySum[i]);
+                for (size_t j = 0; j < parseStatusCount; ++j) {
+                    function(target.results[i][j], source.results[i][j]);
+                }
+                for (size_t j = 0; j < latencyBucketCount; ++j) {
+                    function(target.latency[i][j], source.latency[i][j]);
+                }
+            }
+            for (size_t i = 0; i < countryCodeCount; ++i) {
+                function(target.countryIBANs[i], source.countryIBANs[i]);
+                function(target.countryRejects[i], source.countryRejects[i]);
+            }
+        }
+    }
+
+    /**
+     * Creates a snapshot with all counters set to 0.
+     */
+    StatsSnapshot::StatsSnapshot() noexcept : calls(), ibans(), results(), countryIBANs(),
+                                              countryRejects(), latency(), latencySum() {}
+
+    /**
+     * Adds the counters of another snapshot to this one.
+     *
+     * @param other The snapshot to add
+     * @return This snapshot
+     */
+    StatsSnapshot& StatsSnapshot::merge(const StatsSnapshot& other) noexcept {
+        forEachCounter(*this, other, [](uint64_t& counter, const uint64_t& value) {
+            counter += value;
+        });
+        return *this;
+    }
+
+    /**
+     * Returns the number of calls of an operation.
+     *
+     * @param operation The operation
+     * @return The number of calls
+     */
+    uint64_t StatsSnapshot::getCalls(StatsOperation operation) const noexcept {
+        return calls[static_cast<size_t>(operation)];
+    }
+
+    /**
+     * Returns the number of IBANs an operation returned a result for.
+     *
+     * @param operation The operation
+     * @param status The result
+     * @return The number of IBANs with the result
+     */
+    uint64_t StatsSnapshot::getResults(StatsOperation operation, ParseStatus status) const noexcept {
+        return results[static_cast<size_t>(operation)][static_cast<size_t>(status)];
+    }
+
+    /**
+     * Returns the number of IBANs an operation rejected, i.e. returned a
+     * result other than \p ParseStatus::OK for.
+     *
+     * @param operation The operation
+     * @return The number of rejected IBANs
+     */
+    uint64_t StatsSnapshot::getRejects(StatsOperation operation) const noexcept {
+        uint64_t rejects = 0;
+        for (size_t i = 1; i < parseStatusCount; ++i) {
+            rejects += results[static_cast<size_t>(operation)][i];
+        }
+        return rejects;
+    }
+
+    /**
+     * Formats the snapshot in the text exposition format of Prometheus. The
+     * calls, IBANs and results are exported as counters, the latencies of
+     * the timed calls as histograms in seconds; countries without IBANs are
+     * left out.
+     *
+     * @param prefix The prefix of the metric names
+     * @return The metrics, one sample per line
+     */
+    std::string StatsSnapshot::toPrometheus(const std::string& prefix) const {
+        std::ostringstream out;
+        out << std::setprecision(9);
+        const auto header = [&](const char* name, const char* type, const char* help) {
+            out << "# HELP " << prefix << name << ' ' << help << "\n# TYPE " << prefix << name
+                << ' ' << type << '\n';
+        };
+
+        header("_calls_total", "counter", "Number of calls per operation.");
+        for (size_t i = 0; i < statsOperationCount; ++i) {
+            out << prefix << "_calls_total{operation=\"" << operationNames[i] << "\"} " << calls[i] << '\n';
+        }
+        header("_ibans_total", "counter", "Number of IBANs handled per operation.");
+        for (size_t i = 0; i < statsOperationCount; ++i) {
+            out << prefix << "_ibans_total{operation=\"" << operationNames[i] << "\"} " << ibans[i] << '\n';
+        }
+        header("_results_total", "counter", "Number of IBANs per operation and result.");
+        for (size_t i = 0; i < statsOperationCount; ++i) {
+            for (size_t j = 0; j < parseStatusCount; ++j) {
+                out << prefix << "_results_total{operation=\"" << operationNames[i] << "\",status=\""
+                    << statusNames[j] << "\"} " << results[i][j] << '\n';
+            }
+        }
+        header("_country_ibans_total", "counter", "Number of validated IBANs per country.");
+        header("_country_rejects_total", "counter", "Number of invalid IBANs per country.");
+        for (size_t i = 0; i < countryCodeCount; ++i) {
+            if (countryIBANs[i] == 0 && countryRejects[i] == 0) {
+                continue;
+            }
+            const char country[3] = {static_cast<char>('A' + i / 26), static_cast<char>('A' + i % 26), '\0'};
+            out << prefix << "_country_ibans_total{country=\"" << country << "\"} " << countryIBANs[i] << '\n'
+                << prefix << "_country_rejects_total{country=\"" << country << "\"} " << countryRejects[i] << '\n';
+        }
+        header("_latency_seconds", "histogram", "Latency of the calls per operation.");
+        for (size_t i = 0; i < statsOperationCount; ++i) {
+            uint64_t cumulative = 0;
+            for (size_t j = 0; j < latencyBucketCount; ++j) {
+                cumulative += latency[i][j];
+                out << prefix << "_latency_seconds_bucket{operation=\"" << operationNames[i] << "\",le=\"";
+                if (j + 1 < latencyBucketCount) {
+                    out << static_cast<double>(uint64_t(1) << j) * 1e-9;
+                } else {
+                    out << "+Inf";
+                }
+                out << "\"} " << cumulative << '\n';
+            }
+            // the count of the histogram is the number of timed calls
+            out << prefix << "_latency_seconds_sum{operation=\"" << operationNames[i] << "\"} "
+                << static_cast<double>(latencySum[i]) * 1e-9 << '\n'
+                << prefix << "_latency_seconds_count{operation=\"" << operationNames[i] << "\"} "
+                << cumulative << '\n';
+        }
+        return out.str();
+    }
+
+#if LIBIBAN_ENABLE_STATS
+
+    namespace {
+        /// Counter written by one thread only
+        typedef std::atomic<uint64_t> Counter;
+
+        /// Counters of one thread, with the members of \p StatsSnapshot
+        struct ThreadStats {
+            Counter calls[statsOperationCount];
+            Counter ibans[statsOperationCount];
+            Counter results[statsOperationCount][parseStatusCount];
+            Counter countryIBANs[countryCodeCount];
+            Counter countryRejects[countryCodeCount];
+            Counter latency[statsOperationCount][latencyBucketCount];
+            Counter latencySum[statsOperationCount];
+            /// Whether a thread owns the record
+            std::atomic<bool> inUse {true};
+            /// Next record of the list
+            ThreadStats* next {nullptr};
+            /// Keeps records of different threads in different cache lines
+            char padding[64];
+        };
+
+        /// Head of the list of all records
+        std::atomic<ThreadStats*> statsRecords {nullptr};
+
+        /// Guards \p baseline
+        std::mutex baselineMutex;
+        /// Counters at the last call of \p resetStats()
+        StatsSnapshot baseline;
+
+        /// Takes a free record or adds a new one to the list
+        ThreadStats* acquireStatsRecord() {
+            for (ThreadStats* record = statsRecords.load(); record; record = record->next) {
+                bool inUse = false;
+                if (record->inUse.compare_exchange_strong(inUse, true)) {
+                    return record;
+                }
+            }
+            ThreadStats* record = new ThreadStats();
+            record->next = statsRecords.load();
+            while (!statsRecords.compare_exchange_weak(record->next, record)) {
+            }
+            return record;
+        }
+
+        /// Owns the record of a thread and releases it when the thread ends
+        struct ThreadStatsOwner {
+            ThreadStats* record;
+
+            ThreadStatsOwner() : record(acquireStatsRecord()) {}
+            ~ThreadStatsOwner() {
+                record->inUse.store(false);
+            }
+        };
+
+        /// Returns the record of the calling thread
+        ThreadStats& getThreadStats() {
+            thread_local ThreadStatsOwner threadRecord;
+            return *threadRecord.record;
+        }
+
+        /// Increments a counter of the calling thread
+        inline void add(Counter& counter, uint64_t value = 1) noexcept {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        /// Sums the counters of all records
+        StatsSnapshot sumRecords() noexcept {
+            StatsSnapshot snapshot;
+            for (ThreadStats* record = statsRecords.load(); record; record = record->next) {
+                forEachCounter(snapshot, *record, [](uint64_t& counter, const Counter& value) {
+                    counter += value.load(std::memory_order_relaxed);
+                });
+            }
+            return snapshot;
+        }
+
+        /// Returns the histogram bucket of a latency
+        inline size_t getLatencyBucket(uint64_t nanoseconds) noexcept {
+            size_t bucket = 0;
+            while (bucket + 1 < latencyBucketCount && (nanoseconds >> bucket) != 0) {
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        /// Converts an ASCII letter to uppercase independent of the locale
+        inline char toUpperASCII(char ch) noexcept {
+            return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+        }
+
+        /// Counts the result of one IBAN; only validations count per country
+        inline void addResult(ThreadStats& stats, StatsOperation operation, const char* iban, size_t length,
+                              size_t status) noexcept {
+            add(stats.results[static_cast<size_t>(operation)][status]);
+            if ((operation != StatsOperation::Validate && operation != StatsOperation::ValidateBatch) || length < 2) {
+                return;
+            }
+            const size_t index = getCountryIndex(toUpperASCII(iban[0]), toUpperASCII(iban[1]));
+            if (index < countryCodeCount) {
+                add(stats.countryIBANs[index]);
+                if (status != static_cast<size_t>(ParseStatus::OK)) {
+                    add(stats.countryRejects[index]);
+                }
+            }
+        }
+
+        /// Counts one call
+        inline ThreadStats& addCall(StatsOperation operation, uint64_t ibans, uint64_t nanoseconds) noexcept {
+            ThreadStats& stats = getThreadStats();
+            const size_t index = static_cast<size_t>(operation);
+            add(stats.calls[index]);
+            add(stats.ibans[index], ibans);
+            if (nanoseconds != detail::notTimed) {
+                add(stats.latency[index][getLatencyBucket(nanoseconds)]);
+                add(stats.latencySum[index], nanoseconds);
+            }
+            return stats;
+        }
+    }
+
+    /**
+     * Records one call of an operation handling a single IBAN.
+     *
+     * @param operation The operation
+     * @param iban The IBAN or \p nullptr if there is no result
+     * @param length The length of \p iban
+     * @param status The result (a \p ParseStatus) or -1 if there is none
+     * @param nanoseconds The latency of the call or \p detail::notTimed
+     */
+    void detail::recordStats(StatsOperation operation, const char* iban, size_t length, int status,
+                             uint64_t nanoseconds) noexcept {
+        ThreadStats& stats = addCall(operation, 1, nanoseconds);
+        if (status >= 0) {
+            addResult(stats, operation, iban, length, static_cast<size_t>(status));
+        }
+    }
+
+    /**
+     * Records one call of \p validateBatch().
+     *
+     * @param ibans Pointers to the validated IBANs
+     * @param lengths The lengths of the IBANs
+     * @param count The number of IBANs
+     * @param results The results of the IBANs
+     * @param nanoseconds The latency of the call
+     */
+    void detail::recordBatchStats(const char* const* ibans, const uint8_t* lengths, size_t count,
+                                  const uint8_t* results, uint64_t nanoseconds) noexcept {
+        ThreadStats& stats = addCall(StatsOperation::ValidateBatch, count, nanoseconds);
+        for (size_t i = 0; i < count; ++i) {
+            addResult(stats, StatsOperation::ValidateBatch, ibans[i], lengths[i], results[i]);
+        }
+    }
+
+    /**
+     * Sums the counters of all threads, including finished ones, since the
+     * last call of \p resetStats(). Counts of calls running concurrently may
+     * be missing in part.
+     *
+     * @return The snapshot of the counters, empty if the library was built
+     * without \p LIBIBAN_ENABLE_STATS
+     */
+    StatsSnapshot getStats() {
+        StatsSnapshot snapshot = sumRecords();
+        std::lock_guard<std::mutex> lock(baselineMutex);
+        forEachCounter(snapshot, baseline, [](uint64_t& counter, const uint64_t& value) {
+            counter -= value;
+        });
+        return snapshot;
+    }
+
+    /**
+     * Sets all counters to 0. The counters of the threads are left untouched,
+     * instead the following snapshots are taken relative to the current one.
+     */
+    void resetStats() {
+        const StatsSnapshot snapshot = sumRecords();
+        std::lock_guard<std::mutex> lock(baselineMutex);
+        baseline = snapshot;
+    }
+
+#else
+
+    StatsSnapshot getStats() {
+        return StatsSnapshot();
+    }
+
+    void resetStats() {
+    }
+
+#endif
+}
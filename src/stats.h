@@ -0,0 +1,229 @@
+/*
+ * MIT License
+ * Copyright (c) 2017 Kevin Kirchner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * \file        stats.h
+ * \brief       Header file declaring the optional usage statistics
+ * \author      Kevin Kirchner
+ * \date        2017
+ * \copyright   MIT LICENSE
+ *
+ * This header file declares the statistics layer, which counts the calls of
+ * \p IBAN::createFromString(), \p IBAN::validate(), \p IBAN::generateIBAN()
+ * and \p validateBatch(), their results per \p ParseStatus and per country,
+ * and the distribution of their latencies. The layer is compiled in only if
+ * the library is built with \p LIBIBAN_ENABLE_STATS; otherwise the recording
+ * macros expand to nothing and \p getStats() returns empty snapshots.
+ */
+
+#ifndef LIBIBAN_STATS_H
+#define LIBIBAN_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "registry.h"
+
+#ifndef LIBIBAN_ENABLE_STATS
+#define LIBIBAN_ENABLE_STATS 0
+#endif
+
+namespace IBAN {
+
+enum class ParseStatus;
+
+/// Whether the library was built with the statistics layer
+constexpr bool statsEnabled = LIBIBAN_ENABLE_STATS != 0;
+
+/// Operations counted by the statistics layer
+enum class StatsOperation {
+    /// \p IBAN::createFromString()
+    CreateFromString,
+    /// \p IBAN::validate() and \p IBAN::getStatus()
+    Validate,
+    /// \p IBAN::generateIBAN()
+    GenerateIBAN,
+    /// \p validateBatch(), including the batches of the bulk validators and
+    /// of \p IBANColumn::validate()
+    ValidateBatch
+};
+
+/// Number of values of \p StatsOperation
+constexpr size_t statsOperationCount = 4;
+
+/// Number of values of \p ParseStatus
+constexpr size_t parseStatusCount = 8;
+
+/// Number of buckets of the latency histograms. Bucket \p i counts the calls
+/// taking less than 2^i nanoseconds (but not less than 2^(i-1)), the last
+/// bucket counts all slower calls.
+constexpr size_t latencyBucketCount = 32;
+
+/// Only every n-th call of the operations handling a single IBAN is timed,
+/// as reading the clock takes longer than most of these calls; batches are
+/// timed on every call
+constexpr unsigned latencySampleRate = 16;
+
+/**
+ * Counters of the statistics layer, either summed over all threads by
+ * \p getStats() or merged from several snapshots, e.g. of several processes.
+ */
+struct StatsSnapshot {
+    /// Number of calls per \p StatsOperation
+    uint64_t calls[statsOperationCount];
+    /// Number of IBANs handled per \p StatsOperation; equals \p calls except
+    /// for \p validateBatch()
+    uint64_t ibans[statsOperationCount];
+    /// Number of results per \p StatsOperation and \p ParseStatus; the
+    /// result of \p IBAN::createFromString() only tells if the string could
+    /// be parsed
+    uint64_t results[statsOperationCount][parseStatusCount];
+    /// Number of validated IBANs per country (see \p getCountryIndex())
+    uint64_t countryIBANs[countryCodeCount];
+    /// Number of IBANs per country (see \p getCountryIndex()) found invalid
+    uint64_t countryRejects[countryCodeCount];
+    /// Latency histogram per \p StatsOperation of the timed calls (see
+    /// \p latencySampleRate); batches count their calls, not the single IBANs
+    uint64_t latency[statsOperationCount][latencyBucketCount];
+    /// Total latency of the timed calls per \p StatsOperation in nanoseconds
+    uint64_t latencySum[statsOperationCount];
+
+    StatsSnapshot() noexcept;
+
+    StatsSnapshot& merge(const StatsSnapshot& other) noexcept;
+    uint64_t getCalls(StatsOperation operation) const noexcept;
+    uint64_t getResults(StatsOperation operation, ParseStatus status) const noexcept;
+    uint64_t getRejects(StatsOperation operation) const noexcept;
+    std::string toPrometheus(const std::string& prefix = "libiban") const;
+};
+
+StatsSnapshot getStats();
+void resetStats();
+
+#if LIBIBAN_ENABLE_STATS
+
+namespace detail {
+/// Latency passed to \p recordStats() for calls that were not timed
+constexpr uint64_t notTimed = UINT64_MAX;
+
+void recordStats(StatsOperation operation, const char* iban, size_t length, int status,
+                 uint64_t nanoseconds) noexcept;
+void recordBatchStats(const char* const* ibans, const uint8_t* lengths, size_t count,
+                      const uint8_t* results, uint64_t nanoseconds) noexcept;
+
+/**
+ * Returns the time passed since \p start.
+ *
+ * @param start The start of the measured call
+ * @return The elapsed time in nanoseconds
+ */
+inline uint64_t getElapsedTime(std::chrono::steady_clock::time_point start) noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * Decides whether to time the next call of the calling thread.
+ *
+ * @return \p true for every \p latencySampleRate-th call
+ */
+inline bool isLatencySampled() noexcept {
+    thread_local unsigned calls = 0;
+    return ++calls % latencySampleRate == 0;
+}
+
+/// Measures one call and records it when going out of scope
+class StatsRecorder {
+public:
+    explicit StatsRecorder(StatsOperation operation) noexcept :
+            m_operation(operation), m_timed(isLatencySampled()) {
+        if (m_timed) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StatsRecorder() {
+        recordStats(m_operation, m_iban, m_length, m_status, m_timed ? getElapsedTime(m_start) : notTimed);
+    }
+
+    StatsRecorder(const StatsRecorder&) = delete;
+    StatsRecorder& operator=(const StatsRecorder&) = delete;
+
+    /**
+     * Sets the result of the call; calls without a result (e.g. because of
+     * an exception unrelated to the IBAN) only count towards the calls and
+     * the latency.
+     *
+     * @param status The result of the call
+     * @param iban The IBAN whose first two characters are its country code
+     * @param length The length of \p iban
+     */
+    void setResult(ParseStatus status, const char* iban, size_t length) noexcept {
+        m_status = static_cast<int>(status);
+        m_iban = iban;
+        m_length = length;
+    }
+
+private:
+    /// The measured operation
+    StatsOperation m_operation;
+    /// Whether the call is timed
+    bool m_timed;
+    /// Start of the call if it is timed
+    std::chrono::steady_clock::time_point m_start;
+    /// Result of the call or -1 if there is none
+    int m_status {-1};
+    /// The handled IBAN
+    const char* m_iban {nullptr};
+    /// Length of \p m_iban
+    size_t m_length {0};
+};
+}
+
+/// Starts measuring the enclosing call as \p operation
+#define LIBIBAN_STATS_SCOPE(operation) \
+    ::IBAN::detail::StatsRecorder libibanStatsRecorder(::IBAN::StatsOperation::operation)
+/// Sets the result of the call measured by \p LIBIBAN_STATS_SCOPE
+#define LIBIBAN_STATS_RESULT(status, iban, length) \
+    libibanStatsRecorder.setResult(status, iban, length)
+/// Starts measuring the enclosing batch
+#define LIBIBAN_STATS_BATCH_SCOPE() \
+    const std::chrono::steady_clock::time_point libibanStatsStart = std::chrono::steady_clock::now()
+/// Records the batch measured by \p LIBIBAN_STATS_BATCH_SCOPE
+#define LIBIBAN_STATS_BATCH(ibans, lengths, count, results) \
+    ::IBAN::detail::recordBatchStats(ibans, lengths, count, results, \
+                                     ::IBAN::detail::getElapsedTime(libibanStatsStart))
+
+#else
+
+#define LIBIBAN_STATS_SCOPE(operation) static_cast<void>(0)
+#define LIBIBAN_STATS_RESULT(status, iban, length) static_cast<void>(0)
+#define LIBIBAN_STATS_BATCH_SCOPE() static_cast<void>(0)
+#define LIBIBAN_STATS_BATCH(ibans, lengths, count, results) static_cast<void>(0)
+
+#endif
+
+} // end of namespace IBAN
+
+#endif //LIBIBAN_STATS_H
@@ -32,55 +32,22 @@
  */
 
 #include "utils.h"
-
-// If using Boost Random
-#if USE_BOOST
-
-#include <boost/random/random_device.hpp>
-#include <boost/random/uniform_int_distribution.hpp>
+#include "generator.h"
 
 /**
- * Generates and returns a randomly generated alphanumeric string.
+ * Generates and returns a randomly generated alphanumeric string. Each thread
+ * draws from its own pseudo-random number generator seeded once from the
+ * random device, so the function is fast and may be called concurrently.
  *
  * @param length The desired length of the string
  * @return Randomly generated alphanumeric string with length \p length
  */
 std::string generateRandomString(const size_t length) {
-    static const std::string chars("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
-    boost::random::random_device rng;
-    boost::random::uniform_int_distribution<> index_dist(0, static_cast<int>(chars.size() - 1));
-    std::string str = "";
-    for (size_t i = 0; i < length; i++) {
-        str.push_back(chars[static_cast<size_t>(index_dist(rng))]);
+    static const char chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    thread_local IBAN::Xoshiro256 random(IBAN::Xoshiro256::randomSeed());
+    std::string str(length, '\0');
+    for (auto& ch : str) {
+        ch = chars[random.uniform(sizeof(chars) - 1)];
     }
     return str;
 }
-
-#else
-
-#include <ctime>
-
-/**
- * Generates and returns a randomly generated alphanumeric string.
- *
- * @param length The desired length of the string
- * @return Randomly generated alphanumeric string with length \p length
- */
-std::string generateRandomString(const size_t length) {
-    static const std::string chars("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
-
-    // add a changing factor 'div' to seed so there is a bit more diversity
-    // The test will fail without it, because they are running so fast, that
-    // each of them gets the same random number xD
-    static long div = 100;
-    std::srand(static_cast<unsigned int>(std::time(0) + (div % 1000000)));
-    div += 42;
-
-    std::string str = "";
-    for (size_t i = 0; i < length; i++) {
-        str.push_back(chars[static_cast<size_t>(std::rand()) % (chars.length() - 1)]);
-    }
-    return str;
-}
-
-#endif
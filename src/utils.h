@@ -37,6 +37,7 @@
 #include <string>
 #include <algorithm>
 #include <stdexcept>
+#include <cstdint>
 
 /**
  * Trims a string and removes whitespace characters.
@@ -119,5 +120,65 @@ inline long getReminderForIBANString(const std::string& string) {
     return num % 97;
 }
 
+/**
+ * Feeds \p length characters of \p string into a running IBAN remainder
+ * (modulo 97). Digits are taken as they are and letters are expanded to their
+ * position in the latin alphabet plus 9, just as \p makeNumerical() does, but
+ * without ever building the numerical string. Calling this function with the
+ * pieces of a string one after another yields the same remainder as feeding
+ * the whole string at once.
+ *
+ * @param remainder The remainder to update; start with 0
+ * @param string The characters to feed
+ * @param length The number of characters to feed
+ * @return \p false if \p string contains non-alphanumerical characters, in
+ * which case \p remainder is left unchanged
+ */
+inline bool updateRemainder(unsigned& remainder, const char* string,
+                            const size_t length) {
+    // the remainder is below 97, so seven expanded characters (at most 14
+    // decimal digits) can be accumulated before a 64 bit integer overflows
+    uint64_t acc = remainder;
+    size_t pending = 0;
+    for (size_t i = 0; i < length; ++i) {
+        const unsigned ch = static_cast<unsigned char>(string[i]);
+        const unsigned digit = ch - '0';
+        if (digit < 10) {
+            acc = acc * 10 + digit;
+        } else {
+            const unsigned letter = (ch | 0x20) - 'a';
+            if (letter >= 26) {
+                return false;
+            }
+            acc = acc * 100 + letter + 10;
+        }
+        if (++pending == 7) {
+            acc %= 97;
+            pending = 0;
+        }
+    }
+    remainder = static_cast<unsigned>(acc % 97);
+    return true;
+}
+
+/**
+ * Calculates the remainder (modulo 97) of an IBAN given in its machine form
+ * (country code, check sum, BBAN) in a single pass over the characters. The
+ * country code and check sum are moved behind the BBAN on the fly, so no
+ * temporary string is created.
+ *
+ * @param iban The IBAN in machine form
+ * @param length The length of \p iban
+ * @return The remainder of the IBAN or -1 if \p iban is shorter than four
+ * characters or contains non-alphanumerical characters
+ */
+inline int getRemainderForIBAN(const char* iban, const size_t length) {
+    unsigned remainder = 0;
+    if (length < 4 || !updateRemainder(remainder, iban + 4, length - 4) ||
+        !updateRemainder(remainder, iban, 4)) {
+        return -1;
+    }
+    return static_cast<int>(remainder);
+}
 
 #endif //LIBIBAN_UTILS_H
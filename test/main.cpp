@@ -34,9 +34,57 @@
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <system_error>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "../src/libiban.h"
+#include "../src/arena.h"
+#include "../src/bankdirectory.h"
+#include "../src/bulk.h"
+#include "../src/column.h"
+#include "../src/correction.h"
+#include "../src/countrytable.h"
+#include "../src/epoch.h"
+#include "../src/file.h"
+#include "../src/filter.h"
+#include "../src/generator.h"
+#include "../src/ibanset.h"
+#include "../src/literal.h"
+#include "../src/national.h"
+#include "../src/normalize.h"
+#include "../src/prefixindex.h"
+#include "../src/scanner.h"
+#include "../src/service.h"
+#include "../src/stats.h"
 #include "../src/utils.h"
 
+// Requires that copies of a snapshot with a wrong magic, without the last byte
+// or without any bytes are rejected from memory and from a file at path, and
+// that opening a missing file fails
+template <class T>
+void requireMalformedRejected(const std::vector<char>& snapshot, const std::string& path) {
+    std::vector<char> wrongMagic = snapshot;
+    wrongMagic[0] = 'X';
+    const std::vector<char> truncated(snapshot.begin(), snapshot.end() - 1);
+    for (const std::vector<char>& malformed : {wrongMagic, truncated, std::vector<char>()}) {
+        REQUIRE_THROWS_AS(T::fromBuffer(malformed), const std::runtime_error&);
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(malformed.data(), static_cast<std::streamsize>(malformed.size()));
+        }
+        REQUIRE_THROWS_AS(T::open(path), const std::runtime_error&);
+    }
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(T::open(path), const std::system_error&);
+}
+
 // Test case for trim function in utils.h
 TEST_CASE("trim", "[utils]") {
     std::string test = "345 sdfnsf8 403  fsdfs \na\t asda";
@@ -59,6 +107,98 @@ TEST_CASE("generateRandomString", "[utils]") {
     REQUIRE(test != test2);
 }
 
+TEST_CASE("updateRemainder", "[utils]") {
+    std::vector<std::string> tests = {
+        "370400440532013000DE89", "WEST12345698765432GB82",
+        "0001000201529153355002TR02", "MALT011000012345MTLCAST001SMT84",
+    };
+    for (const auto& str : tests) {
+        unsigned remainder = 0;
+        REQUIRE(updateRemainder(remainder, str.data(), str.length()));
+        REQUIRE(remainder == getReminderForIBANString(makeNumerical(str)));
+
+        // feeding the string piecewise yields the same result
+        unsigned piecewise = 0;
+        for (size_t i = 0; i < str.length(); i += 3) {
+            REQUIRE(updateRemainder(piecewise, str.data() + i,
+                                    std::min<size_t>(3, str.length() - i)));
+        }
+        REQUIRE(piecewise == remainder);
+    }
+
+    unsigned remainder = 42;
+    REQUIRE(!updateRemainder(remainder, "12/4", 4));
+    REQUIRE(remainder == 42);
+    REQUIRE(!updateRemainder(remainder, "12@4", 4));
+}
+
+TEST_CASE("getRemainderForIBAN", "[utils]") {
+    REQUIRE(getRemainderForIBAN("DE89370400440532013000", 22) == 1);
+    REQUIRE(getRemainderForIBAN("GB82WEST12345698765432", 22) == 1);
+    REQUIRE(getRemainderForIBAN("gb82west12345698765432", 22) == 1);
+    REQUIRE(getRemainderForIBAN("GB82TEST12345698765432", 22) != 1);
+    REQUIRE(getRemainderForIBAN("GB82 WEST12345698765432", 23) == -1);
+    REQUIRE(getRemainderForIBAN("GB8", 3) == -1);
+}
+
+// Test case for the compiled-in country registry
+TEST_CASE("CountryRegistry", "[registry]") {
+    static_assert(IBAN::getIBANLength('D', 'E') == 22, "DE must have 22 characters");
+    static_assert(IBAN::getIBANLength('X', 'X') == 0, "XX must be unknown");
+    REQUIRE(IBAN::getIBANLength('N', 'O') == 15);
+    REQUIRE(IBAN::getIBANLength('S', 'A') == 24);
+    REQUIRE(IBAN::getIBANLength('d', 'e') == 0);
+    REQUIRE(IBAN::getIBANLength('D', '1') == 0);
+    REQUIRE(IBAN::getCountryIndex('A', 'A') == 0);
+    REQUIRE(IBAN::getCountryIndex('Z', 'Z') == IBAN::countryCodeCount - 1);
+    REQUIRE(IBAN::getCountryIndex('@', 'A') == IBAN::countryCodeCount);
+
+    // the map is a view of the registry
+    size_t countries = 0;
+    for (size_t i = 0; i < IBAN::countryCodeCount; ++i) {
+        countries += IBAN::CountryRegistry::lengths[i] != 0;
+    }
+    REQUIRE(IBAN::IBAN::m_countryCodes.size() == countries);
+    for (const auto& country : IBAN::IBAN::m_countryCodes) {
+        REQUIRE(IBAN::getIBANLength(country.first[0], country.first[1]) == country.second);
+    }
+}
+
+// Test case for the BBAN structures
+TEST_CASE("BBANStructure", "[registry]") {
+    IBAN::BBANStructure structure;
+    REQUIRE(IBAN::compileBBANFormat("4!a6!n8!n", structure));
+    REQUIRE(structure.length == 18);
+    REQUIRE(structure.matches("WEST12345698765432", 18));
+    REQUIRE(!structure.matches("WEST1234569876543", 17));
+    REQUIRE(!structure.matches("WES312345698765432", 18));
+    REQUIRE(!structure.matches("WESTA2345698765432", 18));
+    REQUIRE(!structure.matches("west12345698765432", 18));
+    REQUIRE(IBAN::compileBBANFormat("12c", structure));
+    REQUIRE(structure.matches("ABC123def456", 12) == false);
+    REQUIRE(structure.matches("ABC123DEF456", 12));
+
+    REQUIRE(!IBAN::compileBBANFormat("", structure));
+    REQUIRE(!IBAN::compileBBANFormat("4!x", structure));
+    REQUIRE(!IBAN::compileBBANFormat("!n", structure));
+    REQUIRE(!IBAN::compileBBANFormat("4!n4", structure));
+    REQUIRE(!IBAN::compileBBANFormat("20!n11!n", structure));
+    REQUIRE(structure.length == 12);
+
+    // every country has a structure matching its length
+    for (size_t i = 0; i < IBAN::countryFormatCount; ++i) {
+        const IBAN::CountryFormat& format = IBAN::CountryRegistry::formats[i];
+        const IBAN::BBANStructure* s = IBAN::getBBANStructure(format.countryCode[0], format.countryCode[1]);
+        REQUIRE(s);
+        REQUIRE(s->length + 4u == IBAN::getIBANLength(format.countryCode[0], format.countryCode[1]));
+        REQUIRE(s->bankOffset + s->bankLength <= s->length);
+        REQUIRE(s->branchOffset + s->branchLength <= s->length);
+    }
+    REQUIRE(IBAN::countryFormatCount == IBAN::IBAN::m_countryCodes.size());
+    REQUIRE(!IBAN::getBBANStructure('X', 'X'));
+    REQUIRE(!IBAN::getBBANStructure('d', 'e'));
+}
+
 // Test case for constructor
 TEST_CASE("createFromString", "[libiban]") {
     IBAN::IBAN iban = IBAN::IBAN::createFromString("DE68 2105 0170 0012 3456 78");
@@ -146,6 +286,73 @@ TEST_CASE("getHumanReadable", "[libiban]") {
 }
 
 // Test cases for validation
+TEST_CASE("getStatus", "[libiban]") {
+    auto iban = IBAN::IBAN::createFromString("DE89370400440532013000");
+    REQUIRE(!iban.isValidated());
+    REQUIRE(iban.getStatus() == IBAN::ParseStatus::OK);
+    REQUIRE(iban.isValidated());
+    REQUIRE(iban.validate());
+
+    auto eager = IBAN::IBAN::createFromString("DE89370400440532013001", IBAN::ValidationPolicy::OnConstruction);
+    REQUIRE(eager.isValidated());
+    REQUIRE(eager.getStatus() == IBAN::ParseStatus::ChecksumMismatch);
+    REQUIRE(!eager.validate());
+
+    // copies, moves and swaps carry the verdict along
+    auto lazy = IBAN::IBAN::createFromString("GB82WEST12345698765432");
+    auto copy = eager;
+    REQUIRE(copy.isValidated());
+    REQUIRE(copy.getStatus() == IBAN::ParseStatus::ChecksumMismatch);
+    auto moved = std::move(copy);
+    REQUIRE(moved.isValidated());
+    swap(moved, lazy);
+    REQUIRE(!moved.isValidated());
+    REQUIRE(lazy.getStatus() == IBAN::ParseStatus::ChecksumMismatch);
+    lazy = moved;
+    REQUIRE(!lazy.isValidated());
+    REQUIRE(lazy.getStatus() == IBAN::ParseStatus::OK);
+    REQUIRE(IBAN::IBAN::generateIBAN("FR").isValidated());
+
+    REQUIRE(IBAN::IBAN::createFromString("XX89370400440532013000").getStatus() ==
+            IBAN::ParseStatus::InvalidCountryCode);
+    REQUIRE(IBAN::IBAN::createFromString("DE8937040044053201300").getStatus() ==
+            IBAN::ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::createFromString("GB82WES312345698765432").getStatus() ==
+            IBAN::ParseStatus::InvalidStructure);
+}
+
+TEST_CASE("formatHumanReadable", "[libiban]") {
+    auto iban = IBAN::IBAN::createFromString("DE89370400440532013000");
+    char buffer[IBAN::maxHumanReadableLength];
+    size_t length = iban.formatHumanReadable(buffer, sizeof(buffer));
+    REQUIRE(std::string(buffer, length) == "DE89 3704 0044 0532 0130 00");
+    length = iban.formatHumanReadable(buffer, sizeof(buffer), 3, '-');
+    REQUIRE(std::string(buffer, length) == "DE8-937-040-044-053-201-300-0");
+    length = iban.formatHumanReadable(buffer, sizeof(buffer), 0);
+    REQUIRE(std::string(buffer, length) == "DE89370400440532013000");
+    length = iban.formatHumanReadable(buffer, sizeof(buffer), 22);
+    REQUIRE(std::string(buffer, length) == "DE89370400440532013000");
+    // too small buffers are left alone
+    REQUIRE(iban.formatHumanReadable(buffer, 26) == 0);
+    REQUIRE(iban.formatHumanReadable(buffer, 27) == 27);
+    REQUIRE(iban.formatHumanReadable(buffer, sizeof(buffer), 1) == 0);
+
+    length = iban.formatMachine(buffer, sizeof(buffer));
+    REQUIRE(std::string(buffer, length) == "DE89370400440532013000");
+    REQUIRE(iban.formatMachine(buffer, 21) == 0);
+
+    const IBAN::CompactIBAN compact(iban);
+    length = compact.formatHumanReadable(buffer, sizeof(buffer), 4, '.');
+    REQUIRE(std::string(buffer, length) == "DE89.3704.0044.0532.0130.00");
+    length = compact.formatMachine(buffer, sizeof(buffer));
+    REQUIRE(std::string(buffer, length) == "DE89370400440532013000");
+    REQUIRE(IBAN::CompactIBAN().formatHumanReadable(buffer, sizeof(buffer)) == 0);
+
+    // the longest IBANs fit into the buffer
+    auto longest = IBAN::IBAN::generateIBAN("LC");
+    REQUIRE(longest.formatHumanReadable(buffer, sizeof(buffer)) == longest.getHumanReadable().size());
+}
+
 TEST_CASE("validate", "[libiban]") {
     std::vector<std::string> valid = {
         "AL06202111090000000005012075", "AD1000060004451247870930",
@@ -307,11 +514,1769 @@ TEST_CASE("validate", "[libiban]") {
     for (const auto& str : valid) {
         auto num = IBAN::IBAN::createFromString(str);
         REQUIRE(num.validate());
+        REQUIRE(IBAN::isValidIBAN(str));
     }
     for (const auto& str : invalid) {
         auto num = IBAN::IBAN::createFromString(str);
         REQUIRE(!num.validate());
+        REQUIRE(!IBAN::isValidIBAN(str));
+    }
+}
+
+// Test cases for bank and branch codes
+TEST_CASE("getBankCode", "[libiban]") {
+    IBAN::IBAN iban = IBAN::IBAN::createFromString("GB82 WEST 1234 5698 7654 32");
+    REQUIRE(iban.getBankCode() == "WEST");
+    REQUIRE(iban.getBranchCode() == "123456");
+    IBAN::IBAN iban2 = IBAN::IBAN::createFromString("DE89370400440532013000");
+    REQUIRE(iban2.getBankCode() == "37040044");
+    REQUIRE(iban2.getBranchCode() == "");
+    IBAN::IBAN iban3 = IBAN::IBAN::createFromString("IT60X0542811101000000123456");
+    REQUIRE(iban3.getBankCode() == "05428");
+    REQUIRE(iban3.getBranchCode() == "11101");
+    IBAN::IBAN iban4 = IBAN::IBAN::createFromString("XX60X0542811101000000123456");
+    REQUIRE(iban4.getBankCode() == "");
+    IBAN::IBAN iban5 = IBAN::IBAN::createFromString("GB82WES");
+    REQUIRE(iban5.getBankCode() == "");
+}
+
+// Test cases for the non-throwing parser
+TEST_CASE("tryParse", "[libiban]") {
+    using IBAN::ParseStatus;
+    char buffer[IBAN::maxIBANLength];
+    size_t length = 0;
+    REQUIRE(IBAN::IBAN::tryParse(" gb82 West 1234 5698 7654 32", buffer, &length) == ParseStatus::OK);
+    REQUIRE(std::string(buffer, length) == "GB82WEST12345698765432");
+    REQUIRE(IBAN::IBAN::tryParse("DE89370400440532013000") == ParseStatus::OK);
+
+    REQUIRE(IBAN::IBAN::tryParse("BLA") == ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::tryParse("") == ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::tryParse("DE89 3704 0044 0532 0130 0000 0000 0000 0") == ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::tryParse("DE8937040044053201300") == ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::tryParse("B1af935395") == ParseStatus::InvalidCountryCode);
+    REQUIRE(IBAN::IBAN::tryParse("XX89370400440532013000") == ParseStatus::InvalidCountryCode);
+    REQUIRE(IBAN::IBAN::tryParse("DEA9370400440532013000") == ParseStatus::InvalidChecksumDigits);
+    REQUIRE(IBAN::IBAN::tryParse("DE682105017000/2345678") == ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::IBAN::tryParse("DE8937040044053201300X") == ParseStatus::InvalidStructure);
+    REQUIRE(IBAN::IBAN::tryParse("GB8212345123456987654X") == ParseStatus::InvalidStructure);
+    REQUIRE(!IBAN::IBAN::createFromString("DE8937040044053201300X").validate());
+    REQUIRE(IBAN::IBAN::tryParse("DE88370400440532013000") == ParseStatus::ChecksumMismatch);
+
+    REQUIRE(IBAN::isValidIBAN(IBAN::StringView("NL91ABNA0417164300xyz", 18)));
+    REQUIRE(!IBAN::isValidIBAN("NL91ABNA0417164301"));
+}
+
+// Test cases for the compact value type
+TEST_CASE("CompactIBAN", "[libiban]") {
+    IBAN::IBAN iban = IBAN::IBAN::createFromString(" GB82 WEST 1234 5698 7654 32");
+    IBAN::CompactIBAN compact(iban);
+    REQUIRE(compact.size() == 22);
+    REQUIRE(compact.getCountryCode() == "GB");
+    REQUIRE(compact.getChecksum() == "82");
+    REQUIRE(compact.getBBAN() == "WEST12345698765432");
+    REQUIRE(compact.getMachineForm() == "GB82WEST12345698765432");
+    REQUIRE(compact.validate());
+    REQUIRE(compact.toIBAN() == iban);
+
+    IBAN::CompactIBAN parsed;
+    REQUIRE(IBAN::CompactIBAN::tryParse("gb82west12345698765432", parsed) == IBAN::ParseStatus::OK);
+    REQUIRE(parsed == compact);
+    IBAN::CompactIBAN copy = parsed;
+    REQUIRE(copy == compact);
+
+    IBAN::CompactIBAN untouched = parsed;
+    REQUIRE(IBAN::CompactIBAN::tryParse("GB82TEST12345698765432", untouched) == IBAN::ParseStatus::ChecksumMismatch);
+    REQUIRE(untouched == parsed);
+
+    IBAN::CompactIBAN other;
+    REQUIRE(other.empty());
+    REQUIRE(!other.validate());
+    REQUIRE(IBAN::CompactIBAN::tryParse("GB29NWBK60161331926819", other) == IBAN::ParseStatus::OK);
+    REQUIRE(other != compact);
+    REQUIRE(other < compact);
+    REQUIRE(!(compact < other));
+
+    // invalid IBANs can be held as well
+    IBAN::CompactIBAN invalid(IBAN::IBAN::createFromString("AD43oh8445353ADF"));
+    REQUIRE(invalid.getMachineForm() == "AD43OH8445353ADF");
+    REQUIRE(!invalid.validate());
+}
+
+// Test cases for the packed binary form
+TEST_CASE("PackedIBAN", "[libiban]") {
+    std::vector<std::string> ibans = {
+        "DE89370400440532013000", "DE68210501700012345678", "DE02100500000024290661",
+        "GB82WEST12345698765432", "GB29NWBK60161331926819", "NO9386011117947",
+        "LC55HEMM000100010012001200023015", "MT84MALT011000012345MTLCAST001S",
+        "QA58DOHB00001234567890ABCDEFG", "BE68539007547034", "AD1000060004451247870930",
+        "DE88370400440532013000", "NI92BAMC000000000000000003123123",
+    };
+    std::vector<IBAN::PackedIBAN> packed;
+    for (const auto& str : ibans) {
+        IBAN::PackedIBAN p;
+        REQUIRE(IBAN::PackedIBAN::pack(str, p));
+        REQUIRE(p.size() <= IBAN::maxPackedIBANSize);
+        REQUIRE(p == IBAN::IBAN::createFromString(str).getPackedForm());
+
+        IBAN::CompactIBAN unpacked;
+        REQUIRE(p.unpack(unpacked));
+        REQUIRE(unpacked.getMachineForm() == str);
+
+        IBAN::PackedIBAN copy(p.data(), p.size());
+        REQUIRE(copy == p);
+        packed.push_back(p);
+    }
+    REQUIRE(packed[0].size() == 10);
+    REQUIRE(packed[5].size() == 7);
+
+    // bytewise order equals the order of the machine forms
+    for (size_t i = 0; i < ibans.size(); ++i) {
+        for (size_t j = 0; j < ibans.size(); ++j) {
+            REQUIRE((ibans[i] < ibans[j]) == (packed[i] < packed[j]));
+        }
+    }
+
+    IBAN::PackedIBAN p;
+    REQUIRE(!IBAN::PackedIBAN::pack("DE8937040044053201300", p));
+    REQUIRE(!IBAN::PackedIBAN::pack("XX89370400440532013000", p));
+    REQUIRE(!IBAN::PackedIBAN::pack("DE89370400440532013/00", p));
+    REQUIRE(!IBAN::PackedIBAN::pack("de89370400440532013000", p));
+    REQUIRE(!IBAN::PackedIBAN::pack("DE89370400440532A13000", p));
+    REQUIRE(p.empty());
+    REQUIRE(IBAN::IBAN::createFromString("AD43oh8445353ADF").getPackedForm().empty());
+
+    IBAN::CompactIBAN unpacked;
+    REQUIRE(!p.unpack(unpacked));
+    const uint8_t garbage[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    REQUIRE(!IBAN::PackedIBAN(garbage, sizeof(garbage)).unpack(unpacked));
+    // NO with a BBAN number exceeding eleven decimal digits
+    const uint8_t overflow[] = {0x58, 0x2E, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    REQUIRE(!IBAN::PackedIBAN(overflow, sizeof(overflow)).unpack(unpacked));
+    REQUIRE(!IBAN::PackedIBAN(overflow, 6).unpack(unpacked));
+    const uint8_t maximum[] = {0x58, 0x2E, 0xDD, 0x21, 0xDB, 0x9F, 0xFC};
+    REQUIRE(IBAN::PackedIBAN(maximum, sizeof(maximum)).unpack(unpacked));
+    REQUIRE(unpacked.getMachineForm() == "NO9399999999999");
+    // a set padding bit would make a second packed form of the same IBAN
+    const uint8_t padded[] = {0x58, 0x2E, 0xDD, 0x21, 0xDB, 0x9F, 0xFD};
+    REQUIRE(!IBAN::PackedIBAN(padded, sizeof(padded)).unpack(unpacked));
+    for (const auto& original : packed) {
+        std::vector<uint8_t> bytes(original.data(), original.data() + original.size());
+        bytes.back() ^= 1;
+        IBAN::PackedIBAN corrupted(bytes.data(), bytes.size());
+        IBAN::PackedIBAN repacked;
+        if (corrupted.unpack(unpacked)) {
+            REQUIRE(IBAN::PackedIBAN::pack(unpacked.getMachineForm(), repacked));
+            REQUIRE(repacked == corrupted);
+        }
+    }
+    unpacked = IBAN::CompactIBAN();
+    REQUIRE(unpacked.empty());
+}
+
+TEST_CASE("validateBatch", "[libiban]") {
+    std::vector<std::string> inputs = {
+        "DE89370400440532013000", "DE89370400440532013001", "DE8937040044053201300",
+        "de89370400440532013000", "DE89 3704 0044 0532 0130 00", "XX89370400440532013000",
+        "DE8937040044053201300A", "GB82WEST12345698765432", "GB82WEST1234569876543A",
+        "GB82W3ST12345698765432", "NO9386011117947", "MT84MALT011000012345MTLCAST001S",
+        "LC55HEMM000100010012001200023015", "RU0304452522540817810538091310419", "",
+        "DE", "DE8X370400440532013000", "DE89370400440532013000\n"
+    };
+    for (const auto& country : IBAN::IBAN::m_countryCodes) {
+        for (int i = 0; i < 10; ++i) {
+            auto iban = IBAN::IBAN::generateIBAN(country.first).getMachineForm();
+            inputs.push_back(iban);
+            // a wrong check sum or a single wrong character must be found
+            iban[3] = iban[3] == '9' ? '0' : static_cast<char>(iban[3] + 1);
+            inputs.push_back(iban);
+            iban[3 + iban.size() / 2] = '@';
+            inputs.push_back(iban);
+        }
+    }
+
+    std::vector<const char*> pointers;
+    std::vector<uint8_t> lengths;
+    for (const auto& str : inputs) {
+        pointers.push_back(str.data());
+        lengths.push_back(static_cast<uint8_t>(str.size()));
+    }
+    std::vector<uint8_t> expected;
+    for (const auto& str : inputs) {
+        expected.push_back(static_cast<uint8_t>(IBAN::IBAN::tryParse(str)));
+    }
+    REQUIRE(expected[0] == static_cast<uint8_t>(IBAN::ParseStatus::OK));
+    REQUIRE(expected[1] == static_cast<uint8_t>(IBAN::ParseStatus::ChecksumMismatch));
+
+    for (auto kernel : {IBAN::BatchKernel::Auto, IBAN::BatchKernel::Scalar,
+                        IBAN::BatchKernel::SSE42, IBAN::BatchKernel::AVX2}) {
+        std::vector<uint8_t> results(inputs.size(), 0xFF);
+        IBAN::validateBatch(pointers.data(), lengths.data(), inputs.size(), results.data(), kernel);
+        REQUIRE(results == expected);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    // IBANs ending right before an inaccessible page must not be read beyond
+    const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    void* mapping = ::mmap(nullptr, 2 * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mapping != MAP_FAILED);
+    char* end = static_cast<char*>(mapping) + pageSize;
+    REQUIRE(::mprotect(end, pageSize, PROT_NONE) == 0);
+    const std::vector<std::string> edgeInputs = {"DE89370400440532013000", "NO9386011117947",
+                                                 "DE89370400440532013001", "LC55HEMM000100010012001200023015",
+                                                 "de89 3704 0044 0532 0130 00", "DE"};
+    for (const auto& iban : edgeInputs) {
+        std::memcpy(end - iban.size(), iban.data(), iban.size());
+        const char* pointer = end - iban.size();
+        const uint8_t length = static_cast<uint8_t>(iban.size());
+        for (auto kernel : {IBAN::BatchKernel::Scalar, IBAN::BatchKernel::SSE42, IBAN::BatchKernel::AVX2}) {
+            uint8_t result = 0xFF;
+            IBAN::validateBatch(&pointer, &length, 1, &result, kernel, true);
+            REQUIRE(result == static_cast<uint8_t>(IBAN::IBAN::tryParse(iban)));
+            IBAN::validateBatch(&pointer, &length, 0, &result, kernel);
+            REQUIRE(result == static_cast<uint8_t>(IBAN::IBAN::tryParse(iban)));
+        }
+    }
+    ::munmap(mapping, 2 * pageSize);
+#endif
+}
+
+TEST_CASE("BulkValidator", "[bulk]") {
+    std::vector<std::string> records = {
+        "DE89370400440532013000", "DE89370400440532013001", "", "GB82 WEST 1234 5698 7654 32",
+        "NO9386011117947\r", "XX89370400440532013000",
+        "  DE89   3704  0044  0532  0130  00                                                        "
+        "                                                                                           "
+        "                                                                                           "
+    };
+    for (int i = 0; i < 500; ++i) {
+        auto iban = IBAN::IBAN::generateIBAN(i % 2 ? "DE" : "MT").getMachineForm();
+        if (i % 3 == 0) {
+            iban[2] = iban[2] == '9' ? '0' : static_cast<char>(iban[2] + 1);
+        }
+        records.push_back(iban);
+    }
+    std::string buffer;
+    std::vector<uint8_t> expected;
+    for (const auto& record : records) {
+        buffer += record + "\n";
+        std::string trimmed = record;
+        if (!trimmed.empty() && trimmed.back() == '\r') {
+            trimmed.pop_back();
+        }
+        expected.push_back(static_cast<uint8_t>(IBAN::IBAN::tryParse(trimmed)));
+    }
+    REQUIRE(expected[6] == static_cast<uint8_t>(IBAN::ParseStatus::OK));
+    REQUIRE(IBAN::BulkValidator::countRecords(buffer.data(), buffer.size()) == records.size());
+    REQUIRE(IBAN::BulkValidator::countRecords(buffer.data(), buffer.size() - 1) == records.size());
+    REQUIRE(IBAN::BulkValidator::countRecords(buffer.data(), 0) == 0);
+
+    for (size_t threads : {1, 3, 8}) {
+        for (size_t chunkSize : {1, 7, 100, 4096, 1 << 20}) {
+            IBAN::BulkValidator validator(threads, threads == 3, chunkSize);
+            REQUIRE(validator.getThreadCount() == threads);
+            REQUIRE(validator.validate(buffer.data(), buffer.size()) == expected);
+            // the last record need not end with a newline
+            REQUIRE(validator.validate(buffer.data(), buffer.size() - 1) == expected);
+        }
+    }
+    IBAN::BulkValidator validator;
+    REQUIRE(validator.getThreadCount() > 0);
+    REQUIRE(validator.getChunkSize() == IBAN::BulkValidator::defaultChunkSize);
+    REQUIRE(validator.validate(buffer.data(), 0).empty());
+    REQUIRE(validator.validate("\n", 1) == std::vector<uint8_t>(1, static_cast<uint8_t>(IBAN::ParseStatus::InvalidLength)));
+}
+
+TEST_CASE("validateFile", "[file]") {
+    const std::string path = "libiban_test_records.txt";
+    std::vector<std::string> records = {"DE89370400440532013000", "GB82WEST12345698765432\r", "",
+                                        std::string(10000, ' ') + "NO9386011117947", "DE89"};
+    for (int i = 0; i < 2000; ++i) {
+        auto iban = IBAN::IBAN::generateIBAN(i % 2 ? "FR" : "BE").getMachineForm();
+        if (i % 5 == 0) {
+            iban[3] = iban[3] == '9' ? '0' : static_cast<char>(iban[3] + 1);
+        }
+        records.push_back(iban);
+    }
+    std::vector<uint64_t> invalidOffsets;
+    std::vector<bool> valid;
+    std::string contents;
+    for (const auto& record : records) {
+        std::string trimmed = record;
+        if (!trimmed.empty() && trimmed.back() == '\r') {
+            trimmed.pop_back();
+        }
+        valid.push_back(IBAN::isValidIBAN(trimmed));
+        if (!valid.back()) {
+            invalidOffsets.push_back(contents.size());
+        }
+        contents += record + "\n";
+    }
+    REQUIRE(valid[3]);
+    // the last record need not end with a delimiter
+    contents.pop_back();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    for (size_t windowSize : {1, 8192, 1 << 20}) {
+        IBAN::FileValidationOptions options;
+        options.windowSize = windowSize;
+        IBAN::FileValidationResult result;
+        IBAN::validateFile(path, result, options);
+        REQUIRE(result.records == records.size());
+        REQUIRE(result.invalidRecords == invalidOffsets.size());
+        REQUIRE(result.invalidOffsets == invalidOffsets);
+        REQUIRE(result.validBits.empty());
+
+        options.format = IBAN::FileResultFormat::Bitmap;
+        IBAN::validateFile(path, result, options);
+        REQUIRE(result.records == records.size());
+        REQUIRE(result.invalidOffsets.empty());
+        REQUIRE(result.validBits.size() == (records.size() + 63) / 64);
+        for (size_t i = 0; i < valid.size(); ++i) {
+            REQUIRE(((result.validBits[i / 64] >> (i % 64)) & 1) == valid[i]);
+        }
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "DE89370400440532013000;DE89370400440532013001;";
+    }
+    IBAN::FileValidationOptions options;
+    options.delimiter = ';';
+    IBAN::FileValidationResult result;
+    IBAN::validateFile(path, result, options);
+    REQUIRE(result.records == 2);
+    REQUIRE(result.invalidOffsets == std::vector<uint64_t>(1, 23));
+
+    { std::ofstream out(path, std::ios::binary); }
+    IBAN::validateFile(path, result);
+    REQUIRE(result.records == 0);
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(IBAN::validateFile(path, result), const std::system_error&);
+}
+
+TEST_CASE("Xoshiro256", "[generator]") {
+    // reference values of xoshiro256** seeded with SplitMix64
+    IBAN::Xoshiro256 random(42);
+    REQUIRE(random() == 0x15780B2E0C2EC716ull);
+    REQUIRE(random() == 0x6104D9866D113A7Eull);
+    REQUIRE(random() == 0xAE17533239E499A1ull);
+
+    IBAN::Xoshiro256 jumped(42);
+    jumped.jump();
+    REQUIRE(jumped() != 0x15780B2E0C2EC716ull);
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(random.uniform(10) < 10);
+    }
+}
+
+TEST_CASE("IBANGenerator", "[generator]") {
+    std::vector<IBAN::CompactIBAN> ibans(1000), again(1000);
+    IBAN::IBANGenerator(7).generate("DE", ibans.data(), ibans.size());
+    IBAN::IBANGenerator(7).generate("DE", again.data(), again.size());
+    REQUIRE(std::equal(ibans.begin(), ibans.end(), again.begin()));
+    IBAN::IBANGenerator(7, 1).generate("DE", again.data(), again.size());
+    REQUIRE(!(ibans[0] == again[0]));
+    for (const auto& iban : ibans) {
+        REQUIRE(iban.validate());
+        REQUIRE(iban.getCountryCode() == "DE");
+    }
+
+    const std::vector<IBAN::CountryWeight> mix = {{"GB", 3}, {"MT", 1}, {"LC", 0}};
+    IBAN::IBANGenerator generator(11);
+    generator.generate(mix, ibans.data(), ibans.size());
+    size_t british = 0;
+    for (const auto& iban : ibans) {
+        REQUIRE(iban.validate());
+        REQUIRE((iban.getCountryCode() == "GB" || iban.getCountryCode() == "MT"));
+        british += iban.getCountryCode() == "GB";
+    }
+    REQUIRE(british > 650);
+    REQUIRE(british < 850);
+    REQUIRE(generator.generate("BR").validate());
+    REQUIRE_THROWS_AS(generator.generate("XX"), const IBAN::IBANInvalidCountryCodeException&);
+    REQUIRE_THROWS_AS(generator.generate(std::vector<IBAN::CountryWeight>(1, {"DE", 0}), ibans.data(), 1),
+                      const std::invalid_argument&);
+
+    // one generator per thread
+    std::vector<std::vector<IBAN::CompactIBAN>> results(4, std::vector<IBAN::CompactIBAN>(2000));
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&results, t]() {
+            IBAN::IBANGenerator(99, t).generate("FR", results[t].data(), results[t].size());
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& result : results) {
+        for (const auto& iban : result) {
+            REQUIRE(iban.validate());
+        }
+    }
+    REQUIRE(!(results[0][0] == results[1][0]));
+}
+
+TEST_CASE("generateRange", "[generator]") {
+    std::vector<IBAN::CompactIBAN> ibans(1500);
+    IBAN::generateRange("DE", "37040044", 532012500, ibans.size(), ibans.data());
+    REQUIRE(ibans[500].getMachineForm() == "DE89370400440532013000");
+    for (size_t i = 0; i < ibans.size(); ++i) {
+        REQUIRE(ibans[i].validate());
+        REQUIRE(ibans[i].getBankCode() == "37040044");
+        REQUIRE(std::stoull(ibans[i].getBBAN().toString().substr(8)) == 532012500 + i);
+    }
+
+    // the counter may carry into the leading digits and fill them completely
+    IBAN::generateRange("NO", "", 99999999998ull, 2, ibans.data());
+    REQUIRE(ibans[0].getBBAN() == "99999999998");
+    REQUIRE(ibans[1].getBBAN() == "99999999999");
+    REQUIRE(ibans[0].validate());
+    REQUIRE(ibans[1].validate());
+    IBAN::generateRange("GB", "WEST123456", 0, 3, ibans.data());
+    REQUIRE(ibans[2].getMachineForm().toString().substr(4) == "WEST12345600000002");
+    REQUIRE(ibans[2].validate());
+    IBAN::generateRange("NO", "1", 0, 0, nullptr);
+
+    REQUIRE_THROWS_AS(IBAN::generateRange("XX", "", 0, 1, ibans.data()),
+                      const IBAN::IBANInvalidCountryCodeException&);
+    REQUIRE_THROWS_AS(IBAN::generateRange("NO", "", 99999999999ull, 2, ibans.data()),
+                      const std::invalid_argument&);
+    REQUIRE_THROWS_AS(IBAN::generateRange("NO", "12345678901", 0, 1, ibans.data()),
+                      const std::invalid_argument&);
+    REQUIRE_THROWS_AS(IBAN::generateRange("GB", "WES1", 0, 1, ibans.data()),
+                      const std::invalid_argument&);
+    // counters must not overwrite letters
+    REQUIRE_THROWS_AS(IBAN::generateRange("GB", "WE", 0, 1, ibans.data()),
+                      const std::invalid_argument&);
+}
+
+namespace {
+    // counts the blocks requested from the upstream resource
+    class CountingResource : public IBAN::MemoryResource {
+    public:
+        size_t allocations = 0, deallocations = 0;
+
+    protected:
+        void* doAllocate(size_t bytes, size_t alignment) override {
+            ++allocations;
+            return IBAN::MemoryResource::getDefault()->allocate(bytes, alignment);
+        }
+
+        void doDeallocate(void* pointer, size_t bytes, size_t alignment) noexcept override {
+            ++deallocations;
+            IBAN::MemoryResource::getDefault()->deallocate(pointer, bytes, alignment);
+        }
+
+        bool doIsEqual(const IBAN::MemoryResource&) const noexcept override {
+            return false;
+        }
+    };
+}
+
+TEST_CASE("MonotonicArena", "[arena]") {
+    CountingResource upstream;
+    {
+        alignas(16) char buffer[256];
+        IBAN::MonotonicArena arena(buffer, sizeof(buffer), &upstream);
+        void* first = arena.allocate(10, 1);
+        REQUIRE(first == buffer);
+        void* second = arena.allocate(8, 8);
+        REQUIRE(reinterpret_cast<uintptr_t>(second) % 8 == 0);
+        REQUIRE(arena.getUsedSize() == 24);
+        REQUIRE(upstream.allocations == 0);
+        // exceeds the buffer
+        void* large = arena.allocate(1000, 16);
+        REQUIRE(reinterpret_cast<uintptr_t>(large) % 16 == 0);
+        REQUIRE(upstream.allocations == 1);
+        arena.deallocate(large, 1000, 16);
+        REQUIRE(upstream.deallocations == 0);
+        arena.release();
+        REQUIRE(upstream.deallocations == 1);
+        REQUIRE(arena.getUsedSize() == 0);
+        REQUIRE(arena.allocate(10, 1) == buffer);
+        REQUIRE(arena.isEqual(arena));
+        REQUIRE(!arena.isEqual(*IBAN::MemoryResource::getDefault()));
+    }
+
+    IBAN::MonotonicArena arena(1024, &upstream);
+    upstream.allocations = upstream.deallocations = 0;
+    {
+        IBAN::IBANVector batch(&arena);
+        batch.reserve(10000);
+        for (int i = 0; i < 10000; ++i) {
+            batch.push_back(IBAN::IBAN::generateIBAN(i % 2 ? "DE" : "LC"));
+        }
+        const size_t blocks = upstream.allocations;
+        REQUIRE(blocks == 1);
+        for (const auto& iban : batch) {
+            REQUIRE(iban.validate());
+        }
+        IBAN::CompactIBANVector compact(batch.begin(), batch.end(), &arena);
+        REQUIRE(compact.size() == batch.size());
+        REQUIRE(compact[1].toIBAN() == batch[1]);
+        REQUIRE(compact.get_allocator() == IBAN::ArenaAllocator<int>(&arena));
+        REQUIRE(compact.get_allocator() != IBAN::ArenaAllocator<int>());
+    }
+    REQUIRE(upstream.deallocations == 0);
+    arena.release();
+    REQUIRE(upstream.deallocations == upstream.allocations);
+
+    IBAN::IBANVector heap;
+    heap.push_back(IBAN::IBAN::createFromString("DE89 3704 0044 0532 0130 00"));
+    REQUIRE(heap.get_allocator().getResource() == IBAN::MemoryResource::getDefault());
+}
+
+TEST_CASE("IBANColumn", "[column]") {
+    std::vector<std::string> inputs = {
+        "DE89370400440532013000", "de89 3704 0044 0532 0130 01", "GB82WEST12345698765432",
+        "XX89370400440532013000", "DE8X370400440532013000", "DE89370400440532013/00", "",
+        "DE893704004405320130000", "GB82WES312345698765432", "NO9386011117947",
+        "MT84MALT011000012345MTLCAST001S", "AD1200012030200359100100"
+    };
+    IBAN::IBANGenerator generator(5);
+    for (int i = 0; i < 300; ++i) {
+        inputs.push_back(generator.generate(i % 3 ? "FR" : "SM").getMachineForm().toString());
+    }
+    std::string buffer;
+    for (const auto& input : inputs) {
+        buffer += input + "\r\n";
+    }
+    IBAN::IBANColumn column = IBAN::IBANColumn::fromBuffer(buffer.data(), buffer.size());
+    REQUIRE(column.size() == inputs.size());
+    REQUIRE(column.getNullCount() == 3);
+    REQUIRE(column.isNull(4));
+    REQUIRE(!column.isNull(1));
+    REQUIRE(column.get(1).getMachineForm() == "DE89370400440532013001");
+    REQUIRE(column.get(4).empty());
+    // unknown countries are rows, as a table set by setCountryTable() may add them
+    REQUIRE(!column.isNull(3));
+
+    std::vector<uint8_t> results(column.size());
+    column.validate(results.data());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        REQUIRE(results[i] == static_cast<uint8_t>(IBAN::IBAN::tryParse(inputs[i])));
+    }
+
+    // Arrow compatible buffers
+    REQUIRE(column.getBBANOffsets()[0] == 0);
+    REQUIRE(column.getBBANOffsets()[1] == 18);
+    REQUIRE(std::string(column.getBBANData(), 18) == "370400440532013000");
+    REQUIRE(column.getBBANDataSize() == static_cast<size_t>(column.getBBANOffsets()[column.size()]));
+    REQUIRE(column.getCountryIndices()[2] == IBAN::getCountryIndex('G', 'B'));
+    REQUIRE(column.getChecksums()[2] == 82);
+    REQUIRE(column.getValidityBitmap()[0] == 0x8F);
+
+    std::vector<IBAN::CountryGroup> groups;
+    auto order = column.groupByCountry(groups);
+    REQUIRE(order.size() == inputs.size() - 3);
+    REQUIRE(groups.size() == 8);
+    REQUIRE(std::string(groups[0].countryCode) == "AD");
+    REQUIRE(std::string(groups[1].countryCode) == "DE");
+    REQUIRE(groups[1].end - groups[1].begin == 3);
+    REQUIRE(order[groups[1].begin] == 0);
+    REQUIRE(order[groups[1].begin + 1] == 1);
+    for (const auto& group : groups) {
+        for (uint32_t i = group.begin; i < group.end; ++i) {
+            REQUIRE(column.get(order[i]).getCountryCode() == group.countryCode);
+        }
+    }
+
+    IBAN::IBANColumn french = column.filter("FR");
+    REQUIRE(french.size() == 200);
+    REQUIRE(french.getNullCount() == 0);
+    REQUIRE(french.get(0).getMachineForm() == inputs[13]);
+    REQUIRE(column.filter("XX").size() == 1);
+    REQUIRE(column.filter("D").size() == 0);
+
+    std::vector<char> data;
+    std::vector<int32_t> offsets;
+    column.formatMachine(data, offsets);
+    REQUIRE(offsets.size() == column.size() + 1);
+    for (size_t i = 0; i < column.size(); ++i) {
+        const std::string formatted(data.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+        REQUIRE(formatted == (column.isNull(i) ? std::string() : column.get(i).getMachineForm().toString()));
+    }
+    column.formatHumanReadable(data, offsets);
+    for (size_t i = 0; i < column.size(); ++i) {
+        const std::string formatted(data.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+        REQUIRE(formatted == (column.isNull(i) ? std::string() : column.get(i).toIBAN().getHumanReadable()));
+    }
+
+    column.clear();
+    REQUIRE(column.size() == 0);
+    REQUIRE(column.getNullCount() == 0);
+    std::vector<const char*> pointers = {"NO9386011117947", "x"};
+    std::vector<uint8_t> lengths = {15, 1};
+    column.append(pointers.data(), lengths.data(), pointers.size());
+    REQUIRE(column.size() == 2);
+    REQUIRE(column.isNull(1));
+
+    // normalized just as tryParse() does
+    column.clear();
+    const std::vector<std::string> entered = {"DE89-3704-0044-0532-0130-00", "IBAN: gb82.west.1234.5698.7654.32",
+                                              "DE89-3704/0044", "1/", "DE89 3704 0044 0532 0130 0000 0000 0000 000"};
+    for (const auto& input : entered) {
+        column.append(input);
+    }
+    REQUIRE(column.getNullCount() == 3);
+    REQUIRE(column.get(0).getMachineForm() == "DE89370400440532013000");
+    REQUIRE(column.get(1).getMachineForm() == "GB82WEST12345698765432");
+    results.assign(column.size(), 0);
+    column.validate(results.data());
+    for (size_t i = 0; i < entered.size(); ++i) {
+        REQUIRE(results[i] == static_cast<uint8_t>(IBAN::IBAN::tryParse(entered[i])));
+    }
+}
+
+TEST_CASE("hash", "[hash]") {
+    REQUIRE(IBAN::hashBytes("", 0) == IBAN::hashBytes("", 0));
+    REQUIRE(IBAN::hashBytes("DE89", 4) != IBAN::hashBytes("DE89", 4, 1));
+    REQUIRE(IBAN::hashBytes("DE89", 4) != IBAN::hashBytes("DE89\0", 5));
+
+    IBAN::IBAN iban = IBAN::IBAN::createFromString("DE89 3704 0044 0532 0130 00");
+    IBAN::CompactIBAN compact(iban);
+    REQUIRE(iban.hash() == compact.hash());
+    REQUIRE(iban.hash() == IBAN::hashBytes("DE89370400440532013000", 22));
+    REQUIRE(std::hash<IBAN::IBAN>()(iban) == std::hash<IBAN::CompactIBAN>()(compact));
+    REQUIRE(std::hash<IBAN::PackedIBAN>()(iban.getPackedForm()) == iban.getPackedForm().hash());
+    REQUIRE(iban.hash() != IBAN::IBAN::createFromString("DE88370400440532013000").hash());
+
+    // consecutive account numbers must spread over the low bits
+    std::vector<IBAN::CompactIBAN> ibans(1 << 14);
+    IBAN::generateRange("DE", "37040044", 0, ibans.size(), ibans.data());
+    std::vector<size_t> buckets(1 << 10);
+    for (const auto& elem : ibans) {
+        ++buckets[elem.hash() & (buckets.size() - 1)];
+    }
+    for (size_t count : buckets) {
+        REQUIRE(count < 40);
+    }
+}
+
+TEST_CASE("IBANSet", "[hash]") {
+    std::vector<IBAN::CompactIBAN> ibans(5000);
+    IBAN::generateRange("DE", "37040044", 10000, ibans.size(), ibans.data());
+
+    IBAN::IBANSet set;
+    REQUIRE(set.empty());
+    REQUIRE(set.capacity() == 0);
+    REQUIRE(!set.contains(ibans[0]));
+    for (const auto& iban : ibans) {
+        REQUIRE(set.insert(iban));
+    }
+    REQUIRE(set.size() == ibans.size());
+    REQUIRE(!set.insert(ibans[42]));
+    REQUIRE(!set.insert(ibans[42].toIBAN()));
+    REQUIRE(set.size() == ibans.size());
+    REQUIRE(set.getMemoryUsage() == set.capacity() * 23);
+
+    IBAN::CompactIBAN other;
+    IBAN::generateRange("DE", "37040044", 0, 1, &other);
+    REQUIRE(!set.contains(other));
+    for (const auto& iban : ibans) {
+        REQUIRE(set.contains(iban));
+        REQUIRE(set.contains(iban.toIBAN()));
+    }
+
+    // IBANs which cannot be packed are never contained
+    IBAN::IBAN tooShort = IBAN::IBAN::createFromString("DE8937040044053201300");
+    REQUIRE(!set.contains(tooShort));
+    REQUIRE(!set.erase(tooShort));
+    REQUIRE_THROWS_AS(set.insert(tooShort), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(set.insert(IBAN::PackedIBAN()), const std::invalid_argument&);
+
+    // erase every other IBAN, the remaining ones must still be found
+    for (size_t i = 0; i < ibans.size(); i += 2) {
+        REQUIRE(set.erase(ibans[i]));
+    }
+    REQUIRE(!set.erase(ibans[0]));
+    REQUIRE(set.size() == ibans.size() / 2);
+    for (size_t i = 0; i < ibans.size(); ++i) {
+        REQUIRE(set.contains(ibans[i]) == (i % 2 == 1));
+    }
+
+    size_t visited = 0;
+    set.forEach([&](const IBAN::PackedIBAN& packed) {
+        IBAN::CompactIBAN unpacked;
+        REQUIRE(packed.unpack(unpacked));
+        REQUIRE(set.contains(unpacked));
+        ++visited;
+    });
+    REQUIRE(visited == set.size());
+
+    const size_t capacity = set.capacity();
+    set.clear();
+    REQUIRE(set.empty());
+    REQUIRE(set.capacity() == capacity);
+    REQUIRE(!set.contains(ibans[1]));
+
+    IBAN::IBANSet reserved(1000);
+    const size_t reservedCapacity = reserved.capacity();
+    REQUIRE(reservedCapacity >= 1000);
+    for (size_t i = 0; i < 1000; ++i) {
+        reserved.insert(ibans[i]);
     }
+    REQUIRE(reserved.capacity() == reservedCapacity);
+}
+
+TEST_CASE("IBANMap", "[hash]") {
+    std::vector<IBAN::CompactIBAN> ibans(2000);
+    IBAN::generateRange("GB", "NWBK601613", 0, ibans.size(), ibans.data());
+
+    IBAN::IBANMap<std::string> map;
+    for (size_t i = 0; i < ibans.size(); ++i) {
+        auto result = map.insert(ibans[i], std::to_string(i));
+        REQUIRE(result.second);
+        REQUIRE(*result.first == std::to_string(i));
+    }
+    auto result = map.insert(ibans[7], "other");
+    REQUIRE(!result.second);
+    REQUIRE(*result.first == "7");
+    REQUIRE(map.size() == ibans.size());
+
+    for (size_t i = 0; i < ibans.size(); ++i) {
+        const std::string* value = map.find(ibans[i]);
+        REQUIRE(value != nullptr);
+        REQUIRE(*value == std::to_string(i));
+    }
+    REQUIRE(map.find(IBAN::CompactIBAN()) == nullptr);
+    REQUIRE(map.contains(ibans[3].toIBAN()));
+
+    IBAN::IBANMap<size_t> counts;
+    for (size_t i = 0; i < 3 * ibans.size(); ++i) {
+        ++counts[ibans[i % ibans.size()]];
+    }
+    REQUIRE(counts.size() == ibans.size());
+    counts.forEach([](const IBAN::PackedIBAN&, size_t& count) {
+        REQUIRE(count == 3);
+        count = 0;
+    });
+    REQUIRE(*counts.find(ibans[0]) == 0);
+
+    REQUIRE(map.erase(ibans[5]));
+    REQUIRE(!map.contains(ibans[5]));
+    REQUIRE(*map.find(ibans[6]) == "6");
+    REQUIRE_THROWS_AS(map[IBAN::CompactIBAN()], const std::invalid_argument&);
+}
+
+TEST_CASE("RcuPointer", "[epoch]") {
+    IBAN::RcuPointer<std::string> pointer(std::unique_ptr<std::string>(new std::string("first")));
+    {
+        IBAN::EpochGuard guard;
+        IBAN::EpochGuard nested;
+        REQUIRE(*pointer.get() == "first");
+    }
+    pointer.reset(std::unique_ptr<std::string>(new std::string("second")));
+    {
+        IBAN::EpochGuard guard;
+        REQUIRE(*pointer.get() == "second");
+    }
+
+    // readers must always see a complete object while it is replaced
+    pointer.reset(std::unique_ptr<std::string>(new std::string("value0")));
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                IBAN::EpochGuard guard;
+                const std::string* value = pointer.get();
+                if (value->size() != 6 || (*value)[0] != 'v') {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        pointer.reset(std::unique_ptr<std::string>(new std::string("value" + std::to_string(i % 10))));
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    REQUIRE(failures.load() == 0);
+    pointer.reset(std::unique_ptr<std::string>());
+    IBAN::EpochGuard guard;
+    REQUIRE(pointer.get() == nullptr);
+}
+
+TEST_CASE("BankDirectory", "[bankdirectory]") {
+    IBAN::BankDirectoryBuilder builder;
+    builder.add("DE", "37040044", "", "COBADEFFXXX", "Commerzbank");
+    builder.add("DE", "10050000", "", "BELADEBEXXX", "Landesbank Berlin");
+    builder.add("GB", "NWBK", "", "NWBKGB2L", "National Westminster Bank");
+    builder.add("GB", "NWBK", "601613", "NWBKGB2L", "NatWest Sheffield");
+    builder.add("AT", "19043", "", "", "Bank Austria");
+    REQUIRE(builder.size() == 5);
+
+    REQUIRE_THROWS_AS(builder.add("XX", "1234", "", "", "Unknown"),
+                      const IBAN::IBANInvalidCountryCodeException&);
+    REQUIRE_THROWS_AS(builder.add("DE", "3704004", "", "", "Short"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("DE", "3704004A", "", "", "Letter"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("GB", "NWBK", "6016", "", "Short"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("DE", "37040044", "", "COBADE", "BIC"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("DE", "37040044", "", "", std::string(106, 'x')),
+                      const std::invalid_argument&);
+
+    const std::string path = "libiban_test_banks.bin";
+    builder.write(path);
+    std::unique_ptr<IBAN::BankDirectory> directory = IBAN::BankDirectory::open(path);
+    REQUIRE(directory->size() == 5);
+
+    IBAN::BankEntry entry;
+    REQUIRE(directory->find(IBAN::CompactIBAN("DE89370400440532013000"), entry));
+    REQUIRE(entry.bic == "COBADEFFXXX");
+    REQUIRE(entry.name == "Commerzbank");
+    REQUIRE(directory->find(IBAN::CompactIBAN("DE02100500000024290661"), entry));
+    REQUIRE(entry.name == "Landesbank Berlin");
+    REQUIRE(!directory->find(IBAN::CompactIBAN("DE68210501700012345678"), entry));
+    REQUIRE(directory->find(IBAN::CompactIBAN("AT611904300234573201"), entry));
+    REQUIRE(entry.bic.empty());
+
+    // the branch takes precedence over the bank
+    REQUIRE(directory->find(IBAN::CompactIBAN("GB29NWBK60161331926819"), entry));
+    REQUIRE(entry.name == "NatWest Sheffield");
+    REQUIRE(directory->find(IBAN::CompactIBAN("GB94NWBK60161231926819"), entry));
+    REQUIRE(entry.name == "National Westminster Bank");
+    REQUIRE(directory->find("GB", "NWBK", "601613", entry));
+    REQUIRE(!directory->find("GB", "WEST", "", entry));
+    REQUIRE(!directory->find("FR", "NWBK", "", entry));
+    REQUIRE(!directory->find(IBAN::CompactIBAN(), entry));
+
+    // snapshots from memory behave the same
+    std::unique_ptr<IBAN::BankDirectory> copy = IBAN::BankDirectory::fromBuffer(builder.build());
+    REQUIRE(copy->find(IBAN::CompactIBAN("DE89370400440532013000"), entry));
+    REQUIRE(entry.name == "Commerzbank");
+
+    builder.add("DE", "37040044", "", "COBADEFFXXX", "Commerzbank");
+    REQUIRE_THROWS_AS(builder.build(), const std::invalid_argument&);
+
+    // the mapped file must not be modified, so use another one
+    requireMalformedRejected<IBAN::BankDirectory>(IBAN::BankDirectoryBuilder().build(),
+                                                  "libiban_test_banks_malformed.bin");
+    std::remove(path.c_str());
+
+    // the process wide directory
+    IBAN::BankInfo info;
+    REQUIRE(!IBAN::lookupBank(IBAN::CompactIBAN("DE89370400440532013000"), info));
+    IBAN::setBankDirectory(std::move(directory));
+    REQUIRE(IBAN::lookupBank(IBAN::IBAN::createFromString("DE89 3704 0044 0532 0130 00"), info));
+    REQUIRE(info.getBIC() == "COBADEFFXXX");
+    REQUIRE(info.getName() == "Commerzbank");
+
+    IBAN::BankDirectoryBuilder update;
+    update.add("DE", "37040044", "", "COBADEFFXXX", "Commerzbank AG");
+    IBAN::setBankDirectory(IBAN::BankDirectory::fromBuffer(update.build()));
+    REQUIRE(IBAN::lookupBank(IBAN::CompactIBAN("DE89370400440532013000"), info));
+    REQUIRE(info.getName() == "Commerzbank AG");
+    REQUIRE(!IBAN::lookupBank(IBAN::CompactIBAN("GB29NWBK60161331926819"), info));
+    IBAN::setBankDirectory(std::unique_ptr<IBAN::BankDirectory>());
+    REQUIRE(!IBAN::lookupBank(IBAN::CompactIBAN("DE89370400440532013000"), info));
+}
+
+namespace {
+    /// Replaces the check sum of an IBAN in machine form by the correct one
+    std::string withChecksum(std::string iban) {
+        const std::string rearranged = iban.substr(4) + iban.substr(0, 2) + "00";
+        unsigned remainder = 0;
+        for (char ch : rearranged) {
+            const unsigned value = ch <= '9' ? static_cast<unsigned>(ch - '0') :
+                                   static_cast<unsigned>(ch - 'A' + 10);
+            remainder = (remainder * (value < 10 ? 10 : 100) + value) % 97;
+        }
+        const unsigned checksum = 98 - remainder;
+        iban[2] = static_cast<char>('0' + checksum / 10);
+        iban[3] = static_cast<char>('0' + checksum % 10);
+        return iban;
+    }
+
+    bool rejectAll(const char*, size_t) {
+        return false;
+    }
+}
+
+TEST_CASE("checkNationalDigits", "[national]") {
+    const std::vector<std::string> valid = {
+        "AL47212110090000000235698741", "BA391290079401028494", "BE68539007547034",
+        "CZ6508000000192000145399", "EE382200221020145685", "ES9121000418450200051332",
+        "FI2112345600000785", "FR1420041010050500013M02606", "FR7630006000011234567890189",
+        "HR1210010051863000160", "IT60X0542811101000000123456", "MC5811222000010123456789030",
+        "ME25505000012345678951", "MK07250120000058984", "MR1300020001010000123456753",
+        "NO9386011117947", "PL61109010140000071219812874", "PT50000201231234567890154",
+        "RS35260005601001611379", "SI56263300012039086", "SK3112000000198742637541",
+        "SM86U0322509800000000270100", "TL380080012345678910157",
+        // countries without national check digits always pass
+        "DE89370400440532013000", "GB29NWBK60161331926819",
+    };
+    for (const auto& iban : valid) {
+        INFO(iban);
+        REQUIRE(IBAN::isValidIBAN(iban));
+        REQUIRE(IBAN::checkNationalDigits(iban));
+        REQUIRE(IBAN::IBAN::createFromString(iban).validateNational());
+        REQUIRE(IBAN::CompactIBAN(IBAN::StringView(iban)).validateNational());
+
+        if (IBAN::hasNationalCheck(iban.substr(0, 2))) {
+            // change a digit covered by the check and fix the IBAN check sum;
+            // AL and PL only check the bank's sort code at the start of the BBAN
+            std::string changed = iban;
+            const bool bankOnly = iban.compare(0, 2, "AL") == 0 || iban.compare(0, 2, "PL") == 0;
+            char& ch = changed[bankOnly ? 4 : changed.size() - 1];
+            ch = ch == '9' ? '0' : ch == 'Z' ? 'A' : static_cast<char>(ch + 1);
+            changed = withChecksum(changed);
+            INFO(changed);
+            REQUIRE(IBAN::isValidIBAN(changed));
+            REQUIRE(!IBAN::checkNationalDigits(changed));
+            REQUIRE(!IBAN::IBAN::createFromString(changed).validateNational());
+            REQUIRE(IBAN::IBAN::createFromString(changed).validate());
+        }
+    }
+    REQUIRE(!IBAN::hasNationalCheck("DE"));
+    REQUIRE(IBAN::hasNationalCheck("FR"));
+    REQUIRE(!IBAN::hasNationalCheck("XX"));
+    REQUIRE(!IBAN::checkNationalDigits("FR14200410100505"));
+    REQUIRE(!IBAN::IBAN::createFromString("FR1520041010050500013M02606").validateNational());
+
+    // custom checks replace the built-in ones
+    IBAN::setNationalCheck("DE", rejectAll);
+    REQUIRE(IBAN::hasNationalCheck("DE"));
+    REQUIRE(!IBAN::checkNationalDigits("DE89370400440532013000"));
+    IBAN::setNationalCheck("DE", nullptr);
+    REQUIRE(IBAN::checkNationalDigits("DE89370400440532013000"));
+    REQUIRE_THROWS_AS(IBAN::setNationalCheck("XX", rejectAll),
+                      const IBAN::IBANInvalidCountryCodeException&);
+
+    // batches report wrong national check digits on request only
+    std::vector<std::string> batch = {"BE68539007547034", withChecksum("BE68539007547035"),
+                                      "be68 5390 0754 7034", withChecksum("ES9121000418450200051333"),
+                                      "BE68539007547035"};
+    std::vector<const char*> pointers;
+    std::vector<uint8_t> lengths;
+    for (const auto& iban : batch) {
+        pointers.push_back(iban.data());
+        lengths.push_back(static_cast<uint8_t>(iban.size()));
+    }
+    for (auto kernel : {IBAN::BatchKernel::Scalar, IBAN::BatchKernel::SSE42, IBAN::BatchKernel::AVX2}) {
+        std::vector<uint8_t> results(batch.size());
+        IBAN::validateBatch(pointers.data(), lengths.data(), batch.size(), results.data(), kernel, true);
+        REQUIRE(results[0] == static_cast<uint8_t>(IBAN::ParseStatus::OK));
+        REQUIRE(results[1] == static_cast<uint8_t>(IBAN::ParseStatus::NationalChecksumMismatch));
+        REQUIRE(results[2] == static_cast<uint8_t>(IBAN::ParseStatus::OK));
+        REQUIRE(results[3] == static_cast<uint8_t>(IBAN::ParseStatus::NationalChecksumMismatch));
+        REQUIRE(results[4] == static_cast<uint8_t>(IBAN::ParseStatus::ChecksumMismatch));
+        IBAN::validateBatch(pointers.data(), lengths.data(), batch.size(), results.data(), kernel);
+        REQUIRE(results[1] == static_cast<uint8_t>(IBAN::ParseStatus::OK));
+    }
+}
+
+TEST_CASE("suggestCorrections", "[correction]") {
+    const std::string original = "DE89370400440532013000";
+    const auto suggests = [](const std::string& input, size_t maxEdits, const std::string& expected) {
+        for (const auto& suggestion : IBAN::suggestCorrections(input, maxEdits, 1000)) {
+            if (suggestion.getMachineForm() == expected) {
+                return true;
+            }
+        }
+        return false;
+    };
+    REQUIRE(suggests("DE89370400440532013001", 1, original));
+    REQUIRE(suggests("DE89370400440532031000", 1, original));
+    REQUIRE(suggests("DE98370400440532013000", 1, original));
+    REQUIRE(suggests("DE83970400440532013000", 1, original));
+    REQUIRE(suggests("de89 3704 0044 0532 O130 00", 1, original));
+    // the input is normalized like by tryParse()
+    REQUIRE(suggests("IBAN: DE89-3704-0044-0532-0130-01", 1, original));
+    REQUIRE(suggests("DE89\xC2\xA0" "3704\xC2\xA0" "0044\xC2\xA0" "0532\xC2\xA0" "0130\xC2\xA0" "01", 1, original));
+    REQUIRE(IBAN::suggestCorrections("DE89/370400440532013001").empty());
+    REQUIRE(suggests("DF89370400440532013000", 1, original));
+    REQUIRE(suggests("GB29NWBK6016133192681O", 1, "GB29NWBK60161331926819"));
+    REQUIRE(!suggests("DE89370400440532013011", 1, original));
+    REQUIRE(suggests("DE89370400440532013011", 2, original));
+    REQUIRE(suggests("DE89370400440532O13O00", 2, original));
+
+    REQUIRE(IBAN::suggestCorrections("DE8937040044053201300").empty());
+    REQUIRE(IBAN::suggestCorrections("DE89370400440532013001", 0).empty());
+    REQUIRE(IBAN::suggestCorrections("DE89370400440532013001", 1, 0).empty());
+    REQUIRE(IBAN::suggestCorrections("DE89370400440532O1300O", 1).empty());
+    REQUIRE(IBAN::suggestCorrections("DE89370400440532013001", 2, 3).size() == 3);
+
+    // suggestions are valid and honour national check digits
+    for (const std::string input : {"FR1420041010050500013M02607", "IT60X0542811101000000123465",
+                                    "DE89370400440532013001"}) {
+        for (const auto& suggestion : IBAN::suggestCorrections(input, 2, 100)) {
+            REQUIRE(suggestion.validateNational());
+            size_t changed = 0;
+            for (size_t i = 0; i < input.size(); ++i) {
+                changed += suggestion.getMachineForm()[i] != input[i];
+            }
+            REQUIRE(changed >= 1);
+            REQUIRE(changed <= 2);
+        }
+    }
+
+    // compare with trying every replacement of one and two digits
+    const std::string mistyped = "NO9386011117948";
+    std::set<std::string> expected;
+    std::string candidate = mistyped;
+    for (size_t i = 2; i < candidate.size(); ++i) {
+        for (char a = '0'; a <= '9'; ++a) {
+            if (a == mistyped[i]) {
+                continue;
+            }
+            candidate[i] = a;
+            if (IBAN::isValidIBAN(candidate) && IBAN::checkNationalDigits(candidate)) {
+                expected.insert(candidate);
+            }
+            for (size_t j = i + 1; j < candidate.size(); ++j) {
+                for (char b = '0'; b <= '9'; ++b) {
+                    if (b == mistyped[j]) {
+                        continue;
+                    }
+                    candidate[j] = b;
+                    if (IBAN::isValidIBAN(candidate) && IBAN::checkNationalDigits(candidate)) {
+                        expected.insert(candidate);
+                    }
+                }
+                candidate[j] = mistyped[j];
+            }
+        }
+        candidate[i] = mistyped[i];
+    }
+    std::set<std::string> found;
+    for (const auto& suggestion : IBAN::suggestCorrections(mistyped, 2, 100000)) {
+        REQUIRE(found.insert(suggestion.getMachineForm().toString()).second);
+    }
+    REQUIRE(found == expected);
+}
+
+TEST_CASE("stats", "[stats]") {
+    using IBAN::StatsOperation;
+    using IBAN::ParseStatus;
+    IBAN::resetStats();
+
+    const IBAN::IBAN valid = IBAN::IBAN::createFromString("DE89 3704 0044 0532 0130 00");
+    const IBAN::IBAN invalid = IBAN::IBAN::createFromString("DE88370400440532013000");
+    REQUIRE_THROWS_AS(IBAN::IBAN::createFromString("DE89!"), const IBAN::IBANParseException&);
+    REQUIRE_THROWS_AS(IBAN::IBAN::createFromString("D"), const IBAN::IBANParseException&);
+    REQUIRE(valid.validate());
+    REQUIRE_FALSE(invalid.validate());
+    IBAN::IBAN::generateIBAN("FR");
+
+    const char* ibans[] = {"DE89370400440532013000", "FR1420041010050500013M02606", "FR00"};
+    const uint8_t lengths[] = {22, 27, 4};
+    uint8_t results[3];
+    IBAN::validateBatch(ibans, lengths, 3, results);
+
+    const IBAN::StatsSnapshot stats = IBAN::getStats();
+    if (!IBAN::statsEnabled) {
+        REQUIRE(stats.getCalls(StatsOperation::CreateFromString) == 0);
+        REQUIRE(stats.getCalls(StatsOperation::ValidateBatch) == 0);
+        return;
+    }
+    REQUIRE(stats.getCalls(StatsOperation::CreateFromString) == 4);
+    REQUIRE(stats.getResults(StatsOperation::CreateFromString, ParseStatus::OK) == 2);
+    REQUIRE(stats.getResults(StatsOperation::CreateFromString, ParseStatus::IllegalCharacter) == 1);
+    REQUIRE(stats.getResults(StatsOperation::CreateFromString, ParseStatus::InvalidLength) == 1);
+    REQUIRE(stats.getCalls(StatsOperation::Validate) == 2);
+    REQUIRE(stats.getResults(StatsOperation::Validate, ParseStatus::ChecksumMismatch) == 1);
+    REQUIRE(stats.getCalls(StatsOperation::GenerateIBAN) == 1);
+    REQUIRE(stats.getCalls(StatsOperation::ValidateBatch) == 1);
+    REQUIRE(stats.ibans[static_cast<size_t>(StatsOperation::ValidateBatch)] == 3);
+    REQUIRE(stats.getRejects(StatsOperation::ValidateBatch) == 1);
+    REQUIRE(stats.getResults(StatsOperation::ValidateBatch, ParseStatus::InvalidLength) == 1);
+
+    // only validations count per country
+    const size_t germany = IBAN::getCountryIndex('D', 'E'), france = IBAN::getCountryIndex('F', 'R');
+    REQUIRE(stats.countryIBANs[germany] == 3);
+    REQUIRE(stats.countryRejects[germany] == 1);
+    REQUIRE(stats.countryIBANs[france] == 2);
+    REQUIRE(stats.countryRejects[france] == 1);
+
+    // counts of finished threads are kept
+    std::thread([]() { IBAN::IBAN::generateIBAN("DE"); }).join();
+    IBAN::StatsSnapshot merged = IBAN::getStats();
+    REQUIRE(merged.getCalls(StatsOperation::GenerateIBAN) == 2);
+    merged.merge(stats);
+    REQUIRE(merged.getCalls(StatsOperation::GenerateIBAN) == 3);
+    REQUIRE(merged.countryIBANs[germany] == 6);
+
+    const std::string metrics = stats.toPrometheus();
+    REQUIRE(metrics.find("# TYPE libiban_latency_seconds histogram\n") != std::string::npos);
+    REQUIRE(metrics.find("libiban_calls_total{operation=\"createFromString\"} 4\n") != std::string::npos);
+    REQUIRE(metrics.find("libiban_country_rejects_total{country=\"FR\"} 1\n") != std::string::npos);
+    REQUIRE(metrics.find("country=\"IT\"") == std::string::npos);
+
+    // every 16th call is timed
+    IBAN::resetStats();
+    REQUIRE(IBAN::getStats().getCalls(StatsOperation::CreateFromString) == 0);
+    for (size_t i = 0; i < 4 * IBAN::latencySampleRate; ++i) {
+        REQUIRE(valid.validate());
+    }
+    const IBAN::StatsSnapshot timed = IBAN::getStats();
+    uint64_t latencies = 0;
+    for (const uint64_t bucket : timed.latency[static_cast<size_t>(StatsOperation::Validate)]) {
+        latencies += bucket;
+    }
+    REQUIRE(latencies == 4);
+    REQUIRE(timed.toPrometheus().find("libiban_latency_seconds_count{operation=\"validate\"} 4\n") !=
+            std::string::npos);
+}
+
+TEST_CASE("IBANScanner", "[scanner]") {
+    const std::string text =
+            "<Dbtr><IBAN>DE89370400440532013000</IBAN></Dbtr> Ref: pay to "
+            "GB82 WEST 1234 5698 7654 32, not DE89370400440532013001 or "
+            "XDE89370400440532013000 or FR12 fr14 2004 1010 0505 0001 3m02 606.";
+
+    const auto matches = IBAN::findIBANs(text);
+    REQUIRE(matches.size() == 3);
+    REQUIRE(matches[0].offset == text.find("DE89"));
+    REQUIRE(matches[0].length == 22);
+    REQUIRE(matches[0].iban.getMachineForm() == "DE89370400440532013000");
+    REQUIRE(matches[1].offset == text.find("GB82"));
+    REQUIRE(matches[1].length == 27);
+    REQUIRE(matches[1].iban.getMachineForm() == "GB82WEST12345698765432");
+    // a failed candidate does not hide the IBAN following it
+    REQUIRE(matches[2].offset == text.find("fr14"));
+    REQUIRE(matches[2].length == 33);
+    REQUIRE(matches[2].iban.getMachineForm() == "FR1420041010050500013M02606");
+
+    IBAN::ScannerOptions caseSensitive;
+    caseSensitive.allowLowercase = false;
+    REQUIRE(IBAN::findIBANs(text, caseSensitive).size() == 2);
+
+    // mixing grouped and compact forms, longer tokens and bad groups
+    REQUIRE(IBAN::findIBANs("DE89 370400440532013000").empty());
+    REQUIRE(IBAN::findIBANs("DE8937040044 0532 0130 00").empty());
+    REQUIRE(IBAN::findIBANs("DE89  3704 0044 0532 0130 00").empty());
+    REQUIRE(IBAN::findIBANs("DE89 3704 0044 0532 0130 001").empty());
+    REQUIRE(IBAN::findIBANs("DE893704004405320130001").empty());
+    REQUIRE(IBAN::findIBANs("DE89 3704 0044 0532 0130 00 1").size() == 1);
+    REQUIRE(IBAN::findIBANs("DE89370400440532013000").size() == 1);
+    REQUIRE(IBAN::findIBANs("").empty());
+
+    // national check digits (the second IBAN has a valid check sum only)
+    const std::string belgian = "BE71 0961 2345 6769, BE91 0961 2345 6700";
+    REQUIRE(IBAN::findIBANs(belgian).size() == 2);
+    IBAN::ScannerOptions national;
+    national.nationalCheckDigits = true;
+    const auto nationalMatches = IBAN::findIBANs(belgian, national);
+    REQUIRE(nationalMatches.size() == 1);
+    REQUIRE(nationalMatches[0].iban.getMachineForm() == "BE71096123456769");
+
+    // the result does not depend on how the stream is split into chunks
+    for (size_t split = 0; split <= text.size(); ++split) {
+        std::vector<IBAN::IBANMatch> found;
+        IBAN::IBANScanner scanner([&found](const IBAN::IBANMatch& match) { found.push_back(match); });
+        scanner.feed(text.data(), split);
+        for (size_t i = split; i < text.size(); ++i) {
+            scanner.feed(text.data() + i, 1);
+        }
+        REQUIRE(scanner.getOffset() == text.size());
+        scanner.finish();
+        REQUIRE(found.size() == matches.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            REQUIRE(found[i].offset == matches[i].offset);
+            REQUIRE(found[i].length == matches[i].length);
+            REQUIRE(found[i].iban == matches[i].iban);
+        }
+    }
+
+    // streams larger than the chunks of scanStream()
+    std::string large;
+    for (size_t i = 0; i < 20000; ++i) {
+        large += "lorem ipsum DE89 3704 0044 0532 0130 00;";
+    }
+    std::istringstream in(large);
+    size_t count = 0;
+    uint64_t lastOffset = 0;
+    IBAN::scanStream(in, [&](const IBAN::IBANMatch& match) {
+        ++count;
+        lastOffset = match.offset;
+    });
+    REQUIRE(count == 20000);
+    REQUIRE(lastOffset == large.rfind("DE89"));
+}
+
+TEST_CASE("ValidationService", "[service]") {
+    std::vector<std::string> ibans;
+    for (size_t i = 0; i < 200; ++i) {
+        std::string iban = IBAN::IBAN::generateIBAN(i % 2 ? "DE" : "GB").getMachineForm();
+        if (i % 7 == 0) {
+            iban.back() = iban.back() == '9' ? '0' : static_cast<char>(iban.back() + 1);
+        }
+        ibans.push_back(i % 3 ? iban : IBAN::IBAN::createFromString(iban).getHumanReadable());
+    }
+    ibans.push_back("");
+    ibans.push_back("XX00 1234");
+    ibans.push_back(std::string(300, ' ') + "DE89370400440532013000");
+
+    // jobs of different sizes from several producers
+    {
+        IBAN::ServiceOptions options;
+        options.threads = 2;
+        options.maxBatchSize = 64;
+        IBAN::ValidationService service(options);
+        REQUIRE(service.getThreadCount() == 2);
+        std::vector<std::thread> producers;
+        std::atomic<size_t> mismatches(0);
+        for (size_t producer = 0; producer < 4; ++producer) {
+            producers.emplace_back([&, producer]() {
+                std::vector<std::future<std::vector<IBAN::ParseStatus>>> futures;
+                std::vector<std::vector<std::string>> jobs;
+                for (size_t begin = producer; begin < ibans.size(); begin += 1 + begin % 13) {
+                    const size_t end = std::min(ibans.size(), begin + 1 + begin % 13);
+                    jobs.emplace_back(ibans.begin() + static_cast<std::ptrdiff_t>(begin),
+                                      ibans.begin() + static_cast<std::ptrdiff_t>(end));
+                    futures.push_back(service.submit(jobs.back()));
+                }
+                for (size_t i = 0; i < jobs.size(); ++i) {
+                    const auto results = futures[i].get();
+                    if (results.size() != jobs[i].size()) {
+                        ++mismatches;
+                        continue;
+                    }
+                    for (size_t j = 0; j < results.size(); ++j) {
+                        mismatches += results[j] != IBAN::IBAN::tryParse(jobs[i][j]);
+                    }
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        REQUIRE(mismatches.load() == 0);
+        REQUIRE(service.getBatchCount() > 0);
+    }
+
+    // small jobs are coalesced until the batch is full
+    {
+        IBAN::ServiceOptions options;
+        options.maxBatchSize = 100;
+        options.maxDelay = std::chrono::seconds(10);
+        IBAN::ValidationService service(options);
+        std::vector<std::future<std::vector<IBAN::ParseStatus>>> futures;
+        for (size_t i = 0; i < 100; ++i) {
+            futures.push_back(service.submit(std::vector<std::string>(1, ibans[i])));
+        }
+        for (size_t i = 0; i < 100; ++i) {
+            REQUIRE(futures[i].get()[0] == IBAN::IBAN::tryParse(ibans[i]));
+        }
+        REQUIRE(service.getBatchCount() == 1);
+    }
+
+    // handlers, national check digits and destruction with pending jobs
+    std::vector<std::future<std::vector<IBAN::ParseStatus>>> futures;
+    std::vector<IBAN::ParseStatus> handled;
+    {
+        IBAN::ServiceOptions options;
+        options.maxDelay = std::chrono::seconds(10);
+        options.nationalCheckDigits = true;
+        IBAN::ValidationService service(options);
+        service.submit({"BE71096123456769", "BE91096123456700"}, [&handled](std::vector<IBAN::ParseStatus> results) {
+            handled = std::move(results);
+        });
+        for (size_t i = 0; i < 10; ++i) {
+            futures.push_back(service.submit(ibans));
+        }
+        futures.push_back(service.submit(std::vector<std::string>()));
+    }
+    REQUIRE(handled.size() == 2);
+    REQUIRE(handled[0] == IBAN::ParseStatus::OK);
+    REQUIRE(handled[1] == IBAN::ParseStatus::NationalChecksumMismatch);
+    for (auto& future : futures) {
+        REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+    REQUIRE(futures.back().get().empty());
+}
+
+namespace {
+    using namespace IBAN::literals;
+
+    // validated by the compiler
+    constexpr IBAN::CompactIBAN treasury = "DE89 3704 0044 0532 0130 00"_iban;
+    static_assert(treasury.getMachineForm().size() == 22, "length of the literal");
+    static_assert(treasury.getCountryCode()[0] == 'D' && treasury.getBBAN()[0] == '3', "content of the literal");
+    static_assert("gb82west12345698765432"_iban.getBBAN()[0] == 'W', "lowercase literal");
+    static_assert(IBAN::getConstantStatus("FR1420041010050500013M02606") == IBAN::ParseStatus::OK, "valid IBAN");
+    static_assert(IBAN::getConstantStatus("DE88370400440532013000") == IBAN::ParseStatus::ChecksumMismatch,
+                  "check sum");
+    static_assert(IBAN::getConstantStatus("DE8937040044053201300A") == IBAN::ParseStatus::InvalidStructure,
+                  "structure");
+    static_assert("IBAN: DE89-3704-0044-0532-0130-00"_iban.getBBAN()[0] == '3', "prefix and dashes");
+    static_assert(IBAN::getConstantStatus("1/") == IBAN::ParseStatus::IllegalCharacter, "illegal character");
+}
+
+TEST_CASE("getConstantStatus", "[literal]") {
+    REQUIRE(std::string(treasury.getMachineForm().data(), 22) == "DE89370400440532013000");
+    REQUIRE(treasury == IBAN::CompactIBAN(IBAN::IBAN::createFromString("DE89370400440532013000")));
+    // padded with zeros like CompactIBAN::tryParse() does
+    IBAN::CompactIBAN parsed;
+    REQUIRE(IBAN::CompactIBAN::tryParse("DE89370400440532013000", parsed) == IBAN::ParseStatus::OK);
+    REQUIRE(std::memcmp(&parsed, &treasury, sizeof(parsed)) == 0);
+
+    // evaluated at runtime, the results equal those of tryParse()
+    std::vector<std::string> inputs = {
+            "", "DE", "DE89", "de89 3704 0044 0532 0130 00", "D189370400440532013000",
+            "XX89370400440532013000", "DEX9370400440532013000", "DE89370400440532013!00",
+            "DE8937040044053201300", "DE89370400440532013000" + std::string(13, '0'),
+            "GB82WEST12345698765432", "GB8212345612345698765432", "IT60X0542811101000000123456",
+            "\tNO93 8601 1117 947\n", "SC52BAHL01031234567890123456USD",
+            // separators, prefix and illegal characters as normalizeIBAN() handles them
+            "DE89-3704-0044-0532-0130-00", "gb82.west.1234.5698.7654.32", "IBAN DE89370400440532013000",
+            "iban: de89 3704 0044 0532 0130 00", "IBANDE89370400440532013000", "IBAN", "IBAN:", "IBAN::DE89",
+            "DE89 IBAN 370400440532013000", "1/", "DE89/370400440532013000", "DE89:370400440532013000",
+            "DE89 3704 0044 0532 0130 0000 0000 0000 000", "DE89 3704 0044 0532 0130 00/",
+            "DE89\xC2\xA0" "3704\xE2\x80\xAF" "0044\xE2\x80\x93" "0532 0130 00",
+            "\xEF\xBB\xBF" "IBAN\xEF\xBC\x9A\xEF\xBC\xA4\xEF\xBD\x85" "89370400440532013000",
+            "DE89\xF0\x8F\xBC\x93" "70400440532013000", "DE89\xED\xA0\x80" "370400440532013000",
+            "DE89\xE2\x82\xAC" "370400440532013000", "DE89\xC2"
+    };
+    for (const auto& country : {"DE", "FR", "GB", "IT", "MU", "BR", "LC", "NO"}) {
+        std::string iban = IBAN::IBAN::generateIBAN(country).getMachineForm();
+        inputs.push_back(iban);
+        for (size_t i = 0; i < iban.size(); ++i) {
+            std::string changed = iban;
+            changed[i] = changed[i] == 'A' ? '0' : 'A';
+            inputs.push_back(changed);
+        }
+    }
+    for (const auto& input : inputs) {
+        INFO(input);
+        REQUIRE(IBAN::getConstantStatus(input) == IBAN::IBAN::tryParse(input));
+        if (IBAN::IBAN::tryParse(input) == IBAN::ParseStatus::OK) {
+            REQUIRE(IBAN::parseConstant(input) == IBAN::CompactIBAN(IBAN::IBAN::createFromString(input)));
+        } else {
+            REQUIRE_THROWS_AS(IBAN::parseConstant(input), const IBAN::IBANParseException&);
+        }
+    }
+}
+
+TEST_CASE("PrefixIndex", "[prefixindex]") {
+    // enough German IBANs for two levels of fence keys
+    std::vector<IBAN::CompactIBAN> ibans(7000);
+    IBAN::generateRange("DE", "37040044", 0, 6000, ibans.data());
+    IBAN::IBANGenerator generator(5);
+    generator.generate("DE", ibans.data() + 6000, 500);
+    generator.generate("IT", ibans.data() + 6500, 300);
+    generator.generate("NO", ibans.data() + 6800, 100);
+    generator.generate("GB", ibans.data() + 6900, 100);
+
+    IBAN::PrefixIndexBuilder builder;
+    builder.add(ibans.data(), ibans.size());
+    builder.add("DE89370400440532013000");
+    builder.add(ibans[0]);
+    REQUIRE(builder.size() == 7002);
+    REQUIRE_THROWS_AS(builder.add("DE8937040044053201300A"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("XX89370400440532013000"), const std::invalid_argument&);
+
+    std::vector<std::string> sorted = {"DE89370400440532013000"};
+    for (const auto& iban : ibans) {
+        sorted.push_back(iban.getMachineForm().toString());
+    }
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    const std::string path = "libiban_test_index.bin";
+    builder.write(path);
+    std::unique_ptr<IBAN::PrefixIndex> index = IBAN::PrefixIndex::open(path);
+    REQUIRE(index->size() == sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        REQUIRE(index->getIBAN(i).getMachineForm() == sorted[i]);
+        REQUIRE(index->contains(sorted[i]));
+    }
+    REQUIRE(index->getIBAN(sorted.size()).empty());
+    REQUIRE(index->contains(IBAN::CompactIBAN("DE89370400440532013000")));
+    REQUIRE(!index->contains("DE89370400440532013001"));
+    REQUIRE(!index->contains("FR1420041010050500013M02606"));
+    REQUIRE(!index->contains("DE"));
+
+    // the ranges equal those of the sorted machine forms
+    auto check = [&sorted, &index](const std::string& prefix) {
+        INFO(prefix);
+        const size_t first = std::lower_bound(sorted.begin(), sorted.end(), prefix) - sorted.begin();
+        const size_t last = std::partition_point(sorted.begin(), sorted.end(), [&prefix](const std::string& s) {
+            return s.compare(0, prefix.size(), prefix) <= 0;
+        }) - sorted.begin();
+        REQUIRE(index->lowerBound(prefix) == first);
+        REQUIRE(index->upperBound(prefix) == last);
+    };
+    for (const std::string prefix : {"", "A", "D", "DE", "DE8", "DE89", "DE893704", "DEZ", "DE8X", "D[",
+                                     "D@", "IT", "IT60X", "IT6001", "NO", "GB00", "ZZ", "\xff",
+                                     "DE99999999999999999999", "DE999999999999999999999"}) {
+        check(prefix);
+    }
+    for (size_t i = 0; i < 2000; ++i) {
+        std::string prefix = sorted[(i * 7919) % sorted.size()].substr(0, 1 + i % 23);
+        if (i % 3 == 0) {
+            prefix.back() = static_cast<char>(' ' + (i * 31) % 95);
+        }
+        check(prefix);
+    }
+    const IBAN::IndexRange german = index->findPrefix("DE");
+    REQUIRE(german.size() == 6501);
+    size_t count = 0;
+    index->forEach(german, [&count](const IBAN::CompactIBAN& iban) {
+        REQUIRE(iban.getCountryCode() == "DE");
+        ++count;
+    });
+    REQUIRE(count == german.size());
+    const IBAN::IndexRange range = index->findRange("DE5", "IT");
+    REQUIRE(range.first == index->lowerBound("DE5"));
+    REQUIRE(range.last == index->upperBound("IT"));
+    REQUIRE(index->findRange("IT", "DE").empty());
+
+    // the ranges of a bank cover exactly its IBANs
+    const std::vector<std::pair<std::string, std::string>> banks = {
+            {"DE", "37040044"}, {"IT", "05428"}, {"IT", ibans[6600].getBankCode().toString()},
+            {"GB", ibans[6950].getBankCode().toString()}
+    };
+    for (const auto& code : banks) {
+        const std::string& bankCode = code.second;
+        size_t expected = 0;
+        for (const auto& s : sorted) {
+            expected += IBAN::CompactIBAN(s).getCountryCode() == code.first &&
+                        IBAN::CompactIBAN(s).getBankCode() == bankCode;
+        }
+        size_t found = 0;
+        for (const auto& bank : index->findBank(code.first, bankCode)) {
+            index->forEach(bank, [&found, &bankCode](const IBAN::CompactIBAN& iban) {
+                REQUIRE(iban.getBankCode() == bankCode);
+                ++found;
+            });
+        }
+        REQUIRE(found == expected);
+    }
+    REQUIRE(index->findBank("DE", "3704004").empty());
+    REQUIRE(index->findBank("XX", "37040044").empty());
+
+    // snapshots from memory behave the same
+    std::unique_ptr<IBAN::PrefixIndex> copy = IBAN::PrefixIndex::fromBuffer(builder.build());
+    REQUIRE(copy->size() == sorted.size());
+    REQUIRE(copy->findPrefix("IT").size() == 300);
+    REQUIRE(IBAN::PrefixIndex::fromBuffer(IBAN::PrefixIndexBuilder().build())->findPrefix("").empty());
+
+    requireMalformedRejected<IBAN::PrefixIndex>(builder.build(), "libiban_test_index_malformed.bin");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("IBANFilter", "[filter]") {
+    std::vector<IBAN::CompactIBAN> ibans(20000);
+    IBAN::IBANGenerator generator(7);
+    generator.generate("DE", ibans.data(), 10000);
+    generator.generate("FR", ibans.data() + 10000, 10000);
+
+    IBAN::IBANFilterBuilder builder;
+    builder.add(ibans.data(), ibans.size());
+    builder.add("DE89370400440532013000");
+    builder.add(ibans[0]);
+    REQUIRE(builder.size() == 20002);
+
+    std::set<std::string> members = {"DE89370400440532013000"};
+    for (const auto& iban : ibans) {
+        members.insert(iban.getMachineForm().toString());
+    }
+
+    const std::string path = "libiban_test_filter.bin";
+    builder.write(path);
+    std::unique_ptr<IBAN::IBANFilter> filter = IBAN::IBANFilter::open(path);
+    REQUIRE(filter->size() == members.size());
+    REQUIRE(filter->getBitCount() < 10 * members.size());
+    for (const auto& member : members) {
+        REQUIRE(filter->contains(member));
+    }
+    REQUIRE(filter->contains(ibans[1]));
+    REQUIRE(filter->contains(IBAN::CompactIBAN("DE89370400440532013000")));
+
+    std::vector<IBAN::CompactIBAN> others(20000);
+    IBAN::IBANGenerator(8).generate("DE", others.data(), others.size());
+    size_t falsePositives = 0;
+    size_t nonMembers = 0;
+    std::vector<uint8_t> results(others.size());
+    filter->containsBatch(others.data(), others.size(), results.data());
+    for (size_t i = 0; i < others.size(); ++i) {
+        REQUIRE(results[i] == filter->contains(others[i]));
+        if (members.count(others[i].getMachineForm().toString()) == 0) {
+            ++nonMembers;
+            falsePositives += results[i];
+        }
+    }
+    REQUIRE(falsePositives < nonMembers / 100);
+
+    std::vector<const char*> pointers;
+    std::vector<uint8_t> lengths;
+    for (const auto& iban : ibans) {
+        pointers.push_back(iban.getMachineForm().data());
+        lengths.push_back(static_cast<uint8_t>(iban.size()));
+    }
+    results.assign(ibans.size(), 0);
+    filter->containsBatch(pointers.data(), lengths.data(), pointers.size(), results.data());
+    REQUIRE(static_cast<size_t>(std::count(results.begin(), results.end(), 1)) == ibans.size());
+
+    std::unique_ptr<IBAN::IBANFilter> copy = IBAN::IBANFilter::fromBuffer(builder.build());
+    REQUIRE(copy->size() == members.size());
+    REQUIRE(copy->contains(ibans[19999]));
+    std::unique_ptr<IBAN::IBANFilter> empty = IBAN::IBANFilter::fromBuffer(IBAN::IBANFilterBuilder().build());
+    REQUIRE(empty->size() == 0);
+    REQUIRE_FALSE(empty->contains(ibans[0]));
+    IBAN::IBANFilterBuilder single;
+    single.add(ibans[0]);
+    REQUIRE(IBAN::IBANFilter::fromBuffer(single.build())->contains(ibans[0]));
+
+    requireMalformedRejected<IBAN::IBANFilter>(builder.build(), "libiban_test_filter_malformed.bin");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("normalizeIBAN", "[normalize]") {
+    using IBAN::ParseStatus;
+    char buffer[IBAN::maxIBANLength];
+    size_t length = 0;
+    auto normalize = [&](IBAN::StringView input) {
+        return IBAN::normalizeIBAN(input, buffer, &length) == ParseStatus::OK ?
+               std::string(buffer, length) : std::string("error");
+    };
+
+    REQUIRE(normalize("IBAN: de89-3704-0044-0532-0130-00") == "DE89370400440532013000");
+    REQUIRE(normalize("iban DE89 3704 0044 0532 0130 00\r\n") == "DE89370400440532013000");
+    REQUIRE(normalize("IBANDE89370400440532013000") == "DE89370400440532013000");
+    REQUIRE(normalize("  gb82.west.1234.5698.7654.32") == "GB82WEST12345698765432");
+    // no-break spaces, narrow no-break spaces and an en dash
+    REQUIRE(normalize("DE89\xC2\xA0" "3704\xE2\x80\xAF" "0044\xE2\x80\x93" "0532 0130 00") ==
+            "DE89370400440532013000");
+    // fullwidth letters, digits and colon, an ideographic space and a byte order mark
+    REQUIRE(normalize("\xEF\xBB\xBF" "IBAN\xEF\xBC\x9A\xE3\x80\x80\xEF\xBC\xA4\xEF\xBD\x85\xEF\xBC\x98\xEF\xBC\x99"
+                      "370400440532013000") == "DE89370400440532013000");
+    REQUIRE(normalize("") == "");
+    REQUIRE(normalize(" - ") == "");
+
+    REQUIRE(IBAN::normalizeIBAN("DE682105017000/2345678", buffer, &length) == ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89:370400440532013000", buffer, &length) == ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89\xE2\x82\xAC" "370400440532013000", buffer, &length) ==
+            ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89\xC2", buffer, &length) == ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89\xE0\x82\xA0" "3704", buffer, &length) == ParseStatus::IllegalCharacter);
+    // overlong sequences of a fullwidth digit and a surrogate
+    REQUIRE(normalize("DE89\xEF\xBC\x93" "70400440532013000") == "DE89370400440532013000");
+    REQUIRE(IBAN::normalizeIBAN("DE89\xF0\x8F\xBC\x93" "70400440532013000", buffer, &length) ==
+            ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89\xED\xA0\x80" "370400440532013000", buffer, &length) ==
+            ParseStatus::IllegalCharacter);
+    REQUIRE(IBAN::normalizeIBAN("DE89 3704 0044 0532 0130 0000 0000 0000 000", buffer, &length) ==
+            ParseStatus::InvalidLength);
+    REQUIRE(IBAN::normalizeIBAN(std::string(IBAN::maxIBANLength, '1'), buffer, &length) == ParseStatus::OK);
+    REQUIRE(length == IBAN::maxIBANLength);
+
+    // the vector and the scalar path agree at every offset and length
+    const std::string alphabet = "aZ09 -.\t/:\xC2\xA0";
+    std::vector<char> text(8192);
+    uint64_t state = 1;
+    for (char& ch : text) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        ch = alphabet[(state >> 33) % alphabet.size()];
+    }
+    for (size_t begin = 4096 - 40; begin < 4096; ++begin) {
+        for (size_t size = 0; size <= 40; ++size) {
+            std::string expected;
+            ParseStatus expectedStatus = ParseStatus::OK;
+            for (size_t i = begin; i < begin + size && expectedStatus == ParseStatus::OK; ++i) {
+                const char ch = text[i];
+                if (std::isalnum(static_cast<unsigned char>(ch))) {
+                    if (expected.size() == IBAN::maxIBANLength) {
+                        expectedStatus = ParseStatus::InvalidLength;
+                    } else {
+                        expected += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+                    }
+                } else if (ch == '\xC2' && i + 1 < begin + size && text[i + 1] == '\xA0') {
+                    ++i;
+                } else if (std::string(" -.\t").find(ch) == std::string::npos) {
+                    expectedStatus = ParseStatus::IllegalCharacter;
+                }
+            }
+            if (expected.compare(0, 4, "IBAN") == 0) {
+                // the prefix is only stripped when it comes first
+                continue;
+            }
+            const ParseStatus status = IBAN::normalizeIBAN(IBAN::StringView(text.data() + begin, size),
+                                                           buffer, &length);
+            REQUIRE(status == expectedStatus);
+            if (status == ParseStatus::OK) {
+                REQUIRE(std::string(buffer, length) == expected);
+            }
+        }
+    }
+
+    REQUIRE(IBAN::IBAN::tryParse("IBAN: de89-3704-0044-0532-0130-00") == ParseStatus::OK);
+    REQUIRE(IBAN::IBAN::createFromString("IBAN\xC2\xA0GB82\xC2\xA0WEST\xC2\xA0" "1234 5698 7654 32").validate());
+    const char* messy[] = {"IBAN: de89-3704-0044-0532-0130-00", "DE89370400440532013000", "DE89/370400440532013000"};
+    const uint8_t lengths[] = {33, 22, 23};
+    uint8_t results[3];
+    IBAN::validateBatch(messy, lengths, 3, results);
+    REQUIRE(results[0] == static_cast<uint8_t>(ParseStatus::OK));
+    REQUIRE(results[1] == static_cast<uint8_t>(ParseStatus::OK));
+    REQUIRE(results[2] == static_cast<uint8_t>(ParseStatus::IllegalCharacter));
+}
+
+TEST_CASE("CountryTable", "[countrytable]") {
+    using IBAN::ParseStatus;
+    static_assert(IBAN::getDayNumber(2017, 12, 31) == 17531, "getDayNumber() is broken");
+    REQUIRE(IBAN::getDayNumber(2024, 2, 29) + 1 == IBAN::getDayNumber(2024, 3, 1));
+    const uint32_t today = IBAN::getCurrentDay();
+    REQUIRE(today > IBAN::getDayNumber(2017, 1, 1));
+
+    IBAN::CountryTableBuilder builder;
+    builder.addCompiledIn();
+    builder.add("ZZ", "10!n", today - 1, 0, 4);
+    builder.add("ZZ", "20!n", today + 1);
+    builder.add("DE", "8!n11!n", today + 1, 0, 8);
+    builder.withdraw("XK", today - 1);
+    REQUIRE_THROWS_AS(builder.add("Z1", "10!n", 0), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("ZZ", "10!x", 0), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(builder.add("ZZ", "10!n", 0, 8, 4), const std::invalid_argument&);
+    REQUIRE(builder.size() == IBAN::countryFormatCount + 4);
+
+    const std::string path = "libiban_test_countries.bin";
+    builder.write(path);
+    std::unique_ptr<IBAN::CountryTable> table = IBAN::CountryTable::open(path);
+    REQUIRE(table->size() == IBAN::countryFormatCount + 4);
+    REQUIRE(table->find('Z', 'Z', today - 2) == nullptr);
+    REQUIRE(table->find('Z', 'Z', today)->length == 10);
+    REQUIRE(table->find('Z', 'Z', today)->bankLength == 4);
+    REQUIRE(table->find('Z', 'Z', today + 1)->length == 20);
+    REQUIRE(table->findEntry('D', 'E', today)->compiledIn);
+    REQUIRE_FALSE(table->findEntry('D', 'E', today + 1)->compiledIn);
+    REQUIRE(table->find('D', 'E', today + 1)->length == 19);
+    REQUIRE(table->find('X', 'K', today - 2) != nullptr);
+    REQUIRE(table->find('X', 'K', today) == nullptr);
+    REQUIRE(table->find('A', 'A', today) == nullptr);
+    REQUIRE(table->find('d', 'e', today) == nullptr);
+
+    // the compiled-in registry is the default
+    REQUIRE_FALSE(IBAN::hasCountryTable());
+    REQUIRE(IBAN::IBAN::tryParse("ZZ121234567890") == ParseStatus::InvalidCountryCode);
+    REQUIRE(IBAN::IBAN::tryParse("XK051212012345678906") == ParseStatus::OK);
+    const IBAN::IBAN kosovo = IBAN::IBAN::createFromString("XK051212012345678906",
+                                                           IBAN::ValidationPolicy::OnConstruction);
+    REQUIRE(kosovo.isValidated());
+    REQUIRE(kosovo.getStatus() == ParseStatus::OK);
+
+    IBAN::setCountryTable(std::move(table));
+    // verdicts cached before the table was set do not apply
+    REQUIRE_FALSE(kosovo.isValidated());
+    REQUIRE(kosovo.getStatus() == ParseStatus::InvalidCountryCode);
+    REQUIRE_FALSE(kosovo.validate());
+    REQUIRE_FALSE(IBAN::CompactIBAN(kosovo).validate());
+    REQUIRE(IBAN::hasCountryTable());
+    REQUIRE(IBAN::IBAN::tryParse("ZZ121234567890") == ParseStatus::OK);
+    REQUIRE(IBAN::IBAN::tryParse("ZZ13 1234 5678 90") == ParseStatus::ChecksumMismatch);
+    REQUIRE(IBAN::IBAN::tryParse("ZZ12123456789") == ParseStatus::InvalidLength);
+    REQUIRE(IBAN::IBAN::tryParse("ZZ1212345678A0") == ParseStatus::InvalidStructure);
+    REQUIRE(IBAN::IBAN::tryParse("ZZAB1234567890") == ParseStatus::InvalidChecksumDigits);
+    REQUIRE(IBAN::IBAN::tryParse("XK051212012345678906") == ParseStatus::InvalidCountryCode);
+    REQUIRE(IBAN::IBAN::tryParse("DE89370400440532013000") == ParseStatus::OK);
+    REQUIRE(IBAN::IBAN::createFromString("ZZ12 1234 5678 90").validate());
+    REQUIRE(IBAN::IBAN::createFromString("XK051212012345678906").getStatus() ==
+            ParseStatus::InvalidCountryCode);
+
+    const std::vector<std::string> inputs = {"ZZ121234567890", "ZZ131234567890", "XK051212012345678906",
+                                             "DE89370400440532013000", "DE89370400440532013001", "ZZ12 1234 5678 90",
+                                             "ZZAB1234567890", "XKAB1212012345678906", "YYAB1234567890"};
+    std::vector<const char*> pointers;
+    std::vector<uint8_t> lengths;
+    for (const auto& input : inputs) {
+        pointers.push_back(input.data());
+        lengths.push_back(static_cast<uint8_t>(input.size()));
+    }
+    for (auto kernel : {IBAN::BatchKernel::Scalar, IBAN::BatchKernel::SSE42, IBAN::BatchKernel::AVX2}) {
+        std::vector<uint8_t> results(inputs.size());
+        IBAN::validateBatch(pointers.data(), lengths.data(), inputs.size(), results.data(), kernel);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            REQUIRE(results[i] == static_cast<uint8_t>(IBAN::IBAN::tryParse(inputs[i])));
+        }
+    }
+    // columns validate against the table as well, whenever their rows were appended
+    IBAN::IBANColumn column;
+    IBAN::setCountryTable(nullptr);
+    for (const auto& input : inputs) {
+        column.append(input);
+    }
+    IBAN::loadCountryTable(path);
+    for (const auto& input : inputs) {
+        column.append(input);
+    }
+    std::vector<uint8_t> columnResults(column.size());
+    column.validate(columnResults.data());
+    for (size_t i = 0; i < column.size(); ++i) {
+        REQUIRE(columnResults[i] == static_cast<uint8_t>(IBAN::IBAN::tryParse(inputs[i % inputs.size()])));
+    }
+
+    // national check digits are verified for compiled-in formats only
+    IBAN::CountryTableBuilder reformatted;
+    reformatted.addCompiledIn();
+    reformatted.add("BE", "13!n", today - 1);
+    IBAN::setCountryTable(IBAN::CountryTable::fromBuffer(reformatted.build()));
+    REQUIRE_FALSE(IBAN::hasCompiledInFormat('B', 'E'));
+    REQUIRE(IBAN::hasCompiledInFormat('D', 'E'));
+    const std::vector<std::string> belgian = {"BE705390075470341", "BE68539007547034", "BE68539007547035"};
+    const char* belgianPointers[] = {belgian[0].data(), belgian[1].data(), belgian[2].data()};
+    const uint8_t belgianLengths[] = {17, 16, 16};
+    std::vector<uint8_t> belgianResults(belgian.size());
+    IBAN::validateBatch(belgianPointers, belgianLengths, belgian.size(), belgianResults.data(),
+                        IBAN::BatchKernel::Scalar, true);
+    REQUIRE(belgianResults[0] == static_cast<uint8_t>(ParseStatus::OK));
+    REQUIRE(belgianResults[1] == static_cast<uint8_t>(ParseStatus::InvalidLength));
+    REQUIRE(IBAN::IBAN::createFromString(belgian[0]).validateNational());
+    REQUIRE(IBAN::CompactIBAN(IBAN::IBAN::createFromString(belgian[0])).validateNational());
+    IBAN::setCountryTable(nullptr);
+    REQUIRE(IBAN::hasCompiledInFormat('B', 'E'));
+    IBAN::validateBatch(belgianPointers, belgianLengths, belgian.size(), belgianResults.data(),
+                        IBAN::BatchKernel::Scalar, true);
+    REQUIRE(belgianResults[0] == static_cast<uint8_t>(ParseStatus::InvalidLength));
+    REQUIRE(belgianResults[1] == static_cast<uint8_t>(ParseStatus::OK));
+    REQUIRE(belgianResults[2] == static_cast<uint8_t>(ParseStatus::ChecksumMismatch));
+
+    // readers keep validating while the table is replaced
+    const std::vector<char> snapshot = builder.build();
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                const ParseStatus zz = IBAN::IBAN::tryParse("ZZ121234567890");
+                if (IBAN::IBAN::tryParse("DE89370400440532013000") != ParseStatus::OK ||
+                    (zz != ParseStatus::OK && zz != ParseStatus::InvalidCountryCode)) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 100; ++i) {
+        IBAN::setCountryTable(i % 2 ? IBAN::CountryTable::fromBuffer(snapshot) : nullptr);
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    REQUIRE(failures.load() == 0);
+
+    IBAN::loadCountryTable(path);
+    REQUIRE(IBAN::IBAN::tryParse("ZZ121234567890") == ParseStatus::OK);
+    requireMalformedRejected<IBAN::CountryTable>(snapshot, "libiban_test_countries_malformed.bin");
+    std::vector<char> malformed = snapshot;
+    std::swap_ranges(malformed.begin() + 16, malformed.begin() + 64, malformed.begin() + 64);
+    REQUIRE_THROWS_AS(IBAN::CountryTable::fromBuffer(malformed), const std::runtime_error&);
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(IBAN::loadCountryTable(path), const std::system_error&);
+    REQUIRE(IBAN::hasCountryTable());
+
+    IBAN::setCountryTable(nullptr);
+    REQUIRE_FALSE(IBAN::hasCountryTable());
+    REQUIRE(kosovo.isValidated());
+    REQUIRE(kosovo.validate());
+    REQUIRE(IBAN::IBAN::tryParse("ZZ121234567890") == ParseStatus::InvalidCountryCode);
 }
 
 TEST_CASE("generateIBAN", "[libiban]") {
@@ -328,6 +2293,11 @@ TEST_CASE("generateIBAN", "[libiban]") {
     REQUIRE(iban3.validate());
     REQUIRE(iban3.getCountryCode() == "FO");
 
+    // every country generates IBANs matching its structure
+    for (const auto& country : IBAN::IBAN::m_countryCodes) {
+        REQUIRE(IBAN::IBAN::generateIBAN(country.first).validate());
+    }
+
     try {
         auto iban4 = IBAN::IBAN::generateIBAN("XX");
     } catch (const IBAN::IBANInvalidCountryCodeException& ex) {